@@ -1,17 +1,21 @@
 #include "PCH.h"
 #include "Application.h"
+#include "RenderStats.h"
 
 using std::tr1::bind;
 using std::tr1::mem_fn;
 using namespace std::tr1::placeholders;
 
 Application::Application(const WCHAR* title, const WCHAR* icon)
-    : _window(NULL, title, icon, 1360, 768)
+    : _window(NULL, title, icon, 1360, 768), _pipelined(false), _headless(false), _fixedTimeStep(0.0f), _simulationTime(0.0),
+      _pendingSimulationTime(0.0f), _stepStartTime(0.0), _stepDelta(0.0f), _stepCount(0), _simulationDuration(0.0f),
+      _simulationThread(NULL), _simulateEvent(NULL), _simulatedEvent(NULL), _exiting(false)
 {
 }
 
 Application::~Application()
 {
+    stopSimulationThread();
 }
 
 LRESULT Application::OnMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -57,6 +61,144 @@ void Application::OnInitialize()
 {
 }
 
+void Application::OnFrameSimulate(double totalTime, float dt)
+{
+}
+
+void Application::OnFrameSnapshot()
+{
+}
+
+HRESULT Application::startSimulationThread()
+{
+    _exiting = false;
+    _simulateEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    _simulatedEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!_simulateEvent || !_simulatedEvent)
+    {
+        return E_FAIL;
+    }
+
+    _simulationThread = CreateThread(NULL, 0, simulationMain, this, 0, NULL);
+    if (!_simulationThread)
+    {
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+void Application::stopSimulationThread()
+{
+    // The thread is only ever stopped while it is waiting for a frame
+    if (_simulationThread)
+    {
+        _exiting = true;
+        SetEvent(_simulateEvent);
+
+        WaitForSingleObject(_simulationThread, INFINITE);
+        CloseHandle(_simulationThread);
+        _simulationThread = NULL;
+    }
+
+    if (_simulateEvent)
+    {
+        CloseHandle(_simulateEvent);
+        _simulateEvent = NULL;
+    }
+    if (_simulatedEvent)
+    {
+        CloseHandle(_simulatedEvent);
+        _simulatedEvent = NULL;
+    }
+}
+
+DWORD WINAPI Application::simulationMain(LPVOID param)
+{
+    Application* app = (Application*)param;
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+
+    Logger::GetInstance()->SetThreadName(L"Simulation");
+
+    while (true)
+    {
+        WaitForSingleObject(app->_simulateEvent, INFINITE);
+        if (app->_exiting)
+        {
+            break;
+        }
+
+        // The simulation's events go into this thread's lane, its time is also added to the main
+        // thread's tree once it is done so that the frame can be read from one lane
+        LARGE_INTEGER start, stop;
+        QueryPerformanceCounter(&start);
+        BEGIN_EVENT(L"Simulate");
+        app->simulate();
+        END_EVENT(L"");
+        QueryPerformanceCounter(&stop);
+        app->_simulationDuration = (float)((double)(stop.QuadPart - start.QuadPart) / freq.QuadPart);
+
+        SetEvent(app->_simulatedEvent);
+    }
+
+    return 0;
+}
+
+void Application::prepareSimulationSteps(double totalTime, float dt)
+{
+    if (_fixedTimeStep <= 0.0f)
+    {
+        _stepStartTime = totalTime - dt;
+        _stepDelta = dt;
+        _stepCount = 1;
+
+        _simulationTime = totalTime;
+        _pendingSimulationTime = 0.0f;
+        return;
+    }
+
+    // Time that did not make up a whole step is carried over to the next frame, anything past
+    // the most steps a frame can take is dropped so that one long frame does not make the next
+    // one longer still
+    _pendingSimulationTime += dt;
+    _stepCount = min((UINT)(_pendingSimulationTime / _fixedTimeStep), MAX_SIMULATION_STEPS);
+    _pendingSimulationTime = min(_pendingSimulationTime - (_stepCount * _fixedTimeStep), _fixedTimeStep);
+
+    _stepStartTime = _simulationTime;
+    _stepDelta = _fixedTimeStep;
+
+    _simulationTime += _stepCount * _fixedTimeStep;
+}
+
+void Application::simulate()
+{
+    for (UINT i = 0; i < _stepCount; i++)
+    {
+        OnFrameSimulate(_stepStartTime + ((i + 1) * (double)_stepDelta), _stepDelta);
+    }
+}
+
+HRESULT Application::renderFrame()
+{
+    HRESULT hr;
+
+    BEGIN_EVENT(L"Render");
+    hr = OnD3D11FrameRender(_deviceManager.GetDevice(), _deviceManager.GetImmediateContext());
+    END_EVENT(L"");
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    BEGIN_EVENT(L"Present");
+    hr = _deviceManager.Present();
+    END_EVENT(L"");
+
+    return hr;
+}
+
 Window* Application::GetWindow()
 {
     return &_window;
@@ -88,13 +230,21 @@ HRESULT Application::Start()
     _window.SetClientSize(_deviceManager.GetBackBufferWidth(), _deviceManager.GetBackBufferHeight());
 
     // Window prepared, show it
-    _window.Show();
+    if (!_headless)
+    {
+        _window.Show();
+    }
 
     // Call the IHasContent methods
     V_RETURN(OnD3D11CreateDevice(_deviceManager.GetDevice(), &_contentManager, _deviceManager.GetBackBufferSurfaceDesc()));
     V_RETURN(OnD3D11ResizedSwapChain(_deviceManager.GetDevice(), &_contentManager, _deviceManager.GetSwapChain(),
         _deviceManager.GetBackBufferSurfaceDesc()));
 
+    V_RETURN(startSimulationThread());
+
+    // A pipelined first frame renders the scene as it was before anything was simulated
+    OnFrameSnapshot();
+
     // Prepare the counters to use for timing
     LARGE_INTEGER largeInt;
     if (!QueryPerformanceCounter(&largeInt))
@@ -116,6 +266,15 @@ HRESULT Application::Start()
     {
         BEGIN_EVENT(L"Main loop");
 
+        // Messages logged since the last frame, on any thread, are handed to the readers here
+        BEGIN_EVENT(L"Flush log");
+        Logger::GetInstance()->FlushMessages();
+        END_EVENT(L"");
+
+        // Everything the last frame drew has been counted by now, its counts are what the frame
+        // move and the panes see
+        RenderStats::GetInstance()->EndFrame();
+
         // Calculate times even if the window is minimized so that there is not a giant time delta
         // in the next update
         if (!QueryPerformanceCounter(&largeInt))
@@ -124,7 +283,7 @@ HRESULT Application::Start()
         }
         INT64 curTime = largeInt.QuadPart - startTime;
 
-        if (_window.IsActive())
+        if (_window.IsActive() || _headless)
         {
             float deltaSeconds = (float)((curTime - prevTime) / (double)counterFreq);
             double totalSeconds = (curTime - inactiveTime) / (double)counterFreq;
@@ -133,13 +292,38 @@ HRESULT Application::Start()
             OnFrameMove(totalSeconds, deltaSeconds);
             END_EVENT(L"");
 
-            BEGIN_EVENT(L"Render");
-            V_RETURN(OnD3D11FrameRender(_deviceManager.GetDevice(), _deviceManager.GetImmediateContext()));
-            END_EVENT(L"");
+            prepareSimulationSteps(totalSeconds, deltaSeconds);
 
-            BEGIN_EVENT(L"Present");
-            V_RETURN(_deviceManager.Present());
-            END_EVENT(L"");
+            if (_pipelined)
+            {
+                // Simulate this frame while the snapshot of the last one is rendered
+                SetEvent(_simulateEvent);
+
+                HRESULT renderResult = renderFrame();
+
+                BEGIN_EVENT(L"Wait for simulation");
+                WaitForSingleObject(_simulatedEvent, INFINITE);
+                END_EVENT(L"");
+                ADD_EVENT(L"Simulate", _simulationDuration);
+
+                V_RETURN(renderResult);
+
+                BEGIN_EVENT(L"Snapshot");
+                OnFrameSnapshot();
+                END_EVENT(L"");
+            }
+            else
+            {
+                BEGIN_EVENT(L"Simulate");
+                simulate();
+                END_EVENT(L"");
+
+                BEGIN_EVENT(L"Snapshot");
+                OnFrameSnapshot();
+                END_EVENT(L"");
+
+                V_RETURN(renderFrame());
+            }
         }
         else
         {
@@ -155,6 +339,8 @@ HRESULT Application::Start()
     }
 
     // Clean up
+    stopSimulationThread();
+
     OnD3D11ReleasingSwapChain(&_contentManager);
     OnD3D11DestroyDevice(&_contentManager);
 
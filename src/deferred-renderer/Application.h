@@ -8,6 +8,10 @@
 #include "Logger.h"
 #include "ContentManager.h"
 
+// Runs the frame loop. Every frame is moved, simulated, snapshotted and then rendered. When
+// pipelined the simulation of a frame runs on its own thread while the snapshot of the frame
+// before it is rendered, so the snapshot must hold everything rendering reads that the
+// simulation writes.
 class Application : public IUpdateable, public IHasContent
 {
 private:
@@ -15,11 +19,50 @@ private:
     DeviceManager _deviceManager;
     ContentManager _contentManager;
 
+    bool _pipelined;
+
+    // A headless application never shows its window and renders whether or not it is active
+    bool _headless;
+
+    // A fixed timestep of zero simulates once a frame with the frame's time delta
+    float _fixedTimeStep;
+    double _simulationTime;
+    float _pendingSimulationTime;
+
+    static const UINT MAX_SIMULATION_STEPS = 8;
+
+    // The steps the next simulation takes, only written while the simulation is not running
+    double _stepStartTime;
+    float _stepDelta;
+    UINT _stepCount;
+    float _simulationDuration;
+
+    HANDLE _simulationThread;
+    HANDLE _simulateEvent;
+    HANDLE _simulatedEvent;
+    volatile bool _exiting;
+
+    void prepareSimulationSteps(double totalTime, float dt);
+    void simulate();
+    HRESULT renderFrame();
+
+    HRESULT startSimulationThread();
+    void stopSimulationThread();
+    static DWORD WINAPI simulationMain(LPVOID param);
+
 protected:
     virtual void OnPreparingContentManager(ContentManager* contentManager);
     virtual void OnPreparingDeviceSettings(DeviceManager* deviceManager);
     virtual void OnInitialize();
 
+    // Called once for every step the simulation takes, which is on the simulation thread when
+    // pipelined. With a fixed timestep a frame can take any number of steps, including none.
+    virtual void OnFrameSimulate(double totalTime, float dt);
+
+    // Called on the main thread once the frame's simulation is done and before it is rendered,
+    // nothing else is running so this is where the state to render is copied out
+    virtual void OnFrameSnapshot();
+
     Window* GetWindow();
     DeviceManager* GetDeviceManager();
 
@@ -38,6 +81,17 @@ public:
 
     bool IsActive() const;
 
+    // Must be set before Start
+    bool GetHeadless() const { return _headless; }
+    void SetHeadless(bool headless) { _headless = headless; }
+
+    // Can be changed from OnFrameMove, it takes effect from the next frame
+    bool GetPipelined() const { return _pipelined; }
+    void SetPipelined(bool pipelined) { _pipelined = pipelined; }
+
+    float GetFixedTimeStep() const { return _fixedTimeStep; }
+    void SetFixedTimeStep(float step) { _fixedTimeStep = max(step, 0.0f); }
+
     HWND GetHWND() const;
 
     UINT GetWidth() const;
@@ -0,0 +1,194 @@
+#include "PCH.h"
+#include "Benchmark.h"
+
+Benchmark::Benchmark()
+    : _frameCount(0), _frameBegun(false)
+{
+}
+
+void Benchmark::Clear()
+{
+    _series.clear();
+    _seriesIndices.clear();
+    _frameCount = 0;
+    _frameBegun = false;
+}
+
+Benchmark::SERIES_INFO* Benchmark::getSeries(const std::wstring& name)
+{
+    std::map<std::wstring, UINT>::iterator it = _seriesIndices.find(name);
+    if (it != _seriesIndices.end())
+    {
+        return &_series[it->second];
+    }
+
+    SERIES_INFO series;
+    series.Name = name;
+    series.FrameTotal = 0.0f;
+    series.InFrame = false;
+
+    _seriesIndices[name] = _series.size();
+    _series.push_back(series);
+
+    return &_series.back();
+}
+
+void Benchmark::BeginFrame()
+{
+    _frameBegun = true;
+}
+
+void Benchmark::EndFrame()
+{
+    if (!_frameBegun)
+    {
+        return;
+    }
+
+    // Series that were not recorded this frame are left a sample short rather than given a zero
+    for (UINT i = 0; i < _series.size(); i++)
+    {
+        SERIES_INFO& series = _series[i];
+        if (series.InFrame)
+        {
+            series.Values.push_back(series.FrameTotal);
+            series.FrameTotal = 0.0f;
+            series.InFrame = false;
+        }
+    }
+
+    _frameCount++;
+    _frameBegun = false;
+}
+
+void Benchmark::recordEvents(Logger::EventIterator it, const std::wstring& parentPath)
+{
+    for (; it.IsValid(); it = it.GetNextSibling())
+    {
+        std::wstring path = parentPath.empty() ? it.GetName() : parentPath + L"/" + it.GetName();
+
+        SERIES_INFO* series = getSeries(path);
+        series->FrameTotal += it.GetDuration() * 1000.0f;
+        series->InFrame = true;
+
+        if (it.HasChildren())
+        {
+            recordEvents(it.GetFirstChild(), path);
+        }
+    }
+}
+
+void Benchmark::RecordEvents(Logger::EventIterator root, const std::wstring& prefix)
+{
+    if (_frameBegun)
+    {
+        recordEvents(root, prefix);
+    }
+}
+
+void Benchmark::RecordValue(const std::wstring& name, float value)
+{
+    if (_frameBegun)
+    {
+        SERIES_INFO* series = getSeries(name);
+        series->FrameTotal += value;
+        series->InFrame = true;
+    }
+}
+
+void Benchmark::summarize(const std::vector<float>& values, SUMMARY_INFO* summary)
+{
+    ZeroMemory(summary, sizeof(SUMMARY_INFO));
+
+    summary->Samples = values.size();
+    if (values.size() == 0)
+    {
+        return;
+    }
+
+    std::vector<float> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0.0;
+    for (UINT i = 0; i < sorted.size(); i++)
+    {
+        total += sorted[i];
+    }
+
+    // Nearest rank percentiles
+    UINT count = sorted.size();
+    summary->Min = sorted.front();
+    summary->Mean = (float)(total / count);
+    summary->P95 = sorted[min((UINT)ceil(count * 0.95) - 1, count - 1)];
+    summary->P99 = sorted[min((UINT)ceil(count * 0.99) - 1, count - 1)];
+    summary->Max = sorted.back();
+}
+
+HRESULT Benchmark::WriteCSV(const WCHAR* path) const
+{
+    std::ofstream file;
+    file.open(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    file << "name,samples,min,mean,p95,p99,max" << std::endl;
+    for (UINT i = 0; i < _series.size(); i++)
+    {
+        SUMMARY_INFO summary;
+        summarize(_series[i].Values, &summary);
+
+        // Event names may hold commas, quote them all
+        std::string name = WStringToUTF8(_series[i].Name);
+        for (UINT j = 0; j < name.size(); j++)
+        {
+            if (name[j] == '"')
+            {
+                name.insert(j++, 1, '"');
+            }
+        }
+
+        file << "\"" << name << "\"," << summary.Samples << "," << summary.Min << "," << summary.Mean << "," <<
+            summary.P95 << "," << summary.P99 << "," << summary.Max << std::endl;
+    }
+
+    return file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT Benchmark::WriteJSON(const WCHAR* path) const
+{
+    std::ofstream file;
+    file.open(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    file << "{" << std::endl;
+    file << "  \"frames\": " << _frameCount << "," << std::endl;
+    file << "  \"series\": [" << std::endl;
+    for (UINT i = 0; i < _series.size(); i++)
+    {
+        SUMMARY_INFO summary;
+        summarize(_series[i].Values, &summary);
+
+        std::string name = WStringToUTF8(_series[i].Name);
+        for (UINT j = 0; j < name.size(); j++)
+        {
+            if (name[j] == '"' || name[j] == '\\')
+            {
+                name.insert(j++, 1, '\\');
+            }
+        }
+
+        file << "    { \"name\": \"" << name << "\", \"samples\": " << summary.Samples << ", \"min\": " <<
+            summary.Min << ", \"mean\": " << summary.Mean << ", \"p95\": " << summary.P95 << ", \"p99\": " <<
+            summary.P99 << ", \"max\": " << summary.Max << " }" << ((i + 1 < _series.size()) ? "," : "") <<
+            std::endl;
+    }
+    file << "  ]" << std::endl;
+    file << "}" << std::endl;
+
+    return file.good() ? S_OK : E_FAIL;
+}
\ No newline at end of file
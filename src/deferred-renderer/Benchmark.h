@@ -0,0 +1,61 @@
+#pragma once
+
+#include "PCH.h"
+#include "Logger.h"
+
+// Collects a value per frame for every named series, the CPU time of each event in the logger's
+// tree and any counters the application records, and writes the min, mean, 95th and 99th
+// percentiles and max of every series to CSV or JSON. Events are named by their path from the
+// root event and an event that appears more than once in a frame is summed.
+class Benchmark
+{
+private:
+    struct SERIES_INFO
+    {
+        std::wstring Name;
+        std::vector<float> Values;
+
+        // Events with the same path in one frame are summed here before being added as a value
+        float FrameTotal;
+        bool InFrame;
+    };
+    std::vector<SERIES_INFO> _series;
+    std::map<std::wstring, UINT> _seriesIndices;
+
+    UINT _frameCount;
+    bool _frameBegun;
+
+    struct SUMMARY_INFO
+    {
+        UINT Samples;
+        float Min;
+        float Mean;
+        float P95;
+        float P99;
+        float Max;
+    };
+    static void summarize(const std::vector<float>& values, SUMMARY_INFO* summary);
+
+    SERIES_INFO* getSeries(const std::wstring& name);
+    void recordEvents(Logger::EventIterator it, const std::wstring& parentPath);
+
+public:
+    Benchmark();
+
+    void Clear();
+
+    // Values recorded between these calls belong to one frame
+    void BeginFrame();
+    void EndFrame();
+
+    // Records the duration of every event in the tree, in milliseconds. The paths of the events
+    // start with the prefix when one is given
+    void RecordEvents(Logger::EventIterator root, const std::wstring& prefix = L"");
+    void RecordValue(const std::wstring& name, float value);
+
+    UINT GetFrameCount() const { return _frameCount; }
+    UINT GetSeriesCount() const { return _series.size(); }
+
+    HRESULT WriteCSV(const WCHAR* path) const;
+    HRESULT WriteJSON(const WCHAR* path) const;
+};
\ No newline at end of file
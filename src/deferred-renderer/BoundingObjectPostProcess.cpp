@@ -2,7 +2,7 @@
 #include "BoundingObjectPostProcess.h"
 BoundingObjectPostProcess::BoundingObjectPostProcess()
     : _boxVB(NULL), _boxIB(NULL), _sphereVB(NULL), _vertexShader(NULL),
-    _pixelShader(NULL), _wvpConstantBuffer(NULL), _colorConstantBuffer(NULL), _frustVB(NULL)
+    _pixelShader(NULL), _colorConstantBuffer(NULL), _frustVB(NULL)
 {
     SetIsAdditive(true);
     SetColor(XMFLOAT4(1.0f, 0.0f, 1.0f, 1.0f));
@@ -49,6 +49,8 @@ HRESULT BoundingObjectPostProcess::Render(ID3D11DeviceContext* pd3dImmediateCont
 
     HRESULT hr;
 
+    _constantBuffers.Reset();
+
     pd3dImmediateContext->OMSetRenderTargets(1, &dstRTV, gBuffer->GetReadOnlyDepthDSV());
 
     D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -92,12 +94,13 @@ HRESULT BoundingObjectPostProcess::Render(ID3D11DeviceContext* pd3dImmediateCont
         XMMATRIX world = XMMatrixMultiply(scale, trans);
         XMMATRIX wvp = XMMatrixMultiply(world, viewProj);
 
-        V_RETURN(pd3dImmediateContext->Map(_wvpConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        CB_BOUNDING_OBJECT_PROPERTIES* properties = (CB_BOUNDING_OBJECT_PROPERTIES*)mappedResource.pData;
-        XMStoreFloat4x4(&properties->WorldViewProjection, XMMatrixTranspose(wvp));
-        pd3dImmediateContext->Unmap(_wvpConstantBuffer, 0);
+        CB_BOUNDING_OBJECT_PROPERTIES properties;
+        XMStoreFloat4x4(&properties.WorldViewProjection, XMMatrixTranspose(wvp));
+
+        ID3D11Buffer* wvpConstantBuffer;
+        V_RETURN(_constantBuffers.Upload(pd3dImmediateContext, properties, &wvpConstantBuffer));
 
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &_wvpConstantBuffer);
+        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &wvpConstantBuffer);
 
         pd3dImmediateContext->DrawIndexed(24, 0, 0);
     }
@@ -119,12 +122,13 @@ HRESULT BoundingObjectPostProcess::Render(ID3D11DeviceContext* pd3dImmediateCont
 
         XMMATRIX wvp = XMMatrixMultiply(world, viewProj);
 
-        V_RETURN(pd3dImmediateContext->Map(_wvpConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        CB_BOUNDING_OBJECT_PROPERTIES* properties = (CB_BOUNDING_OBJECT_PROPERTIES*)mappedResource.pData;
-        XMStoreFloat4x4(&properties->WorldViewProjection, XMMatrixTranspose(wvp));
-        pd3dImmediateContext->Unmap(_wvpConstantBuffer, 0);
+        CB_BOUNDING_OBJECT_PROPERTIES properties;
+        XMStoreFloat4x4(&properties.WorldViewProjection, XMMatrixTranspose(wvp));
+
+        ID3D11Buffer* wvpConstantBuffer;
+        V_RETURN(_constantBuffers.Upload(pd3dImmediateContext, properties, &wvpConstantBuffer));
 
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &_wvpConstantBuffer);
+        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &wvpConstantBuffer);
 
         pd3dImmediateContext->DrawIndexed(24, 0, 0);
     }
@@ -147,12 +151,13 @@ HRESULT BoundingObjectPostProcess::Render(ID3D11DeviceContext* pd3dImmediateCont
         XMMATRIX world = XMMatrixMultiply(rot, translate);
         XMMATRIX wvp = XMMatrixMultiply(world, viewProj);
 
-        V_RETURN(pd3dImmediateContext->Map(_wvpConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        CB_BOUNDING_OBJECT_PROPERTIES* properties = (CB_BOUNDING_OBJECT_PROPERTIES*)mappedResource.pData;
-        XMStoreFloat4x4(&properties->WorldViewProjection, XMMatrixTranspose(wvp));
-        pd3dImmediateContext->Unmap(_wvpConstantBuffer, 0);
+        CB_BOUNDING_OBJECT_PROPERTIES properties;
+        XMStoreFloat4x4(&properties.WorldViewProjection, XMMatrixTranspose(wvp));
 
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &_wvpConstantBuffer);
+        ID3D11Buffer* wvpConstantBuffer;
+        V_RETURN(_constantBuffers.Upload(pd3dImmediateContext, properties, &wvpConstantBuffer));
+
+        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &wvpConstantBuffer);
 
         // Map the vertices
         V_RETURN(pd3dImmediateContext->Map(_frustVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
@@ -194,12 +199,13 @@ HRESULT BoundingObjectPostProcess::Render(ID3D11DeviceContext* pd3dImmediateCont
         XMMATRIX world = XMMatrixMultiply(scale, trans);
         XMMATRIX wvp = XMMatrixMultiply(world, viewProj);
 
-        V_RETURN(pd3dImmediateContext->Map(_wvpConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        CB_BOUNDING_OBJECT_PROPERTIES* properties = (CB_BOUNDING_OBJECT_PROPERTIES*)mappedResource.pData;
-        XMStoreFloat4x4(&properties->WorldViewProjection, XMMatrixTranspose(wvp));
-        pd3dImmediateContext->Unmap(_wvpConstantBuffer, 0);
+        CB_BOUNDING_OBJECT_PROPERTIES properties;
+        XMStoreFloat4x4(&properties.WorldViewProjection, XMMatrixTranspose(wvp));
+
+        ID3D11Buffer* wvpConstantBuffer;
+        V_RETURN(_constantBuffers.Upload(pd3dImmediateContext, properties, &wvpConstantBuffer));
 
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &_wvpConstantBuffer);
+        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &wvpConstantBuffer);
 
         pd3dImmediateContext->Draw(SPHERE_POINT_COUNT, 0);
     }
@@ -291,9 +297,6 @@ HRESULT BoundingObjectPostProcess::OnD3D11CreateDevice(ID3D11Device* pd3dDevice,
         0, //UINT StructureByteStride;
     };
 
-    cbDesc.ByteWidth = sizeof(CB_BOUNDING_OBJECT_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&cbDesc, NULL, &_wvpConstantBuffer));
-
     cbDesc.ByteWidth = sizeof(CB_BOUNDING_OBJECT_COLOR);
     V_RETURN(pd3dDevice->CreateBuffer(&cbDesc, NULL, &_colorConstantBuffer));
 
@@ -390,7 +393,7 @@ void BoundingObjectPostProcess::OnD3D11DestroyDevice(ContentManager* pContentMan
     SAFE_RELEASE(_boxVB);
     SAFE_RELEASE(_frustVB);
     SAFE_RELEASE(_sphereVB);
-    SAFE_RELEASE(_wvpConstantBuffer);
+    _constantBuffers.OnD3D11DestroyDevice();
     SAFE_RELEASE(_colorConstantBuffer);
 }
 
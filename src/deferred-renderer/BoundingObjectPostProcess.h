@@ -7,6 +7,7 @@
 #include "xnaCollision.h"
 #include "PixelShaderLoader.h"
 #include "VertexShaderLoader.h"
+#include "ConstantBufferAllocator.h"
 
 class BoundingObjectPostProcess : public PostProcess
 {
@@ -38,7 +39,8 @@ private:
     VertexShaderContent* _vertexShader;
     PixelShaderContent* _pixelShader;
 
-    ID3D11Buffer* _wvpConstantBuffer;
+    // Each object gets a buffer of its own for its world view projection
+    ConstantBufferAllocator _constantBuffers;
     ID3D11Buffer* _colorConstantBuffer;
 
     XMFLOAT4 _boColor;
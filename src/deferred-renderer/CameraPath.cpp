@@ -0,0 +1,161 @@
+#include "PCH.h"
+#include "CameraPath.h"
+
+CameraPath::CameraPath()
+{
+}
+
+static float unwrapAngle(float angle, float previous)
+{
+    while (angle - previous > Pi)
+    {
+        angle -= 2.0f * Pi;
+    }
+    while (angle - previous < -Pi)
+    {
+        angle += 2.0f * Pi;
+    }
+    return angle;
+}
+
+void CameraPath::AddKey(float time, const XMFLOAT3& position, const XMFLOAT2& rotation, float roll)
+{
+    KEY_INFO key;
+    key.Time = time;
+    key.Position = position;
+    key.Rotation = XMFLOAT3(rotation.x, rotation.y, roll);
+
+    if (_keys.size() > 0)
+    {
+        const XMFLOAT3& prevRotation = _keys.back().Rotation;
+        key.Rotation.x = unwrapAngle(key.Rotation.x, prevRotation.x);
+        key.Rotation.z = unwrapAngle(key.Rotation.z, prevRotation.z);
+    }
+
+    _keys.push_back(key);
+}
+
+void CameraPath::AddKey(float time, const FirstPersonCamera* camera)
+{
+    AddKey(time, camera->GetPosition(), camera->GetRotation(), camera->GetRoll());
+}
+
+void CameraPath::Clear()
+{
+    _keys.clear();
+}
+
+float CameraPath::GetDuration() const
+{
+    return (_keys.size() > 0) ? _keys.back().Time : 0.0f;
+}
+
+void CameraPath::Evaluate(float time, XMFLOAT3* position, XMFLOAT2* rotation, float* roll) const
+{
+    if (_keys.size() == 0)
+    {
+        *position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        *rotation = XMFLOAT2(0.0f, 0.0f);
+        *roll = 0.0f;
+        return;
+    }
+
+    // Find the segment the time falls in, the path holds still before the first key and after
+    // the last one
+    UINT next = 0;
+    while (next < _keys.size() && _keys[next].Time <= time)
+    {
+        next++;
+    }
+    UINT prev = (next > 0) ? next - 1 : 0;
+    next = min(next, _keys.size() - 1);
+
+    float span = _keys[next].Time - _keys[prev].Time;
+    float t = (span > 0.0f) ? saturate((time - _keys[prev].Time) / span) : 0.0f;
+
+    // The ends are repeated so the spline still passes through the first and last keys
+    const KEY_INFO& k0 = _keys[(prev > 0) ? prev - 1 : prev];
+    const KEY_INFO& k1 = _keys[prev];
+    const KEY_INFO& k2 = _keys[next];
+    const KEY_INFO& k3 = _keys[min(next + 1, _keys.size() - 1)];
+
+    XMVECTOR pos = XMVectorCatmullRom(XMLoadFloat3(&k0.Position), XMLoadFloat3(&k1.Position),
+        XMLoadFloat3(&k2.Position), XMLoadFloat3(&k3.Position), t);
+    XMVECTOR rot = XMVectorCatmullRom(XMLoadFloat3(&k0.Rotation), XMLoadFloat3(&k1.Rotation),
+        XMLoadFloat3(&k2.Rotation), XMLoadFloat3(&k3.Rotation), t);
+
+    XMFLOAT3 fRot;
+    XMStoreFloat3(position, pos);
+    XMStoreFloat3(&fRot, rot);
+
+    *rotation = XMFLOAT2(fRot.x, fRot.y);
+    *roll = fRot.z;
+}
+
+void CameraPath::Apply(float time, FirstPersonCamera* camera) const
+{
+    XMFLOAT3 position;
+    XMFLOAT2 rotation;
+    float roll;
+    Evaluate(time, &position, &rotation, &roll);
+
+    camera->SetPosition(position);
+    camera->SetRotation(rotation, roll);
+}
+
+HRESULT CameraPath::Load(const WCHAR* path)
+{
+    std::ifstream file;
+    file.open(path, std::ios::in);
+    if (!file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    _keys.clear();
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        float time;
+        XMFLOAT3 position;
+        XMFLOAT2 rotation;
+        float roll;
+
+        std::istringstream lineStream(line);
+        if (!(lineStream >> time >> position.x >> position.y >> position.z >> rotation.x >> rotation.y >> roll))
+        {
+            _keys.clear();
+            return E_FAIL;
+        }
+
+        AddKey(time, position, rotation, roll);
+    }
+
+    return (_keys.size() > 0) ? S_OK : E_FAIL;
+}
+
+HRESULT CameraPath::Save(const WCHAR* path) const
+{
+    std::ofstream file;
+    file.open(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    file << "# time x y z yaw pitch roll" << std::endl;
+    for (UINT i = 0; i < _keys.size(); i++)
+    {
+        const KEY_INFO& key = _keys[i];
+        file << key.Time << " " << key.Position.x << " " << key.Position.y << " " << key.Position.z << " " <<
+            key.Rotation.x << " " << key.Rotation.y << " " << key.Rotation.z << std::endl;
+    }
+
+    return file.good() ? S_OK : E_FAIL;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "PCH.h"
+#include "FirstPersonCamera.h"
+
+// A path for a first person camera to follow, made of timed keys that are joined by a Catmull-Rom
+// spline so that the camera moves and turns smoothly through every key. Paths are stored as text
+// files with one key per line, "time x y z yaw pitch roll", and lines starting with # are skipped.
+class CameraPath
+{
+private:
+    struct KEY_INFO
+    {
+        float Time;
+        XMFLOAT3 Position;
+
+        // Yaw, pitch and roll, the angles are unwrapped so that the camera always takes the short
+        // way around between keys
+        XMFLOAT3 Rotation;
+    };
+    std::vector<KEY_INFO> _keys;
+
+public:
+    CameraPath();
+
+    // Keys must be added in time order
+    void AddKey(float time, const XMFLOAT3& position, const XMFLOAT2& rotation, float roll);
+    void Clear();
+
+    UINT GetKeyCount() const { return _keys.size(); }
+    float GetDuration() const;
+
+    void Evaluate(float time, XMFLOAT3* position, XMFLOAT2* rotation, float* roll) const;
+    void Apply(float time, FirstPersonCamera* camera) const;
+
+    // Adds a key at the camera's current position and rotation
+    void AddKey(float time, const FirstPersonCamera* camera);
+
+    HRESULT Load(const WCHAR* path);
+    HRESULT Save(const WCHAR* path) const;
+};
\ No newline at end of file
@@ -2,15 +2,18 @@
 #include "CascadedDirectionalLightRenderer.h"
 #include "Logger.h"
 #include "ModelInstanceSet.h"
+#include "RenderStats.h"
 
 const float CascadedDirectionalLightRenderer::CASCADE_SPLITS[NUM_CASCADES] = { 0.125f, 0.25f, 0.5f, 1.0f };
 const float CascadedDirectionalLightRenderer::BIAS = 0.005f;
 
 CascadedDirectionalLightRenderer::CascadedDirectionalLightRenderer()
     : _depthVSNoAlpha(NULL), _alphaCutoutProperties(NULL),
-    _depthVSAlpha(NULL), _depthPSAlpha(NULL), _instanceWVPVB(NULL),
-    _unshadowedPS(NULL), _shadowedPS(NULL), _cameraPropertiesBuffer(NULL), _lightPropertiesBuffer(NULL),
-    _shadowPropertiesBuffer(NULL), _unshadowedParticlePS(NULL), _shadowedParticlePS(NULL)
+    _depthVSAlpha(NULL), _depthPSAlpha(NULL),
+    _instanceStream(sizeof(XMFLOAT4X4), INITIAL_INSTANCES, MAX_BATCH_INSTANCES, "Directional light instance stream"),
+    _unshadowedPS(NULL), _shadowedPS(NULL), _cameraPropertiesBuffer(NULL),
+    _unshadowedParticlePS(NULL), _shadowedParticlePS(NULL),
+    _casterNearPlaneEnabled(false), _nearFarValidationEnabled(false)
 {
     for (int i = 0; i < NUM_SHADOW_MAPS; i++)
     {
@@ -26,15 +29,32 @@ HRESULT CascadedDirectionalLightRenderer::RenderGeometryShadowMaps(ID3D11DeviceC
     {
         BEGIN_EVENT_D3D(L"Directional Light Shadow Maps");
 
+        UINT lightCount = min(GetCount(true), NUM_SHADOW_MAPS);
+
+        // Fit the cascades of every light first so that the near and far planes of all of them
+        // can be computed in one batch
+        BEGIN_EVENT(L"Fit cascades");
+        {
+            FitCascades(camera, models, sceneBounds);
+            if (_nearFarValidationEnabled)
+            {
+                NearFarComparison comparison;
+                compareNearAndFarPlanes(lightCount, sceneBounds, &comparison);
+            }
+        }
+        END_EVENT(L"");
+
         // Save the old viewport
         D3D11_VIEWPORT vpOld[D3D11_VIEWPORT_AND_SCISSORRECT_MAX_INDEX];
         UINT nViewPorts = 1;
         pd3dImmediateContext->RSGetViewports(&nViewPorts, vpOld);
 
+        _instanceStream.Begin(pd3dImmediateContext);
+
         // Iterate over the lights and render the shadow maps
-        for (UINT i = 0; i < GetCount(true) && i < NUM_SHADOW_MAPS; i++)
+        for (UINT i = 0; i < lightCount; i++)
         {
-            renderDepth(pd3dImmediateContext, GetLight(i, true), i, models, camera, sceneBounds);
+            renderDepth(pd3dImmediateContext, i, models);
         }
 
         // Re-apply the old viewport
@@ -45,6 +65,20 @@ HRESULT CascadedDirectionalLightRenderer::RenderGeometryShadowMaps(ID3D11DeviceC
     return S_OK;
 }
 
+// These are the indices used to tesselate an AABB into a list of triangles.
+static const INT AABB_TRIANGLE_INDICES[] =
+{
+    0,1,2,  1,2,3,
+    4,5,6,  5,6,7,
+    0,2,4,  2,4,6,
+    1,3,5,  3,5,7,
+    0,1,4,  1,4,5,
+    2,3,6,  3,6,7
+};
+
+static const XMVECTORF32 g_FltMax = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+static const XMVECTORF32 g_NegFltMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
 //--------------------------------------------------------------------------------------
 // Used to compute an intersection of the orthographic projection and the Scene AABB
 //--------------------------------------------------------------------------------------
@@ -61,6 +95,7 @@ struct Triangle
 // As offsets are generally used with PCF filtering due self shadowing issues, computing the
 // correct near and far planes becomes even more important.
 // This concept is not complicated, but the intersection code is.
+// This is the scalar version of computeNearAndFarPlanes and is now only used to validate it.
 //--------------------------------------------------------------------------------------
 void CascadedDirectionalLightRenderer::ComputeNearAndFar( FLOAT& fNearPlane,
                                                          FLOAT& fFarPlane,
@@ -80,17 +115,6 @@ void CascadedDirectionalLightRenderer::ComputeNearAndFar( FLOAT& fNearPlane,
     triangleList[0].pt[2] = pvPointsInCameraView[2];
     triangleList[0].culled = false;
 
-    // These are the indices used to tesselate an AABB into a list of triangles.
-    static const INT iAABBTriIndexes[] =
-    {
-        0,1,2,  1,2,3,
-        4,5,6,  5,6,7,
-        0,2,4,  2,4,6,
-        1,3,5,  3,5,7,
-        0,1,4,  1,4,5,
-        2,3,6,  3,6,7
-    };
-
     INT iPointPassesCollision[3];
 
     // At a high level:
@@ -107,9 +131,9 @@ void CascadedDirectionalLightRenderer::ComputeNearAndFar( FLOAT& fNearPlane,
 
     for( INT AABBTriIter = 0; AABBTriIter < 12; ++AABBTriIter )
     {
-        triangleList[0].pt[0] = pvPointsInCameraView[ iAABBTriIndexes[ AABBTriIter*3 + 0 ] ];
-        triangleList[0].pt[1] = pvPointsInCameraView[ iAABBTriIndexes[ AABBTriIter*3 + 1 ] ];
-        triangleList[0].pt[2] = pvPointsInCameraView[ iAABBTriIndexes[ AABBTriIter*3 + 2 ] ];
+        triangleList[0].pt[0] = pvPointsInCameraView[ AABB_TRIANGLE_INDICES[ AABBTriIter*3 + 0 ] ];
+        triangleList[0].pt[1] = pvPointsInCameraView[ AABB_TRIANGLE_INDICES[ AABBTriIter*3 + 1 ] ];
+        triangleList[0].pt[2] = pvPointsInCameraView[ AABB_TRIANGLE_INDICES[ AABBTriIter*3 + 2 ] ];
         iTriangleCnt = 1;
         triangleList[0].culled = FALSE;
 
@@ -395,72 +419,226 @@ void CascadedDirectionalLightRenderer::CreateFrustumPointsFromCascadeInterval(fl
     pvCornerPointsWorld[7] = XMVectorSelect( vRightTopFar ,vLeftBottomFar, vGrabY );
 }
 
-HRESULT CascadedDirectionalLightRenderer::renderDepth(ID3D11DeviceContext* pd3dImmediateContext, DirectionalLight* dlight,
-                                                      UINT shadowMapIdx, std::vector<ModelInstance*>* models, Camera* camera, AxisAlignedBox* sceneBounds)
+//--------------------------------------------------------------------------------------
+// Tessellates a world space box into 12 light space triangles and appends them as three
+// triangle groups. Boxes that do not overlap the cull rectangle (min x, min y, max x, max y)
+// in light space are skipped.
+//--------------------------------------------------------------------------------------
+void CascadedDirectionalLightRenderer::addBoxTriangles(std::vector<TRIANGLE_GROUP>* groups, const AxisAlignedBox& box,
+                                                       const XMMATRIX& lightView, const XMFLOAT4* cullRect)
 {
-    HRESULT hr;
-    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    XMVECTOR vBoxPoints[8];
+    CreateAABBPoints(vBoxPoints, XMLoadFloat3(&box.Center), XMLoadFloat3(&box.Extents));
 
-    // Set up the render targets for the shadow map and clear them
-    pd3dImmediateContext->OMSetRenderTargets(0, NULL, _shadowMapDSVs[shadowMapIdx]);
-    pd3dImmediateContext->ClearDepthStencilView(_shadowMapDSVs[shadowMapIdx], D3D11_CLEAR_DEPTH, 1.0f, 0);
+    XMFLOAT3 lightSpacePoints[8];
+    XMVECTOR vLightSpaceMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR vLightSpaceMax = XMVectorReplicate(-FLT_MAX);
+    for (UINT i = 0; i < 8; i++)
+    {
+        XMVECTOR vPoint = XMVector3Transform(vBoxPoints[i], lightView);
+        vLightSpaceMin = XMVectorMin(vLightSpaceMin, vPoint);
+        vLightSpaceMax = XMVectorMax(vLightSpaceMax, vPoint);
 
-    pd3dImmediateContext->OMSetDepthStencilState(GetDepthStencilStates()->GetDepthWriteEnabled(), 0);
+        XMStoreFloat3(&lightSpacePoints[i], vPoint);
+    }
 
-    float blendFactor[4] = {1, 1, 1, 1};
-    pd3dImmediateContext->OMSetBlendState(GetBlendStates()->GetBlendDisabled(), blendFactor, 0xFFFFFFFF);
+    if (cullRect)
+    {
+        XMFLOAT3 lightSpaceMin, lightSpaceMax;
+        XMStoreFloat3(&lightSpaceMin, vLightSpaceMin);
+        XMStoreFloat3(&lightSpaceMax, vLightSpaceMax);
 
-    pd3dImmediateContext->RSSetState(GetRasterizerStates()->GetNoCull());
+        if (lightSpaceMax.x < cullRect->x || lightSpaceMin.x > cullRect->z ||
+            lightSpaceMax.y < cullRect->y || lightSpaceMin.y > cullRect->w)
+        {
+            return;
+        }
+    }
 
-    // Set alpha cutout properties, even if they arn't used
-    ID3D11SamplerState* samplers[1] = { GetSamplerStates()->GetAnisotropic16Wrap() };
-    pd3dImmediateContext->PSSetSamplers(0, 1, samplers);
+    for (UINT groupIdx = 0; groupIdx < 3; groupIdx++)
+    {
+        const INT* indices = &AABB_TRIANGLE_INDICES[groupIdx * 12];
 
-    V_RETURN(pd3dImmediateContext->Map(_alphaCutoutProperties, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-    CB_DIRECTIONALLIGHT_ALPHACUTOUT_PROPERTIES* modelProperties = (CB_DIRECTIONALLIGHT_ALPHACUTOUT_PROPERTIES*)mappedResource.pData;
-    modelProperties->AlphaThreshold = GetAlphaThreshold();
-    pd3dImmediateContext->Unmap(_alphaCutoutProperties, 0);
+        TRIANGLE_GROUP group;
+        for (UINT vertIdx = 0; vertIdx < 3; vertIdx++)
+        {
+            const XMFLOAT3& a = lightSpacePoints[indices[0 + vertIdx]];
+            const XMFLOAT3& b = lightSpacePoints[indices[3 + vertIdx]];
+            const XMFLOAT3& c = lightSpacePoints[indices[6 + vertIdx]];
+            const XMFLOAT3& d = lightSpacePoints[indices[9 + vertIdx]];
+
+            group.X[vertIdx] = XMFLOAT4(a.x, b.x, c.x, d.x);
+            group.Y[vertIdx] = XMFLOAT4(a.y, b.y, c.y, d.y);
+            group.Z[vertIdx] = XMFLOAT4(a.z, b.z, c.z, d.z);
+        }
 
-    pd3dImmediateContext->PSSetConstantBuffers(1, 1, &_alphaCutoutProperties);
+        groups->push_back(group);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Merges z into the near and far planes for every lane set in the mask.
+//--------------------------------------------------------------------------------------
+static inline void mergeClippedDepth(FXMVECTOR z, FXMVECTOR mask, XMVECTOR* nearZ, XMVECTOR* farZ)
+{
+    *nearZ = XMVectorMin(*nearZ, XMVectorSelect(g_FltMax, z, mask));
+    *farZ = XMVectorMax(*farZ, XMVectorSelect(g_NegFltMax, z, mask));
+}
+
+//--------------------------------------------------------------------------------------
+// Merges the point where an edge crosses one side of the rectangle. t is how far along the
+// edge the side's line is crossed and other is the crossing point's other coordinate, which
+// has to be between the rectangle's limits along the side.
+//--------------------------------------------------------------------------------------
+static inline void clipEdge(FXMVECTOR t, FXMVECTOR other, FXMVECTOR otherMin, CXMVECTOR otherMax,
+                            CXMVECTOR z, CXMVECTOR dz, XMVECTOR* nearZ, XMVECTOR* farZ)
+{
+    // An edge parallel to the side has an infinite or NaN t, neither passes the range test
+    XMVECTOR mask = XMVectorAndInt(XMVectorGreaterOrEqual(t, XMVectorZero()), XMVectorLessOrEqual(t, XMVectorSplatOne()));
+    mask = XMVectorAndInt(mask, XMVectorAndInt(XMVectorGreaterOrEqual(other, otherMin), XMVectorLessOrEqual(other, otherMax)));
+
+    mergeClippedDepth(XMVectorMultiplyAdd(t, dz, z), mask, nearZ, farZ);
+}
+
+//--------------------------------------------------------------------------------------
+// Clips four triangles against a rectangle in light space (rect holds min x, min y, max x
+// and max y splatted) and returns the min and max z of what is left of each triangle, or
+// FLT_MAX and -FLT_MAX for lanes where nothing is left.
+// The clipped triangle is convex so its z range is found at one of its corners. Those can
+// only be triangle vertices inside the rectangle, edges crossing the rectangle's sides or
+// rectangle corners inside the triangle, so every candidate is computed for all four lanes
+// and masked instead of building the clipped polygon.
+//--------------------------------------------------------------------------------------
+static void clipTriangleGroup(const XMVECTOR* x, const XMVECTOR* y, const XMVECTOR* z, const XMVECTOR* rect,
+                              XMVECTOR* nearZ, XMVECTOR* farZ)
+{
+    *nearZ = g_FltMax;
+    *farZ = g_NegFltMax;
+
+    // Vertices inside the rectangle
+    for (UINT i = 0; i < 3; i++)
+    {
+        XMVECTOR insideX = XMVectorAndInt(XMVectorGreaterOrEqual(x[i], rect[0]), XMVectorLessOrEqual(x[i], rect[2]));
+        XMVECTOR insideY = XMVectorAndInt(XMVectorGreaterOrEqual(y[i], rect[1]), XMVectorLessOrEqual(y[i], rect[3]));
+
+        mergeClippedDepth(z[i], XMVectorAndInt(insideX, insideY), nearZ, farZ);
+    }
+
+    // Edges crossing the sides of the rectangle
+    for (UINT i = 0; i < 3; i++)
+    {
+        UINT j = (i + 1) % 3;
+
+        XMVECTOR dx = x[j] - x[i];
+        XMVECTOR dy = y[j] - y[i];
+        XMVECTOR dz = z[j] - z[i];
+        XMVECTOR invDx = XMVectorReciprocal(dx);
+        XMVECTOR invDy = XMVectorReciprocal(dy);
+
+        XMVECTOR t = (rect[0] - x[i]) * invDx;
+        clipEdge(t, XMVectorMultiplyAdd(t, dy, y[i]), rect[1], rect[3], z[i], dz, nearZ, farZ);
+
+        t = (rect[2] - x[i]) * invDx;
+        clipEdge(t, XMVectorMultiplyAdd(t, dy, y[i]), rect[1], rect[3], z[i], dz, nearZ, farZ);
+
+        t = (rect[1] - y[i]) * invDy;
+        clipEdge(t, XMVectorMultiplyAdd(t, dx, x[i]), rect[0], rect[2], z[i], dz, nearZ, farZ);
+
+        t = (rect[3] - y[i]) * invDy;
+        clipEdge(t, XMVectorMultiplyAdd(t, dx, x[i]), rect[0], rect[2], z[i], dz, nearZ, farZ);
+    }
+
+    // Rectangle corners inside the triangles, found with barycentric coordinates. Triangles
+    // seen edge on by the light have no area and are fully handled by the edge tests.
+    XMVECTOR e0x = x[2] - x[1], e0y = y[2] - y[1];
+    XMVECTOR e1x = x[0] - x[2], e1y = y[0] - y[2];
+    XMVECTOR e2x = x[1] - x[0], e2y = y[1] - y[0];
+
+    XMVECTOR area = e2x * (y[2] - y[0]) - e2y * (x[2] - x[0]);
+    XMVECTOR hasArea = XMVectorNotEqual(area, XMVectorZero());
+    XMVECTOR invArea = XMVectorReciprocal(area);
 
-    // Store this for later
+    for (UINT i = 0; i < 4; i++)
+    {
+        const XMVECTOR& cx = rect[(i == 1 || i == 2) ? 2 : 0];
+        const XMVECTOR& cy = rect[(i < 2) ? 1 : 3];
+
+        XMVECTOR b0 = (e0x * (cy - y[1]) - e0y * (cx - x[1])) * invArea;
+        XMVECTOR b1 = (e1x * (cy - y[2]) - e1y * (cx - x[2])) * invArea;
+        XMVECTOR b2 = (e2x * (cy - y[0]) - e2y * (cx - x[0])) * invArea;
+
+        XMVECTOR mask = XMVectorAndInt(hasArea, XMVectorGreaterOrEqual(b0, XMVectorZero()));
+        mask = XMVectorAndInt(mask, XMVectorAndInt(XMVectorGreaterOrEqual(b1, XMVectorZero()),
+            XMVectorGreaterOrEqual(b2, XMVectorZero())));
+
+        XMVECTOR cz = XMVectorMultiplyAdd(b0, z[0], XMVectorMultiplyAdd(b1, z[1], b2 * z[2]));
+        mergeClippedDepth(cz, mask, nearZ, farZ);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Clips every triangle group against every cascade of one light and merges the results
+// into the per cascade near and far planes, which are still four lanes wide.
+//--------------------------------------------------------------------------------------
+void CascadedDirectionalLightRenderer::clipTriangleGroups(const std::vector<TRIANGLE_GROUP>& groups,
+                                                          const XMVECTOR (*rects)[4], XMVECTOR* nearZ, XMVECTOR* farZ)
+{
+    for (UINT i = 0; i < groups.size(); i++)
+    {
+        const TRIANGLE_GROUP& group = groups[i];
+
+        XMVECTOR x[3], y[3], z[3];
+        for (UINT j = 0; j < 3; j++)
+        {
+            x[j] = XMLoadFloat4(&group.X[j]);
+            y[j] = XMLoadFloat4(&group.Y[j]);
+            z[j] = XMLoadFloat4(&group.Z[j]);
+        }
+
+        for (UINT j = 0; j < NUM_CASCADES; j++)
+        {
+            XMVECTOR groupNear, groupFar;
+            clipTriangleGroup(x, y, z, rects[j], &groupNear, &groupFar);
+
+            nearZ[j] = XMVectorMin(nearZ[j], groupNear);
+            farZ[j] = XMVectorMax(farZ[j], groupFar);
+        }
+    }
+}
+
+static inline float horizontalMin(FXMVECTOR v)
+{
+    XMFLOAT4 f;
+    XMStoreFloat4(&f, v);
+    return min(min(f.x, f.y), min(f.z, f.w));
+}
+
+static inline float horizontalMax(FXMVECTOR v)
+{
+    XMFLOAT4 f;
+    XMStoreFloat4(&f, v);
+    return max(max(f.x, f.y), max(f.z, f.w));
+}
+
+void CascadedDirectionalLightRenderer::computeCascades(DirectionalLight* dlight, UINT shadowMapIdx, Camera* camera)
+{
     XMFLOAT4X4 fView = camera->GetView();
     XMMATRIX cameraView = XMLoadFloat4x4(&fView);
 
-    XMFLOAT4X4 fViewProj = camera->GetViewProjection();
-    XMMATRIX cameraViewProj = XMLoadFloat4x4(&fViewProj);
-
     XMFLOAT4X4 fProj = camera->GetProjection();
     XMMATRIX cameraProj = XMLoadFloat4x4(&fProj);
 
-    XMFLOAT3 fCamForward = camera->GetForward();
-    XMVECTOR camFwd = XMLoadFloat3(&fCamForward);
-
-    XMFLOAT3 fCamPos = camera->GetPosition();
-    XMVECTOR camPos = XMLoadFloat3(&fCamPos);
-
     // Compute the inverse of the camera's view
     XMVECTOR det;
     XMMATRIX inverseCameraView = XMMatrixInverse(&det, cameraView);
 
-    // Calculate the scene aabb in light space
-    XMVECTOR vSceneCenter = XMLoadFloat3(&sceneBounds->Center);
-    XMVECTOR vSceneExtents = XMLoadFloat3(&sceneBounds->Extents);
-
     XMFLOAT3 fLightDir = dlight->GetDirection();
     XMVECTOR lightDir = XMLoadFloat3(&fLightDir);
     XMVECTOR lightOrigin =  XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
     XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 1.0f);
 
     XMMATRIX mLightCameraView = XMMatrixLookToLH(lightOrigin, -lightDir, up);
-    XMMATRIX mInvLightCameraView = XMMatrixInverse(&det, mLightCameraView);
-
-    XMVECTOR vSceneAABBPointsLightSpace[8];
-    CreateAABBPoints(vSceneAABBPointsLightSpace, vSceneCenter, vSceneExtents);
-    for(int cascadeIdx = 0; cascadeIdx < 8; cascadeIdx++)
-    {
-        vSceneAABBPointsLightSpace[cascadeIdx] = XMVector4Transform(vSceneAABBPointsLightSpace[cascadeIdx], mLightCameraView);
-    }
+    XMStoreFloat4x4(&_lightViews[shadowMapIdx], mLightCameraView);
 
     FLOAT fFrustumIntervalBegin, fFrustumIntervalEnd;
     XMVECTOR vLightCameraOrthographicMin;  // light space frustrum aabb
@@ -469,33 +647,11 @@ HRESULT CascadedDirectionalLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
     XMVECTOR vWorldUnitsPerTexel = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
 
-    // Cascade offsets
-    const XMFLOAT2 offsets[4] = {
-        XMFLOAT2(0.0f, 0.0f),
-        XMFLOAT2(0.5f, 0.0f),
-        XMFLOAT2(0.5f, 0.5f),
-        XMFLOAT2(0.0f, 0.5f)
-    };
-
     int numRows = (int)sqrtf((float)NUM_CASCADES);
     float cascadeSize = (float)SHADOW_MAP_SIZE / numRows;
 
-    UINT instanceVBStride = sizeof(XMFLOAT4X4);
-    UINT instanceVBOffset = 0;
-
     for (UINT cascadeIdx = 0; cascadeIdx < NUM_CASCADES; cascadeIdx++)
     {
-        // Create the viewport
-        D3D11_VIEWPORT vp;
-        vp.MinDepth = 0.0f;
-        vp.MaxDepth = 1.0f;
-        vp.Width = cascadeSize;
-        vp.Height = cascadeSize;
-        vp.TopLeftX = offsets[cascadeIdx].x * cascadeSize * 2.0f;
-        vp.TopLeftY = offsets[cascadeIdx].y * cascadeSize * 2.0f;
-
-        pd3dImmediateContext->RSSetViewports(1, &vp);
-
         // calc the split depths
         float splitDist = CASCADE_SPLITS[cascadeIdx];
 
@@ -564,98 +720,352 @@ HRESULT CascadedDirectionalLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
         vLightCameraOrthographicMax = XMVectorFloor(vLightCameraOrthographicMax);
         vLightCameraOrthographicMax *= vWorldUnitsPerTexel;
 
-        // Determine the near and far planes
-        FLOAT fNearPlane = 0.0f;
-        FLOAT fFarPlane = 10000.0f;
+        CASCADE_INFO& info = _cascadeInfos[shadowMapIdx][cascadeIdx];
+        XMStoreFloat2(&info.OrthoMin, vLightCameraOrthographicMin);
+        XMStoreFloat2(&info.OrthoMax, vLightCameraOrthographicMax);
+        info.IntervalBegin = fFrustumIntervalBegin;
+        info.IntervalEnd = fFrustumIntervalEnd;
 
-        ComputeNearAndFar(fNearPlane, fFarPlane, vLightCameraOrthographicMin,
-            vLightCameraOrthographicMax, vSceneAABBPointsLightSpace);
+        // Determined for all lights at once in computeNearAndFarPlanes
+        info.NearPlane = 0.0f;
+        info.FarPlane = 10000.0f;
+    }
+}
 
-        // Create the orthographic projection for this cascade.
-        XMMATRIX shadowProj = XMMatrixOrthographicOffCenterLH(
-            XMVectorGetX(vLightCameraOrthographicMin), XMVectorGetX(vLightCameraOrthographicMax),
-            XMVectorGetY(vLightCameraOrthographicMin), XMVectorGetY(vLightCameraOrthographicMax),
-            fNearPlane, fFarPlane);
+void CascadedDirectionalLightRenderer::computeNearAndFarPlanes(UINT lightCount, std::vector<ModelInstance*>* models,
+                                                               AxisAlignedBox* sceneBounds)
+{
+    BEGIN_EVENT(L"Compute near/far planes");
 
-        XMMATRIX shadowViewProj = XMMatrixMultiply(mLightCameraView, shadowProj);
+    for (UINT lightIdx = 0; lightIdx < lightCount; lightIdx++)
+    {
+        XMMATRIX lightView = XMLoadFloat4x4(&_lightViews[lightIdx]);
 
-        // Create the shadow frustum for intersection tests
-        OrientedBox shadowObb;
-        XMVECTOR obbCenter = camPos + (camFwd * ((fFrustumIntervalEnd + fFrustumIntervalBegin) * 0.5f));
-        XMStoreFloat3(&shadowObb.Center, obbCenter);
+        // Splat the cascade rectangles once and find the area all of them cover, casters outside
+        // of it can not be in any cascade
+        XMVECTOR rects[NUM_CASCADES][4];
+        XMFLOAT4 cullRect(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (UINT cascadeIdx = 0; cascadeIdx < NUM_CASCADES; cascadeIdx++)
+        {
+            const CASCADE_INFO& info = _cascadeInfos[lightIdx][cascadeIdx];
 
-        shadowObb.Extents.x = (XMVectorGetX(vLightCameraOrthographicMax) - XMVectorGetX(vLightCameraOrthographicMin)) * 0.5f;
-        shadowObb.Extents.y = (XMVectorGetY(vLightCameraOrthographicMax) - XMVectorGetY(vLightCameraOrthographicMin)) * 0.5f;
-        shadowObb.Extents.z = (fFarPlane - fNearPlane) * 0.5f;
+            rects[cascadeIdx][0] = XMVectorReplicate(info.OrthoMin.x);
+            rects[cascadeIdx][1] = XMVectorReplicate(info.OrthoMin.y);
+            rects[cascadeIdx][2] = XMVectorReplicate(info.OrthoMax.x);
+            rects[cascadeIdx][3] = XMVectorReplicate(info.OrthoMax.y);
 
-        XMStoreFloat4(&shadowObb.Orientation, XMQuaternionRotationMatrix(mInvLightCameraView));
+            cullRect.x = min(cullRect.x, info.OrthoMin.x);
+            cullRect.y = min(cullRect.y, info.OrthoMin.y);
+            cullRect.z = max(cullRect.z, info.OrthoMax.x);
+            cullRect.w = max(cullRect.w, info.OrthoMax.y);
+        }
 
-        ModelInstanceSet modelSet = ModelInstanceSet(models, &shadowObb);
+        _sceneTriangles.clear();
+        addBoxTriangles(&_sceneTriangles, *sceneBounds, lightView, NULL);
 
-        // Copy the instance wvp matrices into the vertex buffer
-        V_RETURN(pd3dImmediateContext->Map(_instanceWVPVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        XMFLOAT4X4* instanceVB = (XMFLOAT4X4*)mappedResource.pData;
+        _casterTriangles.clear();
+        if (_casterNearPlaneEnabled)
+        {
+            for (UINT i = 0; i < models->size(); i++)
+            {
+                addBoxTriangles(&_casterTriangles, models->at(i)->GetAxisAlignedBox(), lightView, &cullRect);
+            }
+        }
+
+        XMVECTOR sceneNear[NUM_CASCADES], sceneFar[NUM_CASCADES];
+        XMVECTOR casterNear[NUM_CASCADES], casterFar[NUM_CASCADES];
+        for (UINT cascadeIdx = 0; cascadeIdx < NUM_CASCADES; cascadeIdx++)
+        {
+            sceneNear[cascadeIdx] = casterNear[cascadeIdx] = g_FltMax;
+            sceneFar[cascadeIdx] = casterFar[cascadeIdx] = g_NegFltMax;
+        }
+
+        clipTriangleGroups(_sceneTriangles, rects, sceneNear, sceneFar);
+        clipTriangleGroups(_casterTriangles, rects, casterNear, casterFar);
+
+        for (UINT cascadeIdx = 0; cascadeIdx < NUM_CASCADES; cascadeIdx++)
+        {
+            CASCADE_INFO& info = _cascadeInfos[lightIdx][cascadeIdx];
+
+            float fNearPlane = horizontalMin(sceneNear[cascadeIdx]);
+            float fFarPlane = horizontalMax(sceneFar[cascadeIdx]);
+            if (fNearPlane > fFarPlane)
+            {
+                // The scene is entirely outside of this cascade, nothing will be drawn into it
+                continue;
+            }
+
+            // Nothing in front of the nearest caster can shadow anything, but receivers can be
+            // anywhere so the far plane stays fit to the scene
+            float fCasterNearPlane = horizontalMin(casterNear[cascadeIdx]);
+            if (_casterNearPlaneEnabled && fCasterNearPlane <= fFarPlane)
+            {
+                fNearPlane = max(fNearPlane, fCasterNearPlane);
+            }
+
+            info.NearPlane = fNearPlane;
+            info.FarPlane = fFarPlane;
+        }
+    }
+
+    END_EVENT(L"");
+}
+
+void CascadedDirectionalLightRenderer::FitCascades(Camera* camera, std::vector<ModelInstance*>* models,
+                                                   AxisAlignedBox* sceneBounds)
+{
+    UINT lightCount = min(GetCount(true), NUM_SHADOW_MAPS);
+    for (UINT i = 0; i < lightCount; i++)
+    {
+        computeCascades(GetLight(i, true), i, camera);
+    }
+
+    computeNearAndFarPlanes(lightCount, models, sceneBounds);
+}
+
+void CascadedDirectionalLightRenderer::CompareNearAndFarPlanes(AxisAlignedBox* sceneBounds,
+                                                               NearFarComparison* comparison)
+{
+    compareNearAndFarPlanes(min(GetCount(true), NUM_SHADOW_MAPS), sceneBounds, comparison);
+}
+
+void CascadedDirectionalLightRenderer::compareNearAndFarPlanes(UINT lightCount, AxisAlignedBox* sceneBounds,
+                                                               NearFarComparison* comparison)
+{
+    BEGIN_EVENT(L"Compute near/far planes (scalar)");
+
+    ZeroMemory(comparison, sizeof(NearFarComparison));
+
+    XMVECTOR vSceneCenter = XMLoadFloat3(&sceneBounds->Center);
+    XMVECTOR vSceneExtents = XMLoadFloat3(&sceneBounds->Extents);
+
+    for (UINT lightIdx = 0; lightIdx < lightCount; lightIdx++)
+    {
+        XMMATRIX mLightCameraView = XMLoadFloat4x4(&_lightViews[lightIdx]);
 
-        for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+        XMVECTOR vSceneAABBPointsLightSpace[8];
+        CreateAABBPoints(vSceneAABBPointsLightSpace, vSceneCenter, vSceneExtents);
+        for (UINT i = 0; i < 8; i++)
         {
-            for (UINT j = 0; j < modelSet.GetInstanceCount(i); j++)
+            vSceneAABBPointsLightSpace[i] = XMVector4Transform(vSceneAABBPointsLightSpace[i], mLightCameraView);
+        }
+
+        for (UINT cascadeIdx = 0; cascadeIdx < NUM_CASCADES; cascadeIdx++)
+        {
+            const CASCADE_INFO& info = _cascadeInfos[lightIdx][cascadeIdx];
+
+            XMVECTOR vOrthoMin = XMVectorSet(info.OrthoMin.x, info.OrthoMin.y, 0.0f, 0.0f);
+            XMVECTOR vOrthoMax = XMVectorSet(info.OrthoMax.x, info.OrthoMax.y, 0.0f, 0.0f);
+
+            FLOAT fNearPlane, fFarPlane;
+            ComputeNearAndFar(fNearPlane, fFarPlane, vOrthoMin, vOrthoMax, vSceneAABBPointsLightSpace);
+            if (fNearPlane > fFarPlane)
             {
-                ModelInstance* instance = modelSet.GetInstance(i, j);
+                continue;
+            }
+
+            // The caster near plane can only be further in than the scene's
+            float tolerance = max(fFarPlane - fNearPlane, 1.0f) * 0.001f;
+            float nearDifference = _casterNearPlaneEnabled ? max(fNearPlane - info.NearPlane, 0.0f) :
+                fabsf(info.NearPlane - fNearPlane);
+            float farDifference = fabsf(info.FarPlane - fFarPlane);
 
-                XMFLOAT4X4 fWorld = instance->GetWorld();
-                XMMATRIX world = XMLoadFloat4x4(&fWorld);
+            comparison->CascadeCount++;
+            comparison->MaxNearDifference = max(comparison->MaxNearDifference, nearDifference);
+            comparison->MaxFarDifference = max(comparison->MaxFarDifference, farDifference);
 
-                XMMATRIX wvp = XMMatrixMultiply(XMLoadFloat4x4(&fWorld), shadowViewProj);
+            if (nearDifference > tolerance || farDifference > tolerance)
+            {
+                comparison->MismatchCount++;
 
-                XMStoreFloat4x4(&instanceVB[modelSet.GetGlobalIndex(i, j)], XMMatrixTranspose(wvp));
+                WCHAR msg[MAX_LOG_LENGTH];
+                swprintf_s(msg, L"Light %u cascade %u near/far planes (%f, %f) do not match the scalar clipper (%f, %f).",
+                    lightIdx, cascadeIdx, info.NearPlane, info.FarPlane, fNearPlane, fFarPlane);
+                LOG_WARNING(L"CascadedDirectionalLightRenderer", msg);
             }
         }
+    }
 
-        pd3dImmediateContext->Unmap(_instanceWVPVB, 0);
+    END_EVENT(L"");
+}
+
+void CascadedDirectionalLightRenderer::renderInstances(ID3D11DeviceContext* pd3dImmediateContext, Model* model,
+                                                       UINT firstInstance, UINT instanceCount)
+{
+    // Render each mesh
+    for (UINT j = 0; j < model->GetMeshCount(); j++)
+    {
+        const Mesh* mesh = model->GetMesh(j);
+        UINT partCount = mesh->GetMeshPartCount();
+
+        ID3D11Buffer* meshVB = mesh->GetVertexBuffer();
+        UINT meshStride = mesh->GetVertexStride();
+        UINT meshOffset = 0;
 
-        pd3dImmediateContext->IASetVertexBuffers(1, 1, &_instanceWVPVB, &instanceVBStride, &instanceVBOffset);
+        pd3dImmediateContext->IASetVertexBuffers(0, 1, &meshVB, &meshStride, &meshOffset);
+        pd3dImmediateContext->IASetIndexBuffer(mesh->GetIndexBuffer(), mesh->GetIndexBufferFormat(), 0);
+        pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+        for (UINT k = 0; k < partCount; k++)
         {
-            Model* model = modelSet.GetModel(i);
+            const MeshPart* part = mesh->GetMeshPart(k);
+            const Material* mat = model->GetMaterial(part->MaterialIndex);
 
-            // Render each mesh
-            for (UINT j = 0; j < model->GetMeshCount(); j++)
+            bool alphaCutoutEnabled = GetAlphaCutoutEnabled() && mesh->GetAlphaCutoutEnabled();
+
+            pd3dImmediateContext->VSSetShader(alphaCutoutEnabled ? _depthVSAlpha->VertexShader : _depthVSNoAlpha->VertexShader, NULL, 0);
+            pd3dImmediateContext->PSSetShader(alphaCutoutEnabled ? _depthPSAlpha->PixelShader : NULL, NULL, 0);
+
+            pd3dImmediateContext->IASetInputLayout(
+                alphaCutoutEnabled ? _depthVSAlpha->InputLayout : _depthVSNoAlpha->InputLayout);
+
+            if (alphaCutoutEnabled)
             {
-                const Mesh* mesh = model->GetMesh(j);
-                UINT partCount = mesh->GetMeshPartCount();
+                ID3D11ShaderResourceView* diffuseSRV = mat->GetDiffuseSRV();
+                pd3dImmediateContext->PSSetShaderResources(0, 1, &diffuseSRV);
+            }
+
+            pd3dImmediateContext->DrawIndexedInstanced(part->IndexCount, instanceCount, part->IndexStart,
+                part->VertexStart, firstInstance);
+            ADD_RENDER_STAT(DrawCalls, 1);
+            ADD_RENDER_STAT(Triangles, part->IndexCount / 3 * instanceCount);
+        }
+    }
+}
+
+HRESULT CascadedDirectionalLightRenderer::renderDepth(ID3D11DeviceContext* pd3dImmediateContext, UINT shadowMapIdx,
+                                                      std::vector<ModelInstance*>* models)
+{
+    HRESULT hr;
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+
+    // Set up the render targets for the shadow map and clear them
+    pd3dImmediateContext->OMSetRenderTargets(0, NULL, _shadowMapDSVs[shadowMapIdx]);
+    pd3dImmediateContext->ClearDepthStencilView(_shadowMapDSVs[shadowMapIdx], D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+    pd3dImmediateContext->OMSetDepthStencilState(GetDepthStencilStates()->GetDepthWriteEnabled(), 0);
+
+    float blendFactor[4] = {1, 1, 1, 1};
+    pd3dImmediateContext->OMSetBlendState(GetBlendStates()->GetBlendDisabled(), blendFactor, 0xFFFFFFFF);
+
+    pd3dImmediateContext->RSSetState(GetRasterizerStates()->GetNoCull());
+
+    // Set alpha cutout properties, even if they arn't used
+    ID3D11SamplerState* samplers[1] = { GetSamplerStates()->GetAnisotropic16Wrap() };
+    pd3dImmediateContext->PSSetSamplers(0, 1, samplers);
+
+    V_RETURN(pd3dImmediateContext->Map(_alphaCutoutProperties, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+    CB_DIRECTIONALLIGHT_ALPHACUTOUT_PROPERTIES* modelProperties = (CB_DIRECTIONALLIGHT_ALPHACUTOUT_PROPERTIES*)mappedResource.pData;
+    modelProperties->AlphaThreshold = GetAlphaThreshold();
+    pd3dImmediateContext->Unmap(_alphaCutoutProperties, 0);
+
+    pd3dImmediateContext->PSSetConstantBuffers(1, 1, &_alphaCutoutProperties);
+
+    XMMATRIX mLightCameraView = XMLoadFloat4x4(&_lightViews[shadowMapIdx]);
+
+    XMVECTOR det;
+    XMMATRIX mInvLightCameraView = XMMatrixInverse(&det, mLightCameraView);
+
+    // Cascade offsets
+    const XMFLOAT2 offsets[4] = {
+        XMFLOAT2(0.0f, 0.0f),
+        XMFLOAT2(0.5f, 0.0f),
+        XMFLOAT2(0.5f, 0.5f),
+        XMFLOAT2(0.0f, 0.5f)
+    };
+
+    int numRows = (int)sqrtf((float)NUM_CASCADES);
+    float cascadeSize = (float)SHADOW_MAP_SIZE / numRows;
+
+    UINT instanceVBStride = _instanceStream.GetStride();
+    UINT instanceVBOffset = 0;
+
+    for (UINT cascadeIdx = 0; cascadeIdx < NUM_CASCADES; cascadeIdx++)
+    {
+        const CASCADE_INFO& info = _cascadeInfos[shadowMapIdx][cascadeIdx];
+        ADD_RENDER_STAT(ShadowMaps, 1);
+
+        // Create the viewport
+        D3D11_VIEWPORT vp;
+        vp.MinDepth = 0.0f;
+        vp.MaxDepth = 1.0f;
+        vp.Width = cascadeSize;
+        vp.Height = cascadeSize;
+        vp.TopLeftX = offsets[cascadeIdx].x * cascadeSize * 2.0f;
+        vp.TopLeftY = offsets[cascadeIdx].y * cascadeSize * 2.0f;
+
+        pd3dImmediateContext->RSSetViewports(1, &vp);
+
+        // Create the orthographic projection for this cascade.
+        XMMATRIX shadowProj = XMMatrixOrthographicOffCenterLH(info.OrthoMin.x, info.OrthoMax.x,
+            info.OrthoMin.y, info.OrthoMax.y, info.NearPlane, info.FarPlane);
+
+        XMMATRIX shadowViewProj = XMMatrixMultiply(mLightCameraView, shadowProj);
+
+        // Create the shadow frustum for intersection tests, it covers exactly the light space
+        // volume of the projection
+        OrientedBox shadowObb;
+        XMVECTOR obbCenter = XMVectorSet((info.OrthoMin.x + info.OrthoMax.x) * 0.5f,
+            (info.OrthoMin.y + info.OrthoMax.y) * 0.5f, (info.NearPlane + info.FarPlane) * 0.5f, 1.0f);
+        XMStoreFloat3(&shadowObb.Center, XMVector3Transform(obbCenter, mInvLightCameraView));
+
+        shadowObb.Extents.x = (info.OrthoMax.x - info.OrthoMin.x) * 0.5f;
+        shadowObb.Extents.y = (info.OrthoMax.y - info.OrthoMin.y) * 0.5f;
+        shadowObb.Extents.z = (info.FarPlane - info.NearPlane) * 0.5f;
+
+        XMStoreFloat4(&shadowObb.Orientation, XMQuaternionRotationMatrix(mInvLightCameraView));
+
+        ModelInstanceSet modelSet = ModelInstanceSet(models, &shadowObb);
 
-                ID3D11Buffer* meshVB = mesh->GetVertexBuffer();
-                UINT meshStride = mesh->GetVertexStride();
-                UINT meshOffset = 0;
+        // Copy the instance wvp matrices into the instance stream a batch at a time and draw them
+        UINT instanceCount = modelSet.GetInstanceCount();
+        ADD_RENDER_STAT(ShadowCasters, instanceCount);
 
-                pd3dImmediateContext->IASetVertexBuffers(0, 1, &meshVB, &meshStride, &meshOffset);
-                pd3dImmediateContext->IASetIndexBuffer(mesh->GetIndexBuffer(), mesh->GetIndexBufferFormat(), 0);
-                pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        for (UINT batchStart = 0; batchStart < instanceCount; )
+        {
+            UINT batchEnd = min(batchStart + _instanceStream.GetMaxInstances(), instanceCount);
+
+            XMFLOAT4X4* instanceData;
+            UINT firstInstance;
+            V_RETURN(_instanceStream.Map(pd3dImmediateContext, batchEnd - batchStart, (void**)&instanceData,
+                &firstInstance));
 
-                for (UINT k = 0; k < partCount; k++)
+            for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+            {
+                UINT modelStart = modelSet.GetGlobalIndex(i, 0);
+                UINT begin = max(modelStart, batchStart);
+                UINT end = min(modelStart + modelSet.GetInstanceCount(i), batchEnd);
+
+                for (UINT j = begin; j < end; j++)
                 {
-                    const MeshPart* part = mesh->GetMeshPart(k);
-                    const Material* mat = model->GetMaterial(part->MaterialIndex);
+                    ModelInstance* instance = modelSet.GetInstance(i, j - modelStart);
 
-                    bool alphaCutoutEnabled = GetAlphaCutoutEnabled() && mesh->GetAlphaCutoutEnabled();
+                    XMFLOAT4X4 fWorld = instance->GetWorld();
+                    XMMATRIX wvp = XMMatrixMultiply(XMLoadFloat4x4(&fWorld), shadowViewProj);
 
-                    pd3dImmediateContext->VSSetShader(alphaCutoutEnabled ? _depthVSAlpha->VertexShader : _depthVSNoAlpha->VertexShader, NULL, 0);
-                    pd3dImmediateContext->PSSetShader(alphaCutoutEnabled ? _depthPSAlpha->PixelShader : NULL, NULL, 0);
+                    XMStoreFloat4x4(&instanceData[j - batchStart], XMMatrixTranspose(wvp));
+                }
+            }
 
-                    pd3dImmediateContext->IASetInputLayout(
-                        alphaCutoutEnabled ? _depthVSAlpha->InputLayout : _depthVSNoAlpha->InputLayout);
+            _instanceStream.Unmap(pd3dImmediateContext);
 
-                    if (alphaCutoutEnabled)
-                    {
-                        ID3D11ShaderResourceView* diffuseSRV = mat->GetDiffuseSRV();
-                        pd3dImmediateContext->PSSetShaderResources(0, 1, &diffuseSRV);
-                    }
+            ID3D11Buffer* instanceVB = _instanceStream.GetBuffer();
+            pd3dImmediateContext->IASetVertexBuffers(1, 1, &instanceVB, &instanceVBStride, &instanceVBOffset);
+
+            for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+            {
+                UINT modelStart = modelSet.GetGlobalIndex(i, 0);
+                UINT begin = max(modelStart, batchStart);
+                UINT end = min(modelStart + modelSet.GetInstanceCount(i), batchEnd);
 
-                    pd3dImmediateContext->DrawIndexedInstanced(part->IndexCount, modelSet.GetInstanceCount(i),
-                        part->IndexStart, part->VertexStart, modelSet.GetGlobalIndex(i, 0));
+                if (begin < end)
+                {
+                    renderInstances(pd3dImmediateContext, modelSet.GetModel(i), firstInstance + begin - batchStart,
+                        end - begin);
                 }
             }
+
+            batchStart = batchEnd;
         }
 
         // Bake the cascade offset and bias into the projection matrix and then store it
@@ -675,7 +1085,7 @@ HRESULT CascadedDirectionalLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
         XMStoreFloat4x4(&_shadowMatricies[shadowMapIdx][cascadeIdx], XMMatrixTranspose(shadowViewProj));
         XMStoreFloat4x4(&_shadowTexCoordTransforms[shadowMapIdx][cascadeIdx], XMMatrixTranspose(cascadeOffsetMatrix));
-        _cascadeSplits[shadowMapIdx][cascadeIdx] = fFrustumIntervalEnd;
+        _cascadeSplits[shadowMapIdx][cascadeIdx] = info.IntervalEnd;
     }
 
     return S_OK;
@@ -709,6 +1119,9 @@ HRESULT CascadedDirectionalLightRenderer::RenderGeometryLights(ID3D11DeviceConte
         float blendFactor[4] = {1, 1, 1, 1};
         pd3dImmediateContext->OMSetBlendState(GetBlendStates()->GetAdditiveBlend(), blendFactor, 0xFFFFFFFF);
 
+        // Nothing is left bound for this pass when it follows a run of deferred passes
+        pd3dImmediateContext->RSSetState(GetRasterizerStates()->GetNoCull());
+
         ID3D11ShaderResourceView* gBufferSRVs[3] =
         {
             gBuffer->GetDiffuseSRV(),
@@ -734,19 +1147,20 @@ HRESULT CascadedDirectionalLightRenderer::RenderGeometryLights(ID3D11DeviceConte
         {
             DirectionalLight* light = GetLight(i, false);
 
-            V_RETURN(pd3dImmediateContext->Map(_lightPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES* lightProperties =
-                (CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES*)mappedResource.pData;
+            CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES lightProperties;
+            ZeroMemory(&lightProperties, sizeof(CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES));
 
-            lightProperties->LightColor = light->GetColor();
-            lightProperties->LightBrightness = light->GetBrightness();
-            lightProperties->LightDirection = light->GetDirection();
+            lightProperties.LightColor = light->GetColor();
+            lightProperties.LightBrightness = light->GetBrightness();
+            lightProperties.LightDirection = light->GetDirection();
 
-            pd3dImmediateContext->Unmap(_lightPropertiesBuffer, 0);
+            ID3D11Buffer* lightPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, lightProperties, &lightPropertiesBuffer));
 
-            pd3dImmediateContext->PSSetConstantBuffers(1, 1, &_lightPropertiesBuffer);
+            pd3dImmediateContext->PSSetConstantBuffers(1, 1, &lightPropertiesBuffer);
 
             _fsQuad.Render(pd3dImmediateContext, _unshadowedPS->PixelShader);
+            ADD_RENDER_STAT(Lights, 1);
         }
 
         // begin rendering shadowed lights
@@ -756,35 +1170,35 @@ HRESULT CascadedDirectionalLightRenderer::RenderGeometryLights(ID3D11DeviceConte
             DirectionalLight* light = GetLight(i, true);
 
             // Prepare the light properties
-            V_RETURN(pd3dImmediateContext->Map(_lightPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES* lightProperties =
-                (CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES*)mappedResource.pData;
+            CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES lightProperties;
+            ZeroMemory(&lightProperties, sizeof(CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES));
 
-            lightProperties->LightColor = light->GetColor();
-            lightProperties->LightBrightness = light->GetBrightness();
-            lightProperties->LightDirection = light->GetDirection();
+            lightProperties.LightColor = light->GetColor();
+            lightProperties.LightBrightness = light->GetBrightness();
+            lightProperties.LightDirection = light->GetDirection();
 
-            pd3dImmediateContext->Unmap(_lightPropertiesBuffer, 0);
+            ID3D11Buffer* lightPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, lightProperties, &lightPropertiesBuffer));
 
             // Prepare the shadow properties
-            V_RETURN(pd3dImmediateContext->Map(_shadowPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_DIRECTIONALLIGHT_SHADOW_PROPERTIES* shadowProperties =
-                (CB_DIRECTIONALLIGHT_SHADOW_PROPERTIES*)mappedResource.pData;
+            CB_DIRECTIONALLIGHT_SHADOW_PROPERTIES shadowProperties;
+            ZeroMemory(&shadowProperties, sizeof(CB_DIRECTIONALLIGHT_SHADOW_PROPERTIES));
 
             for (UINT j = 0; j < NUM_CASCADES; j++)
             {
                 // Matricies are already transposed
-                shadowProperties->CascadeSplits[j] = _cascadeSplits[i][j];
-                shadowProperties->ShadowMatricies[j] = _shadowMatricies[i][j];
-                shadowProperties->ShadowTexCoordTransforms[j] = _shadowTexCoordTransforms[i][j];
+                shadowProperties.CascadeSplits[j] = _cascadeSplits[i][j];
+                shadowProperties.ShadowMatricies[j] = _shadowMatricies[i][j];
+                shadowProperties.ShadowTexCoordTransforms[j] = _shadowTexCoordTransforms[i][j];
             }
-            shadowProperties->CameraClips = XMFLOAT2(camera->GetNearClip(), camera->GetFarClip());
-            shadowProperties->ShadowMapSize = XMFLOAT2((float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE);
+            shadowProperties.CameraClips = XMFLOAT2(camera->GetNearClip(), camera->GetFarClip());
+            shadowProperties.ShadowMapSize = XMFLOAT2((float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE);
 
-            pd3dImmediateContext->Unmap(_shadowPropertiesBuffer, 0);
+            ID3D11Buffer* shadowPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, shadowProperties, &shadowPropertiesBuffer));
 
             // Set both constant buffers back to the shader at once
-            ID3D11Buffer* constantBuffers[2] = { _lightPropertiesBuffer, _shadowPropertiesBuffer };
+            ID3D11Buffer* constantBuffers[2] = { lightPropertiesBuffer, shadowPropertiesBuffer };
             pd3dImmediateContext->PSSetConstantBuffers(1, 2, constantBuffers);
 
             // Set the shadow map SRV
@@ -792,6 +1206,8 @@ HRESULT CascadedDirectionalLightRenderer::RenderGeometryLights(ID3D11DeviceConte
 
             // Finally, render the quad
             _fsQuad.Render(pd3dImmediateContext, _shadowedPS->PixelShader);
+            ADD_RENDER_STAT(Lights, 1);
+            ADD_RENDER_STAT(ShadowedLights, 1);
         }
 
         // Null all the SRVs
@@ -832,6 +1248,9 @@ HRESULT CascadedDirectionalLightRenderer::RenderParticleLights(ID3D11DeviceConte
         float blendFactor[4] = {1, 1, 1, 1};
         pd3dImmediateContext->OMSetBlendState(GetBlendStates()->GetAdditiveBlend(), blendFactor, 0xFFFFFFFF);
 
+        // Nothing is left bound for this pass when it follows a run of deferred passes
+        pd3dImmediateContext->RSSetState(GetRasterizerStates()->GetNoCull());
+
         ID3D11ShaderResourceView* gBufferSRVs[2] =
         {
             pBuffer->GetDiffuseSRV(),
@@ -856,17 +1275,17 @@ HRESULT CascadedDirectionalLightRenderer::RenderParticleLights(ID3D11DeviceConte
             DirectionalLight* light = GetLight(i);
 
             // Prepare the light properties
-            V_RETURN(pd3dImmediateContext->Map(_lightPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES* lightProperties =
-                (CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES*)mappedResource.pData;
+            CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES lightProperties;
+            ZeroMemory(&lightProperties, sizeof(CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES));
 
-            lightProperties->LightColor = light->GetColor();
-            lightProperties->LightBrightness = light->GetBrightness();
-            lightProperties->LightDirection = light->GetDirection();
+            lightProperties.LightColor = light->GetColor();
+            lightProperties.LightBrightness = light->GetBrightness();
+            lightProperties.LightDirection = light->GetDirection();
 
-            pd3dImmediateContext->Unmap(_lightPropertiesBuffer, 0);
+            ID3D11Buffer* lightPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, lightProperties, &lightPropertiesBuffer));
 
-            pd3dImmediateContext->PSSetConstantBuffers(1, 1, &_lightPropertiesBuffer);
+            pd3dImmediateContext->PSSetConstantBuffers(1, 1, &lightPropertiesBuffer);
 
             // Finally, render the quad
             _fsQuad.Render(pd3dImmediateContext, _unshadowedParticlePS->PixelShader);
@@ -988,22 +1407,7 @@ HRESULT CascadedDirectionalLightRenderer::OnD3D11CreateDevice(ID3D11Device* pd3d
     bufferDesc.ByteWidth = sizeof(CB_DIRECTIONALLIGHT_CAMERA_PROPERTIES);
     V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_cameraPropertiesBuffer));
 
-    bufferDesc.ByteWidth = sizeof(CB_DIRECTIONALLIGHT_LIGHT_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_lightPropertiesBuffer));
-
-    bufferDesc.ByteWidth = sizeof(CB_DIRECTIONALLIGHT_SHADOW_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_shadowPropertiesBuffer));
-
-    D3D11_BUFFER_DESC vbDesc =
-    {
-        sizeof(XMFLOAT4X4) * MAX_INSTANCES, // INT ByteWidth;
-        D3D11_USAGE_DYNAMIC, // D3D11_USAGE Usage;
-        D3D11_BIND_VERTEX_BUFFER, // UINT BindFlags;
-        D3D11_CPU_ACCESS_WRITE, // UINT CPUAccessFlags;
-        0, // UINT MiscFlags;
-        0, // UINT StructureByteStride;
-    };
-    V_RETURN(pd3dDevice->CreateBuffer(&vbDesc, NULL, &_instanceWVPVB));
+    V_RETURN(_instanceStream.OnD3D11CreateDevice(pd3dDevice));
 
     // Create the shadow textures
     D3D11_TEXTURE2D_DESC shadowMapTextureDesc =
@@ -1072,16 +1476,14 @@ void CascadedDirectionalLightRenderer::OnD3D11DestroyDevice(ContentManager* pCon
     SAFE_CM_RELEASE(pContentManager, _depthVSAlpha);
     SAFE_CM_RELEASE(pContentManager, _depthPSAlpha);
 
-    SAFE_RELEASE(_instanceWVPVB);
+    _instanceStream.OnD3D11DestroyDevice();
 
     SAFE_CM_RELEASE(pContentManager, _unshadowedPS);
     SAFE_CM_RELEASE(pContentManager, _shadowedPS);
     SAFE_CM_RELEASE(pContentManager, _unshadowedParticlePS);
     SAFE_CM_RELEASE(pContentManager, _shadowedParticlePS);
 
-    SAFE_RELEASE(_lightPropertiesBuffer);
     SAFE_RELEASE(_cameraPropertiesBuffer);
-    SAFE_RELEASE(_shadowPropertiesBuffer);
 
     for (UINT i = 0; i < NUM_SHADOW_MAPS; i++)
     {
@@ -5,10 +5,20 @@
 #include "Lights.h"
 #include "FullscreenQuad.h"
 #include "DeviceStates.h"
+#include "InstanceStream.h"
 
 #include "PixelShaderLoader.h"
 #include "VertexShaderLoader.h"
 
+// How far the near and far planes of the batched clipper are from those of the scalar clipper
+struct NearFarComparison
+{
+    UINT CascadeCount;
+    UINT MismatchCount;
+    float MaxNearDifference;
+    float MaxFarDifference;
+};
+
 class CascadedDirectionalLightRenderer : public LightRenderer<DirectionalLight>
 {
 private:
@@ -25,12 +35,13 @@ private:
     PixelShaderContent* _unshadowedParticlePS;
     PixelShaderContent* _shadowedParticlePS;
 
-    static const UINT MAX_INSTANCES = 128;
-    ID3D11Buffer* _instanceWVPVB;
+    // Holds the world view projection of each instance, cascades with more instances than fit in
+    // a batch are drawn a batch at a time
+    static const UINT INITIAL_INSTANCES = 1024;
+    static const UINT MAX_BATCH_INSTANCES = 16384;
+    InstanceStream _instanceStream;
 
     ID3D11Buffer* _cameraPropertiesBuffer;
-    ID3D11Buffer* _lightPropertiesBuffer;
-    ID3D11Buffer* _shadowPropertiesBuffer;
     FullscreenQuad _fsQuad;
 
     static const UINT NUM_SHADOW_MAPS = 3;
@@ -44,6 +55,34 @@ private:
     XMFLOAT4X4 _shadowTexCoordTransforms[NUM_SHADOW_MAPS][NUM_CASCADES];
     float _cascadeSplits[NUM_SHADOW_MAPS][NUM_CASCADES];
 
+    // The light space volume of each cascade, these are computed for every shadowed light
+    // before any depth is rendered so that the near and far planes can be found in one batch
+    struct CASCADE_INFO
+    {
+        XMFLOAT2 OrthoMin;
+        XMFLOAT2 OrthoMax;
+        float NearPlane;
+        float FarPlane;
+        float IntervalBegin;
+        float IntervalEnd;
+    };
+    CASCADE_INFO _cascadeInfos[NUM_SHADOW_MAPS][NUM_CASCADES];
+    XMFLOAT4X4 _lightViews[NUM_SHADOW_MAPS];
+
+    // Four triangles in structure of arrays form, the near/far clipper works on one group at a
+    // time and a box is always made of exactly three groups
+    struct TRIANGLE_GROUP
+    {
+        XMFLOAT4 X[3];
+        XMFLOAT4 Y[3];
+        XMFLOAT4 Z[3];
+    };
+    std::vector<TRIANGLE_GROUP> _sceneTriangles;
+    std::vector<TRIANGLE_GROUP> _casterTriangles;
+
+    bool _casterNearPlaneEnabled;
+    bool _nearFarValidationEnabled;
+
     void ComputeNearAndFar(FLOAT& fNearPlane, FLOAT& fFarPlane, FXMVECTOR& vLightCameraOrthographicMin,
         FXMVECTOR& vLightCameraOrthographicMax, XMVECTOR* pvPointsInCameraView);
 
@@ -52,9 +91,18 @@ private:
     void CreateFrustumPointsFromCascadeInterval(float fCascadeIntervalBegin, FLOAT fCascadeIntervalEnd,
         XMMATRIX &vProjection, XMVECTOR* pvCornerPointsWorld);
 
-    HRESULT renderDepth(ID3D11DeviceContext* pd3dImmediateContext, DirectionalLight* dlight,
-        UINT shadowMapIdx, std::vector<ModelInstance*>* models, Camera* camera,
-        AxisAlignedBox* sceneBounds);
+    void addBoxTriangles(std::vector<TRIANGLE_GROUP>* groups, const AxisAlignedBox& box, const XMMATRIX& lightView,
+        const XMFLOAT4* cullRect);
+    void clipTriangleGroups(const std::vector<TRIANGLE_GROUP>& groups, const XMVECTOR (*rects)[4], XMVECTOR* nearZ,
+        XMVECTOR* farZ);
+    void computeCascades(DirectionalLight* dlight, UINT shadowMapIdx, Camera* camera);
+    void computeNearAndFarPlanes(UINT lightCount, std::vector<ModelInstance*>* models, AxisAlignedBox* sceneBounds);
+    void compareNearAndFarPlanes(UINT lightCount, AxisAlignedBox* sceneBounds, NearFarComparison* comparison);
+
+    void renderInstances(ID3D11DeviceContext* pd3dImmediateContext, Model* model, UINT firstInstance,
+        UINT instanceCount);
+    HRESULT renderDepth(ID3D11DeviceContext* pd3dImmediateContext, UINT shadowMapIdx,
+        std::vector<ModelInstance*>* models);
 
     struct CB_DIRECTIONALLIGHT_ALPHACUTOUT_PROPERTIES
     {
@@ -92,6 +140,24 @@ protected:
 public:
     CascadedDirectionalLightRenderer();
 
+    // Fit the near plane of each cascade to the model instances that can cast into it instead
+    // of the whole scene, the far plane still covers the scene so every receiver is in range
+    bool GetCasterNearPlaneEnabled() const { return _casterNearPlaneEnabled; }
+    void SetCasterNearPlaneEnabled(bool enabled) { _casterNearPlaneEnabled = enabled; }
+
+    // Also run the scalar near/far clipper each frame and warn if the results differ, both are
+    // timed as separate events
+    bool GetNearFarValidationEnabled() const { return _nearFarValidationEnabled; }
+    void SetNearFarValidationEnabled(bool enabled) { _nearFarValidationEnabled = enabled; }
+
+    // Fits the cascades of the shadowed lights to the camera and computes their near and far
+    // planes with the batched clipper, the first step of rendering the shadow maps
+    void FitCascades(Camera* camera, std::vector<ModelInstance*>* models, AxisAlignedBox* sceneBounds);
+
+    // Runs the scalar clipper on the cascades that were fit last and compares it against them,
+    // every cascade that does not match is also logged
+    void CompareNearAndFarPlanes(AxisAlignedBox* sceneBounds, NearFarComparison* comparison);
+
     HRESULT RenderGeometryShadowMaps(ID3D11DeviceContext* pd3dImmediateContext, std::vector<ModelInstance*>* models,
         Camera* camera, AxisAlignedBox* sceneBounds);
     HRESULT RenderGeometryLights(ID3D11DeviceContext* pd3dImmediateContext, Camera* camera,
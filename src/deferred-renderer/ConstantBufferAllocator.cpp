@@ -0,0 +1,138 @@
+#include "PCH.h"
+#include "ConstantBufferAllocator.h"
+#include "Logger.h"
+
+UINT ConstantBufferAllocator::_currentGeneration = 0;
+
+ConstantBufferAllocator::ConstantBufferAllocator()
+    : _generation(_currentGeneration)
+{
+    ZeroMemory(&_frameStats, sizeof(ConstantBufferStats));
+    ZeroMemory(&_stats, sizeof(ConstantBufferStats));
+}
+
+ConstantBufferAllocator::~ConstantBufferAllocator()
+{
+    OnD3D11DestroyDevice();
+}
+
+void ConstantBufferAllocator::invalidateContents()
+{
+    for (std::map<UINT, POOL_INFO>::iterator it = _pools.begin(); it != _pools.end(); it++)
+    {
+        for (UINT i = 0; i < it->second.Buffers.size(); i++)
+        {
+            it->second.Buffers[i].Contents.clear();
+        }
+    }
+}
+
+void ConstantBufferAllocator::Reset()
+{
+    UINT bufferCount = 0;
+    UINT64 poolBytes = 0;
+    for (std::map<UINT, POOL_INFO>::iterator it = _pools.begin(); it != _pools.end(); it++)
+    {
+        bufferCount += it->second.Buffers.size();
+        poolBytes += (UINT64)it->first * it->second.Buffers.size();
+
+        it->second.Next = 0;
+    }
+
+    if (bufferCount > _stats.BufferCount)
+    {
+        WCHAR msg[256];
+        swprintf_s(msg, L"Pool grew to %u buffers (%llu KB)", bufferCount, poolBytes / 1024);
+        LOG_INFO(L"Constant buffers", msg);
+    }
+
+    _frameStats.BufferCount = bufferCount;
+    _frameStats.PoolBytes = poolBytes;
+    _stats = _frameStats;
+
+    _frameStats.Uploads = 0;
+    _frameStats.Maps = 0;
+    _frameStats.UploadedBytes = 0;
+
+    if (_generation != _currentGeneration)
+    {
+        invalidateContents();
+        _generation = _currentGeneration;
+    }
+}
+
+HRESULT ConstantBufferAllocator::Upload(ID3D11DeviceContext* context, const void* data, UINT size,
+    ID3D11Buffer** buffer)
+{
+    HRESULT hr;
+
+    UINT bufferSize = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    POOL_INFO& pool = _pools[bufferSize];
+
+    if (pool.Next == pool.Buffers.size())
+    {
+        ID3D11Device* device;
+        context->GetDevice(&device);
+
+        D3D11_BUFFER_DESC cbDesc =
+        {
+            bufferSize,
+            D3D11_USAGE_DYNAMIC,
+            D3D11_BIND_CONSTANT_BUFFER,
+            D3D11_CPU_ACCESS_WRITE,
+            0,
+            0
+        };
+
+        BUFFER_INFO newBuffer;
+        newBuffer.Buffer = NULL;
+        hr = device->CreateBuffer(&cbDesc, NULL, &newBuffer.Buffer);
+        SAFE_RELEASE(device);
+        V_RETURN(hr);
+
+        pool.Buffers.push_back(newBuffer);
+
+        CHAR debugName[256];
+        sprintf_s(debugName, "Constant buffer %u (%u bytes)", pool.Buffers.size() - 1, bufferSize);
+        V_RETURN(SetDXDebugName(newBuffer.Buffer, debugName));
+    }
+
+    BUFFER_INFO& info = pool.Buffers[pool.Next++];
+
+    _frameStats.Uploads++;
+    _frameStats.UploadedBytes += size;
+
+    if (info.Contents.size() != size || memcmp(&info.Contents[0], data, size) != 0)
+    {
+        D3D11_MAPPED_SUBRESOURCE mappedResource;
+        V_RETURN(context->Map(info.Buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+        memcpy(mappedResource.pData, data, size);
+        context->Unmap(info.Buffer, 0);
+
+        info.Contents.assign((const BYTE*)data, (const BYTE*)data + size);
+        _frameStats.Maps++;
+    }
+
+    *buffer = info.Buffer;
+    return S_OK;
+}
+
+void ConstantBufferAllocator::InvalidateAll()
+{
+    _currentGeneration++;
+}
+
+void ConstantBufferAllocator::OnD3D11DestroyDevice()
+{
+    for (std::map<UINT, POOL_INFO>::iterator it = _pools.begin(); it != _pools.end(); it++)
+    {
+        for (UINT i = 0; i < it->second.Buffers.size(); i++)
+        {
+            SAFE_RELEASE(it->second.Buffers[i].Buffer);
+        }
+    }
+    _pools.clear();
+
+    ZeroMemory(&_frameStats, sizeof(ConstantBufferStats));
+    ZeroMemory(&_stats, sizeof(ConstantBufferStats));
+}
\ No newline at end of file
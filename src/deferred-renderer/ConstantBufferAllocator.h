@@ -0,0 +1,76 @@
+#pragma once
+
+#include "PCH.h"
+
+struct ConstantBufferStats
+{
+    // Uploads whose data matched what their buffer already held did not map it
+    UINT Uploads;
+    UINT Maps;
+    UINT64 UploadedBytes;
+
+    UINT BufferCount;
+    UINT64 PoolBytes;
+};
+
+// Hands out dynamic constant buffers for constants that only live for a single draw or pass.
+// Buffers are taken in order from a pool per size that is rewound every frame, so a draw tends to
+// get the same buffer as it did the frame before. A copy of the contents of every buffer is kept
+// and the buffer is only mapped again when the data uploaded to it changes.
+//
+// Sizes are rounded up to 256 bytes, the alignment constant buffers have to be bound at when they
+// are bound with an offset into a larger buffer.
+class ConstantBufferAllocator
+{
+private:
+    static const UINT ALIGNMENT = 256;
+
+    // Bumped by InvalidateAll, allocators compare it to their own when they are reset
+    static UINT _currentGeneration;
+    UINT _generation;
+
+    struct BUFFER_INFO
+    {
+        ID3D11Buffer* Buffer;
+        std::vector<BYTE> Contents;
+    };
+
+    struct POOL_INFO
+    {
+        std::vector<BUFFER_INFO> Buffers;
+        UINT Next;
+
+        POOL_INFO() : Next(0) { }
+    };
+    std::map<UINT, POOL_INFO> _pools;
+
+    ConstantBufferStats _frameStats;
+    ConstantBufferStats _stats;
+
+    void invalidateContents();
+
+public:
+    ConstantBufferAllocator();
+    ~ConstantBufferAllocator();
+
+    // Rewinds the pools, called once a frame before the first upload
+    void Reset();
+
+    // The buffer stays valid until the next reset
+    HRESULT Upload(ID3D11DeviceContext* context, const void* data, UINT size, ID3D11Buffer** buffer);
+
+    template <class T>
+    HRESULT Upload(ID3D11DeviceContext* context, const T& data, ID3D11Buffer** buffer)
+    {
+        return Upload(context, &data, sizeof(T), buffer);
+    }
+
+    // The statistics of the last frame
+    const ConstantBufferStats& GetStats() const { return _stats; }
+
+    // Makes every allocator map its buffers again, for when a frame was rendered through a context
+    // whose maps never reach the buffers
+    static void InvalidateAll();
+
+    void OnD3D11DestroyDevice();
+};
\ No newline at end of file
@@ -4,6 +4,10 @@
 
 typedef std::wstring ContentHash;
 
+// Returned when loading a compiled file written by an older version of the loader, the content
+// manager then compiles the content again
+#define CONTENT_REVISION_MISMATCH HRESULT_FROM_WIN32(ERROR_REVISION_MISMATCH)
+
 class ContentLoaderBase
 {
 private:
@@ -125,37 +125,46 @@ public:
                 return E_FAIL;
             }
 
-            // Load this content
+            // Load this content, a compiled file the loader reports as written by an older version
+            // of it is compiled again once
             contentType* content = NULL;
             WCHAR errorMsg[ERROR_MSG_LEN];
-            if (contentAvailable && !compiledAvailable)
+            bool compiled = false;
+            for (;;)
             {
-                createCompiledContentFolder(compiledPath);
-
-                std::ofstream outputStream;
-                outputStream.open(compiledPath, std::ios::out | std::ios::binary);
-                if (!outputStream.is_open())
+                if (contentAvailable && !compiledAvailable)
                 {
-                    LOG_ERROR(L"ContentManager", L"Could not open output file stream for compiled content.");
-                    return E_FAIL;
+                    createCompiledContentFolder(compiledPath);
+
+                    std::ofstream outputStream;
+                    outputStream.open(compiledPath, std::ios::out | std::ios::binary);
+                    if (!outputStream.is_open())
+                    {
+                        LOG_ERROR(L"ContentManager", L"Could not open output file stream for compiled content.");
+                        return E_FAIL;
+                    }
+
+                    if (FAILED(loader->CompileContentFile(device, NULL, fullPath.c_str(), options, errorMsg,
+                        ERROR_MSG_LEN, &outputStream)))
+                    {
+                        LOG_ERROR(L"ContentManager", errorMsg);
+                        DeleteFile(compiledPath.c_str());
+                        outputStream.close();
+                        return E_FAIL;
+                    }
+
+                    outputStream.close();
+
+                    compiledAvailable = true;
+                    compiled = true;
                 }
 
-                if (FAILED(loader->CompileContentFile(device, NULL, fullPath.c_str(), options, errorMsg,
-                    ERROR_MSG_LEN, &outputStream)))
+                if (!compiledAvailable)
                 {
-                    LOG_ERROR(L"ContentManager", errorMsg);
-                    DeleteFile(compiledPath.c_str());
-                    outputStream.close();
+                    LOG_ERROR(L"ContentManager", L"No content files or compiled content available.");
                     return E_FAIL;
                 }
 
-                outputStream.close();
-
-                compiledAvailable = true;
-            }
-
-            if (compiledAvailable)
-            {
                 std::ifstream inputStream = std::ifstream(compiledPath, std::ios::in | std::ios::binary);
                 if (!inputStream.is_open())
                 {
@@ -163,26 +172,27 @@ public:
                     return E_FAIL;
                 }
 
-                if (FAILED(loader->LoadFromCompiledContentFile(device, &inputStream, options, errorMsg,
-                    ERROR_MSG_LEN, &content)))
+                HRESULT hr = loader->LoadFromCompiledContentFile(device, &inputStream, options, errorMsg,
+                    ERROR_MSG_LEN, &content);
+                inputStream.close();
+
+                if (hr == CONTENT_REVISION_MISMATCH && contentAvailable && !compiled)
+                {
+                    LOG_INFO(L"ContentManager", L"Found a compiled content file from an older version, compiling it again.");
+                    compiledAvailable = false;
+                    continue;
+                }
+                if (FAILED(hr))
                 {
                     LOG_ERROR(L"ContentManager", errorMsg);
-                    inputStream.close();
                     return E_FAIL;
                 }
 
-                inputStream.close();
-
                 _loadedContent[hash] = content;
 
                 *ppContentOut = content;
                 return S_OK;
             }
-            else
-            {
-                LOG_ERROR(L"ContentManager", L"No content files or compiled content available.");
-                return E_FAIL;
-            }
         }
     }
 
@@ -1,5 +1,6 @@
 #include "PCH.h"
 #include "DeferredRendererApplication.h"
+#include "RenderStats.h"
 
 #include "HDRConfigurationPane.h"
 #include "MLAAConfigurationPane.h"
@@ -13,22 +14,31 @@
 #include "DeviceManagerConfigurationPane.h"
 #include "ProfilePane.h"
 
+const float DeferredRendererApplication::FIXED_TIME_STEP = 1.0f / 60.0f;
+const WCHAR* DeferredRendererApplication::RECORDED_PATH_FILE = L"camera_path.txt";
+const WCHAR* DeferredRendererApplication::TRACE_FILE = L"trace.json";
+
 DeferredRendererApplication::DeferredRendererApplication()
-    : Application(L"Deferred Renderer", NULL), _camera(0.1f, 45.0f, 1.0f, 1.0f), _selectedItem(NULL),
-    _configWindow(NULL), _logWindow(NULL), _ppConfigPane(NULL)
+    : Application(L"Deferred Renderer", NULL), _threadPool(0, L"Worker"), _simulationThreadPool(0, L"Simulation worker"),
+    _camera(0.1f, 45.0f, 1.0f, 1.0f),
+    _renderCamera(0.1f, 45.0f, 1.0f, 1.0f), _selectedItem(NULL),
+    _configWindow(NULL), _logWindow(NULL), _ppConfigPane(NULL), _recordNextFrame(false), _recordedPathStart(0.0),
+    _benchmarking(false), _benchmarkFrameCount(0), _benchmarkFrame(0), _particleBenchmarking(false),
+    _nearFarBenchmarking(false),
+    _traceOutput(TRACE_FILE), _useWARP(false), _useNullDevice(false)
 {
-    ModelInstance* tankScene = new ModelInstance(L"\\models\\tankscene\\TankScene.sdkmesh");
+    ModelInstance* tankScene = new ModelInstance(L"\\models\\tankscene\\TankScene.sdkmesh", &_transforms);
     tankScene->SetScale(1.0f);
     tankScene->SetPosition(XMFLOAT3(0, 0, 0));
 
     _models.push_back(tankScene);
 
-    ModelInstance* squid = new ModelInstance(L"\\models\\Squid\\Squid.sdkmesh");
+    ModelInstance* squid = new ModelInstance(L"\\models\\Squid\\Squid.sdkmesh", &_transforms);
     squid->SetScale(0.05f);
     squid->SetPosition(XMFLOAT3(10.0f, 0.0f, 0.0f));
     _models.push_back(squid);
 
-    ModelInstance* tree = new ModelInstance(L"\\models\\tree\\tree.obj");
+    ModelInstance* tree = new ModelInstance(L"\\models\\tree\\tree.obj", &_transforms);
     tree->SetScale(0.5f);
     tree->SetPosition(XMFLOAT3(0.0f, 2.0f, 0.0f));
 
@@ -74,6 +84,7 @@ DeferredRendererApplication::DeferredRendererApplication()
     {
         _contentHolders.push_back(_particles[i]);
         _dragables.push_back(_particles[i]);
+        _particleUpdater.AddInstance(_particles[i]);
     }
 
     for (UINT i = 0; i < _pointLightsShadowed.size(); i++)
@@ -92,6 +103,10 @@ DeferredRendererApplication::~DeferredRendererApplication()
     {
         delete _models[i];
     }
+    for (UINT i = 0; i < _stressModels.size(); i++)
+    {
+        delete _stressModels[i];
+    }
     for (UINT i = 0; i < _particles.size(); i++)
     {
         delete _particles[i];
@@ -114,12 +129,50 @@ DeferredRendererApplication::~DeferredRendererApplication()
     }
 }
 
+void DeferredRendererApplication::AddStressInstances(UINT count)
+{
+    const float spacing = 4.0f;
+    UINT gridSize = (UINT)ceilf(sqrtf((float)count));
+
+    for (UINT i = 0; i < count; i++)
+    {
+        ModelInstance* tree = new ModelInstance(L"\\models\\tree\\tree.obj", &_transforms);
+        tree->SetScale(0.5f);
+        tree->SetPosition(XMFLOAT3(((i % gridSize) - gridSize * 0.5f) * spacing, 2.0f,
+            ((i / gridSize) - gridSize * 0.5f) * spacing));
+
+        XMFLOAT4 orientation;
+        XMStoreFloat4(&orientation, XMQuaternionRotationRollPitchYaw(0.0f, RandomBetween(-Pi, Pi), 0.0f));
+        tree->SetOrientation(orientation);
+
+        _stressModels.push_back(tree);
+        _contentHolders.push_back(tree);
+    }
+}
+
+void DeferredRendererApplication::AddStressLights(UINT count)
+{
+    const float ringRadius = 15.0f;
+
+    for (UINT i = 0; i < count; i++)
+    {
+        float angle = (2.0f * Pi * i) / count;
+        XMFLOAT3 position(cosf(angle) * ringRadius, 3.0f, sinf(angle) * ringRadius);
+        XMFLOAT3 color(RandomBetween(0.25f, 1.0f), RandomBetween(0.25f, 1.0f), RandomBetween(0.25f, 1.0f));
+
+        PointLight* light = new PointLight(position, 6.0f, color, 1.0f);
+        _pointLightsShadowed.push_back(light);
+        _dragables.push_back(light);
+    }
+}
+
 void DeferredRendererApplication::OnInitialize()
 {
     // Set some properties of the renderer
     _renderer.AddLightRenderer(&_paraboloidPointLR);
     _renderer.AddLightRenderer(&_cascadedDirectionalLR);
     _renderer.AddLightRenderer(&_spotLR);
+    _renderer.SetThreadPool(&_threadPool);
 
     // Create all the UI elements
     Gwen::Controls::Canvas* canvas = _uiPP.GetCanvas();
@@ -184,6 +237,388 @@ void DeferredRendererApplication::OnPreparingDeviceSettings(DeviceManager* devic
     deviceManager->SetBackBufferWidth(1920);
     deviceManager->SetBackBufferHeight(1080);
     deviceManager->SetVSyncEnabled(false);
+
+    if (_useNullDevice)
+    {
+        deviceManager->SetDriverType(D3D_DRIVER_TYPE_NULL);
+    }
+    else if (_useWARP)
+    {
+        deviceManager->SetDriverType(D3D_DRIVER_TYPE_WARP);
+    }
+}
+
+void DeferredRendererApplication::EnableBenchmark(const WCHAR* cameraPath, UINT frameCount, const WCHAR* output)
+{
+    _benchmarking = true;
+    _benchmark.Clear();
+    _benchmarkFrameCount = max(frameCount, 1U);
+    _benchmarkFrame = 0;
+    _benchmarkOutput = output;
+
+    if (cameraPath && SUCCEEDED(_benchmarkPath.Load(cameraPath)))
+    {
+        return;
+    }
+    if (cameraPath)
+    {
+        LOG_ERROR(L"Benchmark", L"Could not load the camera path, orbiting the scene instead.");
+    }
+
+    // Circle the scene looking in at its middle
+    const UINT orbitKeys = 16;
+    const float orbitTime = 20.0f;
+    const float orbitRadius = 20.0f;
+    const float orbitHeight = 6.0f;
+    const XMFLOAT3 target = XMFLOAT3(0.0f, 1.0f, 0.0f);
+
+    _benchmarkPath.Clear();
+    for (UINT i = 0; i <= orbitKeys; i++)
+    {
+        float angle = (2.0f * Pi * i) / orbitKeys;
+        XMFLOAT3 position = XMFLOAT3(sinf(angle) * orbitRadius, orbitHeight, cosf(angle) * orbitRadius);
+
+        XMFLOAT3 dir;
+        XMStoreFloat3(&dir, XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&target), XMLoadFloat3(&position))));
+
+        XMFLOAT2 rotation = XMFLOAT2(atan2f(dir.x, dir.z), -asinf(dir.y));
+        _benchmarkPath.AddKey((orbitTime * i) / orbitKeys, position, rotation, 0.0f);
+    }
+}
+
+void DeferredRendererApplication::recordCounts(const CountFunction& record)
+{
+    const FrameGraphStats& graphStats = _renderer.GetFrameGraphStats();
+    const ShadowAtlasStats& atlasStats = _renderer.GetShadowAtlasStats();
+
+    record(L"Counts/Models", (float)(_modelConfigPane->GetModelInstanceCount() + _stressModels.size()));
+    record(L"Counts/Particle systems", (float)_particleConfigPane->GetParticleInstanceCount());
+    record(L"Counts/Simulated particles", (float)_particleUpdater.GetSimulatedParticleCount());
+    record(L"Counts/Point lights", (float)_paraboloidPointLR.GetCount());
+    record(L"Counts/Shadowed point lights", (float)_paraboloidPointLR.GetCount(true));
+    record(L"Counts/Directional lights", (float)_cascadedDirectionalLR.GetCount());
+    record(L"Counts/Shadow regions", (float)atlasStats.RegionCount);
+    record(L"Counts/Passes", (float)(graphStats.PassCount - graphStats.CulledPassCount));
+    record(L"Counts/Draw calls", (float)graphStats.DrawCalls);
+    record(L"Counts/Dispatches", (float)graphStats.Dispatches);
+    record(L"Counts/State calls", (float)(graphStats.StateCalls - graphStats.FilteredStateCalls));
+
+    // What the renderers themselves counted, the draw calls include those made outside the
+    // frame graph such as the UI
+    RenderStats* renderStats = RenderStats::GetInstance();
+    for (UINT i = 0; i < RenderCounter::Count; i++)
+    {
+        record(std::wstring(L"Render/") + RenderStats::GetCounterName(i), (float)renderStats->GetCount(i));
+    }
+
+    // On the null device every command of the frame went through the recorder
+    RecordingDeviceContext* nullContext = GetDeviceManager()->GetRecordingContext();
+    if (nullContext)
+    {
+        const RecordingStats& stats = nullContext->GetStats();
+        record(L"Recorded/Draw calls", (float)stats.DrawCalls);
+        record(L"Recorded/Dispatches", (float)stats.Dispatches);
+        record(L"Recorded/Shader binds", (float)stats.ShaderBinds);
+        record(L"Recorded/Resource binds", (float)stats.ResourceBinds);
+        record(L"Recorded/State binds", (float)stats.StateBinds);
+        record(L"Recorded/Redundant binds", (float)stats.RedundantBinds);
+        record(L"Recorded/Maps", (float)stats.Maps);
+        record(L"Recorded/Clears", (float)stats.Clears);
+        record(L"Recorded/Copies", (float)stats.Copies);
+        record(L"Recorded/Errors", (float)stats.Errors);
+    }
+}
+
+void DeferredRendererApplication::updateBenchmark()
+{
+    // The event tree and the renderer's stats are those of the last frame, they are recorded once
+    // that frame is one of the measured ones
+    if (_benchmarkFrame > BENCHMARK_WARMUP_FRAMES)
+    {
+        _benchmark.BeginFrame();
+        Logger* logger = Logger::GetInstance();
+        _benchmark.RecordEvents(logger->GetRootEvent());
+        for (UINT i = 1; i < logger->GetLaneCount(); i++)
+        {
+            _benchmark.RecordEvents(logger->GetLaneRootEvent(i), logger->GetLaneName(i));
+        }
+        recordCounts(bind(mem_fn(&Benchmark::RecordValue), &_benchmark, _1, _2));
+        _benchmark.EndFrame();
+    }
+
+    if (_benchmarkFrame >= BENCHMARK_WARMUP_FRAMES + _benchmarkFrameCount)
+    {
+        finishBenchmark();
+        return;
+    }
+
+    // The warm up frames hold the camera at the start of the path
+    UINT measuredFrame = (_benchmarkFrame > BENCHMARK_WARMUP_FRAMES) ? _benchmarkFrame - BENCHMARK_WARMUP_FRAMES : 0;
+    float progress = (_benchmarkFrameCount > 1) ? measuredFrame / (float)(_benchmarkFrameCount - 1) : 0.0f;
+    _benchmarkPath.Apply(progress * _benchmarkPath.GetDuration(), &_camera);
+
+    _benchmarkFrame++;
+}
+
+void DeferredRendererApplication::EnableParticleBenchmark(UINT iterationCount, const WCHAR* output)
+{
+    _particleBenchmarking = true;
+    _benchmark.Clear();
+    _benchmarkFrameCount = max(iterationCount, 1U);
+    _benchmarkOutput = output;
+}
+
+void DeferredRendererApplication::runParticleBenchmark()
+{
+    _particleBenchmarking = false;
+
+    ParticleSystem* system = (_particles.size() > 0) ? _particles[0]->GetParticleSystem() : NULL;
+    if (!system)
+    {
+        LOG_ERROR(L"Benchmark", L"There is no particle system to benchmark.");
+        return;
+    }
+
+    // Laid out the same way as the arrays of a particle system instance
+    UINT capacity = (PARTICLE_BENCHMARK_COUNT + 3) & ~3;
+    float* data = (float*)_aligned_malloc(PARTICLE_ARRAY_COUNT * capacity * sizeof(float), 16);
+    if (!data)
+    {
+        LOG_ERROR(L"Benchmark", L"Could not allocate the particles to benchmark.");
+        return;
+    }
+    ZeroMemory(data, PARTICLE_ARRAY_COUNT * capacity * sizeof(float));
+
+    ParticleArrays particles;
+    float** arrays = (float**)&particles;
+    for (UINT i = 0; i < PARTICLE_ARRAY_COUNT; i++)
+    {
+        arrays[i] = data + (i * capacity);
+    }
+
+    LARGE_INTEGER largeInt;
+    QueryPerformanceFrequency(&largeInt);
+    double counterFreq = (double)largeInt.QuadPart;
+
+    // Every iteration respawns all of the particles from the same seed so each one does the same
+    // work
+    XMFLOAT3 emitterPos = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    XMFLOAT4 emitterRot = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+    XMFLOAT3 wind = _particleConfigPane->GetWindVector();
+    XMFLOAT3 gravity = _particleConfigPane->GetGravityVector();
+    const float dt = 1.0f / 60.0f;
+
+    RandomStream random;
+    AxisAlignedBox bounds;
+    for (UINT i = 0; i < BENCHMARK_WARMUP_FRAMES + _benchmarkFrameCount; i++)
+    {
+        random.Seed(1);
+
+        QueryPerformanceCounter(&largeInt);
+        INT64 spawnStart = largeInt.QuadPart;
+
+        system->SpawnParticles(emitterPos, emitterRot, 1.0f, &random, &particles, 0, PARTICLE_BENCHMARK_COUNT);
+
+        QueryPerformanceCounter(&largeInt);
+        INT64 advanceStart = largeInt.QuadPart;
+
+        system->AdvanceParticles(dt, wind, gravity, &particles, PARTICLE_BENCHMARK_COUNT, &bounds);
+
+        QueryPerformanceCounter(&largeInt);
+        INT64 advanceEnd = largeInt.QuadPart;
+
+        if (i >= BENCHMARK_WARMUP_FRAMES)
+        {
+            _benchmark.BeginFrame();
+            _benchmark.RecordValue(L"Particles/Spawn", (float)((advanceStart - spawnStart) * 1000.0 / counterFreq));
+            _benchmark.RecordValue(L"Particles/Advance", (float)((advanceEnd - advanceStart) * 1000.0 / counterFreq));
+            _benchmark.RecordValue(L"Counts/Benchmarked particles", (float)PARTICLE_BENCHMARK_COUNT);
+            _benchmark.EndFrame();
+        }
+    }
+
+    _aligned_free(data);
+}
+
+void DeferredRendererApplication::EnableNearFarBenchmark(UINT sceneCount, const WCHAR* output)
+{
+    _nearFarBenchmarking = true;
+    _benchmark.Clear();
+    _benchmarkFrameCount = max(sceneCount, 1U);
+    _benchmarkOutput = output;
+}
+
+void DeferredRendererApplication::runNearFarBenchmark()
+{
+    _nearFarBenchmarking = false;
+
+    LARGE_INTEGER largeInt;
+    QueryPerformanceFrequency(&largeInt);
+    double counterFreq = (double)largeInt.QuadPart;
+
+    // Only the scene bounds are clipped, without any casters both clippers fit the same planes
+    std::vector<ModelInstance*> noModels;
+    PerspectiveCamera camera(_camera.GetNearClip(), _camera.GetFarClip(), _camera.GetFieldOfView(),
+        _camera.GetAspectRatio());
+
+    NearFarComparison total;
+    ZeroMemory(&total, sizeof(NearFarComparison));
+
+    RandomStream random;
+    for (UINT i = 0; i < BENCHMARK_WARMUP_FRAMES + _benchmarkFrameCount; i++)
+    {
+        // The warm up goes over the first scenes again so scene n is the same in every run
+        UINT sceneIdx = (i < BENCHMARK_WARMUP_FRAMES) ? (i % _benchmarkFrameCount) : (i - BENCHMARK_WARMUP_FRAMES);
+        random.Seed(sceneIdx + 1);
+
+        XMFLOAT4 r0, r1, r2;
+        XMStoreFloat4(&r0, random.NextSigned());
+        XMStoreFloat4(&r1, random.NextSigned());
+        XMStoreFloat4(&r2, random.NextSigned());
+
+        AxisAlignedBox sceneBounds;
+        sceneBounds.Center = XMFLOAT3(r0.x * 50.0f, r0.y * 10.0f, r0.z * 50.0f);
+        sceneBounds.Extents = XMFLOAT3(60.0f + r0.w * 40.0f, 15.0f + r1.x * 10.0f, 60.0f + r1.y * 40.0f);
+
+        // Inside the scene and looking roughly along the ground
+        XMFLOAT3 eye = XMFLOAT3(sceneBounds.Center.x + r1.z * sceneBounds.Extents.x * 0.5f,
+            sceneBounds.Center.y + r1.w * sceneBounds.Extents.y * 0.5f,
+            sceneBounds.Center.z + r2.x * sceneBounds.Extents.z * 0.5f);
+        XMFLOAT3 lookTo = XMFLOAT3(r2.y, r2.z * 0.5f, (r2.w >= 0.0f) ? r2.w + 0.1f : r2.w - 0.1f);
+        camera.SetLookTo(eye, lookTo, XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+        _cascadedDirectionalLR.Clear();
+        for (UINT j = 0; j < NEAR_FAR_BENCHMARK_LIGHTS; j++)
+        {
+            XMFLOAT4 r;
+            XMStoreFloat4(&r, random.NextSigned());
+
+            XMFLOAT3 dir;
+            XMStoreFloat3(&dir, XMVector3Normalize(XMVectorSet(r.x, -0.25f - fabsf(r.y) * 0.75f, r.z, 0.0f)));
+
+            DirectionalLight light = DirectionalLight(dir, XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f);
+            _cascadedDirectionalLR.Add(&light, true);
+        }
+
+        QueryPerformanceCounter(&largeInt);
+        INT64 batchedStart = largeInt.QuadPart;
+
+        _cascadedDirectionalLR.FitCascades(&camera, &noModels, &sceneBounds);
+
+        QueryPerformanceCounter(&largeInt);
+        INT64 scalarStart = largeInt.QuadPart;
+
+        NearFarComparison comparison;
+        _cascadedDirectionalLR.CompareNearAndFarPlanes(&sceneBounds, &comparison);
+
+        QueryPerformanceCounter(&largeInt);
+        INT64 scalarEnd = largeInt.QuadPart;
+
+        if (i >= BENCHMARK_WARMUP_FRAMES)
+        {
+            _benchmark.BeginFrame();
+            _benchmark.RecordValue(L"NearFar/Batched", (float)((scalarStart - batchedStart) * 1000.0 / counterFreq));
+            _benchmark.RecordValue(L"NearFar/Scalar", (float)((scalarEnd - scalarStart) * 1000.0 / counterFreq));
+            _benchmark.RecordValue(L"NearFar/Max near difference", comparison.MaxNearDifference);
+            _benchmark.RecordValue(L"NearFar/Max far difference", comparison.MaxFarDifference);
+            _benchmark.RecordValue(L"NearFar/Mismatched cascades", (float)comparison.MismatchCount);
+            _benchmark.EndFrame();
+
+            total.CascadeCount += comparison.CascadeCount;
+            total.MismatchCount += comparison.MismatchCount;
+            total.MaxNearDifference = max(total.MaxNearDifference, comparison.MaxNearDifference);
+            total.MaxFarDifference = max(total.MaxFarDifference, comparison.MaxFarDifference);
+        }
+    }
+
+    _cascadedDirectionalLR.Clear();
+
+    WCHAR msg[512];
+    swprintf_s(msg, L"Compared %u cascades in %u scenes, %u did not match the scalar clipper. The largest near and far plane differences were %f and %f.",
+        total.CascadeCount, _benchmarkFrameCount, total.MismatchCount, total.MaxNearDifference, total.MaxFarDifference);
+    if (total.MismatchCount > 0)
+    {
+        LOG_WARNING(L"Benchmark", msg);
+    }
+    else
+    {
+        LOG_INFO(L"Benchmark", msg);
+    }
+}
+
+void DeferredRendererApplication::finishBenchmark()
+{
+    _benchmarking = false;
+
+    // The statistics and errors of the last frame the null device recorded
+    RecordingDeviceContext* nullContext = GetDeviceManager()->GetRecordingContext();
+    if (nullContext)
+    {
+        logRecordedFrame(nullContext);
+    }
+
+    std::wstring csvPath = _benchmarkOutput + L".csv";
+    std::wstring jsonPath = _benchmarkOutput + L".json";
+
+    WCHAR msg[512];
+    if (SUCCEEDED(_benchmark.WriteCSV(csvPath.c_str())) && SUCCEEDED(_benchmark.WriteJSON(jsonPath.c_str())))
+    {
+        swprintf_s(msg, L"Benchmarked %u frames, %u series written to %s and %s.", _benchmark.GetFrameCount(),
+            _benchmark.GetSeriesCount(), csvPath.c_str(), jsonPath.c_str());
+        LOG_INFO(L"Benchmark", msg);
+    }
+    else
+    {
+        swprintf_s(msg, L"Could not write the benchmark results to %s.", _benchmarkOutput.c_str());
+        LOG_ERROR(L"Benchmark", msg);
+    }
+
+    stopTrace();
+
+    Exit();
+}
+
+void DeferredRendererApplication::EnableTrace(const WCHAR* output)
+{
+    _traceOutput = output;
+    startTrace();
+}
+
+void DeferredRendererApplication::startTrace()
+{
+    WCHAR msg[512];
+    if (SUCCEEDED(_trace.Begin(_traceOutput.c_str())))
+    {
+        swprintf_s(msg, L"Writing a trace of every frame to %s.", _traceOutput.c_str());
+        LOG_INFO(L"Trace", msg);
+    }
+    else
+    {
+        swprintf_s(msg, L"Could not open %s to write the trace to.", _traceOutput.c_str());
+        LOG_ERROR(L"Trace", msg);
+    }
+}
+
+void DeferredRendererApplication::stopTrace()
+{
+    if (!_trace.IsRecording())
+    {
+        return;
+    }
+
+    UINT frameCount = _trace.GetFrameCount();
+
+    WCHAR msg[512];
+    if (SUCCEEDED(_trace.End()))
+    {
+        swprintf_s(msg, L"Traced %u frames to %s.", frameCount, _traceOutput.c_str());
+        LOG_INFO(L"Trace", msg);
+    }
+    else
+    {
+        swprintf_s(msg, L"Could not write the trace to %s.", _traceOutput.c_str());
+        LOG_ERROR(L"Trace", msg);
+    }
 }
 
 void DeferredRendererApplication::OnFrameMove(double totalTime, float dt)
@@ -196,21 +631,32 @@ void DeferredRendererApplication::OnFrameMove(double totalTime, float dt)
 
     _camera.StoreMatrices();
 
-    BEGIN_EVENT(L"Update Models");
-    for (UINT i = 0; i < _models.size(); i++)
+    // The particle and near/far benchmarks run in one go once the content has loaded
+    if (_particleBenchmarking)
     {
-        _models[i]->StoreWorld();
+        runParticleBenchmark();
+        finishBenchmark();
+        return;
     }
-    END_EVENT(L"");
 
-    BEGIN_EVENT(L"Update Particles");
-    XMFLOAT3 wind = _particleConfigPane->GetWindVector();
-    XMFLOAT3 grav = _particleConfigPane->GetGravityVector();
-    for (UINT i = 0; i < _particleConfigPane->GetParticleInstanceCount(); i++)
+    if (_nearFarBenchmarking)
     {
-        _particleConfigPane->GetParticleInstance(i)->AdvanceSystem(wind, grav, dt);
+        runNearFarBenchmark();
+        finishBenchmark();
+        return;
+    }
+
+    if (_benchmarking)
+    {
+        updateBenchmark();
+    }
+
+    // Like the benchmark, the trace is given the events and counts of the last frame
+    if (_trace.IsRecording())
+    {
+        _trace.RecordFrame(Logger::GetInstance());
+        recordCounts(bind(mem_fn(&TraceRecorder::RecordCounter), &_trace, _1, _2));
     }
-    END_EVENT(L"");
 
     if (IsActive() && mouse.IsOverWindow())
     {
@@ -236,6 +682,51 @@ void DeferredRendererApplication::OnFrameMove(double totalTime, float dt)
             _ppConfigPane->SetPostProcessEnabled(&_uiPP, !uiEnabled);
         }
 
+        if (kb.IsKeyJustPressed(Keys::R))
+        {
+            _recordNextFrame = true;
+        }
+
+        if (kb.IsKeyJustPressed(Keys::K))
+        {
+            if (_recordedPath.GetKeyCount() == 0)
+            {
+                _recordedPathStart = totalTime;
+            }
+            _recordedPath.AddKey((float)(totalTime - _recordedPathStart), &_camera);
+
+            WCHAR msg[256];
+            if (SUCCEEDED(_recordedPath.Save(RECORDED_PATH_FILE)))
+            {
+                swprintf_s(msg, L"Saved camera path with %u keys to %s.", _recordedPath.GetKeyCount(), RECORDED_PATH_FILE);
+                LOG_INFO(L"Application", msg);
+            }
+            else
+            {
+                swprintf_s(msg, L"Could not save the camera path to %s.", RECORDED_PATH_FILE);
+                LOG_ERROR(L"Application", msg);
+            }
+        }
+
+        if (kb.IsKeyJustPressed(Keys::T))
+        {
+            if (_trace.IsRecording())
+            {
+                stopTrace();
+            }
+            else
+            {
+                startTrace();
+            }
+        }
+
+        if (kb.IsKeyJustPressed(Keys::P))
+        {
+            SetPipelined(!GetPipelined());
+            LOG_INFO(L"Application", GetPipelined() ? L"Simulating on its own thread." :
+                L"Simulating on the main thread.");
+        }
+
         if (mouse.IsButtonDown(MouseButton::RightButton))
         {
             const float mouseRotateSpeed = _camera.GetRotationSpeed();
@@ -360,6 +851,51 @@ void DeferredRendererApplication::OnFrameMove(double totalTime, float dt)
 
         END_EVENT(L"");
     }
+
+}
+
+void DeferredRendererApplication::OnFrameSimulate(double totalTime, float dt)
+{
+    // The camera was finalized by the frame move so the particles can be culled and sorted along
+    // with their simulation
+    BEGIN_EVENT(L"Update Particles");
+    _particleUpdater.Update(&_simulationThreadPool, &_camera, _particleConfigPane->GetWindVector(),
+        _particleConfigPane->GetGravityVector(), dt);
+    END_EVENT(L"");
+}
+
+void DeferredRendererApplication::OnFrameSnapshot()
+{
+    // Only the frame move changes the models so their transforms are rebuilt here, once a frame
+    // no matter how many steps were simulated, and are left alone while the frame renders
+    BEGIN_EVENT(L"Update Models");
+    _transforms.Update(&_threadPool);
+    END_EVENT(L"");
+
+    _particleUpdater.Publish();
+
+    _renderCamera = _camera;
+
+    _renderPointLightsShadowed.clear();
+    for (UINT i = 0; i < _pointLightsShadowed.size(); i++)
+    {
+        _renderPointLightsShadowed.push_back(*_pointLightsShadowed[i]);
+    }
+    _renderPointLightsUnshadowed.clear();
+    for (UINT i = 0; i < _pointLightsUnshadowed.size(); i++)
+    {
+        _renderPointLightsUnshadowed.push_back(*_pointLightsUnshadowed[i]);
+    }
+    _renderDirLightsShadowed.clear();
+    for (UINT i = 0; i < _dirLightsShadowed.size(); i++)
+    {
+        _renderDirLightsShadowed.push_back(*_dirLightsShadowed[i]);
+    }
+    _renderDirLightsUnshadowed.clear();
+    for (UINT i = 0; i < _dirLightsUnshadowed.size(); i++)
+    {
+        _renderDirLightsUnshadowed.push_back(*_dirLightsUnshadowed[i]);
+    }
 }
 
 LRESULT DeferredRendererApplication::OnMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -374,10 +910,40 @@ LRESULT DeferredRendererApplication::OnMessage(HWND hWnd, UINT msg, WPARAM wPara
     return Application::OnMessage(hWnd, msg, wParam, lParam);
 }
 
+void DeferredRendererApplication::logRecordedFrame(const RecordingDeviceContext* recorder)
+{
+    const RecordingStats& stats = recorder->GetStats();
+
+    WCHAR msg[512];
+    swprintf_s(msg, L"Recorded frame: %u draws, %u dispatches, %u shader binds, %u resource binds, "
+        L"%u state binds (%u redundant), %u maps, %u clears, %u copies, %u errors", stats.DrawCalls,
+        stats.Dispatches, stats.ShaderBinds, stats.ResourceBinds, stats.StateBinds, stats.RedundantBinds, stats.Maps,
+        stats.Clears, stats.Copies, stats.Errors);
+    LOG_INFO(L"Recording", msg);
+
+    // The recorder sits behind the frame graph's state cache, the binds it counted are the ones
+    // that were not filtered
+    const FrameGraphStats& graphStats = _renderer.GetFrameGraphStats();
+    swprintf_s(msg, L"State cache: %u of %u binds filtered", graphStats.FilteredStateCalls, graphStats.StateCalls);
+    LOG_INFO(L"Recording", msg);
+
+    for (UINT i = 0; i < recorder->GetErrorCount(); i++)
+    {
+        LOG_WARNING(L"Recording", recorder->GetError(i).c_str());
+    }
+}
+
 HRESULT DeferredRendererApplication::OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
 {
     HRESULT hr;
 
+    // The null device's context records every frame, only the last one is counted
+    RecordingDeviceContext* nullContext = GetDeviceManager()->GetRecordingContext();
+    if (nullContext)
+    {
+        nullContext->ResetStats();
+    }
+
     BEGIN_EVENT(L"Prepare scene");
 
     V_RETURN(_renderer.Begin());
@@ -398,6 +964,10 @@ HRESULT DeferredRendererApplication::OnD3D11FrameRender(ID3D11Device* pd3dDevice
             model->FillBoundingObjectSet(&boSet);
         }
     }
+    for (UINT i = 0; i < _stressModels.size(); i++)
+    {
+        _renderer.AddModel(_stressModels[i]);
+    }
 
     for (UINT i = 0; i < _particleConfigPane->GetParticleInstanceCount(); i++)
     {
@@ -410,32 +980,32 @@ HRESULT DeferredRendererApplication::OnD3D11FrameRender(ID3D11Device* pd3dDevice
         }
     }
 
-    for (UINT i = 0; i < _pointLightsShadowed.size(); i++)
+    for (UINT i = 0; i < _renderPointLightsShadowed.size(); i++)
     {
-        _renderer.AddLight(_pointLightsShadowed[i], true);
+        _renderer.AddLight(&_renderPointLightsShadowed[i], true);
 
         if (_boConfigPane->GetLightsEnabled())
         {
-            _pointLightsShadowed[i]->FillBoundingObjectSet(&boSet);
+            _renderPointLightsShadowed[i].FillBoundingObjectSet(&boSet);
         }
     }
-    for (UINT i = 0; i < _pointLightsUnshadowed.size(); i++)
+    for (UINT i = 0; i < _renderPointLightsUnshadowed.size(); i++)
     {
-        _renderer.AddLight(_pointLightsUnshadowed[i], false);
+        _renderer.AddLight(&_renderPointLightsUnshadowed[i], false);
 
         if (_boConfigPane->GetLightsEnabled())
         {
-            _pointLightsUnshadowed[i]->FillBoundingObjectSet(&boSet);
+            _renderPointLightsUnshadowed[i].FillBoundingObjectSet(&boSet);
         }
     }
 
-    for (UINT i = 0; i < _dirLightsShadowed.size(); i++)
+    for (UINT i = 0; i < _renderDirLightsShadowed.size(); i++)
     {
-        _renderer.AddLight(_dirLightsShadowed[i], true);
+        _renderer.AddLight(&_renderDirLightsShadowed[i], true);
     }
-    for (UINT i = 0; i < _dirLightsUnshadowed.size(); i++)
+    for (UINT i = 0; i < _renderDirLightsUnshadowed.size(); i++)
     {
-        _renderer.AddLight(_dirLightsUnshadowed[i], false);
+        _renderer.AddLight(&_renderDirLightsUnshadowed[i], false);
     }
 
     _boPP.Clear();
@@ -460,9 +1030,26 @@ HRESULT DeferredRendererApplication::OnD3D11FrameRender(ID3D11Device* pd3dDevice
 
     END_EVENT(L"");
 
-    BEGIN_EVENT(L"Render scene");
-    V_RETURN(_renderer.End(pd3dImmediateContext, &_camera));
-    END_EVENT(L"");
+    if (_recordNextFrame)
+    {
+        // The frame is sent to the recorder instead of the GPU, so it is not presented
+        BEGIN_EVENT(L"Record scene");
+        _recorder.Reset(pd3dDevice, pd3dImmediateContext);
+        V_RETURN(_renderer.End(&_recorder, &_renderCamera));
+        END_EVENT(L"");
+
+        logRecordedFrame(&_recorder);
+        _recordNextFrame = false;
+
+        // None of the constants uploaded for the frame reached their buffers
+        ConstantBufferAllocator::InvalidateAll();
+    }
+    else
+    {
+        BEGIN_EVENT(L"Render scene");
+        V_RETURN(_renderer.End(pd3dImmediateContext, &_renderCamera));
+        END_EVENT(L"");
+    }
 
     return S_OK;
 }
@@ -514,6 +1101,7 @@ HRESULT DeferredRendererApplication::OnD3D11ResizedSwapChain(ID3D11Device* pd3dD
 
     float fAspectRatio = pBackBufferSurfaceDesc->Width / (float)pBackBufferSurfaceDesc->Height;
     _camera.SetAspectRatio(fAspectRatio);
+    _renderCamera.SetAspectRatio(fAspectRatio);
 
     Gwen::Controls::Canvas* canvas = _uiPP.GetCanvas();
     XMFLOAT2 sizePerc = XMFLOAT2((float)pBackBufferSurfaceDesc->Width / canvas->Width(),
@@ -542,8 +1130,155 @@ void DeferredRendererApplication::OnD3D11ReleasingSwapChain(ContentManager* pCon
     }
 }
 
+// Finds the value following a flag on the command line, which may be quoted
+static bool getCommandLineValue(const WCHAR* cmdLine, const WCHAR* flag, std::wstring* value)
+{
+    const WCHAR* pos = wcsstr(cmdLine, flag);
+    if (!pos)
+    {
+        return false;
+    }
+
+    pos += wcslen(flag);
+    while (*pos == L' ')
+    {
+        pos++;
+    }
+
+    WCHAR end = L' ';
+    if (*pos == L'"')
+    {
+        end = L'"';
+        pos++;
+    }
+
+    const WCHAR* valueEnd = pos;
+    while (*valueEnd && *valueEnd != end)
+    {
+        valueEnd++;
+    }
+
+    value->assign(pos, valueEnd);
+    return !value->empty();
+}
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
     DeferredRendererApplication app;
+
+    // -stress fills the scene with enough instances to need several batches per pass
+    if (wcsstr(lpCmdLine, L"-stress"))
+    {
+        app.AddStressInstances(DeferredRendererApplication::STRESS_INSTANCE_COUNT);
+    }
+
+    // -shadowlights adds enough shadowed point lights that they have to share the shadow atlas
+    if (wcsstr(lpCmdLine, L"-shadowlights"))
+    {
+        app.AddStressLights(DeferredRendererApplication::STRESS_LIGHT_COUNT);
+    }
+
+    // -pipelined simulates each frame on its own thread while the frame before it renders, P
+    // switches it at runtime
+    if (wcsstr(lpCmdLine, L"-pipelined"))
+    {
+        app.SetPipelined(true);
+    }
+
+    // -fixedstep simulates the particles in fixed steps rather than once a frame
+    if (wcsstr(lpCmdLine, L"-fixedstep"))
+    {
+        app.SetFixedTimeStep(DeferredRendererApplication::FIXED_TIME_STEP);
+    }
+
+    // -headless renders without showing the window, -warp renders on the CPU for machines
+    // without a GPU and -nulldevice records the frames without rendering them at all
+    if (wcsstr(lpCmdLine, L"-headless"))
+    {
+        app.SetHeadless(true);
+    }
+    if (wcsstr(lpCmdLine, L"-warp"))
+    {
+        app.SetUseWARP(true);
+    }
+    if (wcsstr(lpCmdLine, L"-nulldevice"))
+    {
+        // Nothing would ever be presented to the window
+        app.SetHeadless(true);
+        app.SetUseNullDevice(true);
+    }
+
+    // -benchmark [-campath <file>] [-frames <count>] [-benchout <path>] follows a camera path and
+    // writes the timings and counts of every frame to <path>.csv and <path>.json
+    if (wcsstr(lpCmdLine, L"-benchmark"))
+    {
+        std::wstring cameraPath, frames, output;
+        bool hasPath = getCommandLineValue(lpCmdLine, L"-campath", &cameraPath);
+
+        UINT frameCount = DeferredRendererApplication::BENCHMARK_FRAME_COUNT;
+        if (getCommandLineValue(lpCmdLine, L"-frames", &frames))
+        {
+            frameCount = (UINT)_wtoi(frames.c_str());
+        }
+        if (!getCommandLineValue(lpCmdLine, L"-benchout", &output))
+        {
+            output = L"benchmark";
+        }
+
+        app.EnableBenchmark(hasPath ? cameraPath.c_str() : NULL, frameCount, output.c_str());
+    }
+
+    // -particlebench [-frames <count>] [-benchout <path>] times spawning and advancing 100,000
+    // particles count times and writes the timings to <path>.csv and <path>.json
+    if (wcsstr(lpCmdLine, L"-particlebench"))
+    {
+        std::wstring frames, output;
+
+        UINT iterationCount = DeferredRendererApplication::BENCHMARK_FRAME_COUNT;
+        if (getCommandLineValue(lpCmdLine, L"-frames", &frames))
+        {
+            iterationCount = (UINT)_wtoi(frames.c_str());
+        }
+        if (!getCommandLineValue(lpCmdLine, L"-benchout", &output))
+        {
+            output = L"particlebench";
+        }
+
+        app.EnableParticleBenchmark(iterationCount, output.c_str());
+    }
+
+    // -nearfarbench [-frames <count>] [-benchout <path>] fits the cascades of three lights to
+    // count generated scenes, compares the batched near/far clipper against the scalar one and
+    // writes the timings and differences to <path>.csv and <path>.json
+    if (wcsstr(lpCmdLine, L"-nearfarbench"))
+    {
+        std::wstring frames, output;
+
+        UINT sceneCount = DeferredRendererApplication::BENCHMARK_FRAME_COUNT;
+        if (getCommandLineValue(lpCmdLine, L"-frames", &frames))
+        {
+            sceneCount = (UINT)_wtoi(frames.c_str());
+        }
+        if (!getCommandLineValue(lpCmdLine, L"-benchout", &output))
+        {
+            output = L"nearfarbench";
+        }
+
+        app.EnableNearFarBenchmark(sceneCount, output.c_str());
+    }
+
+    // -trace [-traceout <file>] writes the events and counts of every frame to a Chrome trace,
+    // until T is pressed or the benchmark finishes
+    if (wcsstr(lpCmdLine, L"-trace"))
+    {
+        std::wstring output;
+        if (!getCommandLineValue(lpCmdLine, L"-traceout", &output))
+        {
+            output = DeferredRendererApplication::TRACE_FILE;
+        }
+
+        app.EnableTrace(output.c_str());
+    }
+
     app.Start();
 }
\ No newline at end of file
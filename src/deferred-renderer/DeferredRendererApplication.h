@@ -6,6 +6,13 @@
 #include "TestingCamera.h"
 #include "KeyboardState.h"
 #include "MouseState.h"
+#include "ThreadPool.h"
+#include "TransformSystem.h"
+#include "ParticleUpdater.h"
+#include "RecordingDeviceContext.h"
+#include "CameraPath.h"
+#include "Benchmark.h"
+#include "TraceRecorder.h"
 
 #include "ParticleCombinePostProcess.h"
 #include "HDRPostProcess.h"
@@ -42,9 +49,68 @@
 class DeferredRendererApplication : public Application
 {
 private:
+    // The renderer's frame graph and the simulation can run at the same time when the frame is
+    // pipelined, and a pool can only be used by one of them at a time
+    ThreadPool _threadPool;
+    ThreadPool _simulationThreadPool;
+    TransformSystem _transforms;
+    ParticleUpdater _particleUpdater;
+
     Renderer _renderer;
     TestingCamera _camera;
 
+    // The camera and lights as they were when the frame was snapshotted, the ones above are
+    // already being moved for the next frame while this one renders
+    TestingCamera _renderCamera;
+    std::vector<PointLight> _renderPointLightsShadowed;
+    std::vector<PointLight> _renderPointLightsUnshadowed;
+    std::vector<DirectionalLight> _renderDirLightsShadowed;
+    std::vector<DirectionalLight> _renderDirLightsUnshadowed;
+
+    // Pressing R sends the next frame to the recorder and logs what it was made of
+    RecordingDeviceContext _recorder;
+    bool _recordNextFrame;
+    void logRecordedFrame(const RecordingDeviceContext* recorder);
+
+    // Pressing K adds the camera to the end of the recorded path and saves it
+    CameraPath _recordedPath;
+    double _recordedPathStart;
+
+    // The camera follows the benchmark path through the measured frames, the path is stepped by
+    // frame rather than by time so every run renders the same frames
+    bool _benchmarking;
+    Benchmark _benchmark;
+    CameraPath _benchmarkPath;
+    UINT _benchmarkFrameCount;
+    UINT _benchmarkFrame;
+    std::wstring _benchmarkOutput;
+    void updateBenchmark();
+    void finishBenchmark();
+
+    // Times spawning and advancing a fixed number of particles of the first particle system, in
+    // place of the camera path
+    bool _particleBenchmarking;
+    void runParticleBenchmark();
+
+    // Fits the cascades of the directional light renderer to generated scenes and compares the
+    // near and far planes of the batched clipper against the scalar one, in place of the camera
+    // path
+    bool _nearFarBenchmarking;
+    void runNearFarBenchmark();
+
+    // Pressing T starts or stops writing the events and counts of every frame to a trace
+    TraceRecorder _trace;
+    std::wstring _traceOutput;
+    void startTrace();
+    void stopTrace();
+
+    // Reports the scene and renderer counts of the last frame to the benchmark or the trace
+    typedef std::tr1::function<void (const std::wstring& name, float value)> CountFunction;
+    void recordCounts(const CountFunction& record);
+
+    bool _useWARP;
+    bool _useNullDevice;
+
     std::vector<PointLight*> _pointLightsShadowed;
     std::vector<PointLight*> _pointLightsUnshadowed;
 
@@ -54,6 +120,9 @@ private:
     std::vector<ModelInstance*> _models;
     std::vector<ParticleSystemInstance*> _particles;
 
+    // Instances added to stress the renderers, they are left out of the configuration panes
+    std::vector<ModelInstance*> _stressModels;
+
     std::vector<IDragable*> _dragables;
 
     std::vector<IHasContent*> _contentHolders;
@@ -99,10 +168,57 @@ protected:
     void OnPreparingContentManager(ContentManager* contentManager);
     void OnPreparingDeviceSettings(DeviceManager* deviceManager);
 
+    void OnFrameSimulate(double totalTime, float dt);
+    void OnFrameSnapshot();
+
 public:
+    static const UINT STRESS_INSTANCE_COUNT = 50000;
+    static const UINT STRESS_LIGHT_COUNT = 48;
+
+    static const float FIXED_TIME_STEP;
+
+    static const UINT BENCHMARK_FRAME_COUNT = 1000;
+    static const UINT BENCHMARK_WARMUP_FRAMES = 30;
+    static const UINT PARTICLE_BENCHMARK_COUNT = 100000;
+    static const UINT NEAR_FAR_BENCHMARK_LIGHTS = 3;
+    static const WCHAR* RECORDED_PATH_FILE;
+    static const WCHAR* TRACE_FILE;
+
     DeferredRendererApplication();
     ~DeferredRendererApplication();
 
+    // Fills a grid around the scene with copies of the tree, must be called before Start
+    void AddStressInstances(UINT count);
+
+    // Places shadowed point lights in a ring around the scene, must be called before Start
+    void AddStressLights(UINT count);
+
+    // Plays the camera path, or an orbit of the scene when no path is given, for the given number
+    // of frames after a short warm up. The results are written to the output path with .csv and
+    // .json appended and the application then exits. Must be called before Start.
+    void EnableBenchmark(const WCHAR* cameraPath, UINT frameCount, const WCHAR* output);
+
+    // Spawns and advances PARTICLE_BENCHMARK_COUNT particles for the given number of iterations
+    // after a short warm up, once the content is loaded. The results are written like those of
+    // the benchmark and the application then exits. Must be called before Start.
+    void EnableParticleBenchmark(UINT iterationCount, const WCHAR* output);
+
+    // Fits the cascades of NEAR_FAR_BENCHMARK_LIGHTS lights to the given number of scenes that
+    // are generated from fixed seeds, so every run sees the same scenes. The timings of both
+    // clippers and the largest differences between their planes are written like the results
+    // of the benchmark and the application then exits. Must be called before Start.
+    void EnableNearFarBenchmark(UINT sceneCount, const WCHAR* output);
+
+    // Writes a trace of every frame from now until T is pressed or a benchmark finishes
+    void EnableTrace(const WCHAR* output);
+
+    // Creates the device on the WARP software rasterizer, must be called before Start
+    void SetUseWARP(bool useWARP) { _useWARP = useWARP; }
+
+    // Creates a NullDevice that records every frame instead of rendering it, so the CPU side of
+    // the renderer can be benchmarked without a GPU. Must be called before Start.
+    void SetUseNullDevice(bool useNullDevice) { _useNullDevice = useNullDevice; }
+
     void OnFrameMove(double totalTime, float dt);
     LRESULT OnMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -1,5 +1,6 @@
 #include "PCH.h"
 #include "DeviceManager.h"
+#include "NullDevice.h"
 
 DeviceManager::DeviceManager()
     : _backBufferFormat(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB), _backBufferWidth(1280),
@@ -7,7 +8,7 @@ DeviceManager::DeviceManager()
     _featureLevel(D3D_FEATURE_LEVEL_11_0), _minFeatureLevel(D3D_FEATURE_LEVEL_10_0),
     _autoDSFormat(DXGI_FORMAT_D24_UNORM_S8_UINT), _useAutoDSAsSR(false), _vsync(true),
     _device(NULL), _immediateContext(NULL), _swapChain(NULL), _backBufferRTV(NULL), _autoDSTexture(NULL),
-    _autoDSView(NULL), _autoDSSRView(NULL)
+    _autoDSView(NULL), _autoDSSRView(NULL), _driverType(D3D_DRIVER_TYPE_HARDWARE)
 {
     _refreshRate.Numerator = 60;
     _refreshRate.Denominator = 1;
@@ -17,6 +18,19 @@ HRESULT DeviceManager::Initialize(HWND outputWindow)
 {
     HRESULT hr = S_OK;
 
+    // The runtime's own null driver cannot create a swap chain and needs the SDK layers, the null
+    // device here has no swap chain either and renders to a back buffer that is never presented
+    if (_driverType == D3D_DRIVER_TYPE_NULL)
+    {
+        _featureLevel = D3D_FEATURE_LEVEL_11_0;
+        _device = new NullDevice(_featureLevel);
+        _device->GetImmediateContext(&_immediateContext);
+
+        V_RETURN(afterReset());
+
+        return S_OK;
+    }
+
     D3D_FEATURE_LEVEL featureLevels[] =
     {
         D3D_FEATURE_LEVEL_11_0,
@@ -47,7 +61,7 @@ HRESULT DeviceManager::Initialize(HWND outputWindow)
     createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
-    hr = D3D11CreateDeviceAndSwapChain(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, createDeviceFlags, featureLevels,
+    hr = D3D11CreateDeviceAndSwapChain(NULL, _driverType, NULL, createDeviceFlags, featureLevels,
         numFeatureLevels, D3D11_SDK_VERSION, &desc, &_swapChain, &_device, &_featureLevel, &_immediateContext);
     if(FAILED(hr))
     {
@@ -104,7 +118,7 @@ HRESULT DeviceManager::Reset()
 {
     HRESULT hr;
 
-    if (!_swapChain)
+    if (!_device)
     {
         return E_FAIL;
     }
@@ -120,6 +134,12 @@ HRESULT DeviceManager::Reset()
     _refreshRate.Numerator = 60;
     _refreshRate.Denominator = 1;
 
+    if (!_swapChain)
+    {
+        V_RETURN(afterReset());
+        return S_OK;
+    }
+
     V_RETURN(_swapChain->SetFullscreenState(_fullScreen, NULL));
 
     V_RETURN(_swapChain->ResizeBuffers(2, _backBufferWidth, _backBufferHeight, _backBufferFormat,
@@ -147,9 +167,10 @@ HRESULT DeviceManager::Present()
 {
     HRESULT hr;
 
+    // The null device has nothing to present to
     if (!_swapChain)
     {
-        return E_FAIL;
+        return _device ? S_OK : E_FAIL;
     }
 
     V_RETURN(_swapChain->Present(_vsync ? 1 : 0, 0));
@@ -162,7 +183,28 @@ HRESULT DeviceManager::afterReset()
     HRESULT hr;
 
     ID3D11Texture2D* pBackBuffer = NULL;
-    V_RETURN(_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)(&pBackBuffer)));
+    if (_swapChain)
+    {
+        V_RETURN(_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)(&pBackBuffer)));
+    }
+    else
+    {
+        D3D11_TEXTURE2D_DESC bbDesc =
+        {
+            _backBufferWidth,//UINT Width;
+            _backBufferHeight,//UINT Height;
+            1,//UINT MipLevels;
+            1,//UINT ArraySize;
+            _backBufferFormat,//DXGI_FORMAT Format;
+            _msCount,//DXGI_SAMPLE_DESC SampleDesc;
+            _msQuality,
+            D3D11_USAGE_DEFAULT,//D3D11_USAGE Usage;
+            D3D11_BIND_RENDER_TARGET,//UINT BindFlags;
+            0,//UINT CPUAccessFlags;
+            0//UINT MiscFlags;
+        };
+        V_RETURN(_device->CreateTexture2D(&bbDesc, NULL, &pBackBuffer));
+    }
 
     V_RETURN(_device->CreateRenderTargetView(pBackBuffer, NULL, &_backBufferRTV));
 
@@ -273,4 +315,14 @@ HRESULT DeviceManager::afterReset()
     _backBufferSurfaceDesc.SampleDesc.Quality = _msQuality;
 
     return S_OK;
+}
+
+RecordingDeviceContext* DeviceManager::GetRecordingContext() const
+{
+    if (_driverType != D3D_DRIVER_TYPE_NULL || !_device)
+    {
+        return NULL;
+    }
+
+    return static_cast<NullDevice*>(_device)->GetRecordingContext();
 }
\ No newline at end of file
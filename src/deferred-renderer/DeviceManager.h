@@ -2,6 +2,8 @@
 
 #include "PCH.h"
 
+class RecordingDeviceContext;
+
 class DeviceManager
 {
 private:
@@ -32,6 +34,8 @@ private:
     D3D_FEATURE_LEVEL _featureLevel;
     D3D_FEATURE_LEVEL _minFeatureLevel;
 
+    D3D_DRIVER_TYPE _driverType;
+
     HRESULT checkForSuitableOutput();
     HRESULT afterReset();
 
@@ -53,6 +57,11 @@ public:
     ID3D11ShaderResourceView* GetAutoDepthStencilSRView() const { return _autoDSSRView; }
     D3D_FEATURE_LEVEL GetFeatureLevel() const { return _featureLevel; }
     D3D_FEATURE_LEVEL GetMinFeatureLevel() const { return _minFeatureLevel; }
+    D3D_DRIVER_TYPE GetDriverType() const { return _driverType; }
+
+    // The immediate context of the null device, which records every frame instead of rendering
+    // it. NULL for any other driver type.
+    RecordingDeviceContext* GetRecordingContext() const;
     const DXGI_SURFACE_DESC* GetBackBufferSurfaceDesc() const { return &_backBufferSurfaceDesc; }
     DXGI_FORMAT GetBackBufferFormat() const    { return _backBufferFormat; }
     UINT GetBackBufferWidth() const    { return _backBufferWidth; }
@@ -76,4 +85,8 @@ public:
     void SetFullScreen(bool enabled) { _fullScreen = enabled; }
     void SetVSyncEnabled(bool enabled) { _vsync = enabled; }
     void SetMinFeatureLevel(D3D_FEATURE_LEVEL level) { _minFeatureLevel = level; }
+
+    // Only read when the device is initialized, WARP renders on the CPU on machines without a GPU
+    // and NULL creates a NullDevice that records the frames without rendering or presenting them
+    void SetDriverType(D3D_DRIVER_TYPE type) { _driverType = type; }
 };
\ No newline at end of file
@@ -1,31 +1,69 @@
 #include "PCH.h"
 #include "DualParaboloidPointLightRenderer.h"
 #include "Logger.h"
+#include "RenderStats.h"
+#include "ModelLoader.h"
 
 const float DualParaboloidPointLightRenderer::BIAS = 0.02f;
 
 DualParaboloidPointLightRenderer::DualParaboloidPointLightRenderer()
-    : _depthPS(NULL), _alphaCutoutPropertiesBuffer(NULL), _depthPropertiesBuffer(NULL),
-    _vertexShader(NULL), _unshadowedPS(NULL), _shadowedPS(NULL), _modelPropertiesBuffer(NULL),
-    _lightPropertiesBuffer(NULL), _cameraPropertiesBuffer(NULL),
-    _lightModel(L"\\models\\sphere\\sphere.sdkmesh")
+    : _depthPS(NULL), _alphaCutoutPropertiesBuffer(NULL), _vertexShader(NULL), _unshadowedPS(NULL),
+    _shadowedPS(NULL), _cameraPropertiesBuffer(NULL), _lightModel(NULL), _shadowAtlas(NULL)
 {
     for (UINT i = 0; i < 2; i++)
     {
         _depthVS[i] = NULL;
     }
+}
+
+void DualParaboloidPointLightRenderer::RequestShadowMaps(ShadowAtlas* atlas, Camera* camera)
+{
+    _shadowAtlas = atlas;
+    _shadows.resize(GetCount(true));
+
+    XMFLOAT4X4 fProj = camera->GetProjection();
+    XMMATRIX proj = XMLoadFloat4x4(&fProj);
+
+    Frustum cameraFrust;
+    Collision::ComputeFrustumFromProjection(&cameraFrust, &proj);
+    cameraFrust.Origin = camera->GetPosition();
+    cameraFrust.Orientation = camera->GetOrientation();
 
-    for (UINT i = 0; i < NUM_SHADOW_MAPS; i++)
+    XMVECTOR cameraPos = XMLoadFloat3(&cameraFrust.Origin);
+
+    for (UINT i = 0; i < GetCount(true); i++)
     {
-        _shadowMapDSVs[i] = NULL;
-        _shadowMapSRVs[i] = NULL;
+        PointLight* light = GetLight(i, true);
+        _shadows[i].Request = ShadowAtlas::INVALID_REQUEST;
+
+        // Lights outside of the view get no shadow map
+        Sphere lightSphere;
+        lightSphere.Center = light->GetPosition();
+        lightSphere.Radius = light->GetRadius();
+        if (!Collision::IntersectSphereFrustum(&lightSphere, &cameraFrust))
+        {
+            continue;
+        }
+
+        // Estimate how much of the screen height the light's sphere covers
+        float dist = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&lightSphere.Center), cameraPos)));
+
+        float coverage = 1.0f;
+        if (dist > lightSphere.Radius)
+        {
+            float tanAngle = lightSphere.Radius / sqrtf(dist * dist - lightSphere.Radius * lightSphere.Radius);
+            coverage = saturate(tanAngle * fProj._22);
+        }
+
+        float priority = coverage * light->GetShadowImportance();
+        _shadows[i].Request = atlas->Request((UINT)(priority * MAX_SHADOW_MAP_SIZE), 2, priority);
     }
 }
 
 HRESULT DualParaboloidPointLightRenderer::RenderGeometryShadowMaps(ID3D11DeviceContext* pd3dImmediateContext,
                                                                    std::vector<ModelInstance*>* models, Camera* camera, AxisAlignedBox* sceneBounds)
 {
-    if (GetCount(true) > 0)
+    if (GetCount(true) > 0 && _shadowAtlas)
     {
         BEGIN_EVENT_D3D(L"Point Light Shadow Maps");
 
@@ -34,10 +72,13 @@ HRESULT DualParaboloidPointLightRenderer::RenderGeometryShadowMaps(ID3D11DeviceC
         UINT nViewPorts = 1;
         pd3dImmediateContext->RSGetViewports(&nViewPorts, vpOld);
 
+        // The atlas has already been cleared, each light only draws into its own regions
+        pd3dImmediateContext->OMSetRenderTargets(0, NULL, _shadowAtlas->GetDSV());
+
         // Iterate over the lights and render the shadow maps
-        for (UINT i = 0; i < GetCount(true) && i < NUM_SHADOW_MAPS; i++)
+        for (UINT i = 0; i < GetCount(true) && i < _shadows.size(); i++)
         {
-            renderDepth(pd3dImmediateContext, GetLight(i, true), i, models, camera, sceneBounds);
+            renderDepth(pd3dImmediateContext, GetLight(i, true), &_shadows[i], models);
         }
 
         // Re-apply the old viewport
@@ -49,35 +90,27 @@ HRESULT DualParaboloidPointLightRenderer::RenderGeometryShadowMaps(ID3D11DeviceC
 }
 
 HRESULT DualParaboloidPointLightRenderer::renderDepth(ID3D11DeviceContext* pd3dImmediateContext, PointLight* light,
-                                                      UINT shadowMapIdx, std::vector<ModelInstance*>* models, Camera* camera, AxisAlignedBox* sceneBounds)
+                                                      SHADOW_INFO* shadow, std::vector<ModelInstance*>* models)
 {
     HRESULT hr;
     D3D11_MAPPED_SUBRESOURCE mappedResource;
 
+    // Lights that are not visible or did not fit in the atlas have no regions
+    ShadowAtlasRegion frontRegion, backRegion;
+    if (!_shadowAtlas->GetRegion(shadow->Request, 0, &frontRegion) ||
+        !_shadowAtlas->GetRegion(shadow->Request, 1, &backRegion))
+    {
+        return S_OK;
+    }
+    ADD_RENDER_STAT(ShadowMaps, 2);
+
     // Create a bounding sphere for the light
     Sphere lightSphere;
     lightSphere.Center = light->GetPosition();
     lightSphere.Radius = light->GetRadius();
 
-    // Make sure this light is in the view fustrum
-    XMFLOAT4X4 fProj = camera->GetProjection();
-    XMMATRIX proj = XMLoadFloat4x4(&fProj);
-
-    Frustum cameraFrust;
-    Collision::ComputeFrustumFromProjection(&cameraFrust, &proj);
-    cameraFrust.Origin = camera->GetPosition();
-    cameraFrust.Orientation = camera->GetOrientation();
-    if (!Collision::IntersectSphereFrustum(&lightSphere, &cameraFrust))
-    {
-        return S_OK;
-    }
-
     bool alphaCutoutEnabled = GetAlphaCutoutEnabled();
 
-    // Set up the render targets for the shadow map and clear them
-    pd3dImmediateContext->OMSetRenderTargets(0, NULL, _shadowMapDSVs[shadowMapIdx]);
-    pd3dImmediateContext->ClearDepthStencilView(_shadowMapDSVs[shadowMapIdx], D3D11_CLEAR_DEPTH, 1.0f, 0);
-
     pd3dImmediateContext->GSSetShader(NULL, NULL, 0);
     pd3dImmediateContext->VSSetShader(alphaCutoutEnabled ? _depthVS[1]->VertexShader : _depthVS[0]->VertexShader, NULL, 0);
     pd3dImmediateContext->PSSetShader(alphaCutoutEnabled ? _depthPS->PixelShader : NULL, NULL, 0);
@@ -108,16 +141,9 @@ HRESULT DualParaboloidPointLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
     XMMATRIX view = XMMatrixLookToLH(lightPos, lightForward, lightUp);
 
-    // Create the viewport
-    D3D11_VIEWPORT vp;
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.Width = SHADOW_MAP_SIZE * 0.5f;
-    vp.Height = SHADOW_MAP_SIZE * 0.5f;
-    vp.TopLeftX = 0.0f;
-    vp.TopLeftY = 0.0f;
-
     // Render the front depths
+    D3D11_VIEWPORT vp;
+    ShadowAtlas::GetViewport(frontRegion, &vp);
     pd3dImmediateContext->RSSetViewports(1, &vp);
 
     pd3dImmediateContext->OMSetDepthStencilState(GetDepthStencilStates()->GetDepthWriteEnabled(), 0);
@@ -135,17 +161,19 @@ HRESULT DualParaboloidPointLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
         XMMATRIX wv = XMMatrixMultiply(world, view);
 
-        V(pd3dImmediateContext->Map(_depthPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        CB_POINTLIGHT_DEPTH_PROPERTIES* depthProperties = (CB_POINTLIGHT_DEPTH_PROPERTIES*)mappedResource.pData;
+        CB_POINTLIGHT_DEPTH_PROPERTIES depthProperties;
+        ZeroMemory(&depthProperties, sizeof(CB_POINTLIGHT_DEPTH_PROPERTIES));
 
-        XMStoreFloat4x4(&depthProperties->WorldView, XMMatrixTranspose(wv));
-        depthProperties->Direction = 1.0f;
-        depthProperties->CameraClips = XMFLOAT2(0.1f, light->GetRadius());
+        XMStoreFloat4x4(&depthProperties.WorldView, XMMatrixTranspose(wv));
+        depthProperties.Direction = 1.0f;
+        depthProperties.CameraClips = XMFLOAT2(0.1f, light->GetRadius());
 
-        pd3dImmediateContext->Unmap(_depthPropertiesBuffer, 0);
+        ID3D11Buffer* depthPropertiesBuffer;
+        V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, depthProperties, &depthPropertiesBuffer));
 
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &_depthPropertiesBuffer);
+        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &depthPropertiesBuffer);
 
+        bool caster = false;
         for (UINT j = 0; j < model->GetMeshCount(); j++)
         {
             OrientedBox meshBounds = instance->GetMeshOrientedBox(j);
@@ -158,12 +186,17 @@ HRESULT DualParaboloidPointLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
             model->RenderMesh(pd3dImmediateContext, j, INVALID_BUFFER_SLOT,
                 alphaCutoutEnabled ? 0 : INVALID_SAMPLER_SLOT, INVALID_SAMPLER_SLOT, INVALID_SAMPLER_SLOT);
+            caster = true;
+        }
+
+        if (caster)
+        {
+            ADD_RENDER_STAT(ShadowCasters, 1);
         }
     }
 
     // render the back depths
-    vp.TopLeftX = SHADOW_MAP_SIZE * 0.5f;
-
+    ShadowAtlas::GetViewport(backRegion, &vp);
     pd3dImmediateContext->RSSetViewports(1, &vp);
 
     pd3dImmediateContext->RSSetState(GetRasterizerStates()->GetFrontFaceCull());
@@ -177,17 +210,19 @@ HRESULT DualParaboloidPointLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
         XMMATRIX wv = XMMatrixMultiply(world, view);
 
-        V(pd3dImmediateContext->Map(_depthPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-        CB_POINTLIGHT_DEPTH_PROPERTIES* depthProperties = (CB_POINTLIGHT_DEPTH_PROPERTIES*)mappedResource.pData;
+        CB_POINTLIGHT_DEPTH_PROPERTIES depthProperties;
+        ZeroMemory(&depthProperties, sizeof(CB_POINTLIGHT_DEPTH_PROPERTIES));
 
-        XMStoreFloat4x4(&depthProperties->WorldView, XMMatrixTranspose(wv));
-        depthProperties->Direction = -1.0f;
-        depthProperties->CameraClips = XMFLOAT2(0.1f, light->GetRadius());
+        XMStoreFloat4x4(&depthProperties.WorldView, XMMatrixTranspose(wv));
+        depthProperties.Direction = -1.0f;
+        depthProperties.CameraClips = XMFLOAT2(0.1f, light->GetRadius());
 
-        pd3dImmediateContext->Unmap(_depthPropertiesBuffer, 0);
+        ID3D11Buffer* depthPropertiesBuffer;
+        V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, depthProperties, &depthPropertiesBuffer));
 
-        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &_depthPropertiesBuffer);
+        pd3dImmediateContext->VSSetConstantBuffers(0, 1, &depthPropertiesBuffer);
 
+        bool caster = false;
         for (UINT j = 0; j < model->GetMeshCount(); j++)
         {
             OrientedBox meshBounds = instance->GetMeshOrientedBox(j);
@@ -200,10 +235,16 @@ HRESULT DualParaboloidPointLightRenderer::renderDepth(ID3D11DeviceContext* pd3dI
 
             model->RenderMesh(pd3dImmediateContext, j, INVALID_BUFFER_SLOT,
                 alphaCutoutEnabled ? 0 : INVALID_SAMPLER_SLOT, INVALID_SAMPLER_SLOT, INVALID_SAMPLER_SLOT);
+            caster = true;
+        }
+
+        if (caster)
+        {
+            ADD_RENDER_STAT(ShadowCasters, 1);
         }
     }
 
-    XMStoreFloat4x4(&_shadowMatricies[shadowMapIdx], XMMatrixTranspose(view));
+    XMStoreFloat4x4(&shadow->ShadowMatrix, XMMatrixTranspose(view));
 
     return S_OK;
 }
@@ -273,12 +314,11 @@ HRESULT DualParaboloidPointLightRenderer::RenderGeometryLights(ID3D11DeviceConte
 
         pd3dImmediateContext->PSSetConstantBuffers(0, 1, &_cameraPropertiesBuffer);
 
+        // The state may be NULL when this pass follows a run of deferred passes, each light sets
+        // the culling it needs
         ID3D11RasterizerState* prevRS;
         pd3dImmediateContext->RSGetState(&prevRS);
 
-        D3D11_RASTERIZER_DESC rsDesc;
-        prevRS->GetDesc(&rsDesc);
-
         // Begin rendering unshadowed lights
         pd3dImmediateContext->PSSetShader(_unshadowedPS->PixelShader, NULL, 0);
 
@@ -313,51 +353,61 @@ HRESULT DualParaboloidPointLightRenderer::RenderGeometryLights(ID3D11DeviceConte
             XMFLOAT4X4 fViewProj = camera->GetViewProjection();
             XMMATRIX viewProj = XMLoadFloat4x4(&fViewProj);
 
-            _lightModel.SetPosition(light->GetPosition());
-            _lightModel.SetScale(light->GetRadius());
-
-            XMFLOAT4X4 fWorld = _lightModel.GetWorld();
-            XMMATRIX world = XMLoadFloat4x4(&fWorld);
+            // The light volume is drawn directly rather than through a model instance, whose world
+            // matrix would not be rebuilt until the next transform update
+            float radius = light->GetRadius();
+            XMFLOAT3 fLightPos = light->GetPosition();
+            XMMATRIX world = XMMatrixMultiply(XMMatrixScaling(radius, radius, radius),
+                XMMatrixTranslation(fLightPos.x, fLightPos.y, fLightPos.z));
 
             XMMATRIX wvp = XMMatrixMultiply(world, viewProj);
 
-            V_RETURN(pd3dImmediateContext->Map(_modelPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_POINTLIGHT_MODEL_PROPERTIES* modelProperties =
-                (CB_POINTLIGHT_MODEL_PROPERTIES*)mappedResource.pData;
-
-            XMStoreFloat4x4(&modelProperties->World, XMMatrixTranspose(world));
-            XMStoreFloat4x4(&modelProperties->WorldViewProjection, XMMatrixTranspose(wvp));
-
-            pd3dImmediateContext->Unmap(_modelPropertiesBuffer, 0);
+            CB_POINTLIGHT_MODEL_PROPERTIES modelProperties;
+            XMStoreFloat4x4(&modelProperties.World, XMMatrixTranspose(world));
+            XMStoreFloat4x4(&modelProperties.WorldViewProjection, XMMatrixTranspose(wvp));
 
-            pd3dImmediateContext->VSSetConstantBuffers(1, 1, &_modelPropertiesBuffer);
+            ID3D11Buffer* modelPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, modelProperties, &modelPropertiesBuffer));
 
-            // Map the light properties
-            V_RETURN(pd3dImmediateContext->Map(_lightPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_POINTLIGHT_LIGHT_PROPERTIES* lightProperties =
-                (CB_POINTLIGHT_LIGHT_PROPERTIES*)mappedResource.pData;
+            pd3dImmediateContext->VSSetConstantBuffers(1, 1, &modelPropertiesBuffer);
 
-            lightProperties->LightPosition = light->GetPosition();
-            lightProperties->LightRadius = light->GetRadius();
-            lightProperties->LightColor = light->GetColor();
-            lightProperties->LightBrightness = light->GetBrightness();
+            // Upload the light properties
+            CB_POINTLIGHT_LIGHT_PROPERTIES lightProperties;
+            lightProperties.LightPosition = light->GetPosition();
+            lightProperties.LightRadius = light->GetRadius();
+            lightProperties.LightColor = light->GetColor();
+            lightProperties.LightBrightness = light->GetBrightness();
 
-            pd3dImmediateContext->Unmap(_lightPropertiesBuffer, 0);
+            ID3D11Buffer* lightPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, lightProperties, &lightPropertiesBuffer));
 
-            pd3dImmediateContext->PSSetConstantBuffers(2, 1, &_lightPropertiesBuffer);
+            pd3dImmediateContext->PSSetConstantBuffers(2, 1, &lightPropertiesBuffer);
 
-            Model* model = _lightModel.GetModel();
-            model->Render(pd3dImmediateContext);
+            _lightModel->Render(pd3dImmediateContext);
+            ADD_RENDER_STAT(Lights, 1);
         }
 
-        // Render the shadowed lights
-        pd3dImmediateContext->PSSetShader(_shadowedPS->PixelShader, NULL, 0);
+        // Render the shadowed lights, the shadow maps of all of them are in the atlas
+        if (_shadowAtlas)
+        {
+            ID3D11ShaderResourceView* atlasSRV = _shadowAtlas->GetSRV();
+            pd3dImmediateContext->PSSetShaderResources(3, 1, &atlasSRV);
+        }
 
         int numShadowed = GetCount(true);
         for (int i = 0; i < numShadowed; i++)
         {
             PointLight* light = GetLight(i, true);
 
+            // Lights that did not get room in the atlas are drawn without a shadow
+            ShadowAtlasRegion frontRegion, backRegion;
+            bool hasShadow = _shadowAtlas && (UINT)i < _shadows.size() &&
+                _shadowAtlas->GetRegion(_shadows[i].Request, 0, &frontRegion) &&
+                _shadowAtlas->GetRegion(_shadows[i].Request, 1, &backRegion);
+
+            pd3dImmediateContext->PSSetShader(hasShadow ? _shadowedPS->PixelShader : _unshadowedPS->PixelShader,
+                NULL, 0);
+
             // Verify that the light is visible
             Sphere lightBounds;
             lightBounds.Center = light->GetPosition();
@@ -384,59 +434,61 @@ HRESULT DualParaboloidPointLightRenderer::RenderGeometryLights(ID3D11DeviceConte
             XMFLOAT4X4 fViewProj = camera->GetViewProjection();
             XMMATRIX viewProj = XMLoadFloat4x4(&fViewProj);
 
-            _lightModel.SetPosition(light->GetPosition());
-            _lightModel.SetScale(light->GetRadius());
-
-            XMFLOAT4X4 fWorld = _lightModel.GetWorld();
-            XMMATRIX world = XMLoadFloat4x4(&fWorld);
+            // The light volume is drawn directly rather than through a model instance, whose world
+            // matrix would not be rebuilt until the next transform update
+            float radius = light->GetRadius();
+            XMFLOAT3 fLightPos = light->GetPosition();
+            XMMATRIX world = XMMatrixMultiply(XMMatrixScaling(radius, radius, radius),
+                XMMatrixTranslation(fLightPos.x, fLightPos.y, fLightPos.z));
 
             XMMATRIX wvp = XMMatrixMultiply(world, viewProj);
 
-            V_RETURN(pd3dImmediateContext->Map(_modelPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_POINTLIGHT_MODEL_PROPERTIES* modelProperties =
-                (CB_POINTLIGHT_MODEL_PROPERTIES*)mappedResource.pData;
+            CB_POINTLIGHT_MODEL_PROPERTIES modelProperties;
+            XMStoreFloat4x4(&modelProperties.World, XMMatrixTranspose(world));
+            XMStoreFloat4x4(&modelProperties.WorldViewProjection, XMMatrixTranspose(wvp));
 
-            XMStoreFloat4x4(&modelProperties->World, XMMatrixTranspose(world));
-            XMStoreFloat4x4(&modelProperties->WorldViewProjection, XMMatrixTranspose(wvp));
+            ID3D11Buffer* modelPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, modelProperties, &modelPropertiesBuffer));
 
-            pd3dImmediateContext->Unmap(_modelPropertiesBuffer, 0);
+            pd3dImmediateContext->VSSetConstantBuffers(1, 1, &modelPropertiesBuffer);
 
-            pd3dImmediateContext->VSSetConstantBuffers(1, 1, &_modelPropertiesBuffer);
+            // Upload the light properties
+            CB_POINTLIGHT_LIGHT_PROPERTIES lightProperties;
+            lightProperties.LightPosition = light->GetPosition();
+            lightProperties.LightRadius = light->GetRadius();
+            lightProperties.LightColor = light->GetColor();
+            lightProperties.LightBrightness = light->GetBrightness();
 
-            // Map the light properties
-            V_RETURN(pd3dImmediateContext->Map(_lightPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_POINTLIGHT_LIGHT_PROPERTIES* lightProperties =
-                (CB_POINTLIGHT_LIGHT_PROPERTIES*)mappedResource.pData;
+            ID3D11Buffer* lightPropertiesBuffer;
+            V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, lightProperties, &lightPropertiesBuffer));
 
-            lightProperties->LightPosition = light->GetPosition();
-            lightProperties->LightRadius = light->GetRadius();
-            lightProperties->LightColor = light->GetColor();
-            lightProperties->LightBrightness = light->GetBrightness();
+            pd3dImmediateContext->PSSetConstantBuffers(2, 1, &lightPropertiesBuffer);
 
-            pd3dImmediateContext->Unmap(_lightPropertiesBuffer, 0);
-
-            pd3dImmediateContext->PSSetConstantBuffers(2, 1, &_lightPropertiesBuffer);
-
-            // Map the shadow properties
-            V_RETURN(pd3dImmediateContext->Map(_shadowPropertiesBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-            CB_POINTLIGHT_SHADOW_PROPERTIES* shadowProperties =
-                (CB_POINTLIGHT_SHADOW_PROPERTIES*)mappedResource.pData;
-
-            // Shadow matrix is already transposed
-            shadowProperties->ShadowMatrix = _shadowMatricies[i];
-            shadowProperties->CameraClips = XMFLOAT2(0.1f, light->GetRadius());
-            shadowProperties->ShadowMapSize = XMFLOAT2((float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE * 0.5f);
-            shadowProperties->Bias = BIAS;
-
-            pd3dImmediateContext->Unmap(_shadowPropertiesBuffer, 0);
-
-            pd3dImmediateContext->PSSetConstantBuffers(3, 1, &_shadowPropertiesBuffer);
-
-            // Set the shadow map
-            pd3dImmediateContext->PSSetShaderResources(3, 1, &_shadowMapSRVs[i]);
+            // Upload the shadow properties
+            if (hasShadow)
+            {
+                CB_POINTLIGHT_SHADOW_PROPERTIES shadowProperties;
+                ZeroMemory(&shadowProperties, sizeof(CB_POINTLIGHT_SHADOW_PROPERTIES));
+
+                // Shadow matrix is already transposed
+                float atlasSize = (float)_shadowAtlas->GetSize();
+                shadowProperties.ShadowMatrix = _shadows[i].ShadowMatrix;
+                shadowProperties.CameraClips = XMFLOAT2(0.1f, light->GetRadius());
+                shadowProperties.ShadowMapSize = XMFLOAT2(atlasSize, atlasSize);
+                shadowProperties.Bias = BIAS;
+                shadowProperties.FrontTransform = _shadowAtlas->GetTexCoordTransform(frontRegion);
+                shadowProperties.BackTransform = _shadowAtlas->GetTexCoordTransform(backRegion);
+
+                ID3D11Buffer* shadowPropertiesBuffer;
+                V_RETURN(GetConstantBuffers()->Upload(pd3dImmediateContext, shadowProperties,
+                    &shadowPropertiesBuffer));
+
+                pd3dImmediateContext->PSSetConstantBuffers(3, 1, &shadowPropertiesBuffer);
+            }
 
-            Model* model = _lightModel.GetModel();
-            model->Render(pd3dImmediateContext);
+            _lightModel->Render(pd3dImmediateContext);
+            ADD_RENDER_STAT(Lights, 1);
+            ADD_RENDER_STAT(ShadowedLights, hasShadow ? 1 : 0);
         }
 
         // Null all the SRVs
@@ -470,7 +522,8 @@ HRESULT DualParaboloidPointLightRenderer::OnD3D11CreateDevice(ID3D11Device* pd3d
     // Call base function
     V_RETURN(LightRenderer::OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
 
-    V_RETURN(_lightModel.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
+    V_RETURN(pContentManager->LoadContent(pd3dDevice, L"\\models\\sphere\\sphere.sdkmesh", (ModelOptions*)NULL,
+        &_lightModel));
 
     // Create the constant buffers
     D3D11_BUFFER_DESC bufferDesc =
@@ -483,30 +536,14 @@ HRESULT DualParaboloidPointLightRenderer::OnD3D11CreateDevice(ID3D11Device* pd3d
         0, //UINT StructureByteStride;
     };
 
-    bufferDesc.ByteWidth = sizeof(CB_POINTLIGHT_MODEL_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_modelPropertiesBuffer));
-    V_RETURN(SetDXDebugName(_modelPropertiesBuffer, "DP Light model CB"));
-
     bufferDesc.ByteWidth = sizeof(CB_POINTLIGHT_ALPHACUTOUT_PROPERTIES);
     V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_alphaCutoutPropertiesBuffer));
     V_RETURN(SetDXDebugName(_alphaCutoutPropertiesBuffer, "DP Light alpha cutout CB"));
 
-    bufferDesc.ByteWidth = sizeof(CB_POINTLIGHT_LIGHT_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_lightPropertiesBuffer));
-    V_RETURN(SetDXDebugName(_lightPropertiesBuffer, "DP Light light CB"));
-
     bufferDesc.ByteWidth = sizeof(CB_POINTLIGHT_CAMERA_PROPERTIES);
     V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_cameraPropertiesBuffer));
     V_RETURN(SetDXDebugName(_cameraPropertiesBuffer, "DP Light camera CB"));
 
-    bufferDesc.ByteWidth = sizeof(CB_POINTLIGHT_SHADOW_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_shadowPropertiesBuffer));
-    V_RETURN(SetDXDebugName(_shadowPropertiesBuffer, "DP Light shadow CB"));
-
-    bufferDesc.ByteWidth = sizeof(CB_POINTLIGHT_DEPTH_PROPERTIES);
-    V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_depthPropertiesBuffer));
-    V_RETURN(SetDXDebugName(_depthPropertiesBuffer, "DP Light depth CB"));
-
     // Create the shaders and input layout
     char entryPoint[256];
     char debugName[256];
@@ -585,56 +622,6 @@ HRESULT DualParaboloidPointLightRenderer::OnD3D11CreateDevice(ID3D11Device* pd3d
     sprintf_s(debugName, "Dual paraboloid depth");
     V_RETURN(pContentManager->LoadContent(pd3dDevice, L"DualParaboloidDepth.hlsl", &psOpts, &_depthPS));
 
-    // Create the shadow textures
-    D3D11_TEXTURE2D_DESC shadowMapTextureDesc =
-    {
-        SHADOW_MAP_SIZE,//UINT Width;
-        SHADOW_MAP_SIZE / 2,//UINT Height;
-        1,//UINT MipLevels;
-        1,//UINT ArraySize;
-        DXGI_FORMAT_R32_TYPELESS,//DXGI_FORMAT Format;
-        1,//DXGI_SAMPLE_DESC SampleDesc;
-        0,
-        D3D11_USAGE_DEFAULT,//D3D11_USAGE Usage;
-        D3D11_BIND_DEPTH_STENCIL|D3D11_BIND_SHADER_RESOURCE,//UINT BindFlags;
-        0,//UINT CPUAccessFlags;
-        0//UINT MiscFlags;
-    };
-
-    // Create the shadow map SRVs
-    D3D11_SHADER_RESOURCE_VIEW_DESC shadowMapSRVDesc =
-    {
-        DXGI_FORMAT_R32_FLOAT,
-        D3D11_SRV_DIMENSION_TEXTURE2D,
-        0,
-        0
-    };
-    shadowMapSRVDesc.Texture2D.MipLevels = 1;
-
-    // Create the shadow map depth stencil views
-    D3D11_DEPTH_STENCIL_VIEW_DESC shadowMapDSVDesc =
-    {
-        DXGI_FORMAT_D32_FLOAT,
-        D3D11_DSV_DIMENSION_TEXTURE2D,
-        0,
-    };
-
-    for (UINT i = 0; i < NUM_SHADOW_MAPS; i++)
-    {
-        ID3D11Texture2D* shadowMapTexutre;
-        V_RETURN(pd3dDevice->CreateTexture2D(&shadowMapTextureDesc, NULL, &shadowMapTexutre));
-
-        V_RETURN(pd3dDevice->CreateShaderResourceView(shadowMapTexutre, &shadowMapSRVDesc, &_shadowMapSRVs[i]));
-        sprintf_s(debugName, "DP shadow map %i SRV", i);
-        V_RETURN(SetDXDebugName(_shadowMapSRVs[i], debugName));
-
-        V_RETURN(pd3dDevice->CreateDepthStencilView(shadowMapTexutre, &shadowMapDSVDesc, &_shadowMapDSVs[i]));
-        sprintf_s(debugName, "DP shadow map %i DSV", i);
-        V_RETURN(SetDXDebugName(_shadowMapDSVs[i], debugName));
-
-        SAFE_RELEASE(shadowMapTexutre);
-    }
-
     return S_OK;
 }
 
@@ -642,30 +629,20 @@ void DualParaboloidPointLightRenderer::OnD3D11DestroyDevice(ContentManager* pCon
 {
     LightRenderer::OnD3D11DestroyDevice(pContentManager);
 
-    _lightModel.OnD3D11DestroyDevice(pContentManager);
+    SAFE_CM_RELEASE(pContentManager, _lightModel);
 
     for (UINT i = 0; i < 2; i++)
     {
         SAFE_CM_RELEASE(pContentManager, _depthVS[i]);
     }
     SAFE_CM_RELEASE(pContentManager, _depthPS);
-    SAFE_RELEASE(_depthPropertiesBuffer);
     SAFE_RELEASE(_alphaCutoutPropertiesBuffer);
 
     SAFE_CM_RELEASE(pContentManager, _vertexShader);
     SAFE_CM_RELEASE(pContentManager, _unshadowedPS);
     SAFE_CM_RELEASE(pContentManager, _shadowedPS);
 
-    SAFE_RELEASE(_modelPropertiesBuffer);
-    SAFE_RELEASE(_lightPropertiesBuffer);
     SAFE_RELEASE(_cameraPropertiesBuffer);
-    SAFE_RELEASE(_shadowPropertiesBuffer);
-
-    for (UINT i = 0; i < NUM_SHADOW_MAPS; i++)
-    {
-        SAFE_RELEASE(_shadowMapDSVs[i]);
-        SAFE_RELEASE(_shadowMapSRVs[i]);
-    }
 }
 
 HRESULT DualParaboloidPointLightRenderer::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, ContentManager* pContentManager, IDXGISwapChain* pSwapChain,
@@ -675,14 +652,10 @@ HRESULT DualParaboloidPointLightRenderer::OnD3D11ResizedSwapChain(ID3D11Device*
 
     V_RETURN(LightRenderer::OnD3D11ResizedSwapChain(pd3dDevice, pContentManager, pSwapChain, pBackBufferSurfaceDesc));
 
-    V_RETURN(_lightModel.OnD3D11ResizedSwapChain(pd3dDevice, pContentManager, pSwapChain, pBackBufferSurfaceDesc));
-
     return S_OK;
 }
 
 void DualParaboloidPointLightRenderer::OnD3D11ReleasingSwapChain(ContentManager* pContentManager)
 {
     LightRenderer::OnD3D11ReleasingSwapChain(pContentManager);
-
-    _lightModel.OnD3D11ReleasingSwapChain(pContentManager);
 }
\ No newline at end of file
@@ -13,30 +13,34 @@ class DualParaboloidPointLightRenderer : public LightRenderer<PointLight>
 private:
     VertexShaderContent* _depthVS[2]; // alphacutout disabled/enabled
     PixelShaderContent* _depthPS; // alphacutout enabled
-    ID3D11Buffer* _depthPropertiesBuffer;
     ID3D11Buffer* _alphaCutoutPropertiesBuffer;
 
     VertexShaderContent* _vertexShader;
     PixelShaderContent* _unshadowedPS;
     PixelShaderContent* _shadowedPS;
 
-    ID3D11Buffer* _modelPropertiesBuffer;
-    ID3D11Buffer* _lightPropertiesBuffer;
     ID3D11Buffer* _cameraPropertiesBuffer;
-    ID3D11Buffer* _shadowPropertiesBuffer;
 
-    ModelInstance _lightModel;
+    Model* _lightModel;
 
-    static const UINT NUM_SHADOW_MAPS = 3;
-    static const UINT SHADOW_MAP_SIZE = 2048;
+    // Shadowed lights that do not get room in the atlas are drawn without a shadow
+    static const UINT MAX_SHADOWED_LIGHTS = 64;
+
+    // The size of each hemisphere of a light that covers the whole screen
+    static const UINT MAX_SHADOW_MAP_SIZE = 1024;
     static const float BIAS;
-    ID3D11DepthStencilView* _shadowMapDSVs[NUM_SHADOW_MAPS];
-    ID3D11ShaderResourceView* _shadowMapSRVs[NUM_SHADOW_MAPS];
-    XMFLOAT4X4 _shadowMatricies[NUM_SHADOW_MAPS];
 
-    HRESULT renderDepth(ID3D11DeviceContext* pd3dImmediateContext, PointLight* light,
-        UINT shadowMapIdx, std::vector<ModelInstance*>* models, Camera* camera,
-        AxisAlignedBox* sceneBounds);
+    // Every shadowed light asks the atlas for two regions, the front and back hemispheres
+    ShadowAtlas* _shadowAtlas;
+    struct SHADOW_INFO
+    {
+        UINT Request;
+        XMFLOAT4X4 ShadowMatrix;
+    };
+    std::vector<SHADOW_INFO> _shadows;
+
+    HRESULT renderDepth(ID3D11DeviceContext* pd3dImmediateContext, PointLight* light, SHADOW_INFO* shadow,
+        std::vector<ModelInstance*>* models);
 
     struct CB_POINTLIGHT_ALPHACUTOUT_PROPERTIES
     {
@@ -79,14 +83,17 @@ private:
         float Bias;
         XMFLOAT3 Padding;
         XMFLOAT4X4 ShadowMatrix;
+        XMFLOAT4 FrontTransform;
+        XMFLOAT4 BackTransform;
     };
 
 protected:
-    UINT GetMaxShadowedLights() const { return NUM_SHADOW_MAPS; }
+    UINT GetMaxShadowedLights() const { return MAX_SHADOWED_LIGHTS; }
 
 public:
     DualParaboloidPointLightRenderer();
 
+    void RequestShadowMaps(ShadowAtlas* atlas, Camera* camera);
     HRESULT RenderGeometryShadowMaps(ID3D11DeviceContext* pd3dImmediateContext, std::vector<ModelInstance*>* models,
         Camera* camera, AxisAlignedBox* sceneBounds);
     HRESULT RenderGeometryLights(ID3D11DeviceContext* pd3dImmediateContext, Camera* camera, GBuffer* gBuffer);
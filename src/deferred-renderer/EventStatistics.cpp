@@ -0,0 +1,272 @@
+#include "PCH.h"
+#include "EventStatistics.h"
+
+const float EventStatistics::MIN_DURATION = 0.001f;
+const float EventStatistics::GROWTH = 1.1f;
+
+EventStatistics::EventStatistics()
+    : _orderDirty(false)
+{
+}
+
+EventStatistics::~EventStatistics()
+{
+    Clear();
+}
+
+void EventStatistics::Clear()
+{
+    for (UINT i = 0; i < _series.size(); i++)
+    {
+        SAFE_DELETE(_series[i]);
+    }
+    _series.clear();
+    _seriesIndices.clear();
+    _order.clear();
+    _roots.clear();
+    _orderDirty = false;
+}
+
+UINT EventStatistics::getBucket(float duration)
+{
+    if (duration <= MIN_DURATION)
+    {
+        return 0;
+    }
+
+    UINT bucket = (UINT)ceil(log(duration / MIN_DURATION) / log(GROWTH));
+    return min(bucket, BUCKET_COUNT - 1);
+}
+
+float EventStatistics::getBucketDuration(UINT bucket)
+{
+    // The value a bucket stands for is the one with the same relative error to both of its ends
+    if (bucket == 0)
+    {
+        return MIN_DURATION;
+    }
+    return MIN_DURATION * pow(GROWTH, (float)bucket) * 2.0f / (1.0f + GROWTH);
+}
+
+UINT EventStatistics::getSeries(UINT parent, const std::wstring* name)
+{
+    std::pair<UINT, const std::wstring*> key(parent, name);
+    std::map<std::pair<UINT, const std::wstring*>, UINT>::iterator it = _seriesIndices.find(key);
+    if (it != _seriesIndices.end())
+    {
+        return it->second;
+    }
+
+    SERIES_INFO* series = new SERIES_INFO();
+    series->Name = *name;
+    series->Parent = parent;
+    series->Depth = (parent != INVALID_EVENT) ? _series[parent]->Depth + 1 : 0;
+    series->WindowCount = 0;
+    series->WindowNext = 0;
+    series->WindowTotal = 0.0;
+    ZeroMemory(series->Buckets, sizeof(series->Buckets));
+    series->FrameTotal = 0.0f;
+    series->InFrame = false;
+
+    UINT idx = _series.size();
+    _series.push_back(series);
+    _seriesIndices[key] = idx;
+
+    if (parent != INVALID_EVENT)
+    {
+        _series[parent]->Children.push_back(idx);
+    }
+    else
+    {
+        _roots.push_back(idx);
+    }
+    _orderDirty = true;
+
+    return idx;
+}
+
+void EventStatistics::addSample(SERIES_INFO* series, float value)
+{
+    // The oldest sample makes way for the new one once the window is full
+    if (series->WindowCount == WINDOW_SIZE)
+    {
+        float oldest = series->Window[series->WindowNext];
+        series->Buckets[getBucket(oldest)]--;
+        series->WindowTotal -= oldest;
+    }
+    else
+    {
+        series->WindowCount++;
+    }
+
+    series->Window[series->WindowNext] = value;
+    series->WindowNext = (series->WindowNext + 1) % WINDOW_SIZE;
+    series->Buckets[getBucket(value)]++;
+    series->WindowTotal += value;
+}
+
+float EventStatistics::recordEvents(Logger::EventIterator it, UINT parent)
+{
+    float total = 0.0f;
+    for (; it.IsValid(); it = it.GetNextSibling())
+    {
+        UINT idx = getSeries(parent, &it.GetName());
+        SERIES_INFO* series = _series[idx];
+        float duration = it.GetDuration() * 1000.0f;
+
+        series->FrameTotal += duration;
+        series->InFrame = true;
+        total += duration;
+
+        if (it.HasChildren())
+        {
+            recordEvents(it.GetFirstChild(), idx);
+        }
+    }
+
+    return total;
+}
+
+void EventStatistics::RecordFrame(Logger* logger)
+{
+    for (UINT i = 0; i < logger->GetLaneCount(); i++)
+    {
+        Logger::EventIterator root = logger->GetLaneRootEvent(i);
+        if (!root.IsValid())
+        {
+            continue;
+        }
+
+        UINT lane = getSeries(INVALID_EVENT, &logger->GetLaneName(i));
+        float busyTime = recordEvents(root, lane);
+
+        _series[lane]->FrameTotal += busyTime;
+        _series[lane]->InFrame = true;
+    }
+
+    // Events that did not happen this frame are left a sample short rather than given a zero
+    for (UINT i = 0; i < _series.size(); i++)
+    {
+        SERIES_INFO* series = _series[i];
+        if (series->InFrame)
+        {
+            addSample(series, series->FrameTotal);
+            series->FrameTotal = 0.0f;
+            series->InFrame = false;
+        }
+    }
+}
+
+void EventStatistics::buildOrder(UINT series)
+{
+    _order.push_back(series);
+    for (UINT i = 0; i < _series[series]->Children.size(); i++)
+    {
+        buildOrder(_series[series]->Children[i]);
+    }
+}
+
+EventStatistics::SERIES_INFO* EventStatistics::getOrderedSeries(UINT idx)
+{
+    if (_orderDirty)
+    {
+        _order.clear();
+        for (UINT i = 0; i < _roots.size(); i++)
+        {
+            buildOrder(_roots[i]);
+        }
+        _orderDirty = false;
+    }
+
+    return _series[_order[idx]];
+}
+
+UINT EventStatistics::GetEventCount()
+{
+    return _series.size();
+}
+
+const std::wstring& EventStatistics::GetEventName(UINT idx)
+{
+    return getOrderedSeries(idx)->Name;
+}
+
+UINT EventStatistics::GetEventDepth(UINT idx)
+{
+    return getOrderedSeries(idx)->Depth;
+}
+
+void EventStatistics::GetEventStats(UINT idx, EventStats* stats)
+{
+    ZeroMemory(stats, sizeof(EventStats));
+
+    const SERIES_INFO* series = getOrderedSeries(idx);
+    stats->Samples = series->WindowCount;
+    if (series->WindowCount == 0)
+    {
+        return;
+    }
+
+    // The extremes are exact, the window is only walked when they are asked for
+    stats->Min = series->Window[0];
+    stats->Max = series->Window[0];
+    for (UINT i = 1; i < series->WindowCount; i++)
+    {
+        stats->Min = min(stats->Min, series->Window[i]);
+        stats->Max = max(stats->Max, series->Window[i]);
+    }
+    stats->Mean = (float)(series->WindowTotal / series->WindowCount);
+
+    // Nearest rank quantiles from the buckets
+    const float quantiles[] = { 0.5f, 0.95f, 0.99f };
+    float* results[] = { &stats->P50, &stats->P95, &stats->P99 };
+
+    UINT seen = 0;
+    UINT bucket = 0;
+    for (UINT i = 0; i < ARRAYSIZE(quantiles); i++)
+    {
+        UINT rank = max((UINT)ceil(quantiles[i] * series->WindowCount), 1U);
+        while (seen + series->Buckets[bucket] < rank)
+        {
+            seen += series->Buckets[bucket];
+            bucket++;
+        }
+
+        *results[i] = clamp(getBucketDuration(bucket), stats->Min, stats->Max);
+    }
+}
+
+void EventStatistics::GetEventHistogram(UINT idx, float* bins, UINT binCount)
+{
+    ZeroMemory(bins, sizeof(float) * binCount);
+
+    EventStats stats;
+    GetEventStats(idx, &stats);
+    if (stats.Samples == 0)
+    {
+        return;
+    }
+
+    // The buckets between the fastest and slowest samples are spread over the bins, a bucket
+    // covers more than one bin when there are fewer of them than bins
+    const SERIES_INFO* series = getOrderedSeries(idx);
+    UINT first = getBucket(stats.Min);
+    UINT span = getBucket(stats.Max) - first + 1;
+
+    float fullest = 0.0f;
+    for (UINT i = 0; i < span; i++)
+    {
+        UINT binBegin = (i * binCount) / span;
+        UINT binEnd = max(((i + 1) * binCount) / span, binBegin + 1);
+        for (UINT j = binBegin; j < binEnd; j++)
+        {
+            bins[j] += (float)series->Buckets[first + i];
+            fullest = max(fullest, bins[j]);
+        }
+    }
+
+    for (UINT i = 0; i < binCount; i++)
+    {
+        bins[i] /= fullest;
+    }
+}
\ No newline at end of file
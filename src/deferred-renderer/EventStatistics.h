@@ -0,0 +1,94 @@
+#pragma once
+
+#include "PCH.h"
+#include "Logger.h"
+
+struct EventStats
+{
+    UINT Samples;
+
+    // In milliseconds, the quantiles are within a few percent of the true ones
+    float Min;
+    float Mean;
+    float P50;
+    float P95;
+    float P99;
+    float Max;
+};
+
+// Keeps the CPU time of every event over a rolling window of frames. Each lane of the logger is
+// an event of its own, holding the time its thread spent in events, with the lane's events below
+// it. An event that appears more than once in a frame is summed.
+//
+// Quantiles come from a histogram of each event's window with logarithmically sized buckets,
+// samples are added to it as they enter the window and taken out as they leave, so recording a
+// frame costs the same no matter how large the window is.
+class EventStatistics
+{
+public:
+    static const UINT INVALID_EVENT = (UINT)-1;
+    static const UINT WINDOW_SIZE = 1000;
+
+private:
+    // Bucket i holds the durations in (MIN_DURATION * GROWTH^(i-1), MIN_DURATION * GROWTH^i],
+    // which covers a microsecond to about a minute
+    static const UINT BUCKET_COUNT = 192;
+    static const float MIN_DURATION;
+    static const float GROWTH;
+
+    struct SERIES_INFO
+    {
+        std::wstring Name;
+        UINT Parent;
+        UINT Depth;
+        std::vector<UINT> Children;
+
+        float Window[WINDOW_SIZE];
+        UINT WindowCount;
+        UINT WindowNext;
+        double WindowTotal;
+        UINT Buckets[BUCKET_COUNT];
+
+        float FrameTotal;
+        bool InFrame;
+    };
+    std::vector<SERIES_INFO*> _series;
+
+    // Logger event and lane names are interned and never move, so a series is found by its name's
+    // address. A thread that is renamed starts a new lane series under its new name
+    std::map<std::pair<UINT, const std::wstring*>, UINT> _seriesIndices;
+
+    // The series in the order of a walk of the tree, rebuilt when a series is added
+    std::vector<UINT> _order;
+    std::vector<UINT> _roots;
+    bool _orderDirty;
+
+    static UINT getBucket(float duration);
+    static float getBucketDuration(UINT bucket);
+
+    UINT getSeries(UINT parent, const std::wstring* name);
+    float recordEvents(Logger::EventIterator it, UINT parent);
+    void addSample(SERIES_INFO* series, float value);
+    void buildOrder(UINT series);
+    SERIES_INFO* getOrderedSeries(UINT idx);
+
+public:
+    EventStatistics();
+    ~EventStatistics();
+
+    void Clear();
+
+    // Adds every lane of the logger's last frame to the window
+    void RecordFrame(Logger* logger);
+
+    // Events are numbered in tree order, a parent comes before its children
+    UINT GetEventCount();
+    const std::wstring& GetEventName(UINT idx);
+    UINT GetEventDepth(UINT idx);
+
+    void GetEventStats(UINT idx, EventStats* stats);
+
+    // Fills the bins with how many samples fell in each part of the range from the fastest to the
+    // slowest sample, on a logarithmic scale and relative to the fullest bin
+    void GetEventHistogram(UINT idx, float* bins, UINT binCount);
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "PCH.h"
+#include "EventStatisticsControl.h"
+#include "Gwen/Utility.h"
+#include "Gwen/Skin.h"
+
+EventStatisticsControl::EventStatisticsControl(Gwen::Controls::Base* parent)
+    : Gwen::Controls::Base(parent)
+{
+    SetHeight(0);
+}
+
+void EventStatisticsControl::Update(EventStatistics* statistics)
+{
+    _rows.resize(statistics->GetEventCount());
+    for (UINT i = 0; i < _rows.size(); i++)
+    {
+        ROW_INFO& row = _rows[i];
+
+        EventStats stats;
+        statistics->GetEventStats(i, &stats);
+
+        row.Name = statistics->GetEventName(i);
+        row.Timings = Gwen::Utility::Format(L"min %.2f  mean %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms",
+            stats.Min, stats.Mean, stats.P50, stats.P95, stats.P99, stats.Max);
+        row.Depth = statistics->GetEventDepth(i);
+        statistics->GetEventHistogram(i, row.Bins, BIN_COUNT);
+    }
+
+    SetHeight(_rows.size() * ROW_HEIGHT);
+}
+
+void EventStatisticsControl::Render(Gwen::Skin::Base* skin)
+{
+    Gwen::Renderer::Base* render = skin->GetRender();
+    Gwen::Rect bounds = GetRenderBounds();
+
+    const int barWidth = SPARKLINE_WIDTH / BIN_COUNT;
+    const int sparklineX = bounds.x + bounds.w - (barWidth * BIN_COUNT);
+    const int lineHeight = ROW_HEIGHT / 2;
+
+    for (UINT i = 0; i < _rows.size(); i++)
+    {
+        const ROW_INFO& row = _rows[i];
+        int y = bounds.y + i * ROW_HEIGHT;
+        int x = bounds.x + row.Depth * INDENT;
+
+        render->SetDrawColor(Gwen::Color(0, 0, 0, 255));
+        render->RenderText(skin->GetDefaultFont(), Gwen::Point(x, y), row.Name);
+        render->RenderText(skin->GetDefaultFont(), Gwen::Point(x + INDENT, y + lineHeight), row.Timings);
+
+        // Faster durations are to the left, the bars are scaled to the fullest bin
+        render->SetDrawColor(Gwen::Color(60, 120, 200, 255));
+        for (UINT j = 0; j < BIN_COUNT; j++)
+        {
+            int barHeight = (int)(row.Bins[j] * (ROW_HEIGHT - 4));
+            if (barHeight > 0)
+            {
+                render->DrawFilledRect(Gwen::Rect(sparklineX + j * barWidth, y + ROW_HEIGHT - 2 - barHeight,
+                    barWidth, barHeight));
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "PCH.h"
+#include "Gwen/Controls/Base.h"
+#include "EventStatistics.h"
+
+// Draws a row for every event of a set of statistics, with its name indented by its depth, its
+// timings and a sparkline of how its durations are spread. The rows are only refreshed by Update
+// and the control is sized to fit them.
+class EventStatisticsControl : public Gwen::Controls::Base
+{
+public:
+    static const UINT BIN_COUNT = 32;
+
+private:
+    static const int ROW_HEIGHT = 30;
+    static const int INDENT = 12;
+    static const int SPARKLINE_WIDTH = 96;
+
+    struct ROW_INFO
+    {
+        Gwen::UnicodeString Name;
+        Gwen::UnicodeString Timings;
+        UINT Depth;
+        float Bins[BIN_COUNT];
+    };
+    std::vector<ROW_INFO> _rows;
+
+protected:
+    virtual void Render(Gwen::Skin::Base* skin);
+
+public:
+    EventStatisticsControl(Gwen::Controls::Base* parent);
+
+    void Update(EventStatistics* statistics);
+};
\ No newline at end of file
@@ -0,0 +1,637 @@
+#include "PCH.h"
+#include "FrameGraph.h"
+#include "Logger.h"
+#include "ConstantBufferAllocator.h"
+
+using std::tr1::bind;
+using std::tr1::mem_fn;
+using namespace std::tr1::placeholders;
+
+FrameGraph::FrameGraph()
+    : _threadPool(NULL), _viewportCount(0)
+{
+    ZeroMemory(&_stats, sizeof(FrameGraphStats));
+}
+
+FrameGraph::~FrameGraph()
+{
+    ReleaseTextures();
+    ReleaseDeferredContexts();
+}
+
+void FrameGraph::Reset()
+{
+    _targets.clear();
+    _passes.clear();
+}
+
+UINT FrameGraph::ImportTarget(const std::wstring& name, ID3D11ShaderResourceView* srv, ID3D11RenderTargetView* rtv)
+{
+    TARGET_INFO target;
+    ZeroMemory(&target.Desc, sizeof(FrameGraphTargetDesc));
+    target.Name = name;
+    target.Transient = false;
+    target.SRV = srv;
+    target.RTV = rtv;
+    target.Output = false;
+
+    _targets.push_back(target);
+    return _targets.size() - 1;
+}
+
+UINT FrameGraph::CreateTarget(const std::wstring& name, const FrameGraphTargetDesc& desc)
+{
+    TARGET_INFO target;
+    target.Name = name;
+    target.Transient = true;
+    target.Desc = desc;
+    target.SRV = NULL;
+    target.RTV = NULL;
+    target.Output = false;
+
+    _targets.push_back(target);
+    return _targets.size() - 1;
+}
+
+void FrameGraph::MarkOutput(UINT target)
+{
+    _targets[target].Output = true;
+}
+
+UINT FrameGraph::AddPass(const std::wstring& name, const ExecuteFunction& execute, bool sideEffects, bool deferred)
+{
+    PASS_INFO pass;
+    pass.Name = name;
+    pass.Execute = execute;
+    pass.SideEffects = sideEffects;
+    pass.Deferred = deferred;
+    pass.Culled = false;
+
+    _passes.push_back(pass);
+    return _passes.size() - 1;
+}
+
+void FrameGraph::Read(UINT pass, UINT target)
+{
+    if (target != INVALID_TARGET)
+    {
+        _passes[pass].Reads.push_back(target);
+    }
+}
+
+void FrameGraph::Write(UINT pass, UINT target)
+{
+    if (target != INVALID_TARGET)
+    {
+        _passes[pass].Writes.push_back(target);
+    }
+}
+
+void FrameGraph::cullPasses()
+{
+    for (UINT i = 0; i < _targets.size(); i++)
+    {
+        _targets[i].Needed = _targets[i].Output;
+    }
+
+    // Walk back from the outputs, a pass is kept if a later kept pass reads anything it writes
+    for (UINT i = _passes.size(); i-- > 0; )
+    {
+        PASS_INFO& pass = _passes[i];
+
+        pass.Culled = !pass.SideEffects;
+        for (UINT j = 0; j < pass.Writes.size() && pass.Culled; j++)
+        {
+            pass.Culled = !_targets[pass.Writes[j]].Needed;
+        }
+
+        if (!pass.Culled)
+        {
+            for (UINT j = 0; j < pass.Reads.size(); j++)
+            {
+                _targets[pass.Reads[j]].Needed = true;
+            }
+        }
+    }
+}
+
+void FrameGraph::computeLifetimes()
+{
+    for (UINT i = 0; i < _targets.size(); i++)
+    {
+        _targets[i].FirstPass = (UINT)-1;
+        _targets[i].LastPass = 0;
+    }
+
+    for (UINT i = 0; i < _passes.size(); i++)
+    {
+        const PASS_INFO& pass = _passes[i];
+        if (pass.Culled)
+        {
+            continue;
+        }
+
+        for (UINT j = 0; j < pass.Reads.size() + pass.Writes.size(); j++)
+        {
+            UINT target = (j < pass.Reads.size()) ? pass.Reads[j] : pass.Writes[j - pass.Reads.size()];
+
+            _targets[target].FirstPass = min(_targets[target].FirstPass, i);
+            _targets[target].LastPass = max(_targets[target].LastPass, i);
+        }
+    }
+}
+
+HRESULT FrameGraph::allocateTextures(ID3D11Device* device)
+{
+    HRESULT hr;
+
+    for (UINT i = 0; i < _textures.size(); i++)
+    {
+        _textures[i].Used = false;
+    }
+
+    _stats.TransientTargetCount = 0;
+    _stats.UnaliasedMemory = 0;
+
+    // Targets are handed textures in the order they first become alive, any texture of the same
+    // description whose previous target has died by then can be reused
+    for (UINT i = 0; i < _passes.size(); i++)
+    {
+        const PASS_INFO& pass = _passes[i];
+        if (pass.Culled)
+        {
+            continue;
+        }
+
+        for (UINT j = 0; j < pass.Reads.size() + pass.Writes.size(); j++)
+        {
+            TARGET_INFO& target = _targets[(j < pass.Reads.size()) ? pass.Reads[j] : pass.Writes[j - pass.Reads.size()]];
+            if (!target.Transient || target.FirstPass != i || target.RTV)
+            {
+                continue;
+            }
+
+            UINT texture = 0;
+            while (texture < _textures.size() && !(_textures[texture].Desc == target.Desc &&
+                   (!_textures[texture].Used || _textures[texture].FreeAfterPass < i)))
+            {
+                texture++;
+            }
+
+            if (texture == _textures.size())
+            {
+                TEXTURE_INFO newTexture;
+                V_RETURN(createTexture(device, target.Desc, _textures.size(), &newTexture));
+                _textures.push_back(newTexture);
+            }
+
+            _textures[texture].Used = true;
+            _textures[texture].FreeAfterPass = target.LastPass;
+
+            target.SRV = _textures[texture].SRV;
+            target.RTV = _textures[texture].RTV;
+
+            _stats.TransientTargetCount++;
+            _stats.UnaliasedMemory += _textures[texture].Size;
+        }
+    }
+
+    // Textures that no target needed this frame are released, the pool only grows back if the
+    // frame changes shape
+    _stats.TextureCount = 0;
+    _stats.TransientMemory = 0;
+    for (UINT i = 0; i < _textures.size(); )
+    {
+        if (_textures[i].Used)
+        {
+            _stats.TextureCount++;
+            _stats.TransientMemory += _textures[i].Size;
+            i++;
+        }
+        else
+        {
+            SAFE_RELEASE(_textures[i].SRV);
+            SAFE_RELEASE(_textures[i].RTV);
+            _textures.erase(_textures.begin() + i);
+        }
+    }
+
+    return S_OK;
+}
+
+UINT64 FrameGraph::getTargetSize(const FrameGraphTargetDesc& desc)
+{
+    UINT bytesPerPixel;
+    switch (desc.Format)
+    {
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        bytesPerPixel = 16;
+        break;
+
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+    case DXGI_FORMAT_R16G16B16A16_UNORM:
+    case DXGI_FORMAT_R32G32_FLOAT:
+        bytesPerPixel = 8;
+        break;
+
+    case DXGI_FORMAT_R16G16_FLOAT:
+    case DXGI_FORMAT_R16G16_UNORM:
+    case DXGI_FORMAT_R32_FLOAT:
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+        bytesPerPixel = 4;
+        break;
+
+    case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_R16_UNORM:
+    case DXGI_FORMAT_R8G8_UNORM:
+        bytesPerPixel = 2;
+        break;
+
+    case DXGI_FORMAT_R8_UNORM:
+        bytesPerPixel = 1;
+        break;
+
+    default:
+        bytesPerPixel = 4;
+        break;
+    }
+
+    UINT64 size = 0;
+    for (UINT i = 0; i < max(desc.MipLevels, 1U); i++)
+    {
+        size += (UINT64)max(desc.Width >> i, 1U) * max(desc.Height >> i, 1U) * bytesPerPixel;
+    }
+    return size;
+}
+
+HRESULT FrameGraph::createTexture(ID3D11Device* device, const FrameGraphTargetDesc& desc, UINT idx,
+                                  TEXTURE_INFO* texture)
+{
+    HRESULT hr;
+
+    D3D11_TEXTURE2D_DESC textureDesc =
+    {
+        desc.Width,//UINT Width;
+        desc.Height,//UINT Height;
+        max(desc.MipLevels, 1U),//UINT MipLevels;
+        1,//UINT ArraySize;
+        desc.Format,//DXGI_FORMAT Format;
+        1,//DXGI_SAMPLE_DESC SampleDesc;
+        0,
+        D3D11_USAGE_DEFAULT,//D3D11_USAGE Usage;
+        D3D11_BIND_RENDER_TARGET|D3D11_BIND_SHADER_RESOURCE,//UINT BindFlags;
+        0,//UINT CPUAccessFlags;
+        (desc.MipLevels > 1) ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0//UINT MiscFlags;
+    };
+
+    ID3D11Texture2D* tex;
+    V_RETURN(device->CreateTexture2D(&textureDesc, NULL, &tex));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc =
+    {
+        desc.Format,
+        D3D11_SRV_DIMENSION_TEXTURE2D,
+        0,
+        0
+    };
+    srvDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+
+    D3D11_RENDER_TARGET_VIEW_DESC rtvDesc =
+    {
+        desc.Format,
+        D3D11_RTV_DIMENSION_TEXTURE2D,
+        0,
+        0
+    };
+
+    texture->SRV = NULL;
+    texture->RTV = NULL;
+
+    hr = device->CreateShaderResourceView(tex, &srvDesc, &texture->SRV);
+    if (SUCCEEDED(hr))
+    {
+        hr = device->CreateRenderTargetView(tex, &rtvDesc, &texture->RTV);
+    }
+    SAFE_RELEASE(tex);
+
+    if (FAILED(hr))
+    {
+        SAFE_RELEASE(texture->SRV);
+        SAFE_RELEASE(texture->RTV);
+        return hr;
+    }
+
+    char debugName[256];
+    sprintf_s(debugName, "Frame graph texture %u SRV", idx);
+    V_RETURN(SetDXDebugName(texture->SRV, debugName));
+
+    sprintf_s(debugName, "Frame graph texture %u RTV", idx);
+    V_RETURN(SetDXDebugName(texture->RTV, debugName));
+
+    texture->Desc = desc;
+    texture->Size = getTargetSize(desc);
+    texture->Used = false;
+    texture->FreeAfterPass = 0;
+
+    return S_OK;
+}
+
+HRESULT FrameGraph::executePass(ID3D11DeviceContext* context, UINT pass)
+{
+    BEGIN_EVENT_D3D(_passes[pass].Name.c_str());
+    HRESULT hr = _passes[pass].Execute(context);
+    END_EVENT_D3D(L"");
+
+    return hr;
+}
+
+void FrameGraph::recordPasses(UINT begin, UINT end)
+{
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+
+    for (UINT i = begin; i < end; i++)
+    {
+        RECORD_INFO& record = _records[i];
+        StateCachingDeviceContext* deferredContext = _deferredStateCaches[i];
+
+        LARGE_INTEGER start;
+        QueryPerformanceCounter(&start);
+
+        BEGIN_EVENT(_passes[record.Pass].Name.c_str());
+
+        deferredContext->RSSetViewports(_viewportCount, _viewports);
+        record.Result = _passes[record.Pass].Execute(deferredContext);
+
+        // The list is finished even if the pass failed so that the context starts empty next time
+        HRESULT hr = deferredContext->FinishCommandList(FALSE, &record.CommandList);
+        if (SUCCEEDED(record.Result))
+        {
+            record.Result = hr;
+        }
+
+        END_EVENT(L"");
+
+        LARGE_INTEGER stop;
+        QueryPerformanceCounter(&stop);
+        record.RecordTime = (float)((double)(stop.QuadPart - start.QuadPart) / freq.QuadPart);
+    }
+}
+
+void FrameGraph::saveState(ID3D11DeviceContext* context, PIPELINE_STATE_INFO* state)
+{
+    context->RSGetState(&state->RasterizerState);
+    context->OMGetDepthStencilState(&state->DepthStencilState, &state->StencilRef);
+    context->OMGetBlendState(&state->BlendState, state->BlendFactor, &state->SampleMask);
+}
+
+void FrameGraph::restoreState(ID3D11DeviceContext* context, PIPELINE_STATE_INFO* state)
+{
+    context->RSSetState(state->RasterizerState);
+    context->OMSetDepthStencilState(state->DepthStencilState, state->StencilRef);
+    context->OMSetBlendState(state->BlendState, state->BlendFactor, state->SampleMask);
+
+    SAFE_RELEASE(state->RasterizerState);
+    SAFE_RELEASE(state->DepthStencilState);
+    SAFE_RELEASE(state->BlendState);
+}
+
+HRESULT FrameGraph::executeSerialRun(ID3D11DeviceContext* context, UINT firstPass, UINT endPass)
+{
+    HRESULT hr = S_OK;
+
+    _viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+    context->RSGetViewports(&_viewportCount, _viewports);
+
+    PIPELINE_STATE_INFO state;
+    saveState(context, &state);
+
+    for (UINT i = firstPass; i < endPass && SUCCEEDED(hr); i++)
+    {
+        if (_passes[i].Culled)
+        {
+            continue;
+        }
+
+        // The same state the pass would start from on a deferred context
+        context->ClearState();
+        context->RSSetViewports(_viewportCount, _viewports);
+
+        hr = executePass(context, i);
+    }
+
+    // And the same state a command list leaves behind
+    context->ClearState();
+    context->RSSetViewports(_viewportCount, _viewports);
+    restoreState(context, &state);
+
+    return hr;
+}
+
+HRESULT FrameGraph::executeDeferredRun(ID3D11DeviceContext* context, ID3D11Device* device, UINT firstPass,
+                                       UINT endPass)
+{
+    HRESULT hr;
+
+    _records.clear();
+    for (UINT i = firstPass; i < endPass; i++)
+    {
+        if (!_passes[i].Culled)
+        {
+            RECORD_INFO record = { i, NULL, S_OK, 0.0f };
+            _records.push_back(record);
+        }
+    }
+
+    while (_deferredContexts.size() < _records.size())
+    {
+        ID3D11DeviceContext* deferredContext;
+        V_RETURN(device->CreateDeferredContext(0, &deferredContext));
+        _deferredContexts.push_back(deferredContext);
+
+        StateCachingDeviceContext* stateCache = new StateCachingDeviceContext();
+        stateCache->Reset(deferredContext);
+        _deferredStateCaches.push_back(stateCache);
+    }
+
+    _viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+    context->RSGetViewports(&_viewportCount, _viewports);
+
+    PIPELINE_STATE_INFO state;
+    saveState(context, &state);
+
+    // The events of the passes recorded on the workers end up in the lanes of the workers, the
+    // ones recorded on this thread must not reach the graphics debugger in the middle of the
+    // immediate context's events
+    BEGIN_EVENT(L"Record deferred passes");
+    Logger::GetInstance()->SetGraphicsEventsSuspended(true);
+    _threadPool->ParallelFor(_records.size(), 1, bind(mem_fn(&FrameGraph::recordPasses), this, _1, _2));
+    Logger::GetInstance()->SetGraphicsEventsSuspended(false);
+    END_EVENT(L"");
+
+    for (UINT i = 0; i < _records.size(); i++)
+    {
+        addStateCacheStats(_deferredStateCaches[i]);
+    }
+
+    // Every list is released even once one has failed, the ones after a failure are not executed
+    hr = S_OK;
+    for (UINT i = 0; i < _records.size(); i++)
+    {
+        RECORD_INFO& record = _records[i];
+        if (SUCCEEDED(hr))
+        {
+            hr = record.Result;
+        }
+
+        BEGIN_EVENT_D3D(_passes[record.Pass].Name.c_str());
+        ADD_EVENT(L"Record", record.RecordTime);
+        if (SUCCEEDED(hr))
+        {
+            context->ExecuteCommandList(record.CommandList, FALSE);
+        }
+        SAFE_RELEASE(record.CommandList);
+        END_EVENT_D3D(L"");
+    }
+
+    // Executing a command list leaves the context in its default state
+    context->RSSetViewports(_viewportCount, _viewports);
+    restoreState(context, &state);
+
+    // The constants uploaded by the lists that were not executed never reached their buffers,
+    // but the allocators took them as written
+    if (FAILED(hr))
+    {
+        ConstantBufferAllocator::InvalidateAll();
+    }
+
+    _stats.DeferredPassCount += _records.size();
+
+    return hr;
+}
+
+void FrameGraph::addStateCacheStats(StateCachingDeviceContext* stateCache)
+{
+    _stats.StateCalls += stateCache->GetStats().SubmittedCalls;
+    _stats.FilteredStateCalls += stateCache->GetStats().FilteredCalls;
+    _stats.DrawCalls += stateCache->GetStats().DrawCalls;
+    _stats.Dispatches += stateCache->GetStats().Dispatches;
+    stateCache->ResetStats();
+}
+
+HRESULT FrameGraph::Execute(ID3D11DeviceContext* context)
+{
+    HRESULT hr;
+
+    cullPasses();
+    computeLifetimes();
+
+    ID3D11Device* device;
+    context->GetDevice(&device);
+
+    hr = allocateTextures(device);
+    if (FAILED(hr))
+    {
+        SAFE_RELEASE(device);
+        LOG_ERROR(L"FrameGraph", L"Unable to create the transient render targets.");
+        return hr;
+    }
+
+    // Command lists can only be executed on the device's own immediate context, anything else
+    // such as a recording context has every pass run on it directly
+    ID3D11DeviceContext* immediateContext;
+    device->GetImmediateContext(&immediateContext);
+    bool threaded = _threadPool && _threadPool->GetThreadCount() > 1;
+    bool recordDeferred = threaded && context == immediateContext;
+    SAFE_RELEASE(immediateContext);
+
+    _stats.PassCount = _passes.size();
+    _stats.CulledPassCount = 0;
+    _stats.DeferredPassCount = 0;
+    _stats.StateCalls = 0;
+    _stats.FilteredStateCalls = 0;
+    _stats.DrawCalls = 0;
+    _stats.Dispatches = 0;
+    for (UINT i = 0; i < _passes.size(); i++)
+    {
+        if (_passes[i].Culled)
+        {
+            _stats.CulledPassCount++;
+        }
+    }
+
+    // Anything may have been bound on the context since the last frame, the cache starts out
+    // knowing nothing
+    _stateCache.Reset(context);
+
+    for (UINT i = 0; i < _passes.size() && SUCCEEDED(hr); )
+    {
+        if (_passes[i].Culled)
+        {
+            i++;
+            continue;
+        }
+
+        // Culled passes do not break up a run of deferred passes
+        UINT end = i;
+        UINT deferredCount = 0;
+        while (threaded && end < _passes.size() && (_passes[end].Culled || _passes[end].Deferred))
+        {
+            deferredCount += _passes[end].Culled ? 0 : 1;
+            end++;
+        }
+
+        if (deferredCount > 1)
+        {
+            hr = recordDeferred ? executeDeferredRun(&_stateCache, device, i, end) :
+                executeSerialRun(&_stateCache, i, end);
+            i = end;
+        }
+        else
+        {
+            hr = executePass(&_stateCache, i);
+            i++;
+        }
+    }
+
+    addStateCacheStats(&_stateCache);
+    _stateCache.Reset(NULL);
+
+    SAFE_RELEASE(device);
+
+    return hr;
+}
+
+void FrameGraph::ReleaseTextures()
+{
+    for (UINT i = 0; i < _textures.size(); i++)
+    {
+        SAFE_RELEASE(_textures[i].SRV);
+        SAFE_RELEASE(_textures[i].RTV);
+    }
+    _textures.clear();
+
+    // Imported views are owned elsewhere, the transient ones were just released
+    for (UINT i = 0; i < _targets.size(); i++)
+    {
+        if (_targets[i].Transient)
+        {
+            _targets[i].SRV = NULL;
+            _targets[i].RTV = NULL;
+        }
+    }
+}
+
+void FrameGraph::ReleaseDeferredContexts()
+{
+    for (UINT i = 0; i < _deferredContexts.size(); i++)
+    {
+        SAFE_RELEASE(_deferredContexts[i]);
+        SAFE_DELETE(_deferredStateCaches[i]);
+    }
+    _deferredContexts.clear();
+    _deferredStateCaches.clear();
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "PCH.h"
+#include "ThreadPool.h"
+#include "StateCachingDeviceContext.h"
+
+struct FrameGraphTargetDesc
+{
+    UINT Width;
+    UINT Height;
+    DXGI_FORMAT Format;
+
+    // Targets with more than one mip level are created with D3D11_RESOURCE_MISC_GENERATE_MIPS
+    UINT MipLevels;
+
+    bool operator==(const FrameGraphTargetDesc& other) const
+    {
+        return Width == other.Width && Height == other.Height && Format == other.Format &&
+               MipLevels == other.MipLevels;
+    }
+};
+
+struct FrameGraphStats
+{
+    UINT PassCount;
+    UINT CulledPassCount;
+
+    UINT TransientTargetCount;
+    UINT TextureCount;
+
+    // The memory of the textures the transient targets were packed into, and what they would
+    // take if every one of them had a texture of its own
+    UINT64 TransientMemory;
+    UINT64 UnaliasedMemory;
+
+    // Passes that were recorded into command lists on deferred contexts
+    UINT DeferredPassCount;
+
+    // The shader, resource and state binds made by the passes and how many of them were dropped
+    // for not changing anything
+    UINT StateCalls;
+    UINT FilteredStateCalls;
+
+    // The draws and dispatches made by the passes
+    UINT DrawCalls;
+    UINT Dispatches;
+};
+
+// Describes a frame as a list of passes and the render targets each of them reads and writes.
+// The graph is rebuilt every frame between Reset and Execute. Passes that nothing reads from
+// are culled, and transient targets that are never alive at the same time share a texture.
+//
+// Targets are either imported, for anything owned elsewhere such as the back buffer or the
+// g-buffer, or transient, in which case the graph creates them and their contents are undefined
+// until the first pass that writes them. Passes are executed in the order they were added so
+// they must be added after the passes that write what they read.
+//
+// Passes that share no CPU side state with each other can be marked as recordable on a deferred
+// context. Runs of such passes are recorded into command lists in parallel on the thread pool,
+// the lists are then executed in pass order so the GPU sees the same sequence of commands. Each
+// deferred pass starts from the default pipeline state with the viewports of the context passed
+// to Execute, and the context is left in the default state with those viewports afterwards.
+//
+// Passes are handed a state caching context in front of the one they run on, so a pass can set
+// everything it uses without paying for what the previous pass already bound.
+//
+// Contexts that cannot execute command lists, such as a recording context, still have the runs
+// of deferred passes split out when there is a thread pool. Their passes run one after another
+// with the context reset to its default state before each one, so recording a frame checks the
+// passes against the same state they would see on the threaded path.
+class FrameGraph
+{
+public:
+    typedef std::tr1::function<HRESULT (ID3D11DeviceContext* context)> ExecuteFunction;
+
+    static const UINT INVALID_TARGET = (UINT)-1;
+
+private:
+    struct TARGET_INFO
+    {
+        std::wstring Name;
+        bool Transient;
+        FrameGraphTargetDesc Desc;
+
+        // Set for imported targets, filled in from the texture pool for transient ones
+        ID3D11ShaderResourceView* SRV;
+        ID3D11RenderTargetView* RTV;
+
+        bool Output;
+        bool Needed;
+        UINT FirstPass;
+        UINT LastPass;
+    };
+    std::vector<TARGET_INFO> _targets;
+
+    struct PASS_INFO
+    {
+        std::wstring Name;
+        ExecuteFunction Execute;
+        std::vector<UINT> Reads;
+        std::vector<UINT> Writes;
+        bool SideEffects;
+        bool Deferred;
+        bool Culled;
+    };
+    std::vector<PASS_INFO> _passes;
+
+    ThreadPool* _threadPool;
+
+    // The passes of the run being recorded, indexed by the deferred context they are recorded on
+    struct RECORD_INFO
+    {
+        UINT Pass;
+        ID3D11CommandList* CommandList;
+        HRESULT Result;
+        float RecordTime;
+    };
+    std::vector<RECORD_INFO> _records;
+    std::vector<ID3D11DeviceContext*> _deferredContexts;
+    std::vector<StateCachingDeviceContext*> _deferredStateCaches;
+    D3D11_VIEWPORT _viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+    UINT _viewportCount;
+
+    // Textures are kept from frame to frame, a texture is free again for a new target once the
+    // last pass using the target it holds has run
+    struct TEXTURE_INFO
+    {
+        FrameGraphTargetDesc Desc;
+        ID3D11ShaderResourceView* SRV;
+        ID3D11RenderTargetView* RTV;
+        UINT64 Size;
+
+        bool Used;
+        UINT FreeAfterPass;
+    };
+    std::vector<TEXTURE_INFO> _textures;
+
+    StateCachingDeviceContext _stateCache;
+
+    FrameGraphStats _stats;
+
+    static UINT64 getTargetSize(const FrameGraphTargetDesc& desc);
+    static HRESULT createTexture(ID3D11Device* device, const FrameGraphTargetDesc& desc, UINT idx,
+        TEXTURE_INFO* texture);
+
+    void cullPasses();
+    void computeLifetimes();
+    HRESULT allocateTextures(ID3D11Device* device);
+
+    HRESULT executePass(ID3D11DeviceContext* context, UINT pass);
+    HRESULT executeDeferredRun(ID3D11DeviceContext* context, ID3D11Device* device, UINT firstPass, UINT endPass);
+    HRESULT executeSerialRun(ID3D11DeviceContext* context, UINT firstPass, UINT endPass);
+
+    // Executing the command lists of a run leaves the context in its default state, the fixed
+    // function state the passes before the run left bound is put back afterwards
+    struct PIPELINE_STATE_INFO
+    {
+        ID3D11RasterizerState* RasterizerState;
+        ID3D11DepthStencilState* DepthStencilState;
+        UINT StencilRef;
+        ID3D11BlendState* BlendState;
+        FLOAT BlendFactor[4];
+        UINT SampleMask;
+    };
+    static void saveState(ID3D11DeviceContext* context, PIPELINE_STATE_INFO* state);
+    static void restoreState(ID3D11DeviceContext* context, PIPELINE_STATE_INFO* state);
+    void recordPasses(UINT begin, UINT end);
+    void addStateCacheStats(StateCachingDeviceContext* stateCache);
+
+public:
+    FrameGraph();
+    ~FrameGraph();
+
+    void Reset();
+
+    UINT ImportTarget(const std::wstring& name, ID3D11ShaderResourceView* srv, ID3D11RenderTargetView* rtv);
+    UINT CreateTarget(const std::wstring& name, const FrameGraphTargetDesc& desc);
+
+    // Passes that write an output are never culled, neither are passes with side effects
+    void MarkOutput(UINT target);
+
+    // A deferred pass may be recorded on a worker thread at the same time as the deferred passes
+    // next to it, it must not touch anything those passes use on the CPU. Its events are logged
+    // in the lane of the thread it was recorded on
+    UINT AddPass(const std::wstring& name, const ExecuteFunction& execute, bool sideEffects = false,
+        bool deferred = false);
+    void Read(UINT pass, UINT target);
+    void Write(UINT pass, UINT target);
+
+    // Only valid while the passes are executing
+    ID3D11ShaderResourceView* GetSRV(UINT target) const { return _targets[target].SRV; }
+    ID3D11RenderTargetView* GetRTV(UINT target) const { return _targets[target].RTV; }
+
+    // Deferred passes are recorded on the calling thread when there is no thread pool
+    void SetThreadPool(ThreadPool* threadPool) { _threadPool = threadPool; }
+
+    HRESULT Execute(ID3D11DeviceContext* context);
+
+    const FrameGraphStats& GetStats() const { return _stats; }
+
+    // Releases every pooled texture, they are created again by the next Execute
+    void ReleaseTextures();
+
+    // Releases the deferred contexts, they are created again when they are next needed
+    void ReleaseDeferredContexts();
+};
\ No newline at end of file
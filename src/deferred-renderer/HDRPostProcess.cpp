@@ -23,18 +23,43 @@ HDRPostProcess::HDRPostProcess()
         _lumSRVs[i] = NULL;
     }
 
+    _frameGraph = NULL;
     for (UINT i = 0; i < 3; i++)
     {
+        _downScaleTargets[i] = FrameGraph::INVALID_TARGET;
         _downScaleRTVs[i] = NULL;
         _downScaleSRVs[i] = NULL;
     }
 
+    _blurTempTarget = FrameGraph::INVALID_TARGET;
     _blurTempRTV = NULL;
     _blurTempSRV = NULL;
 
     _colorGradeSRV = NULL;
 }
 
+void HDRPostProcess::DeclareTargets(FrameGraph* graph, UINT pass, const FrameGraphTargetDesc& sceneDesc)
+{
+    _frameGraph = graph;
+
+    FrameGraphTargetDesc dsDesc = sceneDesc;
+    dsDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    dsDesc.MipLevels = 1;
+
+    const WCHAR* dsNames[3] = { L"HDR 1/2 Downsample", L"HDR 1/4 Downsample", L"HDR 1/8 Downsample" };
+    for (UINT i = 0; i < 3; i++)
+    {
+        dsDesc.Width = sceneDesc.Width >> (i + 1);
+        dsDesc.Height = sceneDesc.Height >> (i + 1);
+
+        _downScaleTargets[i] = graph->CreateTarget(dsNames[i], dsDesc);
+        graph->Write(pass, _downScaleTargets[i]);
+    }
+
+    _blurTempTarget = graph->CreateTarget(L"HDR Blur Temporary", dsDesc);
+    graph->Write(pass, _blurTempTarget);
+}
+
 HRESULT HDRPostProcess::Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11ShaderResourceView* src,
                                ID3D11RenderTargetView* dstRTV, Camera* camera, GBuffer* gBuffer, ParticleBuffer* pBuffer,LightBuffer* lightBuffer)
 {
@@ -43,6 +68,14 @@ HRESULT HDRPostProcess::Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11
     HRESULT hr;
     D3D11_MAPPED_SUBRESOURCE mappedResource;
 
+    for (UINT i = 0; i < 3; i++)
+    {
+        _downScaleRTVs[i] = _frameGraph->GetRTV(_downScaleTargets[i]);
+        _downScaleSRVs[i] = _frameGraph->GetSRV(_downScaleTargets[i]);
+    }
+    _blurTempRTV = _frameGraph->GetRTV(_blurTempTarget);
+    _blurTempSRV = _frameGraph->GetSRV(_blurTempTarget);
+
     // Save the old viewport
     D3D11_VIEWPORT vpOld[D3D11_VIEWPORT_AND_SCISSORRECT_MAX_INDEX];
     UINT nViewPorts = 1;
@@ -405,83 +438,6 @@ HRESULT HDRPostProcess::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, Conten
     SAFE_RELEASE(lumTextures[0]);
     SAFE_RELEASE(lumTextures[1]);
 
-    // Create the downscale/blur temp objects
-    // Create the textures
-    D3D11_TEXTURE2D_DESC dsTextureDesc =
-    {
-        1,//pBackBufferSurfaceDesc->Width,//UINT Width;
-        1,//pBackBufferSurfaceDesc->Height,//UINT Height;
-        1,//UINT MipLevels;
-        1,//UINT ArraySize;
-        DXGI_FORMAT_R16G16B16A16_FLOAT,//DXGI_FORMAT Format;
-        1,//DXGI_SAMPLE_DESC SampleDesc;
-        0,
-        D3D11_USAGE_DEFAULT,//D3D11_USAGE Usage;
-        D3D11_BIND_RENDER_TARGET|D3D11_BIND_SHADER_RESOURCE,//UINT BindFlags;
-        0,//UINT CPUAccessFlags;
-        0, //UINT MiscFlags;
-    };
-
-    ID3D11Texture2D* downScaleTextures[3];
-    ID3D11Texture2D* blurTempTexture;
-
-    dsTextureDesc.Width = pBackBufferSurfaceDesc->Width / 2;
-    dsTextureDesc.Height = pBackBufferSurfaceDesc->Height / 2;
-    V_RETURN(pd3dDevice->CreateTexture2D(&dsTextureDesc, NULL, &downScaleTextures[0]));
-
-    dsTextureDesc.Width = pBackBufferSurfaceDesc->Width / 4;
-    dsTextureDesc.Height = pBackBufferSurfaceDesc->Height / 4;
-    V_RETURN(pd3dDevice->CreateTexture2D(&dsTextureDesc, NULL, &downScaleTextures[1]));
-
-    dsTextureDesc.Width = pBackBufferSurfaceDesc->Width / 8;
-    dsTextureDesc.Height = pBackBufferSurfaceDesc->Height / 8;
-    V_RETURN(pd3dDevice->CreateTexture2D(&dsTextureDesc, NULL, &downScaleTextures[2]));
-    V_RETURN(pd3dDevice->CreateTexture2D(&dsTextureDesc, NULL, &blurTempTexture));
-
-    // Create the render target views
-    D3D11_RENDER_TARGET_VIEW_DESC dsRTVDesc =
-    {
-        DXGI_FORMAT_R16G16B16A16_FLOAT,
-        D3D11_RTV_DIMENSION_TEXTURE2D,
-        0,
-        0
-    };
-
-    V_RETURN(pd3dDevice->CreateRenderTargetView(downScaleTextures[0], &dsRTVDesc, &_downScaleRTVs[0]));
-    V_RETURN(pd3dDevice->CreateRenderTargetView(downScaleTextures[1], &dsRTVDesc, &_downScaleRTVs[1]));
-    V_RETURN(pd3dDevice->CreateRenderTargetView(downScaleTextures[2], &dsRTVDesc, &_downScaleRTVs[2]));
-    V_RETURN(pd3dDevice->CreateRenderTargetView(blurTempTexture, &dsRTVDesc, &_blurTempRTV));
-
-    V_RETURN(SetDXDebugName(_downScaleRTVs[0], "HDR 1/2 Downsample RTV"));
-    V_RETURN(SetDXDebugName(_downScaleRTVs[1], "HDR 1/4 Downsample RTV"));
-    V_RETURN(SetDXDebugName(_downScaleRTVs[2], "HDR 1/8 Downsample RTV"));
-    V_RETURN(SetDXDebugName(_blurTempRTV, "HDR Blur Temporary RTV"));
-
-    // create the SRVs
-    D3D11_SHADER_RESOURCE_VIEW_DESC dsSRVDesc =
-    {
-        DXGI_FORMAT_R16G16B16A16_FLOAT,
-        D3D11_SRV_DIMENSION_TEXTURE2D,
-        0,
-        0
-    };
-    dsSRVDesc.Texture2D.MipLevels = 1;
-
-    V_RETURN(pd3dDevice->CreateShaderResourceView(downScaleTextures[0], &dsSRVDesc, &_downScaleSRVs[0]));
-    V_RETURN(pd3dDevice->CreateShaderResourceView(downScaleTextures[1], &dsSRVDesc, &_downScaleSRVs[1]));
-    V_RETURN(pd3dDevice->CreateShaderResourceView(downScaleTextures[2], &dsSRVDesc, &_downScaleSRVs[2]));
-    V_RETURN(pd3dDevice->CreateShaderResourceView(blurTempTexture, &dsSRVDesc, &_blurTempSRV));
-
-    V_RETURN(SetDXDebugName(_downScaleSRVs[0], "HDR 1/2 Downsample SRV"));
-    V_RETURN(SetDXDebugName(_downScaleSRVs[1], "HDR 1/4 Downsample SRV"));
-    V_RETURN(SetDXDebugName(_downScaleSRVs[2], "HDR 1/8 Downsample SRV"));
-    V_RETURN(SetDXDebugName(_blurTempSRV, "HDR Blur Temporary SRV"));
-
-    SAFE_RELEASE(downScaleTextures[0]);
-    SAFE_RELEASE(downScaleTextures[1]);
-    SAFE_RELEASE(downScaleTextures[2]);
-    SAFE_RELEASE(blurTempTexture);
-
     _invSceneSize.x = 1.0f / pBackBufferSurfaceDesc->Width;
     _invSceneSize.y = 1.0f / pBackBufferSurfaceDesc->Height;
 
@@ -497,13 +453,4 @@ void HDRPostProcess::OnD3D11ReleasingSwapChain(ContentManager* pContentManager)
         SAFE_RELEASE(_lumRTVs[i]);
         SAFE_RELEASE(_lumSRVs[i]);
     }
-
-    for (UINT i = 0; i < 3; i++)
-    {
-        SAFE_RELEASE(_downScaleRTVs[i]);
-        SAFE_RELEASE(_downScaleSRVs[i]);
-    }
-
-    SAFE_RELEASE(_blurTempRTV);
-    SAFE_RELEASE(_blurTempSRV);
 }
\ No newline at end of file
@@ -19,9 +19,16 @@ private:
     UINT _lumMapSize;
     UINT _mipLevels;
 
+    // The adapted luminance is kept from frame to frame so these targets are owned here
     ID3D11RenderTargetView* _lumRTVs[2];
     ID3D11ShaderResourceView* _lumSRVs[2];
 
+    // The bloom targets only live during the pass, they come from the frame graph and their
+    // views are looked up when rendering
+    FrameGraph* _frameGraph;
+    UINT _downScaleTargets[3];
+    UINT _blurTempTarget;
+
     ID3D11RenderTargetView* _downScaleRTVs[3];
     ID3D11ShaderResourceView* _downScaleSRVs[3];
 
@@ -82,6 +89,8 @@ public:
     float GetExposureKey() const { return _exposureKey; }
     void SetExposureKey(float key) { _exposureKey = clamp(key, 0.0f, 1.0f); }
 
+    void DeclareTargets(FrameGraph* graph, UINT pass, const FrameGraphTargetDesc& sceneDesc);
+
     HRESULT Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11ShaderResourceView* src,
         ID3D11RenderTargetView* dstRTV, Camera* camera, GBuffer* gBuffer, ParticleBuffer* pBuffer,LightBuffer* lightBuffer);
 
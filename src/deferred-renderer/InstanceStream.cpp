@@ -0,0 +1,103 @@
+#include "PCH.h"
+#include "InstanceStream.h"
+
+InstanceStream::InstanceStream(UINT stride, UINT initialInstances, UINT maxInstances, const char* debugName)
+    : _stride(stride), _initialInstances(min(initialInstances, maxInstances)), _maxInstances(maxInstances),
+      _debugName(debugName), _buffer(NULL), _capacity(0), _position(0), _discardNext(true)
+{
+}
+
+InstanceStream::~InstanceStream()
+{
+    SAFE_RELEASE(_buffer);
+}
+
+HRESULT InstanceStream::createBuffer(ID3D11Device* device, UINT capacity)
+{
+    HRESULT hr;
+
+    D3D11_BUFFER_DESC vbDesc =
+    {
+        _stride * capacity, // INT ByteWidth;
+        D3D11_USAGE_DYNAMIC, // D3D11_USAGE Usage;
+        D3D11_BIND_VERTEX_BUFFER, // UINT BindFlags;
+        D3D11_CPU_ACCESS_WRITE, // UINT CPUAccessFlags;
+        0, // UINT MiscFlags;
+        0, // UINT StructureByteStride;
+    };
+
+    ID3D11Buffer* buffer;
+    V_RETURN(device->CreateBuffer(&vbDesc, NULL, &buffer));
+
+    // A context that still has the old buffer bound keeps it alive until it is unbound
+    SAFE_RELEASE(_buffer);
+    _buffer = buffer;
+    _capacity = capacity;
+    _position = 0;
+    _discardNext = true;
+
+    V_RETURN(SetDXDebugName(_buffer, _debugName));
+
+    return S_OK;
+}
+
+void InstanceStream::Begin(ID3D11DeviceContext* context)
+{
+    if (context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED)
+    {
+        _discardNext = true;
+    }
+}
+
+HRESULT InstanceStream::Map(ID3D11DeviceContext* context, UINT count, void** data, UINT* firstInstance)
+{
+    HRESULT hr;
+
+    if (count > _maxInstances)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (count > _capacity)
+    {
+        ID3D11Device* device;
+        context->GetDevice(&device);
+        hr = createBuffer(device, min(max(count, _capacity * 2), _maxInstances));
+        SAFE_RELEASE(device);
+        V_RETURN(hr);
+    }
+
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (_discardNext || _position + count > _capacity)
+    {
+        mapType = D3D11_MAP_WRITE_DISCARD;
+        _position = 0;
+        _discardNext = false;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    V_RETURN(context->Map(_buffer, 0, mapType, 0, &mappedResource));
+
+    *data = (BYTE*)mappedResource.pData + _position * _stride;
+    *firstInstance = _position;
+    _position += count;
+
+    return S_OK;
+}
+
+void InstanceStream::Unmap(ID3D11DeviceContext* context)
+{
+    context->Unmap(_buffer, 0);
+}
+
+HRESULT InstanceStream::OnD3D11CreateDevice(ID3D11Device* pd3dDevice)
+{
+    return createBuffer(pd3dDevice, _initialInstances);
+}
+
+void InstanceStream::OnD3D11DestroyDevice()
+{
+    SAFE_RELEASE(_buffer);
+    _capacity = 0;
+    _position = 0;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PCH.h"
+
+// A dynamic vertex buffer that per instance data is streamed through. Each map appends after the
+// previous one with D3D11_MAP_WRITE_NO_OVERWRITE so the GPU can keep reading what was drawn from
+// earlier in the frame, the buffer is only discarded once it is full. It grows when a map asks for
+// more than it holds, up to a maximum, and larger sets have to be drawn in batches of at most
+// GetMaxInstances instances.
+class InstanceStream
+{
+private:
+    UINT _stride;
+    UINT _initialInstances;
+    UINT _maxInstances;
+    const char* _debugName;
+
+    ID3D11Buffer* _buffer;
+    UINT _capacity;
+    UINT _position;
+    bool _discardNext;
+
+    HRESULT createBuffer(ID3D11Device* device, UINT capacity);
+
+public:
+    InstanceStream(UINT stride, UINT initialInstances, UINT maxInstances, const char* debugName);
+    ~InstanceStream();
+
+    UINT GetStride() const { return _stride; }
+    UINT GetMaxInstances() const { return _maxInstances; }
+
+    // The buffer can be replaced by a map that needs it to grow
+    ID3D11Buffer* GetBuffer() const { return _buffer; }
+
+    // Called before the first map of every frame. A deferred context may only map with
+    // NO_OVERWRITE after it has discarded the buffer itself, so the first map of a frame recorded
+    // on one always discards.
+    void Begin(ID3D11DeviceContext* context);
+
+    // Maps room for count instances, count can not be more than GetMaxInstances. The first
+    // instance is where the data starts in the buffer, it is the start instance location of the
+    // draws that use it.
+    HRESULT Map(ID3D11DeviceContext* context, UINT count, void** data, UINT* firstInstance);
+    void Unmap(ID3D11DeviceContext* context);
+
+    HRESULT OnD3D11CreateDevice(ID3D11Device* pd3dDevice);
+    void OnD3D11DestroyDevice();
+};
\ No newline at end of file
@@ -41,6 +41,8 @@ public:
 
     void Clear()
     {
+        GetConstantBuffers()->Reset();
+
         _shadowed.clear();
         _unshadowed.clear();
     }
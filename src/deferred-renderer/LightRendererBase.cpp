@@ -29,6 +29,8 @@ void LightRendererBase::OnD3D11DestroyDevice(ContentManager* pContentManager)
     _samplerStates.OnD3D11DestroyDevice(pContentManager);
     _blendStates.OnD3D11DestroyDevice(pContentManager);
     _rasterStates.OnD3D11DestroyDevice(pContentManager);
+
+    _constantBuffers.OnD3D11DestroyDevice();
 }
 
 HRESULT LightRendererBase::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, ContentManager* pContentManager, IDXGISwapChain* pSwapChain,
@@ -7,6 +7,8 @@
 #include "Camera.h"
 #include "GBuffer.h"
 #include "ParticleBuffer.h"
+#include "ConstantBufferAllocator.h"
+#include "ShadowAtlas.h"
 
 class LightRendererBase : public IHasContent
 {
@@ -16,6 +18,8 @@ private:
     BlendStates _blendStates;
     RasterizerStates _rasterStates;
 
+    ConstantBufferAllocator _constantBuffers;
+
     bool _alphaCutoutEnabled;
     float _alphaThreshold;
 
@@ -25,12 +29,19 @@ protected:
     BlendStates* GetBlendStates() { return &_blendStates; }
     RasterizerStates* GetRasterizerStates() { return &_rasterStates; }
 
+    // For the constants of a single light or draw, reset when the lights are cleared
+    ConstantBufferAllocator* GetConstantBuffers() { return &_constantBuffers; }
+
     virtual UINT GetMaxShadowedLights() const = 0;
 
 public:
     LightRendererBase();
     virtual ~LightRendererBase();
 
+    // Called on the main thread before the shadow maps are rendered, renderers that draw their
+    // shadows into the atlas request their regions here
+    virtual void RequestShadowMaps(ShadowAtlas* atlas, Camera* camera) { }
+
     virtual HRESULT RenderGeometryShadowMaps(ID3D11DeviceContext* pd3dImmediateContext, std::vector<ModelInstance*>* models,
         Camera* camera, AxisAlignedBox* sceneBounds) = 0;
     virtual HRESULT RenderGeometryLights(ID3D11DeviceContext* pd3dImmediateContext, Camera* camera,
@@ -44,6 +55,8 @@ public:
 
     virtual void Clear() = 0;
 
+    const ConstantBufferStats& GetConstantBufferStats() const { return _constantBuffers.GetStats(); }
+
     bool GetAlphaCutoutEnabled() const { return _alphaCutoutEnabled; }
     void SetAlphaCutoutEnabled(bool enabled) { _alphaCutoutEnabled = enabled; }
 
@@ -2,7 +2,7 @@
 #include "Lights.h"
 
 Light::Light(const XMFLOAT3& color, float brightness)
-    : _color(color), _brightness(brightness)
+    : _color(color), _brightness(brightness), _shadowImportance(1.0f)
 {
 }
 
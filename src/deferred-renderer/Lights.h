@@ -8,6 +8,7 @@ class Light
 private:
     XMFLOAT3 _color;
     float _brightness;
+    float _shadowImportance;
 
 public:
     Light(const XMFLOAT3& color, float brightness);
@@ -18,6 +19,11 @@ public:
     float GetBrightness() const { return _brightness; }
     void SetBrightness(float brightness)  { _brightness = brightness; }
 
+    // Scales how much of the shadow atlas the light asks for compared to others covering as much
+    // of the screen
+    float GetShadowImportance() const { return _shadowImportance; }
+    void SetShadowImportance(float importance) { _shadowImportance = max(importance, 0.0f); }
+
     XMFLOAT3 GetMultipliedColor() const;
 
     void MergeColor(Light* otherLight);
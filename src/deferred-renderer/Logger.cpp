@@ -1,25 +1,42 @@
 #include "PCH.h"
 #include "Logger.h"
 
+const float Logger::REPEAT_INTERVAL = 1.0f;
+
+// Set the first time a thread logs an event or a message
+static __declspec(thread) void* threadEventInfo = NULL;
+
 Logger::Logger()
-    : _nextEventSlot(0), _curEvent(NULL), _clogbuf(NULL), _cerrbuf(NULL)
+    : _clogbuf(NULL), _cerrbuf(NULL), _messageWriteIndex(0), _messageReadIndex(0), _droppedMessages(0),
+      _eventThread(GetCurrentThreadId()), _nameCount(0), _timerFreq(1.0), _startTime(0)
 {
-#ifdef EVENTS_ENABLED
+    InitializeCriticalSection(&_threadLock);
+    InitializeCriticalSection(&_nameLock);
+
+    ZeroMemory(_names, sizeof(_names));
+
+    // Every slot starts out free for the first lap of writes
+    for (UINT i = 0; i < MESSAGE_COUNT; i++)
+    {
+        _messages[i].Sequence = i;
+    }
+
     // Query for the frequency of the counter now
     LARGE_INTEGER largeInt;
     QueryPerformanceFrequency(&largeInt);
     _timerFreq = (double)largeInt.QuadPart;
 
+    QueryPerformanceCounter(&largeInt);
+    _startTime = largeInt.QuadPart;
+
+#ifdef EVENTS_ENABLED
     for (UINT i = 0; i < 2; i++)
     {
-        _events[i] = new EVENT_INFO[MAX_EVENTS];
-        ZeroMemory(_events[i], sizeof(EVENT_INFO) * MAX_EVENTS);
-    }
-#else
-    for (UINT i = 0; i < 2; i++)
-    {
-        _events[i] = NULL;
+        _frames[i].BeginTime = 0;
     }
+
+    // The thread creating the logger always has the first lane
+    getThread()->Name = L"Main";
 #endif
 
     _clogbuf = std::clog.rdbuf(this);
@@ -28,12 +45,17 @@ Logger::Logger()
 
 Logger::~Logger()
 {
-#ifdef EVENTS_ENABLED
-    for (UINT i = 0; i < 2; i++)
+    for (UINT i = 0; i < _threads.size(); i++)
     {
-        SAFE_DELETE_ARRAY(_events[i]);
+        SAFE_DELETE(_threads[i]);
+    }
+    for (UINT i = 0; i < MAX_EVENT_NAMES; i++)
+    {
+        SAFE_DELETE(_names[i]);
     }
-#endif
+
+    DeleteCriticalSection(&_threadLock);
+    DeleteCriticalSection(&_nameLock);
 
     if (_clogbuf)
     {
@@ -70,39 +92,6 @@ std::streamsize Logger::xsputn(const char * s, std::streamsize n)
     return n;
 }
 
-void Logger::flush()
-{
-    if (_readers.size() == 0 || _messages.size() == 0)
-    {
-        return;
-    }
-
-    // Scan messages
-    for (UINT i = 0; i < _messages.size(); i++)
-    {
-        bool dispatched = false;
-
-        // Check for readers that read this kind of message
-        for (UINT j = 0; j < _readers.size(); j++)
-        {
-            if (_messages[i].Type & _readers[j].Type)
-            {
-                // Reader found, do the callback
-                LogFunction func = _readers[j].Function;
-                func(_messages[i].Type, _messages[i].Sender, _messages[i].Message);
-
-                dispatched = true;
-            }
-        }
-
-        if (dispatched)
-        {
-            _messages.erase(_messages.begin() + i);
-            i--;
-        }
-    }
-}
-
 void Logger::AddReader(UINT type, void* caller, LogFunction callbackFunction)
 {
     READER_INFO info =
@@ -114,7 +103,7 @@ void Logger::AddReader(UINT type, void* caller, LogFunction callbackFunction)
 
     _readers.push_back(info);
 
-    flush();
+    FlushMessages();
 }
 
 void Logger::RemoveReader(void* caller)
@@ -129,200 +118,541 @@ void Logger::RemoveReader(void* caller)
     }
 }
 
-void Logger::AddLogMessage(UINT type, const std::wstring& sender, const std::wstring& message)
+bool Logger::queueMessage(UINT type, const WCHAR* sender, const WCHAR* message)
 {
-    MESSAGE_INFO info =
+    // Claim the next slot, it is free once the flush has moved its sequence a lap ahead
+    LONG pos = _messageWriteIndex;
+    MESSAGE_INFO* slot;
+    while (true)
     {
-        type,        // UINT Type;
-        sender,        // std::wstring Sender;
-        message,        //std::wstring Message;
-    };
-    _messages.push_back(info);
+        slot = &_messages[pos & (MESSAGE_COUNT - 1)];
+        LONG diff = slot->Sequence - pos;
+        if (diff == 0)
+        {
+            LONG prev = InterlockedCompareExchange(&_messageWriteIndex, pos + 1, pos);
+            if (prev == pos)
+            {
+                break;
+            }
+            pos = prev;
+        }
+        else if (diff < 0)
+        {
+            InterlockedIncrement(&_droppedMessages);
+            return false;
+        }
+        else
+        {
+            pos = _messageWriteIndex;
+        }
+    }
 
-#if _DEBUG
-    std::wstring debugMessage = sender + std::wstring(L":") + message;
-    OutputDebugString(debugMessage.c_str());
+    slot->Type = type;
+    wcsncpy_s(slot->Sender, sender, _TRUNCATE);
+    wcsncpy_s(slot->Message, message, _TRUNCATE);
+
+    // The message must be written before the flush can see it
+    _WriteBarrier();
+    slot->Sequence = pos + 1;
+
+    return true;
+}
 
-    if (debugMessage.size() > 0 && debugMessage[debugMessage.size() - 1] != L'\n')
+void Logger::dispatchMessage(UINT type, const WCHAR* sender, const WCHAR* message)
+{
+    _flushSender = sender;
+    _flushMessage = message;
+
+    for (UINT i = 0; i < _readers.size(); i++)
     {
-        OutputDebugString(L"\n");
+        if (type & _readers[i].Type)
+        {
+            LogFunction func = _readers[i].Function;
+            func(type, _flushSender, _flushMessage);
+        }
     }
-#endif
-
-    // Flush the message queue
-    flush();
 }
 
-void Logger::BeginEvent(const std::wstring& name, bool graphicsEvent)
+void Logger::FlushMessages()
 {
-#ifdef EVENTS_ENABLED
-    if (_nextEventSlot >= MAX_EVENTS)
+    if (_readers.size() == 0)
     {
-        AddLogMessage(MessageType::Error, L"Logger", L"Max event limit hit, too many calls to BeginEvent?");
         return;
     }
 
+    // Messages the readers log while this runs wait for the next flush
+    LONG end = _messageWriteIndex;
+    while (_messageReadIndex < end)
+    {
+        MESSAGE_INFO& slot = _messages[_messageReadIndex & (MESSAGE_COUNT - 1)];
+        if (slot.Sequence != _messageReadIndex + 1)
+        {
+            // Claimed but not written yet
+            break;
+        }
+        _ReadBarrier();
+
+        dispatchMessage(slot.Type, slot.Sender, slot.Message);
+
+        _ReadWriteBarrier();
+        slot.Sequence = _messageReadIndex + MESSAGE_COUNT;
+        _messageReadIndex++;
+    }
+
+    LONG dropped = InterlockedExchange(&_droppedMessages, 0);
+    if (dropped > 0)
+    {
+        WCHAR msg[128];
+        swprintf_s(msg, L"%d messages were dropped, the message queue was full.", dropped);
+        dispatchMessage(MessageType::Warning, L"Logger", msg);
+    }
+}
+
+void Logger::AddLogMessage(UINT type, const WCHAR* sender, const WCHAR* message)
+{
+#if _DEBUG
+    OutputDebugString(sender);
+    OutputDebugString(L":");
+    OutputDebugString(message);
+
+    size_t length = wcslen(message);
+    if (length == 0 || message[length - 1] != L'\n')
+    {
+        OutputDebugString(L"\n");
+    }
+#endif
+
+    THREAD_INFO* thread = getThread();
+
     LARGE_INTEGER largeInt;
     QueryPerformanceCounter(&largeInt);
 
-    EVENT_INFO* newEvent = &_events[0][_nextEventSlot];
+    // FNV-1a over the whole message
+    UINT hash = 2166136261U ^ type;
+    for (const WCHAR* c = sender; *c; c++)
+    {
+        hash = (hash ^ *c) * 16777619U;
+    }
+    for (const WCHAR* c = message; *c; c++)
+    {
+        hash = (hash ^ *c) * 16777619U;
+    }
+
+    if (hash == thread->LastMessageHash && largeInt.QuadPart - thread->LastMessageTime < REPEAT_INTERVAL * _timerFreq)
+    {
+        thread->RepeatCount++;
+        return;
+    }
+
+    if (thread->RepeatCount > 0)
+    {
+        WCHAR note[128];
+        swprintf_s(note, L"The last message was repeated %u more times.", thread->RepeatCount);
+        queueMessage(thread->LastMessageType, L"Logger", note);
+        thread->RepeatCount = 0;
+    }
+
+    if (queueMessage(type, sender, message))
+    {
+        thread->LastMessageType = type;
+        thread->LastMessageHash = hash;
+        thread->LastMessageTime = largeInt.QuadPart;
+    }
+}
+
+void Logger::AddLogMessage(UINT type, const std::wstring& sender, const std::wstring& message)
+{
+    AddLogMessage(type, sender.c_str(), message.c_str());
+}
+
+Logger::THREAD_INFO* Logger::getThread()
+{
+    THREAD_INFO* thread = (THREAD_INFO*)threadEventInfo;
+    if (thread)
+    {
+        return thread;
+    }
 
-    newEvent->Name = name;
-    newEvent->Comment = L"";
-    newEvent->BeginTime = largeInt.QuadPart;
-    newEvent->Duration = -1.0f;
+    thread = new THREAD_INFO();
+    thread->ThreadID = GetCurrentThreadId();
+    thread->WriteIndex = 0;
+    thread->ReadIndex = 0;
+    thread->Depth = 0;
+    thread->DroppedDepth = 0;
+    thread->DroppedCount = 0;
+    thread->GraphicsEventsSuspended = false;
+    thread->LastMessageType = 0;
+    thread->LastMessageHash = 0;
+    thread->LastMessageTime = 0;
+    thread->RepeatCount = 0;
+    ZeroMemory(thread->CachedNames, sizeof(thread->CachedNames));
+    ZeroMemory(thread->CachedIDs, sizeof(thread->CachedIDs));
+
+    WCHAR name[32];
+    swprintf_s(name, L"Thread %u", thread->ThreadID);
+    thread->Name = name;
+
+    EnterCriticalSection(&_threadLock);
+    _threads.push_back(thread);
+    LeaveCriticalSection(&_threadLock);
+
+    threadEventInfo = thread;
+    return thread;
+}
 
-    newEvent->NextSibling = NULL;
-    newEvent->FirstChild = NULL;
-    newEvent->LastChild = NULL;
+UINT Logger::internName(THREAD_INFO* thread, const WCHAR* name)
+{
+    // Names are usually string literals so their address is enough to find them again, it is
+    // still checked against the name in case the memory has since been reused for another one
+    UINT slot = ((size_t)name >> 1) & (NAME_CACHE_SIZE - 1);
+    if (thread->CachedNames[slot] == name && wcscmp(_names[thread->CachedIDs[slot]]->c_str(), name) == 0)
+    {
+        return thread->CachedIDs[slot];
+    }
 
-    newEvent->Red = true;
+    EnterCriticalSection(&_nameLock);
 
-    // Figure out where to place this event
-    if (_nextEventSlot == 0)
+    UINT id;
+    std::map<const WCHAR*, UINT, NAME_LESS>::iterator it = _nameIDs.find(name);
+    if (it != _nameIDs.end())
+    {
+        id = it->second;
+    }
+    else if (_nameCount < MAX_EVENT_NAMES - 1)
     {
-        newEvent->Parent = NULL;
+        id = _nameCount;
+        _names[id] = new std::wstring(name);
+        _nameIDs[_names[id]->c_str()] = id;
+        InterlockedIncrement(&_nameCount);
     }
     else
     {
-        // This should be placed as the last child of the _curEvent
-        if (_curEvent->LastChild)
+        // Every event past the limit shares the last name
+        id = MAX_EVENT_NAMES - 1;
+        if (!_names[id])
         {
-            _curEvent->LastChild->NextSibling = newEvent;
-            newEvent->Red = !_curEvent->LastChild->Red;
+            _names[id] = new std::wstring(L"(Too many event names)");
+            _nameCount = MAX_EVENT_NAMES;
         }
-        else
+    }
+
+    LeaveCriticalSection(&_nameLock);
+
+    thread->CachedNames[slot] = name;
+    thread->CachedIDs[slot] = id;
+
+    return id;
+}
+
+void Logger::writeMarker(THREAD_INFO* thread, UINT name, bool begin, INT64 time)
+{
+    // Once a begin is dropped everything inside it is too, so the depth of the markers that were
+    // written always matches. A begin is only written if there is still room for its own end and
+    // those of every event open around it, so an end is never dropped
+    LONG freeCount = (LONG)MARKER_COUNT - (thread->WriteIndex - thread->ReadIndex);
+    if (begin)
+    {
+        if (thread->DroppedDepth > 0 || freeCount < (LONG)thread->Depth + 2)
         {
-            // _curEvent has no children yet
-            _curEvent->FirstChild = newEvent;
+            thread->DroppedDepth++;
+            thread->DroppedCount++;
+            return;
         }
-        _curEvent->LastChild = newEvent;
-        newEvent->Parent = _curEvent;
+        thread->Depth++;
+    }
+    else
+    {
+        if (thread->DroppedDepth > 0)
+        {
+            thread->DroppedDepth--;
+            return;
+        }
+        _ASSERT(thread->Depth > 0 && freeCount > 0);
+        thread->Depth--;
     }
 
-    // Move the _curEvent pointer
-    _curEvent = newEvent;
+    MARKER_INFO& marker = thread->Markers[thread->WriteIndex & (MARKER_COUNT - 1)];
+    marker.Name = name;
+    marker.Begin = begin;
+    marker.Time = time;
 
-    _nextEventSlot++;
+    // The marker must be written before the gathering can see it
+    _WriteBarrier();
+    thread->WriteIndex++;
+}
 
-    if (graphicsEvent)
+void Logger::BeginEvent(const WCHAR* name, bool graphicsEvent)
+{
+#ifdef EVENTS_ENABLED
+    THREAD_INFO* thread = getThread();
+
+    LARGE_INTEGER largeInt;
+    QueryPerformanceCounter(&largeInt);
+
+    writeMarker(thread, internName(thread, name), true, largeInt.QuadPart);
+
+    if (graphicsEvent && thread->ThreadID == _eventThread && !thread->GraphicsEventsSuspended)
     {
         // Alternate event colors between red and blue
-        D3DCOLOR col = D3DCOLOR_COLORVALUE(newEvent->Red ? 1.0f : 0.0f, 0.0f, newEvent->Red ? 0.0f : 1.0f, 1.0f);
-        D3DPERF_BeginEvent(col, name.c_str());
+        bool red = (thread->Depth & 1) != 0;
+        D3DCOLOR col = D3DCOLOR_COLORVALUE(red ? 1.0f : 0.0f, 0.0f, red ? 0.0f : 1.0f, 1.0f);
+        D3DPERF_BeginEvent(col, name);
     }
 #else
-    if (graphicsEvent)
+    if (graphicsEvent && GetCurrentThreadId() == _eventThread)
     {
         D3DPERF_BeginEvent(D3DCOLOR_COLORVALUE(1.0f, 1.0f, 1.0f, 1.0f), name);
     }
 #endif
 }
 
-void Logger::EndEvent(const std::wstring& comment, bool graphicsEvent)
+void Logger::EndEvent(bool graphicsEvent)
 {
 #ifdef EVENTS_ENABLED
+    THREAD_INFO* thread = getThread();
+
     LARGE_INTEGER largeInt;
     QueryPerformanceCounter(&largeInt);
 
-    if (!_curEvent)
+    if (thread->Depth == 0 && thread->DroppedDepth == 0)
     {
         AddLogMessage(MessageType::Error, L"Logger", L"Too many calls to EndEvent, no events to end.");
         return;
     }
 
-    // Calculate the duration
-    _curEvent->Duration = (float)((largeInt.QuadPart - _curEvent->BeginTime) / _timerFreq);
+    writeMarker(thread, 0, false, largeInt.QuadPart);
 
-    // Change the _curEvent pointer
-    if (_curEvent->Parent)
+    if (graphicsEvent && thread->ThreadID == _eventThread && !thread->GraphicsEventsSuspended)
     {
-        _curEvent = _curEvent->Parent;
+        D3DPERF_EndEvent();
     }
-    else
+
+    // Ending a root event on this thread finishes the frame
+    if (thread->ThreadID == _eventThread && thread->Depth == 0 && thread->DroppedDepth == 0)
     {
-        // Ending the root event, re-setting the tree
-        _curEvent = NULL;
-        _nextEventSlot = 0;
-        swapEventFrames();
+        gatherFrame(thread);
     }
-#endif
-    if (graphicsEvent)
+#else
+    if (graphicsEvent && GetCurrentThreadId() == _eventThread)
     {
         D3DPERF_EndEvent();
     }
+#endif
+}
+
+void Logger::AddEvent(const WCHAR* name, float duration)
+{
+#ifdef EVENTS_ENABLED
+    THREAD_INFO* thread = getThread();
+    if (thread->Depth == 0)
+    {
+        return;
+    }
+
+    LARGE_INTEGER largeInt;
+    QueryPerformanceCounter(&largeInt);
+
+    writeMarker(thread, internName(thread, name), true, largeInt.QuadPart - (INT64)(duration * _timerFreq));
+    writeMarker(thread, 0, false, largeInt.QuadPart);
+#endif
 }
 
-void Logger::swapEventFrames()
+void Logger::SetThreadName(const WCHAR* name)
 {
-    EVENT_INFO* temp = _events[0];
-    _events[0] = _events[1];
-    _events[1] = temp;
+    THREAD_INFO* thread = getThread();
+
+    // The gathering reads the names of the lanes
+    EnterCriticalSection(&_threadLock);
+    thread->Name = name;
+    LeaveCriticalSection(&_threadLock);
+}
+
+void Logger::SetGraphicsEventsSuspended(bool suspended)
+{
+    getThread()->GraphicsEventsSuspended = suspended;
+}
+
+void Logger::gatherLane(THREAD_INFO* gatherThread, THREAD_INFO* thread, LANE_INFO* lane)
+{
+    // The name is read under the thread lock, SetThreadName may be replacing it
+    lane->Thread = thread;
+    lane->Name = internName(gatherThread, thread->Name.c_str());
+    lane->Events.clear();
+    lane->LastRoot = INVALID_EVENT;
+
+    LONG readIndex = thread->ReadIndex;
+    LONG writeIndex = thread->WriteIndex;
+    _ReadBarrier();
+
+    // Only take the markers up to the last point the thread had nothing open, the rest are left
+    // for the next frame
+    LONG end = readIndex;
+    UINT depth = 0;
+    for (LONG i = readIndex; i < writeIndex; i++)
+    {
+        depth = thread->Markers[i & (MARKER_COUNT - 1)].Begin ? depth + 1 : depth - 1;
+        if (depth == 0)
+        {
+            end = i + 1;
+        }
+    }
+
+    _openEvents.clear();
+    for (LONG i = readIndex; i < end; i++)
+    {
+        const MARKER_INFO& marker = thread->Markers[i & (MARKER_COUNT - 1)];
+        if (marker.Begin)
+        {
+            EVENT_INFO event;
+            event.Name = marker.Name;
+            event.BeginTime = marker.Time;
+            event.Duration = 0.0f;
+            event.Parent = _openEvents.empty() ? INVALID_EVENT : _openEvents.back();
+            event.NextSibling = INVALID_EVENT;
+            event.FirstChild = INVALID_EVENT;
+            event.LastChild = INVALID_EVENT;
+
+            UINT idx = lane->Events.size();
+            UINT* prevSibling = (event.Parent != INVALID_EVENT) ? &lane->Events[event.Parent].LastChild : &lane->LastRoot;
+            if (*prevSibling != INVALID_EVENT)
+            {
+                lane->Events[*prevSibling].NextSibling = idx;
+            }
+            else if (event.Parent != INVALID_EVENT)
+            {
+                lane->Events[event.Parent].FirstChild = idx;
+            }
+            *prevSibling = idx;
+
+            lane->Events.push_back(event);
+            _openEvents.push_back(idx);
+        }
+        else
+        {
+            EVENT_INFO& event = lane->Events[_openEvents.back()];
+            event.Duration = (float)((marker.Time - event.BeginTime) / _timerFreq);
+            _openEvents.pop_back();
+        }
+    }
+
+    // The thread may write into the markers again once the read index has passed them
+    _ReadWriteBarrier();
+    thread->ReadIndex = end;
+}
+
+void Logger::gatherFrame(THREAD_INFO* gatherThread)
+{
+    FRAME_INFO& frame = _frames[0];
+
+    EnterCriticalSection(&_threadLock);
+
+    frame.Lanes.resize(_threads.size());
+    frame.BeginTime = 0;
+    for (UINT i = 0; i < _threads.size(); i++)
+    {
+        gatherLane(gatherThread, _threads[i], &frame.Lanes[i]);
+
+        if (frame.Lanes[i].Events.size() > 0 &&
+            (frame.BeginTime == 0 || frame.Lanes[i].Events[0].BeginTime < frame.BeginTime))
+        {
+            frame.BeginTime = frame.Lanes[i].Events[0].BeginTime;
+        }
+    }
+
+    LeaveCriticalSection(&_threadLock);
+
+    std::swap(_frames[0], _frames[1]);
 }
 
 // Event Iterator class...
-Logger::EventIterator::EventIterator(EVENT_INFO* root)
-    : _curEvent(root)
+Logger::EventIterator::EventIterator(const Logger* logger, const FRAME_INFO* frame, const LANE_INFO* lane, UINT index)
+    : _logger(logger), _frame(frame), _lane(lane), _index(index)
 {
 }
 
 const std::wstring& Logger::EventIterator::GetName() const
 {
-    return _curEvent->Name;
+    return *_logger->_names[_lane->Events[_index].Name];
 }
 
-const std::wstring& Logger::EventIterator::GetComment() const
+float Logger::EventIterator::GetDuration() const
 {
-    return _curEvent->Comment;
+    return _lane->Events[_index].Duration;
 }
 
-float Logger::EventIterator::GetDuration() const
+float Logger::EventIterator::GetStartTime() const
 {
-    return _curEvent->Duration;
+    return (float)((_lane->Events[_index].BeginTime - _frame->BeginTime) / _logger->_timerFreq);
 }
 
 bool Logger::EventIterator::IsValid() const
 {
-    return _curEvent != NULL;
+    return _lane && _index < _lane->Events.size();
 }
 
 bool Logger::EventIterator::IsRoot() const
 {
-    return _curEvent->Parent == NULL;
+    return _lane->Events[_index].Parent == INVALID_EVENT;
 }
 
 bool Logger::EventIterator::HasChildren() const
 {
-    return _curEvent->FirstChild != NULL;
+    return _lane->Events[_index].FirstChild != INVALID_EVENT;
 }
 
 bool Logger::EventIterator::HasSiblings() const
 {
-    return _curEvent->NextSibling != NULL;
+    return _lane->Events[_index].NextSibling != INVALID_EVENT;
 }
 
 Logger::EventIterator Logger::EventIterator::GetFirstChild() const
 {
-    return EventIterator(_curEvent->FirstChild);
+    return EventIterator(_logger, _frame, _lane, _lane->Events[_index].FirstChild);
 }
 
 Logger::EventIterator Logger::EventIterator::GetNextSibling() const
 {
-    return EventIterator(_curEvent->NextSibling);
+    return EventIterator(_logger, _frame, _lane, _lane->Events[_index].NextSibling);
 }
 
 Logger::EventIterator Logger::EventIterator::GetParent() const
 {
-    return EventIterator(_curEvent->Parent);
+    return EventIterator(_logger, _frame, _lane, _lane->Events[_index].Parent);
 }
 
 Logger::EventIterator Logger::GetRootEvent()
 {
-    return Logger::EventIterator(&_events[1][0]);
+    return GetLaneRootEvent(0);
+}
+
+UINT Logger::GetLaneCount() const
+{
+    return _frames[1].Lanes.size();
+}
+
+const std::wstring& Logger::GetLaneName(UINT lane) const
+{
+    return *_names[_frames[1].Lanes[lane].Name];
+}
+
+DWORD Logger::GetLaneThreadID(UINT lane) const
+{
+    return _frames[1].Lanes[lane].Thread->ThreadID;
+}
+
+Logger::EventIterator Logger::GetLaneRootEvent(UINT lane)
+{
+    const LANE_INFO* laneInfo = (lane < _frames[1].Lanes.size()) ? &_frames[1].Lanes[lane] : NULL;
+    return Logger::EventIterator(this, &_frames[1], laneInfo, 0);
+}
+
+double Logger::GetFrameStartTime() const
+{
+    return (_frames[1].BeginTime - _startTime) / _timerFreq;
 }
 
 // Static singleton get function
-Logger Logger::_instance = Logger();
+Logger Logger::_instance;
 Logger* Logger::GetInstance()
 {
     return &_instance;
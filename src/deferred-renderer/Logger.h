@@ -29,13 +29,13 @@
 #define SEND_LOG_MESSAGE(type, sender, msg) (Logger::GetInstance()->AddLogMessage(MessageType::##type, (sender), (msg)))
 #endif
 
-// Event implementations
+// Event implementations, the comments given to the end macros are not recorded
 #ifndef BEGIN_EVENT
 #define BEGIN_EVENT(name) (Logger::GetInstance()->BeginEvent(name, false))
 #endif
 
 #ifndef END_EVENT
-#define END_EVENT(comment) (Logger::GetInstance()->EndEvent(comment, false))
+#define END_EVENT(comment) (Logger::GetInstance()->EndEvent(false))
 #endif
 
 #ifndef BEGIN_EVENT_D3D
@@ -43,7 +43,11 @@
 #endif
 
 #ifndef END_EVENT_D3D
-#define END_EVENT_D3D(comment) (Logger::GetInstance()->EndEvent(comment, true))
+#define END_EVENT_D3D(comment) (Logger::GetInstance()->EndEvent(true))
+#endif
+
+#ifndef ADD_EVENT
+#define ADD_EVENT(name, duration) (Logger::GetInstance()->AddEvent(name, duration))
 #endif
 
 namespace MessageType
@@ -72,14 +76,30 @@ private:
     std::streambuf* _clogbuf;
     std::streambuf* _cerrbuf;
 
-    // Messages
+    // Messages are copied into a fixed ring that any thread can add to without locking, and are
+    // only handed to the readers when the thread that created the logger flushes them. Each slot's
+    // sequence tells whether it is free to write or ready to read, a message that finds the ring
+    // full is dropped and counted instead.
+    static const UINT MESSAGE_COUNT = 512;
     struct MESSAGE_INFO
     {
+        volatile LONG Sequence;
         UINT Type;
-        std::wstring Sender;
-        std::wstring Message;
+        WCHAR Sender[MAX_SENDER_LENGTH];
+        WCHAR Message[MAX_LOG_LENGTH];
     };
-    std::vector<MESSAGE_INFO> _messages;
+    MESSAGE_INFO _messages[MESSAGE_COUNT];
+    volatile LONG _messageWriteIndex;
+    LONG _messageReadIndex;
+    volatile LONG _droppedMessages;
+
+    // The readers are given strings, these are reused for every message
+    std::wstring _flushSender;
+    std::wstring _flushMessage;
+
+    // A thread repeating its last message within this many seconds only counts it, the count is
+    // reported before the next of its messages that gets through
+    static const float REPEAT_INTERVAL;
 
     // Log readers
     struct READER_INFO
@@ -90,39 +110,113 @@ private:
     };
     std::vector<READER_INFO> _readers;
 
-    // Events
-    struct EVENT_INFO
+    // Events are recorded by each thread into a ring of markers of its own, so beginning and
+    // ending them takes no locks and allocates nothing. Names are interned the first time they
+    // are seen and each thread caches the IDs of the names it used last by their address.
+    //
+    // The markers of every thread are gathered into a frame whenever the thread that created the
+    // logger ends a root event. Each thread becomes a lane of the frame, a thread's markers are
+    // only gathered up to the last point it had no events open so an event is never split across
+    // frames.
+    static const UINT INVALID_EVENT = (UINT)-1;
+    static const UINT MAX_EVENT_NAMES = 1024;
+    static const UINT MARKER_COUNT = 8192;
+    static const UINT NAME_CACHE_SIZE = 256;
+
+    struct MARKER_INFO
     {
+        UINT Name;
+        bool Begin;
+        INT64 Time;
+    };
+
+    struct THREAD_INFO
+    {
+        DWORD ThreadID;
         std::wstring Name;
-        std::wstring Comment;
 
+        // Only the thread writes its markers and only the gathering reads them, each side only
+        // moves its own index and reads the other's
+        MARKER_INFO Markers[MARKER_COUNT];
+        volatile LONG WriteIndex;
+        volatile LONG ReadIndex;
+
+        // Markers that did not fit are dropped, their ends have to be dropped too
+        UINT Depth;
+        UINT DroppedDepth;
+        UINT DroppedCount;
+
+        const WCHAR* CachedNames[NAME_CACHE_SIZE];
+        UINT CachedIDs[NAME_CACHE_SIZE];
+
+        bool GraphicsEventsSuspended;
+
+        // The last message that got through and how many times it was repeated since
+        UINT LastMessageType;
+        UINT LastMessageHash;
+        INT64 LastMessageTime;
+        UINT RepeatCount;
+    };
+    std::vector<THREAD_INFO*> _threads;
+    CRITICAL_SECTION _threadLock;
+
+    DWORD _eventThread;
+    THREAD_INFO* getThread();
+
+    // Interned names are never freed so their strings can be read without a lock
+    std::wstring* _names[MAX_EVENT_NAMES];
+    volatile LONG _nameCount;
+    struct NAME_LESS
+    {
+        bool operator()(const WCHAR* a, const WCHAR* b) const { return wcscmp(a, b) < 0; }
+    };
+    std::map<const WCHAR*, UINT, NAME_LESS> _nameIDs;
+    CRITICAL_SECTION _nameLock;
+
+    UINT internName(THREAD_INFO* thread, const WCHAR* name);
+    void writeMarker(THREAD_INFO* thread, UINT name, bool begin, INT64 time);
+
+    // Events are stored in the order they began, linked into a tree per lane
+    struct EVENT_INFO
+    {
+        UINT Name;
         INT64 BeginTime;
         float Duration;
 
-        // Event color for alternating colors
-        bool Red;
+        UINT Parent;
+        UINT NextSibling;
+        UINT FirstChild;
+        UINT LastChild;
+    };
 
-        EVENT_INFO* Parent;
-        EVENT_INFO* NextSibling;
+    struct LANE_INFO
+    {
+        const THREAD_INFO* Thread;
 
-        EVENT_INFO* FirstChild;
-        EVENT_INFO* LastChild;
+        // The thread's name when the lane was gathered, interned like the event names
+        UINT Name;
+        std::vector<EVENT_INFO> Events;
+        UINT LastRoot;
     };
-    static const UINT MAX_EVENTS = 512;
-
-    // Always points to the event that will be ended when EndEvent is called
-    EVENT_INFO* _curEvent;
 
-    UINT _nextEventSlot;
-    EVENT_INFO* _events[2];
+    struct FRAME_INFO
+    {
+        std::vector<LANE_INFO> Lanes;
+        INT64 BeginTime;
+    };
+    FRAME_INFO _frames[2];
+    std::vector<UINT> _openEvents;
 
-    void swapEventFrames();
+    void gatherLane(THREAD_INFO* gatherThread, THREAD_INFO* thread, LANE_INFO* lane);
+    void gatherFrame(THREAD_INFO* gatherThread);
 
     // Timers
     double _timerFreq;
+    INT64 _startTime;
 
     // Message functions
-    void flush();
+    bool queueMessage(UINT type, const WCHAR* sender, const WCHAR* message);
+    void dispatchMessage(UINT type, const WCHAR* sender, const WCHAR* message);
 
     static Logger _instance;
 
@@ -135,10 +229,29 @@ public:
     void AddReader(UINT type, void* caller, LogFunction callbackFunction);
     void RemoveReader(void* caller);
 
+    // Can be called from any thread, the message is copied and truncated to MAX_LOG_LENGTH
+    void AddLogMessage(UINT type, const WCHAR* sender, const WCHAR* message);
     void AddLogMessage(UINT type, const std::wstring& sender, const std::wstring& message);
 
-    void BeginEvent(const std::wstring& name, bool graphicsEvent = true);
-    void EndEvent(const std::wstring& comment, bool graphicsEvent = true);
+    // Sends the queued messages to the readers, must be called on the thread that created the
+    // logger. Nothing is sent until there is at least one reader.
+    void FlushMessages();
+
+    // Can be called from any thread, only events on the thread that created the logger are sent
+    // to the graphics debugger
+    void BeginEvent(const WCHAR* name, bool graphicsEvent = true);
+    void EndEvent(bool graphicsEvent = true);
+
+    // Adds an event that was timed elsewhere as a finished child of the calling thread's current
+    // event, ending now
+    void AddEvent(const WCHAR* name, float duration);
+
+    // Names the calling thread's lane
+    void SetThreadName(const WCHAR* name);
+
+    // Used while the calling thread records command lists, whose graphics events would otherwise
+    // be mixed in with those of the immediate context
+    void SetGraphicsEventsSuspended(bool suspended);
 
     // Wrapper class to return event information
     class EventIterator
@@ -147,15 +260,20 @@ public:
         friend class Logger;
 
     private:
-        EVENT_INFO* _curEvent;
+        const Logger* _logger;
+        const FRAME_INFO* _frame;
+        const LANE_INFO* _lane;
+        UINT _index;
 
-        EventIterator(EVENT_INFO* root);
+        EventIterator(const Logger* logger, const FRAME_INFO* frame, const LANE_INFO* lane, UINT index);
 
     public:
         const std::wstring& GetName() const;
-        const std::wstring& GetComment() const;
         float GetDuration() const;
 
+        // The time since the first event of the frame on any lane began, in seconds
+        float GetStartTime() const;
+
         bool IsValid() const;
         bool IsRoot() const;
         bool HasChildren() const;
@@ -166,7 +284,18 @@ public:
         EventIterator GetParent() const;
     };
 
+    // The first root event of the last frame on the thread that created the logger
     EventIterator GetRootEvent();
 
+    // Lanes are in the order their threads first logged an event, the first is the logger's own.
+    // A lane's name stays at the same address for as long as its thread keeps that name
+    UINT GetLaneCount() const;
+    const std::wstring& GetLaneName(UINT lane) const;
+    DWORD GetLaneThreadID(UINT lane) const;
+    EventIterator GetLaneRootEvent(UINT lane);
+
+    // When the first event of the last frame began, in seconds since the logger was created
+    double GetFrameStartTime() const;
+
     static Logger* GetInstance();
 };
\ No newline at end of file
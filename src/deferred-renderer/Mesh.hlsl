@@ -56,6 +56,7 @@ struct VS_In_Mesh
     float3 vTangentOS   : TANGENT;
     float3 vBinormalOS  : BINORMAL;
     float4x4 mWorld     : WORLD;
+    float4x4 mPrevWorld : PREVWORLD;
 };
 
 struct VS_Out_Mesh
@@ -84,7 +85,8 @@ VS_Out_Mesh VS_Mesh(VS_In_Mesh input)
 
     output.vPositionCS = mul(input.vPositionOS, curWVP);
     output.vPositionCS2 = output.vPositionCS;
-    output.vPrevPositionCS = mul(input.vPositionOS, curWVP);
+    float4x4 prevWVP = mul(input.mPrevWorld, PrevViewProjection);
+    output.vPrevPositionCS = mul(input.vPositionOS, prevWVP);
     output.vNormalWS = mul(input.vNormalOS, (float3x3)input.mWorld);
     output.vTangentWS = mul(input.vTangentOS, (float3x3)input.mWorld);
     output.vBinormalWS = mul(input.vBinormalOS, (float3x3)input.mWorld);
@@ -1,5 +1,6 @@
 #include "PCH.h"
 #include "Model.h"
+#include "RenderStats.h"
 #include "SDKmesh.h"
 
 #include "assimp.hpp"      // C++ importer interface
@@ -118,6 +119,8 @@ HRESULT Model::RenderMesh(ID3D11DeviceContext* context, UINT meshIdx, UINT mater
         }
 
         context->DrawIndexed(part->IndexCount, part->IndexStart, part->VertexStart);
+        ADD_RENDER_STAT(DrawCalls, 1);
+        ADD_RENDER_STAT(Triangles, part->IndexCount / 3);
     }
 
     return S_OK;
@@ -1,133 +1,93 @@
 #include "PCH.h"
 #include "ModelInstance.h"
 #include "ModelLoader.h"
+#include "SceneBounds.h"
 
-ModelInstance::ModelInstance(const WCHAR* path)
-    : _model(NULL), _path(path), _transformedMeshOrientedBoxes(NULL), _transformedMeshAxisBoxes(NULL),
-    _position(0.0f, 0.0f, 0.0f), _scale(1.0f), _orientation(0.0f, 0.0f, 0.0f, 1.0f), _dirty(true)
+ModelInstance::ModelInstance(const WCHAR* path, TransformSystem* transforms)
+    : _model(NULL), _path(path), _transforms(transforms), _transformedMeshOrientedBoxes(NULL),
+    _transformedMeshAxisBoxes(NULL), _sceneBounds(NULL), _sceneBoundsIdx(0),
+    _parent(NULL)
 {
+    _transformHandle = _transforms->Add();
 }
 
-void ModelInstance::clean()
+ModelInstance::~ModelInstance()
 {
-    // Load the position and orientation into vectors
-    XMVECTOR position = XMLoadFloat3(&_position);
-    XMVECTOR orientation = XMLoadFloat4(&_orientation);
-
-    // Create the matrices for translation, rotation and scaling
-    XMMATRIX translate = XMMatrixTranslationFromVector(position);
-    XMMATRIX rotate = XMMatrixRotationQuaternion(orientation);
-    XMMATRIX scale = XMMatrixScaling(_scale, _scale, _scale);
-
-    // Store the world matrix
-    XMMATRIX world =  XMMatrixMultiply(scale, XMMatrixMultiply(rotate, translate));
-    XMStoreFloat4x4(&_world, world);
-
-    // Create the bounding boxes...
-
-    // Create an oriented box that sits in the same location as the model's boxes
-    // and then transform it
-    _transformedMainAxisBox = _model->GetAxisAlignedBox();
-    _transformedMainOrientedBox.Center = _transformedMainAxisBox.Center;
-    _transformedMainOrientedBox.Extents = _transformedMainAxisBox.Extents;
-    XMStoreFloat4(&_transformedMainOrientedBox.Orientation, XMQuaternionIdentity());
-
-    Collision::TransformAxisAlignedBox(&_transformedMainAxisBox, &_transformedMainAxisBox,
-        _scale, orientation, position);
-    Collision::TransformOrientedBox(&_transformedMainOrientedBox, &_transformedMainOrientedBox,
-        _scale, orientation, position);
+    if (_sceneBounds)
+    {
+        _sceneBounds->Remove(this);
+    }
 
-    UINT meshCount = _model->GetMeshCount();
-    for (UINT i = 0; i < meshCount; i++)
+    SetParent(NULL);
+    while (_children.size() > 0)
     {
-        _transformedMeshAxisBoxes[i] = _model->GetMeshAxisAlignedBox(i);
-        _transformedMeshOrientedBoxes[i].Center = _transformedMeshAxisBoxes[i].Center;
-        _transformedMeshOrientedBoxes[i].Extents = _transformedMeshAxisBoxes[i].Extents;
-        XMStoreFloat4(&_transformedMeshOrientedBoxes[i].Orientation, XMQuaternionIdentity());
-
-        Collision::TransformAxisAlignedBox(&_transformedMeshAxisBoxes[i], &_transformedMeshAxisBoxes[i],
-            _scale, orientation, position);
-        Collision::TransformOrientedBox(&_transformedMeshOrientedBoxes[i], &_transformedMeshOrientedBoxes[i],
-            _scale, orientation, position);
+        _children.back()->SetParent(NULL);
     }
 
-    _dirty = false;
+    _transforms->Remove(_transformHandle);
 }
 
 void ModelInstance::SetPosition(const XMFLOAT3& pos)
 {
-    _position = pos;
+    _transforms->SetPosition(_transformHandle, pos);
 
-    _dirty = true;
+    markMoved();
 }
 
 void ModelInstance::SetScale(float scale)
 {
-    _scale = scale;
+    _transforms->SetScale(_transformHandle, scale);
 
-    _dirty = true;
+    markMoved();
 }
 
 void ModelInstance::SetOrientation(const XMFLOAT4& orientation)
 {
-    _orientation = orientation;
+    _transforms->SetOrientation(_transformHandle, orientation);
 
-    _dirty = true;
+    markMoved();
 }
 
-const XMFLOAT4X4& ModelInstance::GetWorld()
+void ModelInstance::SetParent(ModelInstance* parent)
 {
-    if (_dirty)
+    if (parent == _parent)
     {
-        clean();
+        return;
     }
 
-    return _world;
-}
-
-const XMFLOAT4X4& ModelInstance::GetPreviousWorld() const
-{
-    return _prevWorld;
-}
-
-const AxisAlignedBox& ModelInstance::GetMeshAxisAlignedBox(UINT meshIdx)
-{
-    if (_dirty)
+    // The transform system refuses parents that are descendants of this instance
+    if (!_transforms->SetParent(_transformHandle, parent ? parent->_transformHandle : TransformSystem::INVALID_HANDLE))
     {
-        clean();
+        return;
     }
 
-    return _transformedMeshAxisBoxes[meshIdx];
-}
-
-const AxisAlignedBox& ModelInstance::GetAxisAlignedBox()
-{
-    if (_dirty)
+    if (_parent)
     {
-        clean();
+        std::vector<ModelInstance*>& siblings = _parent->_children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), this));
     }
 
-    return _transformedMainAxisBox;
-}
-
-const OrientedBox& ModelInstance::GetMeshOrientedBox(UINT meshIdx)
-{
-    if (_dirty)
+    _parent = parent;
+    if (_parent)
     {
-        clean();
+        _parent->_children.push_back(this);
     }
 
-    return _transformedMeshOrientedBoxes[meshIdx];
+    markMoved();
 }
 
-const OrientedBox& ModelInstance::GetOrientedBox()
+void ModelInstance::markMoved()
 {
-    if (_dirty)
+    // Moving an instance moves everything attached to it
+    if (_sceneBounds)
     {
-        clean();
+        _sceneBounds->MarkMoved(this);
     }
 
-    return _transformedMainOrientedBox;
+    for (UINT i = 0; i < _children.size(); i++)
+    {
+        _children[i]->markMoved();
+    }
 }
 
 void ModelInstance::FillBoundingObjectSet(BoundingObjectSet* set)
@@ -138,18 +98,8 @@ void ModelInstance::FillBoundingObjectSet(BoundingObjectSet* set)
     }
 }
 
-void ModelInstance::StoreWorld()
-{
-    _prevWorld = GetWorld();
-}
-
 bool ModelInstance::RayIntersect(const Ray& ray, float* dist)
 {
-    if (_dirty)
-    {
-        clean();
-    }
-
     XMVECTOR rayOrigin = XMLoadFloat3(&ray.Origin);
     XMVECTOR rayDir = XMLoadFloat3(&ray.Direction);
 
@@ -181,19 +131,26 @@ HRESULT ModelInstance::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentMana
     _transformedMeshOrientedBoxes = new OrientedBox[meshCount];
     _transformedMeshAxisBoxes = new AxisAlignedBox[meshCount];
 
-    _dirty = true;
+    _transforms->SetModel(_transformHandle, _model, _transformedMeshAxisBoxes, _transformedMeshOrientedBoxes);
 
     return S_OK;
 }
 
 void ModelInstance::OnD3D11DestroyDevice(ContentManager* pContentManager)
 {
+    _transforms->SetModel(_transformHandle, NULL, NULL, NULL);
+
     SAFE_CM_RELEASE(pContentManager, _model);
 
     SAFE_DELETE_ARRAY(_transformedMeshOrientedBoxes);
     SAFE_DELETE_ARRAY(_transformedMeshAxisBoxes);
 
-    _dirty = true;
+    // The model is no longer loaded so its bounds can not be read, it is registered
+    // again the next time it is added to a renderer
+    if (_sceneBounds)
+    {
+        _sceneBounds->Remove(this);
+    }
 }
 
 HRESULT ModelInstance::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, ContentManager* pContentManager, IDXGISwapChain* pSwapChain,
@@ -4,53 +4,73 @@
 #include "IHasContent.h"
 #include "IDragable.h"
 #include "Model.h"
+#include "TransformSystem.h"
 #include "xnaCollision.h"
 
+class SceneBounds;
+
 class ModelInstance : public IHasContent, public IDragable
 {
 private:
     const WCHAR* _path;
     Model* _model;
 
-    XMFLOAT4X4 _prevWorld;
-    XMFLOAT4X4 _world;
-    XMFLOAT3 _position;
-    float _scale;
-    XMFLOAT4 _orientation;
+    TransformSystem* _transforms;
+    UINT _transformHandle;
 
-    OrientedBox _transformedMainOrientedBox;
-    OrientedBox* _transformedMeshOrientedBoxes;
+    ModelInstance* _parent;
+    std::vector<ModelInstance*> _children;
 
-    AxisAlignedBox _transformedMainAxisBox;
+    OrientedBox* _transformedMeshOrientedBoxes;
     AxisAlignedBox* _transformedMeshAxisBoxes;
 
-    bool _dirty;
-    void clean();
+    SceneBounds* _sceneBounds;
+    UINT _sceneBoundsIdx;
+
+    friend class SceneBounds;
+    void setSceneBounds(SceneBounds* bounds, UINT idx) { _sceneBounds = bounds; _sceneBoundsIdx = idx; }
+    UINT getSceneBoundsIndex() const { return _sceneBoundsIdx; }
+    UINT getTransformUpdateCount() const { return _transforms->GetUpdateCount(); }
+
+    void markMoved();
 
 public:
-    ModelInstance(const WCHAR* path);
+    ModelInstance(const WCHAR* path, TransformSystem* transforms);
+    ~ModelInstance();
 
-    const XMFLOAT3& GetPosition() const { return _position; }
-    float GetScale() const { return _scale; }
-    const XMFLOAT4& GetOrientation() const { return _orientation; }
+    const XMFLOAT3& GetPosition() const { return _transforms->GetPosition(_transformHandle); }
+    float GetScale() const { return _transforms->GetScale(_transformHandle); }
+    const XMFLOAT4& GetOrientation() const { return _transforms->GetOrientation(_transformHandle); }
 
     void SetPosition(const XMFLOAT3& pos);
     void SetScale(float scale);
     void SetOrientation(const XMFLOAT4& orientation);
-    const XMFLOAT4X4& GetWorld();
-    const XMFLOAT4X4& GetPreviousWorld() const;
 
-    const AxisAlignedBox& GetMeshAxisAlignedBox(UINT meshIdx);
-    const AxisAlignedBox& GetAxisAlignedBox();
+    // The position, scale and orientation are relative to the parent, pass NULL to detach
+    void SetParent(ModelInstance* parent);
+    ModelInstance* GetParent() const { return _parent; }
+
+    UINT GetChildCount() const { return _children.size(); }
+    ModelInstance* GetChild(UINT idx) const { return _children[idx]; }
+
+    // These are rebuilt by the transform system's update, changes made since then are not
+    // reflected until the next one
+    const XMFLOAT4X4& GetWorld() const { return _transforms->GetWorld(_transformHandle); }
+    const XMFLOAT4X4& GetPreviousWorld() const { return _transforms->GetPreviousWorld(_transformHandle); }
+
+    const AxisAlignedBox& GetMeshAxisAlignedBox(UINT meshIdx) const { return _transformedMeshAxisBoxes[meshIdx]; }
+    const AxisAlignedBox& GetAxisAlignedBox() const { return _transforms->GetAxisAlignedBox(_transformHandle); }
+
+    const OrientedBox& GetMeshOrientedBox(UINT meshIdx) const { return _transformedMeshOrientedBoxes[meshIdx]; }
+    const OrientedBox& GetOrientedBox() const { return _transforms->GetOrientedBox(_transformHandle); }
 
-    const OrientedBox& GetMeshOrientedBox(UINT meshIdx);
-    const OrientedBox& GetOrientedBox();
+    AxisAlignedBox GetSubtreeAxisAlignedBox() const { return _transforms->GetSubtreeAxisAlignedBox(_transformHandle); }
 
     UINT GetModelMeshCount() const { return _model->GetMeshCount(); }
 
     Model* GetModel() { return _model; }
 
-    void StoreWorld();
+    SceneBounds* GetSceneBounds() const { return _sceneBounds; }
 
     void FillBoundingObjectSet(BoundingObjectSet* set);
     bool RayIntersect(const Ray& ray, float* dist);
@@ -1,8 +1,12 @@
 #include "PCH.h"
 #include "ModelInstanceSet.h"
+#include "RenderStats.h"
 
-void ModelInstanceSet::createSet(std::vector<ModelInstance*>* instances)
+void ModelInstanceSet::createSet(std::vector<ModelInstance*>* instances, UINT testedCount)
 {
+    ADD_RENDER_STAT(InstancesTested, testedCount);
+    ADD_RENDER_STAT(InstancesCulled, testedCount - instances->size());
+
     for (UINT i = 0; i < instances->size(); i++)
     {
         ModelInstance* instance = instances->at(i);
@@ -50,7 +54,7 @@ ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const
             insideModels.push_back(instance);
         }
     }
-    createSet(&insideModels);
+    createSet(&insideModels, instances->size());
 }
 
 ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const Sphere* sphere)
@@ -67,7 +71,7 @@ ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const
             insideModels.push_back(instance);
         }
     }
-    createSet(&insideModels);
+    createSet(&insideModels, instances->size());
 }
 
 ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const OrientedBox* obb)
@@ -84,7 +88,7 @@ ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const
             insideModels.push_back(instance);
         }
     }
-    createSet(&insideModels);
+    createSet(&insideModels, instances->size());
 }
 
 ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const AxisAlignedBox* aabb)
@@ -101,7 +105,7 @@ ModelInstanceSet::ModelInstanceSet(std::vector<ModelInstance*>* instances, const
             insideModels.push_back(instance);
         }
     }
-    createSet(&insideModels);
+    createSet(&insideModels, instances->size());
 }
 
 UINT ModelInstanceSet::GetModelCount() const
@@ -12,7 +12,8 @@ private:
     std::vector<UINT> _globalIndices;
     UINT _instanceCount;
 
-    void createSet(std::vector<ModelInstance*>* instances);
+    // The instances are those that passed the test out of the tested count
+    void createSet(std::vector<ModelInstance*>* instances, UINT testedCount);
 
 public:
     ModelInstanceSet(std::vector<ModelInstance*>* instances, const Frustum* frust);
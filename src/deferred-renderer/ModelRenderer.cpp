@@ -1,10 +1,11 @@
 #include "PCH.h"
 #include "ModelRenderer.h"
 #include "ModelInstanceSet.h"
+#include "RenderStats.h"
 
 ModelRenderer::ModelRenderer()
     : _meshVertexShader(NULL), _alphaThresholdBuffer(NULL), _modelPropertiesBuffer(NULL),
-    _instanceWorldVB(NULL)
+    _instanceStream(sizeof(MODEL_INSTANCE_DATA), INITIAL_INSTANCES, MAX_BATCH_INSTANCES, "Model instance stream")
 {
     for (UINT i = 0; i < 2; i++)
     {
@@ -69,79 +70,66 @@ HRESULT ModelRenderer::RenderModels(ID3D11DeviceContext* pd3dDeviceContext,
     Frustum cameraFrust = camera->CreateFrustum();
     ModelInstanceSet modelSet = ModelInstanceSet(instances, &cameraFrust);
 
-    // Copy the instance world matrices into the vertex buffer
-    V(pd3dDeviceContext->Map(_instanceWorldVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-    XMFLOAT4X4* instanceVB = (XMFLOAT4X4*)mappedResource.pData;
+    _instanceStream.Begin(pd3dDeviceContext);
 
-    for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+    UINT instanceVBStride = _instanceStream.GetStride();
+    UINT instanceVBOffset = 0;
+
+    // Copy the world matrices of as many instances as fit in a batch into the instance stream and
+    // draw them, the instances of a model can be split across batches
+    ID3D11PixelShader* prevPS = NULL;
+    UINT instanceCount = modelSet.GetInstanceCount();
+    ADD_RENDER_STAT(InstancesDrawn, instanceCount);
+
+    for (UINT batchStart = 0; batchStart < instanceCount; )
     {
-        for (UINT j = 0; j < modelSet.GetInstanceCount(i); j++)
-        {
-            ModelInstance* instance = modelSet.GetInstance(i, j);
+        UINT batchEnd = min(batchStart + _instanceStream.GetMaxInstances(), instanceCount);
 
-            XMFLOAT4X4 fWorld = instance->GetWorld();
-            XMMATRIX world = XMLoadFloat4x4(&fWorld);
+        MODEL_INSTANCE_DATA* instanceData;
+        UINT firstInstance;
+        V_RETURN(_instanceStream.Map(pd3dDeviceContext, batchEnd - batchStart, (void**)&instanceData, &firstInstance));
 
-            XMFLOAT4X4 fPrevWorld = instance->GetPreviousWorld();
-            XMMATRIX prevWorld = XMLoadFloat4x4(&fPrevWorld);
+        for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+        {
+            UINT modelStart = modelSet.GetGlobalIndex(i, 0);
+            UINT begin = max(modelStart, batchStart);
+            UINT end = min(modelStart + modelSet.GetInstanceCount(i), batchEnd);
 
-            XMStoreFloat4x4(&instanceVB[modelSet.GetGlobalIndex(i, j)], XMMatrixTranspose(world));
-        }
-    }
+            for (UINT j = begin; j < end; j++)
+            {
+                ModelInstance* instance = modelSet.GetInstance(i, j - modelStart);
 
-    pd3dDeviceContext->Unmap(_instanceWorldVB, 0);
+                XMFLOAT4X4 fWorld = instance->GetWorld();
+                XMMATRIX world = XMLoadFloat4x4(&fWorld);
 
-    UINT instanceVBStride = sizeof(XMFLOAT4X4);
-    UINT instanceVBOffset = 0;
-    pd3dDeviceContext->IASetVertexBuffers(1, 1, &_instanceWorldVB, &instanceVBStride, &instanceVBOffset);
+                XMFLOAT4X4 fPrevWorld = instance->GetPreviousWorld();
+                XMMATRIX prevWorld = XMLoadFloat4x4(&fPrevWorld);
 
-    ID3D11PixelShader* prevPS = NULL;
-    for (UINT i = 0; i < modelSet.GetModelCount(); i++)
-    {
-        Model* model = modelSet.GetModel(i);
+                MODEL_INSTANCE_DATA& data = instanceData[j - batchStart];
+                XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
+                XMStoreFloat4x4(&data.PreviousWorld, XMMatrixTranspose(prevWorld));
+            }
+        }
 
-        // Render each mesh
-        for (UINT j = 0; j < model->GetMeshCount(); j++)
-        {
-            const Mesh* mesh = model->GetMesh(j);
-            UINT partCount = mesh->GetMeshPartCount();
+        _instanceStream.Unmap(pd3dDeviceContext);
 
-            ID3D11Buffer* meshVB = mesh->GetVertexBuffer();
-            UINT meshStride = mesh->GetVertexStride();
-            UINT meshOffset = 0;
+        ID3D11Buffer* instanceVB = _instanceStream.GetBuffer();
+        pd3dDeviceContext->IASetVertexBuffers(1, 1, &instanceVB, &instanceVBStride, &instanceVBOffset);
 
-            pd3dDeviceContext->IASetVertexBuffers(0, 1, &meshVB, &meshStride, &meshOffset);
-            pd3dDeviceContext->IASetIndexBuffer(mesh->GetIndexBuffer(), mesh->GetIndexBufferFormat(), 0);
-            pd3dDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        for (UINT i = 0; i < modelSet.GetModelCount(); i++)
+        {
+            UINT modelStart = modelSet.GetGlobalIndex(i, 0);
+            UINT begin = max(modelStart, batchStart);
+            UINT end = min(modelStart + modelSet.GetInstanceCount(i), batchEnd);
 
-            for (UINT k = 0; k < partCount; k++)
+            if (begin < end)
             {
-                const MeshPart* part = mesh->GetMeshPart(k);
-                const Material* mat = model->GetMaterial(part->MaterialIndex);
-
-                ID3D11Buffer* buf = mat->GetPropertiesBuffer();
-                pd3dDeviceContext->PSSetConstantBuffers(0, 1, &buf);
-
-                ID3D11ShaderResourceView* diffSRV = mat->GetDiffuseSRV();
-                ID3D11ShaderResourceView* normSRV = mat->GetNormalSRV();
-                ID3D11ShaderResourceView* specSRV = mat->GetSpecularSRV();
-
-                ID3D11ShaderResourceView* srvs[3] = { diffSRV, normSRV, specSRV };
-                pd3dDeviceContext->PSSetShaderResources(0, 3, srvs);
-
-                // Set the shader if it wasn't the same for the last mesh
-                ID3D11PixelShader* ps = _meshPixelShader[diffSRV != NULL][normSRV != NULL][specSRV != NULL]
-                [_alphaCutoutEnabled && mesh->GetAlphaCutoutEnabled()]->PixelShader;
-                if (ps != prevPS)
-                {
-                    pd3dDeviceContext->PSSetShader(ps, NULL, 0);
-                    prevPS = ps;
-                }
-
-                pd3dDeviceContext->DrawIndexedInstanced(part->IndexCount, modelSet.GetInstanceCount(i),
-                    part->IndexStart, part->VertexStart, modelSet.GetGlobalIndex(i, 0));
+                renderInstances(pd3dDeviceContext, modelSet.GetModel(i), firstInstance + begin - batchStart,
+                    end - begin, &prevPS);
             }
         }
+
+        batchStart = batchEnd;
     }
 
     // Null the second vertex buffer
@@ -161,6 +149,56 @@ HRESULT ModelRenderer::RenderModels(ID3D11DeviceContext* pd3dDeviceContext,
     return S_OK;
 }
 
+void ModelRenderer::renderInstances(ID3D11DeviceContext* pd3dDeviceContext, Model* model, UINT firstInstance,
+                                    UINT instanceCount, ID3D11PixelShader** prevPS)
+{
+    // Render each mesh
+    for (UINT j = 0; j < model->GetMeshCount(); j++)
+    {
+        const Mesh* mesh = model->GetMesh(j);
+        UINT partCount = mesh->GetMeshPartCount();
+
+        ID3D11Buffer* meshVB = mesh->GetVertexBuffer();
+        UINT meshStride = mesh->GetVertexStride();
+        UINT meshOffset = 0;
+
+        pd3dDeviceContext->IASetVertexBuffers(0, 1, &meshVB, &meshStride, &meshOffset);
+        pd3dDeviceContext->IASetIndexBuffer(mesh->GetIndexBuffer(), mesh->GetIndexBufferFormat(), 0);
+        pd3dDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        for (UINT k = 0; k < partCount; k++)
+        {
+            const MeshPart* part = mesh->GetMeshPart(k);
+            const Material* mat = model->GetMaterial(part->MaterialIndex);
+
+            ID3D11Buffer* buf = mat->GetPropertiesBuffer();
+            pd3dDeviceContext->PSSetConstantBuffers(0, 1, &buf);
+
+            ID3D11ShaderResourceView* diffSRV = mat->GetDiffuseSRV();
+            ID3D11ShaderResourceView* normSRV = mat->GetNormalSRV();
+            ID3D11ShaderResourceView* specSRV = mat->GetSpecularSRV();
+
+            ID3D11ShaderResourceView* srvs[3] = { diffSRV, normSRV, specSRV };
+            pd3dDeviceContext->PSSetShaderResources(0, 3, srvs);
+
+            // Set the shader if it wasn't the same for the last mesh
+            ID3D11PixelShader* ps = _meshPixelShader[diffSRV != NULL][normSRV != NULL][specSRV != NULL]
+            [_alphaCutoutEnabled && mesh->GetAlphaCutoutEnabled()]->PixelShader;
+            if (ps != *prevPS)
+            {
+                pd3dDeviceContext->PSSetShader(ps, NULL, 0);
+                *prevPS = ps;
+                ADD_RENDER_STAT(ShaderChanges, 1);
+            }
+
+            pd3dDeviceContext->DrawIndexedInstanced(part->IndexCount, instanceCount, part->IndexStart,
+                part->VertexStart, firstInstance);
+            ADD_RENDER_STAT(DrawCalls, 1);
+            ADD_RENDER_STAT(Triangles, part->IndexCount / 3 * instanceCount);
+        }
+    }
+}
+
 HRESULT ModelRenderer::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentManager* pContentManager, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
 {
     HRESULT hr;
@@ -222,6 +260,10 @@ HRESULT ModelRenderer::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentMana
         { "WORLD",        1, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 16, D3D11_INPUT_PER_INSTANCE_DATA,    1 },
         { "WORLD",        2, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 32, D3D11_INPUT_PER_INSTANCE_DATA,    1 },
         { "WORLD",        3, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 48, D3D11_INPUT_PER_INSTANCE_DATA,    1 },
+        { "PREVWORLD",    0, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 64, D3D11_INPUT_PER_INSTANCE_DATA,    1 },
+        { "PREVWORLD",    1, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 80, D3D11_INPUT_PER_INSTANCE_DATA,    1 },
+        { "PREVWORLD",    2, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 96, D3D11_INPUT_PER_INSTANCE_DATA,    1 },
+        { "PREVWORLD",    3, DXGI_FORMAT_R32G32B32A32_FLOAT,    1, 112, D3D11_INPUT_PER_INSTANCE_DATA,   1 },
     };
 
     VertexShaderOptions vsOpts =
@@ -251,16 +293,7 @@ HRESULT ModelRenderer::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentMana
     bufferDesc.ByteWidth = sizeof(CB_MODEL_ALPHA_THRESHOLD);
     V_RETURN(pd3dDevice->CreateBuffer(&bufferDesc, NULL, &_alphaThresholdBuffer));
 
-    D3D11_BUFFER_DESC vbDesc =
-    {
-        sizeof(XMFLOAT4X4) * MAX_INSTANCES, // INT ByteWidth;
-        D3D11_USAGE_DYNAMIC, // D3D11_USAGE Usage;
-        D3D11_BIND_VERTEX_BUFFER, // UINT BindFlags;
-        D3D11_CPU_ACCESS_WRITE, // UINT CPUAccessFlags;
-        0, // UINT MiscFlags;
-        0, // UINT StructureByteStride;
-    };
-    V_RETURN(pd3dDevice->CreateBuffer(&vbDesc, NULL, &_instanceWorldVB));
+    V_RETURN(_instanceStream.OnD3D11CreateDevice(pd3dDevice));
 
     V_RETURN(_dsStates.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
     V_RETURN(_samplerStates.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
@@ -288,7 +321,7 @@ void ModelRenderer::OnD3D11DestroyDevice(ContentManager* pContentManager)
 
     SAFE_RELEASE(_modelPropertiesBuffer);
     SAFE_RELEASE(_alphaThresholdBuffer);
-    SAFE_RELEASE(_instanceWorldVB);
+    _instanceStream.OnD3D11DestroyDevice();
 
     _dsStates.OnD3D11DestroyDevice(pContentManager);
     _samplerStates.OnD3D11DestroyDevice(pContentManager);
@@ -7,6 +7,7 @@
 #include "DeviceStates.h"
 #include "PixelShaderLoader.h"
 #include "VertexShaderLoader.h"
+#include "InstanceStream.h"
 
 using namespace std;
 
@@ -34,8 +35,16 @@ private:
     ID3D11Buffer* _modelPropertiesBuffer;
     ID3D11Buffer* _alphaThresholdBuffer;
 
-    static const UINT MAX_INSTANCES = 128;
-    ID3D11Buffer* _instanceWorldVB;
+    // Visible sets larger than a batch are uploaded and drawn a batch at a time
+    static const UINT INITIAL_INSTANCES = 1024;
+    static const UINT MAX_BATCH_INSTANCES = 16384;
+    InstanceStream _instanceStream;
+
+    struct MODEL_INSTANCE_DATA
+    {
+        XMFLOAT4X4 World;
+        XMFLOAT4X4 PreviousWorld;
+    };
 
     struct CB_MODEL_ALPHA_THRESHOLD
     {
@@ -48,6 +57,9 @@ private:
     BlendStates _blendStates;
     RasterizerStates _rasterStates;
 
+    void renderInstances(ID3D11DeviceContext* pd3dDeviceContext, Model* model, UINT firstInstance,
+        UINT instanceCount, ID3D11PixelShader** prevPS);
+
 public:
     ModelRenderer();
 
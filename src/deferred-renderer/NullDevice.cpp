@@ -0,0 +1,994 @@
+#include "PCH.h"
+#include "NullDevice.h"
+
+// Every object the device creates, they hold a reference to the device and answer for the
+// interfaces they implement
+template <class T>
+class NullDeviceChild : public T
+{
+private:
+    ID3D11Device* _device;
+    LONG _refCount;
+
+protected:
+    virtual bool hasInterface(REFIID riid) const
+    {
+        return riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(T);
+    }
+
+public:
+    NullDeviceChild(ID3D11Device* device)
+        : _device(device), _refCount(1)
+    {
+        _device->AddRef();
+    }
+
+    virtual ~NullDeviceChild()
+    {
+        SAFE_RELEASE(_device);
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject)
+    {
+        if (!ppvObject)
+        {
+            return E_POINTER;
+        }
+
+        if (hasInterface(riid))
+        {
+            *ppvObject = static_cast<T*>(this);
+            AddRef();
+            return S_OK;
+        }
+
+        *ppvObject = NULL;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef()
+    {
+        return (ULONG)InterlockedIncrement(&_refCount);
+    }
+
+    ULONG STDMETHODCALLTYPE Release()
+    {
+        ULONG count = (ULONG)InterlockedDecrement(&_refCount);
+        if (count == 0)
+        {
+            delete this;
+        }
+        return count;
+    }
+
+    void STDMETHODCALLTYPE GetDevice(ID3D11Device** ppDevice)
+    {
+        *ppDevice = _device;
+        _device->AddRef();
+    }
+
+    // Private data is only used for debug names, which nothing reads back
+    HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData)
+    {
+        return DXGI_ERROR_NOT_FOUND;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData)
+    {
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData)
+    {
+        return S_OK;
+    }
+};
+
+template <class T, class DESC, D3D11_RESOURCE_DIMENSION DIMENSION>
+class NullResource : public NullDeviceChild<T>
+{
+private:
+    DESC _desc;
+    UINT _evictionPriority;
+
+protected:
+    bool hasInterface(REFIID riid) const
+    {
+        return riid == __uuidof(ID3D11Resource) || NullDeviceChild<T>::hasInterface(riid);
+    }
+
+public:
+    NullResource(ID3D11Device* device, const DESC& desc)
+        : NullDeviceChild<T>(device), _desc(desc), _evictionPriority(0)
+    {
+    }
+
+    void STDMETHODCALLTYPE GetType(D3D11_RESOURCE_DIMENSION* pResourceDimension) { *pResourceDimension = DIMENSION; }
+    void STDMETHODCALLTYPE SetEvictionPriority(UINT EvictionPriority) { _evictionPriority = EvictionPriority; }
+    UINT STDMETHODCALLTYPE GetEvictionPriority() { return _evictionPriority; }
+    void STDMETHODCALLTYPE GetDesc(DESC* pDesc) { *pDesc = _desc; }
+};
+
+typedef NullResource<ID3D11Buffer, D3D11_BUFFER_DESC, D3D11_RESOURCE_DIMENSION_BUFFER> NullBuffer;
+typedef NullResource<ID3D11Texture1D, D3D11_TEXTURE1D_DESC, D3D11_RESOURCE_DIMENSION_TEXTURE1D> NullTexture1D;
+typedef NullResource<ID3D11Texture2D, D3D11_TEXTURE2D_DESC, D3D11_RESOURCE_DIMENSION_TEXTURE2D> NullTexture2D;
+typedef NullResource<ID3D11Texture3D, D3D11_TEXTURE3D_DESC, D3D11_RESOURCE_DIMENSION_TEXTURE3D> NullTexture3D;
+
+template <class T, class DESC>
+class NullView : public NullDeviceChild<T>
+{
+private:
+    ID3D11Resource* _resource;
+    DESC _desc;
+
+protected:
+    bool hasInterface(REFIID riid) const
+    {
+        return riid == __uuidof(ID3D11View) || NullDeviceChild<T>::hasInterface(riid);
+    }
+
+public:
+    NullView(ID3D11Device* device, ID3D11Resource* resource, const DESC& desc)
+        : NullDeviceChild<T>(device), _resource(resource), _desc(desc)
+    {
+        _resource->AddRef();
+    }
+
+    ~NullView()
+    {
+        SAFE_RELEASE(_resource);
+    }
+
+    void STDMETHODCALLTYPE GetResource(ID3D11Resource** ppResource)
+    {
+        *ppResource = _resource;
+        _resource->AddRef();
+    }
+
+    void STDMETHODCALLTYPE GetDesc(DESC* pDesc) { *pDesc = _desc; }
+};
+
+typedef NullView<ID3D11ShaderResourceView, D3D11_SHADER_RESOURCE_VIEW_DESC> NullShaderResourceView;
+typedef NullView<ID3D11UnorderedAccessView, D3D11_UNORDERED_ACCESS_VIEW_DESC> NullUnorderedAccessView;
+typedef NullView<ID3D11RenderTargetView, D3D11_RENDER_TARGET_VIEW_DESC> NullRenderTargetView;
+typedef NullView<ID3D11DepthStencilView, D3D11_DEPTH_STENCIL_VIEW_DESC> NullDepthStencilView;
+
+template <class T, class DESC>
+class NullState : public NullDeviceChild<T>
+{
+private:
+    DESC _desc;
+
+public:
+    NullState(ID3D11Device* device, const DESC& desc)
+        : NullDeviceChild<T>(device), _desc(desc)
+    {
+    }
+
+    void STDMETHODCALLTYPE GetDesc(DESC* pDesc) { *pDesc = _desc; }
+};
+
+typedef NullState<ID3D11BlendState, D3D11_BLEND_DESC> NullBlendState;
+typedef NullState<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC> NullDepthStencilState;
+typedef NullState<ID3D11RasterizerState, D3D11_RASTERIZER_DESC> NullRasterizerState;
+typedef NullState<ID3D11SamplerState, D3D11_SAMPLER_DESC> NullSamplerState;
+
+// Shaders and input layouts have nothing to describe, their byte code is not kept
+typedef NullDeviceChild<ID3D11InputLayout> NullInputLayout;
+typedef NullDeviceChild<ID3D11VertexShader> NullVertexShader;
+typedef NullDeviceChild<ID3D11GeometryShader> NullGeometryShader;
+typedef NullDeviceChild<ID3D11PixelShader> NullPixelShader;
+typedef NullDeviceChild<ID3D11HullShader> NullHullShader;
+typedef NullDeviceChild<ID3D11DomainShader> NullDomainShader;
+typedef NullDeviceChild<ID3D11ComputeShader> NullComputeShader;
+
+template <class T>
+class NullQuery : public NullDeviceChild<T>
+{
+private:
+    D3D11_QUERY_DESC _desc;
+
+protected:
+    bool hasInterface(REFIID riid) const
+    {
+        return riid == __uuidof(ID3D11Asynchronous) || riid == __uuidof(ID3D11Query) ||
+               NullDeviceChild<T>::hasInterface(riid);
+    }
+
+public:
+    NullQuery(ID3D11Device* device, const D3D11_QUERY_DESC& desc)
+        : NullDeviceChild<T>(device), _desc(desc)
+    {
+    }
+
+    UINT STDMETHODCALLTYPE GetDataSize()
+    {
+        switch (_desc.Query)
+        {
+        case D3D11_QUERY_EVENT:
+        case D3D11_QUERY_OCCLUSION_PREDICATE:
+        case D3D11_QUERY_SO_OVERFLOW_PREDICATE:
+        case D3D11_QUERY_SO_OVERFLOW_PREDICATE_STREAM0:
+        case D3D11_QUERY_SO_OVERFLOW_PREDICATE_STREAM1:
+        case D3D11_QUERY_SO_OVERFLOW_PREDICATE_STREAM2:
+        case D3D11_QUERY_SO_OVERFLOW_PREDICATE_STREAM3:
+            return sizeof(BOOL);
+        case D3D11_QUERY_OCCLUSION:
+        case D3D11_QUERY_TIMESTAMP:
+            return sizeof(UINT64);
+        case D3D11_QUERY_TIMESTAMP_DISJOINT:
+            return sizeof(D3D11_QUERY_DATA_TIMESTAMP_DISJOINT);
+        case D3D11_QUERY_PIPELINE_STATISTICS:
+            return sizeof(D3D11_QUERY_DATA_PIPELINE_STATISTICS);
+        default:
+            return sizeof(D3D11_QUERY_DATA_SO_STATISTICS);
+        }
+    }
+
+    void STDMETHODCALLTYPE GetDesc(D3D11_QUERY_DESC* pDesc) { *pDesc = _desc; }
+};
+
+typedef NullQuery<ID3D11Query> NullQueryObject;
+typedef NullQuery<ID3D11Predicate> NullPredicate;
+
+static UINT getFullMipCount(UINT width, UINT height, UINT depth)
+{
+    UINT count = 1;
+    while (width > 1 || height > 1 || depth > 1)
+    {
+        width = max(width / 2, 1U);
+        height = max(height / 2, 1U);
+        depth = max(depth / 2, 1U);
+        count++;
+    }
+    return count;
+}
+
+enum VIEW_KIND
+{
+    VIEW_BUFFER,
+    VIEW_TEXTURE1D,
+    VIEW_TEXTURE1DARRAY,
+    VIEW_TEXTURE2D,
+    VIEW_TEXTURE2DARRAY,
+    VIEW_TEXTURE2DMS,
+    VIEW_TEXTURE2DMSARRAY,
+    VIEW_TEXTURE3D,
+};
+
+// A view created without a description sees the whole resource in the resource's own format,
+// only the format and dimension of that description are filled in
+static VIEW_KIND getDefaultView(ID3D11Resource* resource, DXGI_FORMAT* format)
+{
+    D3D11_RESOURCE_DIMENSION dimension;
+    resource->GetType(&dimension);
+
+    switch (dimension)
+    {
+    case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+        {
+            D3D11_TEXTURE1D_DESC desc;
+            static_cast<ID3D11Texture1D*>(resource)->GetDesc(&desc);
+            *format = desc.Format;
+            return (desc.ArraySize > 1) ? VIEW_TEXTURE1DARRAY : VIEW_TEXTURE1D;
+        }
+    case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+        {
+            D3D11_TEXTURE2D_DESC desc;
+            static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+            *format = desc.Format;
+            if (desc.SampleDesc.Count > 1)
+            {
+                return (desc.ArraySize > 1) ? VIEW_TEXTURE2DMSARRAY : VIEW_TEXTURE2DMS;
+            }
+            return (desc.ArraySize > 1) ? VIEW_TEXTURE2DARRAY : VIEW_TEXTURE2D;
+        }
+    case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+        {
+            D3D11_TEXTURE3D_DESC desc;
+            static_cast<ID3D11Texture3D*>(resource)->GetDesc(&desc);
+            *format = desc.Format;
+            return VIEW_TEXTURE3D;
+        }
+    default:
+        *format = DXGI_FORMAT_UNKNOWN;
+        return VIEW_BUFFER;
+    }
+}
+
+NullDevice::NullDevice(D3D_FEATURE_LEVEL featureLevel)
+    : _refCount(1), _featureLevel(featureLevel), _exceptionMode(0)
+{
+    // The contexts are part of the device, their references to it are not counted or the device
+    // could never be released
+    _immediateContext.Reset(this, NULL);
+    _refCount--;
+}
+
+NullDevice::~NullDevice()
+{
+    // Letting go of the contexts releases the references that were not counted, the count is
+    // raised so that it does not reach zero a second time
+    _refCount = 2 + (LONG)_deferredContexts.size();
+
+    for (UINT i = 0; i < _deferredContexts.size(); i++)
+    {
+        _deferredContexts[i]->Reset(NULL, NULL);
+        delete _deferredContexts[i];
+    }
+    _immediateContext.Reset(NULL, NULL);
+}
+
+// IUnknown
+HRESULT STDMETHODCALLTYPE NullDevice::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if (!ppvObject)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11Device))
+    {
+        *ppvObject = static_cast<ID3D11Device*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE NullDevice::AddRef()
+{
+    return (ULONG)InterlockedIncrement(&_refCount);
+}
+
+ULONG STDMETHODCALLTYPE NullDevice::Release()
+{
+    ULONG count = (ULONG)InterlockedDecrement(&_refCount);
+    if (count == 0)
+    {
+        delete this;
+    }
+    return count;
+}
+
+// Resources
+HRESULT STDMETHODCALLTYPE NullDevice::CreateBuffer(const D3D11_BUFFER_DESC* pDesc, const D3D11_SUBRESOURCE_DATA* pInitialData,
+                                                   ID3D11Buffer** ppBuffer)
+{
+    if (!pDesc || pDesc->ByteWidth == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Like the runtime, only validate when there is nowhere to put the buffer
+    if (!ppBuffer)
+    {
+        return S_FALSE;
+    }
+
+    *ppBuffer = new NullBuffer(this, *pDesc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateTexture1D(const D3D11_TEXTURE1D_DESC* pDesc, const D3D11_SUBRESOURCE_DATA* pInitialData,
+                                                      ID3D11Texture1D** ppTexture1D)
+{
+    if (!pDesc || pDesc->Width == 0 || pDesc->ArraySize == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppTexture1D)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_TEXTURE1D_DESC desc = *pDesc;
+    if (desc.MipLevels == 0)
+    {
+        desc.MipLevels = getFullMipCount(desc.Width, 1, 1);
+    }
+
+    *ppTexture1D = new NullTexture1D(this, desc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateTexture2D(const D3D11_TEXTURE2D_DESC* pDesc, const D3D11_SUBRESOURCE_DATA* pInitialData,
+                                                      ID3D11Texture2D** ppTexture2D)
+{
+    if (!pDesc || pDesc->Width == 0 || pDesc->Height == 0 || pDesc->ArraySize == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppTexture2D)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_TEXTURE2D_DESC desc = *pDesc;
+    if (desc.MipLevels == 0)
+    {
+        desc.MipLevels = getFullMipCount(desc.Width, desc.Height, 1);
+    }
+
+    *ppTexture2D = new NullTexture2D(this, desc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateTexture3D(const D3D11_TEXTURE3D_DESC* pDesc, const D3D11_SUBRESOURCE_DATA* pInitialData,
+                                                      ID3D11Texture3D** ppTexture3D)
+{
+    if (!pDesc || pDesc->Width == 0 || pDesc->Height == 0 || pDesc->Depth == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppTexture3D)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_TEXTURE3D_DESC desc = *pDesc;
+    if (desc.MipLevels == 0)
+    {
+        desc.MipLevels = getFullMipCount(desc.Width, desc.Height, desc.Depth);
+    }
+
+    *ppTexture3D = new NullTexture3D(this, desc);
+    return S_OK;
+}
+
+// Views
+HRESULT STDMETHODCALLTYPE NullDevice::CreateShaderResourceView(ID3D11Resource* pResource, const D3D11_SHADER_RESOURCE_VIEW_DESC* pDesc,
+                                                               ID3D11ShaderResourceView** ppSRView)
+{
+    if (!pResource)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppSRView)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC desc;
+    if (pDesc)
+    {
+        desc = *pDesc;
+    }
+    else
+    {
+        static const D3D11_SRV_DIMENSION dimensions[] =
+        {
+            D3D11_SRV_DIMENSION_BUFFER,
+            D3D11_SRV_DIMENSION_TEXTURE1D,
+            D3D11_SRV_DIMENSION_TEXTURE1DARRAY,
+            D3D11_SRV_DIMENSION_TEXTURE2D,
+            D3D11_SRV_DIMENSION_TEXTURE2DARRAY,
+            D3D11_SRV_DIMENSION_TEXTURE2DMS,
+            D3D11_SRV_DIMENSION_TEXTURE2DMSARRAY,
+            D3D11_SRV_DIMENSION_TEXTURE3D,
+        };
+
+        ZeroMemory(&desc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+        desc.ViewDimension = dimensions[getDefaultView(pResource, &desc.Format)];
+    }
+
+    *ppSRView = new NullShaderResourceView(this, pResource, desc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateUnorderedAccessView(ID3D11Resource* pResource, const D3D11_UNORDERED_ACCESS_VIEW_DESC* pDesc,
+                                                                ID3D11UnorderedAccessView** ppUAView)
+{
+    if (!pResource)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppUAView)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC desc;
+    if (pDesc)
+    {
+        desc = *pDesc;
+    }
+    else
+    {
+        // Multisampled textures cannot be unordered access views, they are described like the
+        // single sampled ones
+        static const D3D11_UAV_DIMENSION dimensions[] =
+        {
+            D3D11_UAV_DIMENSION_BUFFER,
+            D3D11_UAV_DIMENSION_TEXTURE1D,
+            D3D11_UAV_DIMENSION_TEXTURE1DARRAY,
+            D3D11_UAV_DIMENSION_TEXTURE2D,
+            D3D11_UAV_DIMENSION_TEXTURE2DARRAY,
+            D3D11_UAV_DIMENSION_TEXTURE2D,
+            D3D11_UAV_DIMENSION_TEXTURE2DARRAY,
+            D3D11_UAV_DIMENSION_TEXTURE3D,
+        };
+
+        ZeroMemory(&desc, sizeof(D3D11_UNORDERED_ACCESS_VIEW_DESC));
+        desc.ViewDimension = dimensions[getDefaultView(pResource, &desc.Format)];
+    }
+
+    *ppUAView = new NullUnorderedAccessView(this, pResource, desc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateRenderTargetView(ID3D11Resource* pResource, const D3D11_RENDER_TARGET_VIEW_DESC* pDesc,
+                                                             ID3D11RenderTargetView** ppRTView)
+{
+    if (!pResource)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppRTView)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_RENDER_TARGET_VIEW_DESC desc;
+    if (pDesc)
+    {
+        desc = *pDesc;
+    }
+    else
+    {
+        static const D3D11_RTV_DIMENSION dimensions[] =
+        {
+            D3D11_RTV_DIMENSION_BUFFER,
+            D3D11_RTV_DIMENSION_TEXTURE1D,
+            D3D11_RTV_DIMENSION_TEXTURE1DARRAY,
+            D3D11_RTV_DIMENSION_TEXTURE2D,
+            D3D11_RTV_DIMENSION_TEXTURE2DARRAY,
+            D3D11_RTV_DIMENSION_TEXTURE2DMS,
+            D3D11_RTV_DIMENSION_TEXTURE2DMSARRAY,
+            D3D11_RTV_DIMENSION_TEXTURE3D,
+        };
+
+        ZeroMemory(&desc, sizeof(D3D11_RENDER_TARGET_VIEW_DESC));
+        desc.ViewDimension = dimensions[getDefaultView(pResource, &desc.Format)];
+    }
+
+    *ppRTView = new NullRenderTargetView(this, pResource, desc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateDepthStencilView(ID3D11Resource* pResource, const D3D11_DEPTH_STENCIL_VIEW_DESC* pDesc,
+                                                             ID3D11DepthStencilView** ppDepthStencilView)
+{
+    if (!pResource)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppDepthStencilView)
+    {
+        return S_FALSE;
+    }
+
+    D3D11_DEPTH_STENCIL_VIEW_DESC desc;
+    if (pDesc)
+    {
+        desc = *pDesc;
+    }
+    else
+    {
+        // Neither buffers nor volumes can be depth stencil views
+        static const D3D11_DSV_DIMENSION dimensions[] =
+        {
+            D3D11_DSV_DIMENSION_UNKNOWN,
+            D3D11_DSV_DIMENSION_TEXTURE1D,
+            D3D11_DSV_DIMENSION_TEXTURE1DARRAY,
+            D3D11_DSV_DIMENSION_TEXTURE2D,
+            D3D11_DSV_DIMENSION_TEXTURE2DARRAY,
+            D3D11_DSV_DIMENSION_TEXTURE2DMS,
+            D3D11_DSV_DIMENSION_TEXTURE2DMSARRAY,
+            D3D11_DSV_DIMENSION_UNKNOWN,
+        };
+
+        ZeroMemory(&desc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC));
+        desc.ViewDimension = dimensions[getDefaultView(pResource, &desc.Format)];
+    }
+
+    *ppDepthStencilView = new NullDepthStencilView(this, pResource, desc);
+    return S_OK;
+}
+
+// Shaders
+HRESULT STDMETHODCALLTYPE NullDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* pInputElementDescs, UINT NumElements,
+                                                        const void* pShaderBytecodeWithInputSignature, SIZE_T BytecodeLength,
+                                                        ID3D11InputLayout** ppInputLayout)
+{
+    if ((!pInputElementDescs && NumElements > 0) || !pShaderBytecodeWithInputSignature)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppInputLayout)
+    {
+        return S_FALSE;
+    }
+
+    *ppInputLayout = new NullInputLayout(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateVertexShader(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                         ID3D11ClassLinkage* pClassLinkage, ID3D11VertexShader** ppVertexShader)
+{
+    if (!pShaderBytecode || BytecodeLength == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppVertexShader)
+    {
+        return S_FALSE;
+    }
+
+    *ppVertexShader = new NullVertexShader(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateGeometryShader(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                           ID3D11ClassLinkage* pClassLinkage, ID3D11GeometryShader** ppGeometryShader)
+{
+    if (!pShaderBytecode || BytecodeLength == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppGeometryShader)
+    {
+        return S_FALSE;
+    }
+
+    *ppGeometryShader = new NullGeometryShader(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateGeometryShaderWithStreamOutput(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                                           const D3D11_SO_DECLARATION_ENTRY* pSODeclaration,
+                                                                           UINT NumEntries, const UINT* pBufferStrides,
+                                                                           UINT NumStrides, UINT RasterizedStream,
+                                                                           ID3D11ClassLinkage* pClassLinkage,
+                                                                           ID3D11GeometryShader** ppGeometryShader)
+{
+    return CreateGeometryShader(pShaderBytecode, BytecodeLength, pClassLinkage, ppGeometryShader);
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreatePixelShader(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                        ID3D11ClassLinkage* pClassLinkage, ID3D11PixelShader** ppPixelShader)
+{
+    if (!pShaderBytecode || BytecodeLength == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppPixelShader)
+    {
+        return S_FALSE;
+    }
+
+    *ppPixelShader = new NullPixelShader(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateHullShader(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                       ID3D11ClassLinkage* pClassLinkage, ID3D11HullShader** ppHullShader)
+{
+    if (!pShaderBytecode || BytecodeLength == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppHullShader)
+    {
+        return S_FALSE;
+    }
+
+    *ppHullShader = new NullHullShader(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateDomainShader(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                         ID3D11ClassLinkage* pClassLinkage, ID3D11DomainShader** ppDomainShader)
+{
+    if (!pShaderBytecode || BytecodeLength == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppDomainShader)
+    {
+        return S_FALSE;
+    }
+
+    *ppDomainShader = new NullDomainShader(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateComputeShader(const void* pShaderBytecode, SIZE_T BytecodeLength,
+                                                          ID3D11ClassLinkage* pClassLinkage, ID3D11ComputeShader** ppComputeShader)
+{
+    if (!pShaderBytecode || BytecodeLength == 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppComputeShader)
+    {
+        return S_FALSE;
+    }
+
+    *ppComputeShader = new NullComputeShader(this);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateClassLinkage(ID3D11ClassLinkage** ppLinkage)
+{
+    // Nothing in the renderer uses dynamic shader linkage
+    return E_NOTIMPL;
+}
+
+// States
+HRESULT STDMETHODCALLTYPE NullDevice::CreateBlendState(const D3D11_BLEND_DESC* pBlendStateDesc, ID3D11BlendState** ppBlendState)
+{
+    if (!pBlendStateDesc)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppBlendState)
+    {
+        return S_FALSE;
+    }
+
+    *ppBlendState = new NullBlendState(this, *pBlendStateDesc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* pDepthStencilDesc,
+                                                              ID3D11DepthStencilState** ppDepthStencilState)
+{
+    if (!pDepthStencilDesc)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppDepthStencilState)
+    {
+        return S_FALSE;
+    }
+
+    *ppDepthStencilState = new NullDepthStencilState(this, *pDepthStencilDesc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC* pRasterizerDesc,
+                                                            ID3D11RasterizerState** ppRasterizerState)
+{
+    if (!pRasterizerDesc)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppRasterizerState)
+    {
+        return S_FALSE;
+    }
+
+    *ppRasterizerState = new NullRasterizerState(this, *pRasterizerDesc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateSamplerState(const D3D11_SAMPLER_DESC* pSamplerDesc, ID3D11SamplerState** ppSamplerState)
+{
+    if (!pSamplerDesc)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppSamplerState)
+    {
+        return S_FALSE;
+    }
+
+    *ppSamplerState = new NullSamplerState(this, *pSamplerDesc);
+    return S_OK;
+}
+
+// Queries, the recording contexts finish every query straight away
+HRESULT STDMETHODCALLTYPE NullDevice::CreateQuery(const D3D11_QUERY_DESC* pQueryDesc, ID3D11Query** ppQuery)
+{
+    if (!pQueryDesc)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppQuery)
+    {
+        return S_FALSE;
+    }
+
+    *ppQuery = new NullQueryObject(this, *pQueryDesc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreatePredicate(const D3D11_QUERY_DESC* pPredicateDesc, ID3D11Predicate** ppPredicate)
+{
+    if (!pPredicateDesc)
+    {
+        return E_INVALIDARG;
+    }
+    if (!ppPredicate)
+    {
+        return S_FALSE;
+    }
+
+    *ppPredicate = new NullPredicate(this, *pPredicateDesc);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateCounter(const D3D11_COUNTER_DESC* pCounterDesc, ID3D11Counter** ppCounter)
+{
+    // There are no hardware counters to expose
+    return DXGI_ERROR_UNSUPPORTED;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CreateDeferredContext(UINT ContextFlags, ID3D11DeviceContext** ppDeferredContext)
+{
+    if (!ppDeferredContext)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Recording contexts are owned by their creator, releasing them does not free them so the
+    // device keeps them until it is destroyed
+    RecordingDeviceContext* context = new RecordingDeviceContext(D3D11_DEVICE_CONTEXT_DEFERRED);
+    context->Reset(this, NULL);
+    InterlockedDecrement(&_refCount);
+
+    _deferredContexts.push_back(context);
+
+    *ppDeferredContext = context;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::OpenSharedResource(HANDLE hResource, REFIID ReturnedInterface, void** ppResource)
+{
+    return E_NOTIMPL;
+}
+
+// Capabilities, everything that the feature level allows is reported as supported
+HRESULT STDMETHODCALLTYPE NullDevice::CheckFormatSupport(DXGI_FORMAT Format, UINT* pFormatSupport)
+{
+    if (!pFormatSupport)
+    {
+        return E_INVALIDARG;
+    }
+
+    *pFormatSupport = 0xFFFFFFFF;
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CheckMultisampleQualityLevels(DXGI_FORMAT Format, UINT SampleCount, UINT* pNumQualityLevels)
+{
+    if (!pNumQualityLevels)
+    {
+        return E_INVALIDARG;
+    }
+
+    bool supported = SampleCount > 0 && SampleCount <= D3D11_MAX_MULTISAMPLE_SAMPLE_COUNT &&
+        (SampleCount & (SampleCount - 1)) == 0;
+    *pNumQualityLevels = supported ? 1 : 0;
+    return S_OK;
+}
+
+void STDMETHODCALLTYPE NullDevice::CheckCounterInfo(D3D11_COUNTER_INFO* pCounterInfo)
+{
+    ZeroMemory(pCounterInfo, sizeof(D3D11_COUNTER_INFO));
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CheckCounter(const D3D11_COUNTER_DESC* pDesc, D3D11_COUNTER_TYPE* pType,
+                                                   UINT* pActiveCounters, LPSTR szName, UINT* pNameLength, LPSTR szUnits,
+                                                   UINT* pUnitsLength, LPSTR szDescription, UINT* pDescriptionLength)
+{
+    return DXGI_ERROR_UNSUPPORTED;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::CheckFeatureSupport(D3D11_FEATURE Feature, void* pFeatureSupportData,
+                                                          UINT FeatureSupportDataSize)
+{
+    if (!pFeatureSupportData)
+    {
+        return E_INVALIDARG;
+    }
+
+    switch (Feature)
+    {
+    case D3D11_FEATURE_THREADING:
+        if (FeatureSupportDataSize != sizeof(D3D11_FEATURE_DATA_THREADING))
+        {
+            return E_INVALIDARG;
+        }
+        ((D3D11_FEATURE_DATA_THREADING*)pFeatureSupportData)->DriverConcurrentCreates = TRUE;
+        ((D3D11_FEATURE_DATA_THREADING*)pFeatureSupportData)->DriverCommandLists = TRUE;
+        return S_OK;
+
+    case D3D11_FEATURE_DOUBLES:
+        if (FeatureSupportDataSize != sizeof(D3D11_FEATURE_DATA_DOUBLES))
+        {
+            return E_INVALIDARG;
+        }
+        ((D3D11_FEATURE_DATA_DOUBLES*)pFeatureSupportData)->DoublePrecisionFloatShaderOps = FALSE;
+        return S_OK;
+
+    case D3D11_FEATURE_FORMAT_SUPPORT:
+        if (FeatureSupportDataSize != sizeof(D3D11_FEATURE_DATA_FORMAT_SUPPORT))
+        {
+            return E_INVALIDARG;
+        }
+        ((D3D11_FEATURE_DATA_FORMAT_SUPPORT*)pFeatureSupportData)->OutFormatSupport = 0xFFFFFFFF;
+        return S_OK;
+
+    case D3D11_FEATURE_FORMAT_SUPPORT2:
+        if (FeatureSupportDataSize != sizeof(D3D11_FEATURE_DATA_FORMAT_SUPPORT2))
+        {
+            return E_INVALIDARG;
+        }
+        ((D3D11_FEATURE_DATA_FORMAT_SUPPORT2*)pFeatureSupportData)->OutFormatSupport2 = 0;
+        return S_OK;
+
+    case D3D11_FEATURE_D3D10_X_HARDWARE_OPTIONS:
+        if (FeatureSupportDataSize != sizeof(D3D11_FEATURE_DATA_D3D10_X_HARDWARE_OPTIONS))
+        {
+            return E_INVALIDARG;
+        }
+        ((D3D11_FEATURE_DATA_D3D10_X_HARDWARE_OPTIONS*)pFeatureSupportData)->
+            ComputeShaders_Plus_RawAndStructuredBuffers_Via_Shader_4_x = TRUE;
+        return S_OK;
+
+    default:
+        return E_INVALIDARG;
+    }
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData)
+{
+    return DXGI_ERROR_NOT_FOUND;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::SetPrivateData(REFGUID guid, UINT DataSize, const void* pData)
+{
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::SetPrivateDataInterface(REFGUID guid, const IUnknown* pData)
+{
+    return S_OK;
+}
+
+D3D_FEATURE_LEVEL STDMETHODCALLTYPE NullDevice::GetFeatureLevel()
+{
+    return _featureLevel;
+}
+
+UINT STDMETHODCALLTYPE NullDevice::GetCreationFlags()
+{
+    return 0;
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::GetDeviceRemovedReason()
+{
+    return S_OK;
+}
+
+void STDMETHODCALLTYPE NullDevice::GetImmediateContext(ID3D11DeviceContext** ppImmediateContext)
+{
+    *ppImmediateContext = &_immediateContext;
+    _immediateContext.AddRef();
+}
+
+HRESULT STDMETHODCALLTYPE NullDevice::SetExceptionMode(UINT RaiseFlags)
+{
+    _exceptionMode = RaiseFlags;
+    return S_OK;
+}
+
+UINT STDMETHODCALLTYPE NullDevice::GetExceptionMode()
+{
+    return _exceptionMode;
+}
\ No newline at end of file
@@ -2,29 +2,43 @@
 
 #include "PCH.h"
 
+// 32 bytes per particle, only the position needs full precision. The previous position is stored
+// as an offset from the position and the previous radius and rotation share a vector with the
+// current ones.
 struct ParticleVertex
 {
     XMFLOAT3 Position;
-    XMFLOAT3 PreviousPosition;
-    XMFLOAT4 Color;
-    float Radius;
-    float PreviousRadius;
-    float Rotation;
-    float PreviousRotation;
+    XMUBYTEN4 Color;
+    XMHALF4 PreviousOffset;
+    XMHALF2 Radius;
+    XMHALF2 Rotation;
 };
 
-struct Particle
+// Particles are stored as one array per component so that they can be advanced four at a time,
+// every array is 16 byte aligned and padded to a multiple of four particles
+struct ParticleArrays
 {
-    XMFLOAT3 Position;
-    XMFLOAT3 PreviousPosition;
-    XMFLOAT3 Velocity;
-    float SpeedPerc;
-    XMFLOAT4 Color;
-    float Radius;
-    float PreviousRadius;
-    float Scale;
-    float Life;
-    float Rotation;
-    float PreviousRotation;
-    float RotationRate;
-};
\ No newline at end of file
+    float* PositionX;
+    float* PositionY;
+    float* PositionZ;
+    float* PreviousPositionX;
+    float* PreviousPositionY;
+    float* PreviousPositionZ;
+    float* VelocityX;
+    float* VelocityY;
+    float* VelocityZ;
+    float* SpeedPerc;
+    float* ColorR;
+    float* ColorG;
+    float* ColorB;
+    float* ColorA;
+    float* Radius;
+    float* PreviousRadius;
+    float* Scale;
+    float* Life;
+    float* Rotation;
+    float* PreviousRotation;
+    float* RotationRate;
+};
+
+static const UINT PARTICLE_ARRAY_COUNT = sizeof(ParticleArrays) / sizeof(float*);
\ No newline at end of file
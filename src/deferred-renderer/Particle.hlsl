@@ -49,12 +49,10 @@ SamplerState SceneSampler        : register(s1);
 struct VS_In_Particle
 {
     float3 vPositionWS        : POSITION;
-    float3 vPrevPositionWS    : PREVPOSITION;
     float4 vColor             : COLOR;
-    float  fRadius            : RADIUS;
-    float  fPrevRadius        : PREVRADIUS;
-    float  fRotation          : ROTATION;
-    float  fPrevRotation      : PREVROTATION;
+    float3 vPrevOffset        : PREVOFFSET;
+    float2 vRadius            : RADIUS;
+    float2 vRotation          : ROTATION;
 };
 
 struct VS_Out_Particle
@@ -88,13 +86,14 @@ VS_Out_Particle VS_Particle(VS_In_Particle input)
 {
     VS_Out_Particle output;
 
+    // The previous values are packed next to the current ones
     output.vPositionWS = input.vPositionWS;
-    output.vPrevPositionWS = input.vPrevPositionWS;
+    output.vPrevPositionWS = input.vPositionWS + input.vPrevOffset;
     output.vColor = input.vColor;
-    output.fRadius = input.fRadius;
-    output.fPrevRadius = input.fPrevRadius;
-    output.fRotation = input.fRotation;
-    output.fPrevRotation = input.fPrevRotation;
+    output.fRadius = input.vRadius.x;
+    output.fPrevRadius = input.vRadius.y;
+    output.fRotation = input.vRotation.x;
+    output.fPrevRotation = input.vRotation.y;
 
     return output;
 }
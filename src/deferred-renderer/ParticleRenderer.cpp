@@ -1,12 +1,102 @@
 #include "PCH.h"
 #include "ParticleRenderer.h"
+#include "Logger.h"
+#include "RenderStats.h"
 
 ParticleRenderer::ParticleRenderer()
-    : _ps(NULL), _gs(NULL), _vs(NULL), _particleCB(NULL), _cameraCB(NULL), _particleBlend(NULL)
+    : _ps(NULL), _gs(NULL), _vs(NULL), _particleCB(NULL), _cameraCB(NULL), _particleBlend(NULL),
+      _vertexRing(NULL), _ringSize(0), _ringPosition(0)
 {
     SetFadeDistance(0.5f);
 }
 
+HRESULT ParticleRenderer::createVertexRing(ID3D11Device* device, UINT size)
+{
+    HRESULT hr;
+
+    SAFE_RELEASE(_vertexRing);
+
+    D3D11_BUFFER_DESC vbDesc =
+    {
+        size * sizeof(ParticleVertex), // INT ByteWidth;
+        D3D11_USAGE_DYNAMIC, // D3D11_USAGE Usage;
+        D3D11_BIND_VERTEX_BUFFER, // UINT BindFlags;
+        D3D11_CPU_ACCESS_WRITE, // UINT CPUAccessFlags;
+        0, // UINT MiscFlags;
+        0, // UINT StructureByteStride;
+    };
+    V_RETURN(device->CreateBuffer(&vbDesc, NULL, &_vertexRing));
+    V_RETURN(SetDXDebugName(_vertexRing, "Particle Renderer vertex ring"));
+
+    // The first map of a new buffer has to discard it
+    _ringSize = size;
+    _ringPosition = size;
+
+    return S_OK;
+}
+
+HRESULT ParticleRenderer::uploadVertices(ID3D11DeviceContext* context, vector<ParticleSystemInstance*>* instances,
+                                         const std::vector<PARTICLE_SYSTEM_INFO>& order, UINT* firstVertex)
+{
+    HRESULT hr;
+
+    UINT vertexCount = 0;
+    for (UINT i = 0; i < order.size(); i++)
+    {
+        vertexCount += instances->at(order[i].System)->GetVertexCount();
+    }
+
+    *firstVertex = 0;
+    if (vertexCount == 0)
+    {
+        return S_OK;
+    }
+
+    if (vertexCount > _ringSize)
+    {
+        ID3D11Device* device;
+        context->GetDevice(&device);
+        hr = createVertexRing(device, max(vertexCount, _ringSize * 2));
+        SAFE_RELEASE(device);
+        V_RETURN(hr);
+    }
+
+    // Append to the data the GPU may still be reading, or start again at the front once it is
+    // full. A deferred context can only map with NO_OVERWRITE after it has discarded the buffer
+    // itself, so recording on one always starts again at the front.
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (_ringPosition + vertexCount > _ringSize || context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED)
+    {
+        mapType = D3D11_MAP_WRITE_DISCARD;
+        _ringPosition = 0;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    V_RETURN(context->Map(_vertexRing, 0, mapType, 0, &mappedResource));
+
+    ParticleVertex* vertices = (ParticleVertex*)mappedResource.pData + _ringPosition;
+    for (UINT i = 0; i < order.size(); i++)
+    {
+        ParticleSystemInstance* system = instances->at(order[i].System);
+        if (system->GetVertexCount() == 0)
+        {
+            continue;
+        }
+
+        BEGIN_EVENT(system->GetParticleSystem()->GetName().c_str());
+        system->CopyVertices(vertices);
+        vertices += system->GetVertexCount();
+        END_EVENT(L"");
+    }
+
+    context->Unmap(_vertexRing, 0);
+
+    *firstVertex = _ringPosition;
+    _ringPosition += vertexCount;
+
+    return S_OK;
+}
+
 HRESULT ParticleRenderer::RenderParticles(ID3D11DeviceContext* pd3dDeviceContext,
                                           vector<ParticleSystemInstance*>* instances,  Camera* camera, GBuffer* gBuffer)
 {
@@ -27,6 +117,13 @@ HRESULT ParticleRenderer::RenderParticles(ID3D11DeviceContext* pd3dDeviceContext
 
         std::sort(depthVec.begin(), depthVec.end(), depthCompare);
 
+        // Copy the vertices of every system into the ring in draw order with a single map
+        BEGIN_EVENT(L"Upload");
+        UINT firstVertex;
+        hr = uploadVertices(pd3dDeviceContext, instances, depthVec, &firstVertex);
+        END_EVENT(L"");
+        V_RETURN(hr);
+
         pd3dDeviceContext->VSSetShader(_vs->VertexShader, NULL, 0);
         pd3dDeviceContext->GSSetShader(_gs->GeometryShader, NULL, 0);
         pd3dDeviceContext->PSSetShader(_ps->PixelShader, NULL, 0);
@@ -45,6 +142,10 @@ HRESULT ParticleRenderer::RenderParticles(ID3D11DeviceContext* pd3dDeviceContext
 
         pd3dDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 
+        UINT stride = sizeof(ParticleVertex);
+        UINT offset = 0;
+        pd3dDeviceContext->IASetVertexBuffers(0, 1, &_vertexRing, &stride, &offset);
+
         pd3dDeviceContext->OMSetDepthStencilState(_dsStates.GetDepthEnabled(), 0);
 
         XMFLOAT4X4 fViewProj = camera->GetViewProjection();
@@ -94,21 +195,34 @@ HRESULT ParticleRenderer::RenderParticles(ID3D11DeviceContext* pd3dDeviceContext
         {
             ParticleSystemInstance* system = instances->at(depthVec[i].System);
 
+            // Culled or empty
+            if (system->GetVertexCount() == 0)
+            {
+                continue;
+            }
+
+            BEGIN_EVENT_D3D(system->GetParticleSystem()->GetName().c_str());
+
             ID3D11ShaderResourceView* srvs[2] = { system->GetDiffuseSRV(), system->GetNormalSRV() };
             pd3dDeviceContext->PSSetShaderResources(0, 2, srvs);
 
-            ID3D11Buffer* vertexBuffers[1] = { system->GetParticleVertexBuffer(pd3dDeviceContext, camera) };
-            UINT strides[1] = { system->GetVertexStride() };
-            UINT offsets[1] = { 0 };
-            pd3dDeviceContext->IASetVertexBuffers(0, 1, vertexBuffers, strides, offsets);
+            pd3dDeviceContext->Draw(system->GetVertexCount(), firstVertex);
+            firstVertex += system->GetVertexCount();
+
+            // Every particle is expanded into a quad by the geometry shader
+            ADD_RENDER_STAT(ParticleSystems, 1);
+            ADD_RENDER_STAT(Particles, system->GetVertexCount());
+            ADD_RENDER_STAT(DrawCalls, 1);
+            ADD_RENDER_STAT(Triangles, system->GetVertexCount() * 2);
 
-            pd3dDeviceContext->Draw(system->GetParticleCount(), 0);
+            END_EVENT_D3D(L"");
         }
 
         ID3D11ShaderResourceView* nullSrvs[2] = { NULL, NULL };
         pd3dDeviceContext->PSSetShaderResources(0, 2, nullSrvs);
 
         ID3D11Buffer* nullBuf = NULL;
+        pd3dDeviceContext->IASetVertexBuffers(0, 1, &nullBuf, &stride, &offset);
         pd3dDeviceContext->GSSetConstantBuffers(0, 1, &nullBuf);
         pd3dDeviceContext->PSSetConstantBuffers(1, 1, &nullBuf);
 
@@ -146,12 +260,10 @@ HRESULT ParticleRenderer::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentM
     D3D11_INPUT_ELEMENT_DESC layout_particle[] =
     {
         { "POSITION",        0, DXGI_FORMAT_R32G32B32_FLOAT,        0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "PREVPOSITION",    0, DXGI_FORMAT_R32G32B32_FLOAT,        0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR",            0, DXGI_FORMAT_R32G32B32A32_FLOAT,    0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "RADIUS",            0, DXGI_FORMAT_R32_FLOAT,            0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "PREVRADIUS",        0, DXGI_FORMAT_R32_FLOAT,            0, 44, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "ROTATION",        0, DXGI_FORMAT_R32_FLOAT,            0, 48, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "PREVROTATION",    0, DXGI_FORMAT_R32_FLOAT,            0, 52, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "COLOR",            0, DXGI_FORMAT_R8G8B8A8_UNORM,        0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "PREVOFFSET",        0, DXGI_FORMAT_R16G16B16A16_FLOAT,    0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "RADIUS",            0, DXGI_FORMAT_R16G16_FLOAT,        0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "ROTATION",        0, DXGI_FORMAT_R16G16_FLOAT,        0, 28, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     };
     VertexShaderOptions vsOpts =
     {
@@ -205,6 +317,8 @@ HRESULT ParticleRenderer::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentM
     }
     V_RETURN(pd3dDevice->CreateBlendState(&blendDesc, &_particleBlend));
 
+    V_RETURN(createVertexRing(pd3dDevice, INITIAL_RING_SIZE));
+
     V_RETURN(_dsStates.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
     V_RETURN(_samplerStates.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
     V_RETURN(_blendStates.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
@@ -224,6 +338,10 @@ void ParticleRenderer::OnD3D11DestroyDevice(ContentManager* pContentManager)
 
     SAFE_RELEASE(_particleBlend);
 
+    SAFE_RELEASE(_vertexRing);
+    _ringSize = 0;
+    _ringPosition = 0;
+
     _dsStates.OnD3D11DestroyDevice(pContentManager);
     _samplerStates.OnD3D11DestroyDevice(pContentManager);
     _blendStates.OnD3D11DestroyDevice(pContentManager);
@@ -66,6 +66,17 @@ private:
         return i.Depth > j.Depth;
     }
 
+    // Every system is drawn from this one buffer. Each frame's vertices are written after the
+    // last frame's with NO_OVERWRITE, the buffer is only discarded when they no longer fit.
+    ID3D11Buffer* _vertexRing;
+    UINT _ringSize;
+    UINT _ringPosition;
+    static const UINT INITIAL_RING_SIZE = 65536;
+
+    HRESULT createVertexRing(ID3D11Device* device, UINT size);
+    HRESULT uploadVertices(ID3D11DeviceContext* context, vector<ParticleSystemInstance*>* instances,
+        const std::vector<PARTICLE_SYSTEM_INFO>& order, UINT* firstVertex);
+
 public:
     ParticleRenderer();
 
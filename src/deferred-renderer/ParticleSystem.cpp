@@ -1,16 +1,14 @@
 #include "PCH.h"
 #include "ParticleSystem.h"
+#include "ContentLoader.h"
 #include "tinyxml.h"
 
 ParticleSystem::ParticleSystem()
     : _diffuse(NULL), _normal(NULL), _spread(0), _positionVariance(0.0f, 0.0f, 0.0f),
-    _spawnRate(0), _lifeSpan(0), _startSize(0),
-    _endSize(0), _sizeExponent(0), _startSpeed(0), _endSpeed(0), _speedExponent(0), _speedVariance(0),
-    _rollAmount(0),
-    _windFalloff(0), _direction(0.0f, 0.0f, 0.0f), _directionVariance(0.0f, 0.0f, 0.0f),
-    _initialColor(0.0f, 0.0f, 0.0f, 0.0f), _finalColor(0.0f, 0.0f, 0.0f, 0.0f), _fadeExponent(0),
-    _alphaPower(1.0f)
+    _spawnRate(0), _lifeSpan(0), _speedVariance(0), _rollAmount(0),
+    _windFalloff(0), _direction(0.0f, 0.0f, 0.0f), _directionVariance(0.0f, 0.0f, 0.0f)
 {
+    ZeroMemory(_curve, sizeof(_curve));
 }
 
 ParticleSystem::~ParticleSystem()
@@ -23,84 +21,237 @@ void ParticleSystem::Destroy()
     SAFE_RELEASE(_normal);
 }
 
-void ParticleSystem::SpawnParticle(const XMFLOAT3& emitterPos, const XMFLOAT4& emitterRot, float emitterScale,
-                                   Particle* outParticle)
+static inline void storeSpawned(float* values, FXMVECTOR v, UINT count)
 {
-    outParticle->Position.x = emitterPos.x + (RandomBetween(-1.0f, 1.0f) * _spread * emitterScale * _positionVariance.x);
-    outParticle->Position.y = emitterPos.y + (RandomBetween(-1.0f, 1.0f) * _spread * emitterScale *_positionVariance.y);
-    outParticle->Position.z = emitterPos.z + (RandomBetween(-1.0f, 1.0f) * _spread * emitterScale *_positionVariance.z);
-    outParticle->PreviousPosition = outParticle->Position;
-
-    XMVECTOR rotVec = XMLoadFloat4(&emitterRot);
-    XMMATRIX rotMat = XMMatrixRotationQuaternion(rotVec);
+    if (count == 4)
+    {
+        XMStoreFloat4((XMFLOAT4*)values, v);
+    }
+    else
+    {
+        // The range may end part way through a vector, the values after it belong to live
+        // particles
+        XMFLOAT4 lanes;
+        XMStoreFloat4(&lanes, v);
+        memcpy(values, &lanes, count * sizeof(float));
+    }
+}
 
-    XMVECTOR velocity = XMVectorSet(
-        _direction.x + (RandomBetween(-1.0f, 1.0f) * _directionVariance.x),
-        _direction.y + (RandomBetween(-1.0f, 1.0f) * _directionVariance.y),
-        _direction.z + (RandomBetween(-1.0f, 1.0f) * _directionVariance.z),
-        1.0f);
-    XMStoreFloat3(&outParticle->Velocity, XMVector3Transform(XMVector3Normalize(velocity), rotMat));
+void ParticleSystem::SpawnParticles(const XMFLOAT3& emitterPos, const XMFLOAT4& emitterRot, float emitterScale,
+                                    RandomStream* random, ParticleArrays* particles, UINT firstIdx, UINT count)
+{
+    // Everything that is the same for the whole batch
+    XMMATRIX rotMat = XMMatrixRotationQuaternion(XMLoadFloat4(&emitterRot));
+
+    XMVECTOR emitterX = XMVectorReplicate(emitterPos.x);
+    XMVECTOR emitterY = XMVectorReplicate(emitterPos.y);
+    XMVECTOR emitterZ = XMVectorReplicate(emitterPos.z);
+
+    float spread = _spread * emitterScale;
+    XMVECTOR spreadX = XMVectorReplicate(spread * _positionVariance.x);
+    XMVECTOR spreadY = XMVectorReplicate(spread * _positionVariance.y);
+    XMVECTOR spreadZ = XMVectorReplicate(spread * _positionVariance.z);
+
+    XMVECTOR directionX = XMVectorReplicate(_direction.x);
+    XMVECTOR directionY = XMVectorReplicate(_direction.y);
+    XMVECTOR directionZ = XMVectorReplicate(_direction.z);
+    XMVECTOR directionVarianceX = XMVectorReplicate(_directionVariance.x);
+    XMVECTOR directionVarianceY = XMVectorReplicate(_directionVariance.y);
+    XMVECTOR directionVarianceZ = XMVectorReplicate(_directionVariance.z);
+
+    XMVECTOR one = XMVectorSplatOne();
+    XMVECTOR speedVariance = XMVectorReplicate(_speedVariance);
+    XMVECTOR rollAmount = XMVectorReplicate(_rollAmount);
+
+    const CURVE_SAMPLE& start = _curve[0];
+    XMVECTOR colorR = XMVectorReplicate(start.Color.x);
+    XMVECTOR colorG = XMVectorReplicate(start.Color.y);
+    XMVECTOR colorB = XMVectorReplicate(start.Color.z);
+    XMVECTOR colorA = XMVectorReplicate(start.Color.w);
+    XMVECTOR radius = XMVectorReplicate(start.SizeSpeed.x);
+    XMVECTOR scale = XMVectorReplicate(emitterScale);
+    XMVECTOR zero = XMVectorZero();
+
+    for (UINT i = 0; i < count; i += 4)
+    {
+        UINT idx = firstIdx + i;
+        UINT lanes = min(count - i, 4U);
+
+        XMVECTOR posX = XMVectorMultiplyAdd(random->NextSigned(), spreadX, emitterX);
+        XMVECTOR posY = XMVectorMultiplyAdd(random->NextSigned(), spreadY, emitterY);
+        XMVECTOR posZ = XMVectorMultiplyAdd(random->NextSigned(), spreadZ, emitterZ);
+        storeSpawned(&particles->PositionX[idx], posX, lanes);
+        storeSpawned(&particles->PositionY[idx], posY, lanes);
+        storeSpawned(&particles->PositionZ[idx], posZ, lanes);
+        storeSpawned(&particles->PreviousPositionX[idx], posX, lanes);
+        storeSpawned(&particles->PreviousPositionY[idx], posY, lanes);
+        storeSpawned(&particles->PreviousPositionZ[idx], posZ, lanes);
+
+        // Normalize the direction and rotate it by the emitter
+        XMVECTOR dirX = XMVectorMultiplyAdd(random->NextSigned(), directionVarianceX, directionX);
+        XMVECTOR dirY = XMVectorMultiplyAdd(random->NextSigned(), directionVarianceY, directionY);
+        XMVECTOR dirZ = XMVectorMultiplyAdd(random->NextSigned(), directionVarianceZ, directionZ);
+
+        XMVECTOR invLength = XMVectorReciprocalSqrt(
+            XMVectorMultiplyAdd(dirX, dirX, XMVectorMultiplyAdd(dirY, dirY, XMVectorMultiply(dirZ, dirZ))));
+        dirX = XMVectorMultiply(dirX, invLength);
+        dirY = XMVectorMultiply(dirY, invLength);
+        dirZ = XMVectorMultiply(dirZ, invLength);
+
+        XMVECTOR velX = XMVectorMultiplyAdd(dirX, XMVectorSplatX(rotMat.r[0]),
+            XMVectorMultiplyAdd(dirY, XMVectorSplatX(rotMat.r[1]), XMVectorMultiply(dirZ, XMVectorSplatX(rotMat.r[2]))));
+        XMVECTOR velY = XMVectorMultiplyAdd(dirX, XMVectorSplatY(rotMat.r[0]),
+            XMVectorMultiplyAdd(dirY, XMVectorSplatY(rotMat.r[1]), XMVectorMultiply(dirZ, XMVectorSplatY(rotMat.r[2]))));
+        XMVECTOR velZ = XMVectorMultiplyAdd(dirX, XMVectorSplatZ(rotMat.r[0]),
+            XMVectorMultiplyAdd(dirY, XMVectorSplatZ(rotMat.r[1]), XMVectorMultiply(dirZ, XMVectorSplatZ(rotMat.r[2]))));
+        storeSpawned(&particles->VelocityX[idx], velX, lanes);
+        storeSpawned(&particles->VelocityY[idx], velY, lanes);
+        storeSpawned(&particles->VelocityZ[idx], velZ, lanes);
+
+        storeSpawned(&particles->SpeedPerc[idx], XMVectorMultiplyAdd(random->NextSigned(), speedVariance, one), lanes);
+
+        storeSpawned(&particles->ColorR[idx], colorR, lanes);
+        storeSpawned(&particles->ColorG[idx], colorG, lanes);
+        storeSpawned(&particles->ColorB[idx], colorB, lanes);
+        storeSpawned(&particles->ColorA[idx], colorA, lanes);
+
+        storeSpawned(&particles->Radius[idx], radius, lanes);
+        storeSpawned(&particles->PreviousRadius[idx], radius, lanes);
+
+        storeSpawned(&particles->Scale[idx], scale, lanes);
+
+        storeSpawned(&particles->Life[idx], zero, lanes);
+
+        storeSpawned(&particles->Rotation[idx], zero, lanes);
+        storeSpawned(&particles->PreviousRotation[idx], zero, lanes);
+        storeSpawned(&particles->RotationRate[idx], XMVectorMultiply(random->NextSigned(), rollAmount), lanes);
+    }
+}
 
-    outParticle->SpeedPerc = 1.0f + (RandomBetween(-1.0f, 1.0f) * _speedVariance);
+inline void ParticleSystem::sampleCurve(UINT idx, FXMVECTOR t, XMVECTOR* color, XMVECTOR* sizeSpeed) const
+{
+    const CURVE_SAMPLE& sample = _curve[idx];
+    const CURVE_SAMPLE& nextSample = _curve[idx + 1];
 
-    outParticle->Color = _initialColor;
+    *color = XMVectorLerpV(XMLoadFloat4(&sample.Color), XMLoadFloat4(&nextSample.Color), t);
+    *sizeSpeed = XMVectorLerpV(XMLoadFloat4(&sample.SizeSpeed), XMLoadFloat4(&nextSample.SizeSpeed), t);
+}
 
-    outParticle->Radius = _startSize;
-    outParticle->PreviousRadius = outParticle->Radius;
+static inline XMVECTOR loadParticles(const float* values)
+{
+    return XMLoadFloat4A((const XMFLOAT4A*)values);
+}
 
-    outParticle->Scale = emitterScale;
+static inline void storeParticles(float* values, FXMVECTOR v)
+{
+    XMStoreFloat4A((XMFLOAT4A*)values, v);
+}
 
-    outParticle->Life = 0.0f;
+static inline float horizontalMin(FXMVECTOR v)
+{
+    XMFLOAT4 f;
+    XMStoreFloat4(&f, v);
+    return min(min(f.x, f.y), min(f.z, f.w));
+}
 
-    outParticle->Rotation = 0.0f;//RandomBetween(-1.0f, 1.0f) * Pi;
-    outParticle->PreviousRotation = outParticle->Rotation;
-    outParticle->RotationRate = RandomBetween(-1.0f, 1.0f) * _rollAmount;
+static inline float horizontalMax(FXMVECTOR v)
+{
+    XMFLOAT4 f;
+    XMStoreFloat4(&f, v);
+    return max(max(f.x, f.y), max(f.z, f.w));
 }
 
+static const XMVECTORF32 g_FltMax = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+static const XMVECTORF32 g_NegFltMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+static const XMVECTORF32 g_LaneOffsets = { 0.0f, 1.0f, 2.0f, 3.0f };
+
 void ParticleSystem::AdvanceParticles(float dt, const XMFLOAT3& wind, const XMFLOAT3& gravity,
-                                      Particle* particles, UINT count, AxisAlignedBox* outBounds)
+                                      ParticleArrays* particles, UINT count, AxisAlignedBox* outBounds)
 {
-    XMFLOAT3 minBound = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
-    XMFLOAT3 maxBound = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    XMVECTOR dtVec = XMVectorReplicate(dt);
+    XMVECTOR windX = XMVectorReplicate(wind.x);
+    XMVECTOR windY = XMVectorReplicate(wind.y);
+    XMVECTOR windZ = XMVectorReplicate(wind.z);
+
+    XMVECTOR curveScale = XMVectorReplicate(CURVE_SAMPLE_COUNT / _lifeSpan);
+    XMVECTOR curveEnd = XMVectorReplicate((float)CURVE_SAMPLE_COUNT);
+
+    XMVECTOR countVec = XMVectorReplicate((float)count);
 
-    for (UINT i = 0; i < count; i++)
+    XMVECTOR minX = g_FltMax, minY = g_FltMax, minZ = g_FltMax;
+    XMVECTOR maxX = g_NegFltMax, maxY = g_NegFltMax, maxZ = g_NegFltMax;
+
+    // The arrays are padded so the last group can be advanced whole, the padding is only masked
+    // out of the bounds
+    for (UINT i = 0; i < count; i += 4)
     {
-        Particle* part = &particles[i];
+        XMVECTOR life = XMVectorAdd(loadParticles(&particles->Life[i]), dtVec);
+        storeParticles(&particles->Life[i], life);
+
+        // Sample the curves of each of the four particles and transpose them into one vector per
+        // component
+        XMVECTOR curvePos = XMVectorClamp(XMVectorMultiply(life, curveScale), XMVectorZero(), curveEnd);
+        XMVECTOR curveIdx = XMConvertVectorFloatToInt(curvePos, 0);
+        XMVECTOR curveFrac = XMVectorSubtract(curvePos, XMConvertVectorIntToFloat(curveIdx, 0));
+
+        UINT sampleIdx[4];
+        XMStoreInt4(sampleIdx, curveIdx);
 
-        part->Life += dt;
+        XMMATRIX colors, sizeSpeeds;
+        sampleCurve(sampleIdx[0], XMVectorSplatX(curveFrac), &colors.r[0], &sizeSpeeds.r[0]);
+        sampleCurve(sampleIdx[1], XMVectorSplatY(curveFrac), &colors.r[1], &sizeSpeeds.r[1]);
+        sampleCurve(sampleIdx[2], XMVectorSplatZ(curveFrac), &colors.r[2], &sizeSpeeds.r[2]);
+        sampleCurve(sampleIdx[3], XMVectorSplatW(curveFrac), &colors.r[3], &sizeSpeeds.r[3]);
+        colors = XMMatrixTranspose(colors);
+        sizeSpeeds = XMMatrixTranspose(sizeSpeeds);
 
-        float t = part->Life / _lifeSpan;
+        XMVECTOR scale = loadParticles(&particles->Scale[i]);
 
-        float fSizeLerp = pow(t, _sizeExponent);
-        part->PreviousRadius = part->Radius;
-        part->Radius = (fSizeLerp * _endSize + (1.0f - fSizeLerp) * _startSize) * part->Scale;
+        XMVECTOR radius = XMVectorMultiply(sizeSpeeds.r[0], scale);
+        storeParticles(&particles->PreviousRadius[i], loadParticles(&particles->Radius[i]));
+        storeParticles(&particles->Radius[i], radius);
 
-        float fSpeedLerp =  pow(t, _speedExponent);
-        float fSpeed = (fSpeedLerp * _endSpeed + (1.0f - fSpeedLerp) * _startSpeed) * part->Scale * part->SpeedPerc;
-        part->PreviousPosition = part->Position;
-        part->Position.x += ((part->Velocity.x * fSpeed) + wind.x) * dt;
-        part->Position.y += ((part->Velocity.y * fSpeed) + wind.y) * dt;
-        part->Position.z += ((part->Velocity.z * fSpeed) + wind.z) * dt;
+        XMVECTOR speed = XMVectorMultiply(XMVectorMultiply(sizeSpeeds.r[1], scale),
+            loadParticles(&particles->SpeedPerc[i]));
 
-        part->PreviousRotation = part->Rotation;
-        part->Rotation += part->RotationRate * dt;
+        XMVECTOR posX = loadParticles(&particles->PositionX[i]);
+        XMVECTOR posY = loadParticles(&particles->PositionY[i]);
+        XMVECTOR posZ = loadParticles(&particles->PositionZ[i]);
+        storeParticles(&particles->PreviousPositionX[i], posX);
+        storeParticles(&particles->PreviousPositionY[i], posY);
+        storeParticles(&particles->PreviousPositionZ[i], posZ);
 
-        float fFadeLerp = pow(t, _fadeExponent);
-        part->Color.x = fFadeLerp * _finalColor.x + (1.0f - fFadeLerp) * _initialColor.x;
-        part->Color.y = fFadeLerp * _finalColor.y + (1.0f - fFadeLerp) * _initialColor.y;
-        part->Color.z = fFadeLerp * _finalColor.z + (1.0f - fFadeLerp) * _initialColor.z;
-        part->Color.w = (1.0f - powf(2 * fFadeLerp - 1.0f, _alphaPower)) *
-            (fFadeLerp * _finalColor.w + (1.0f - fFadeLerp) * _initialColor.w);
+        posX = XMVectorMultiplyAdd(XMVectorMultiplyAdd(loadParticles(&particles->VelocityX[i]), speed, windX), dtVec, posX);
+        posY = XMVectorMultiplyAdd(XMVectorMultiplyAdd(loadParticles(&particles->VelocityY[i]), speed, windY), dtVec, posY);
+        posZ = XMVectorMultiplyAdd(XMVectorMultiplyAdd(loadParticles(&particles->VelocityZ[i]), speed, windZ), dtVec, posZ);
+        storeParticles(&particles->PositionX[i], posX);
+        storeParticles(&particles->PositionY[i], posY);
+        storeParticles(&particles->PositionZ[i], posZ);
 
-        minBound.x = min(minBound.x, part->Position.x - part->Radius);
-        minBound.y = min(minBound.y, part->Position.y - part->Radius);
-        minBound.z = min(minBound.z, part->Position.z - part->Radius);
+        XMVECTOR rotation = loadParticles(&particles->Rotation[i]);
+        storeParticles(&particles->PreviousRotation[i], rotation);
+        storeParticles(&particles->Rotation[i],
+            XMVectorMultiplyAdd(loadParticles(&particles->RotationRate[i]), dtVec, rotation));
 
-        maxBound.x = max(maxBound.x, part->Position.x + part->Radius);
-        maxBound.y = max(maxBound.y, part->Position.y + part->Radius);
-        maxBound.z = max(maxBound.z, part->Position.z + part->Radius);
+        storeParticles(&particles->ColorR[i], colors.r[0]);
+        storeParticles(&particles->ColorG[i], colors.r[1]);
+        storeParticles(&particles->ColorB[i], colors.r[2]);
+        storeParticles(&particles->ColorA[i], colors.r[3]);
+
+        XMVECTOR valid = XMVectorLess(XMVectorAdd(XMVectorReplicate((float)i), g_LaneOffsets), countVec);
+
+        minX = XMVectorMin(minX, XMVectorSelect(g_FltMax, XMVectorSubtract(posX, radius), valid));
+        minY = XMVectorMin(minY, XMVectorSelect(g_FltMax, XMVectorSubtract(posY, radius), valid));
+        minZ = XMVectorMin(minZ, XMVectorSelect(g_FltMax, XMVectorSubtract(posZ, radius), valid));
+
+        maxX = XMVectorMax(maxX, XMVectorSelect(g_NegFltMax, XMVectorAdd(posX, radius), valid));
+        maxY = XMVectorMax(maxY, XMVectorSelect(g_NegFltMax, XMVectorAdd(posY, radius), valid));
+        maxZ = XMVectorMax(maxZ, XMVectorSelect(g_NegFltMax, XMVectorAdd(posZ, radius), valid));
     }
 
+    XMFLOAT3 minBound = XMFLOAT3(horizontalMin(minX), horizontalMin(minY), horizontalMin(minZ));
+    XMFLOAT3 maxBound = XMFLOAT3(horizontalMax(maxX), horizontalMax(maxY), horizontalMax(maxZ));
+
     outBounds->Center.x = (maxBound.x + minBound.x) * 0.5f;
     outBounds->Center.y = (maxBound.y + minBound.y) * 0.5f;
     outBounds->Center.z = (maxBound.z + minBound.z) * 0.5f;
@@ -172,6 +323,103 @@ HRESULT readWStringFromXML(TiXmlElement* root, const std::string& name, std::wst
     return S_OK;
 }
 
+struct CURVE_KEY
+{
+    float Time;
+    XMFLOAT4 Value;
+};
+
+// Reads a curve of the form <name><key time="0.5">x y ...</key>...</name>, the times are fractions
+// of the life of a particle and must not decrease from one key to the next
+HRESULT readCurveFromXML(TiXmlElement* root, const std::string& name, UINT components,
+                         std::vector<CURVE_KEY>& out)
+{
+    TiXmlElement* element = root->FirstChildElement(name.c_str());
+    if (!element)
+    {
+        return E_FAIL;
+    }
+
+    out.clear();
+
+    TiXmlElement* child = element->FirstChildElement("key");
+    while (child)
+    {
+        CURVE_KEY key;
+        key.Value = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+        if (child->QueryFloatAttribute("time", &key.Time) != TIXML_SUCCESS || !child->GetText())
+        {
+            return E_FAIL;
+        }
+        if (key.Time < 0.0f || key.Time > 1.0f || (out.size() > 0 && key.Time < out.back().Time))
+        {
+            return E_FAIL;
+        }
+
+        int result = sscanf_s(child->GetText(), "%f %f %f %f", &key.Value.x, &key.Value.y, &key.Value.z,
+            &key.Value.w);
+        if (result != (int)components)
+        {
+            return E_FAIL;
+        }
+
+        out.push_back(key);
+
+        child = child->NextSiblingElement("key");
+    }
+
+    return (out.size() > 0) ? S_OK : E_FAIL;
+}
+
+// Builds the keys of the older start, end and exponent form of a curve, one key per sample of the
+// baked table so baking them is exact
+static void buildExponentCurve(const XMFLOAT4& start, const XMFLOAT4& end, float exponent, UINT keyCount,
+                               std::vector<CURVE_KEY>& out)
+{
+    out.resize(keyCount);
+    for (UINT i = 0; i < keyCount; i++)
+    {
+        float t = i / (float)(keyCount - 1);
+        float lerp = pow(t, exponent);
+
+        out[i].Time = t;
+        out[i].Value = XMFLOAT4(
+            lerp * end.x + (1.0f - lerp) * start.x,
+            lerp * end.y + (1.0f - lerp) * start.y,
+            lerp * end.z + (1.0f - lerp) * start.z,
+            lerp * end.w + (1.0f - lerp) * start.w);
+    }
+}
+
+static XMFLOAT4 evaluateCurve(const std::vector<CURVE_KEY>& keys, float t)
+{
+    if (t <= keys.front().Time)
+    {
+        return keys.front().Value;
+    }
+    if (t >= keys.back().Time)
+    {
+        return keys.back().Value;
+    }
+
+    UINT next = 1;
+    while (keys[next].Time <= t)
+    {
+        next++;
+    }
+
+    const CURVE_KEY& a = keys[next - 1];
+    const CURVE_KEY& b = keys[next];
+    float lerp = (t - a.Time) / (b.Time - a.Time);
+
+    return XMFLOAT4(
+        a.Value.x + (b.Value.x - a.Value.x) * lerp,
+        a.Value.y + (b.Value.y - a.Value.y) * lerp,
+        a.Value.z + (b.Value.z - a.Value.z) * lerp,
+        a.Value.w + (b.Value.w - a.Value.w) * lerp);
+}
+
 HRESULT ParticleSystem::Compile(ID3D11Device* device, const std::wstring& path,
                                 std::ostream& output)
 {
@@ -229,40 +477,51 @@ HRESULT ParticleSystem::Compile(ID3D11Device* device, const std::wstring& path,
         return E_FAIL;
     }
 
-    float startSize;
-    if (FAILED(readFloatFromXML(root, "startSize", startSize)))
-    {
-        return E_FAIL;
-    }
+    // Each curve is either a list of keys or the older start and end values with an exponent
+    const UINT keyCount = CURVE_SAMPLE_COUNT + 1;
 
-    float endSize;
-    if (FAILED(readFloatFromXML(root, "endSize", endSize)))
+    std::vector<CURVE_KEY> sizeKeys;
+    if (root->FirstChildElement("sizeCurve"))
     {
-        return E_FAIL;
+        if (FAILED(readCurveFromXML(root, "sizeCurve", 1, sizeKeys)))
+        {
+            return E_FAIL;
+        }
     }
-
-    float sizeExponent;
-    if (FAILED(readFloatFromXML(root, "sizeExponent", sizeExponent)))
+    else
     {
-        return E_FAIL;
-    }
+        float startSize, endSize, sizeExponent;
+        if (FAILED(readFloatFromXML(root, "startSize", startSize)) ||
+            FAILED(readFloatFromXML(root, "endSize", endSize)) ||
+            FAILED(readFloatFromXML(root, "sizeExponent", sizeExponent)))
+        {
+            return E_FAIL;
+        }
 
-    float startSpeed;
-    if (FAILED(readFloatFromXML(root, "startSpeed", startSpeed)))
-    {
-        return E_FAIL;
+        buildExponentCurve(XMFLOAT4(startSize, 0.0f, 0.0f, 0.0f), XMFLOAT4(endSize, 0.0f, 0.0f, 0.0f),
+            sizeExponent, keyCount, sizeKeys);
     }
 
-    float endSpeed;
-    if (FAILED(readFloatFromXML(root, "endSpeed", endSpeed)))
+    std::vector<CURVE_KEY> speedKeys;
+    if (root->FirstChildElement("speedCurve"))
     {
-        return E_FAIL;
+        if (FAILED(readCurveFromXML(root, "speedCurve", 1, speedKeys)))
+        {
+            return E_FAIL;
+        }
     }
-
-    float speedExponent;
-    if (FAILED(readFloatFromXML(root, "speedExponent", speedExponent)))
+    else
     {
-        return E_FAIL;
+        float startSpeed, endSpeed, speedExponent;
+        if (FAILED(readFloatFromXML(root, "startSpeed", startSpeed)) ||
+            FAILED(readFloatFromXML(root, "endSpeed", endSpeed)) ||
+            FAILED(readFloatFromXML(root, "speedExponent", speedExponent)))
+        {
+            return E_FAIL;
+        }
+
+        buildExponentCurve(XMFLOAT4(startSpeed, 0.0f, 0.0f, 0.0f), XMFLOAT4(endSpeed, 0.0f, 0.0f, 0.0f),
+            speedExponent, keyCount, speedKeys);
     }
 
     float speedVariance;
@@ -295,30 +554,66 @@ HRESULT ParticleSystem::Compile(ID3D11Device* device, const std::wstring& path,
         return E_FAIL;
     }
 
-    XMFLOAT4 initialColor;
-    if (FAILED(readFloat4FromXML(root, "initialColor", initialColor)))
+    std::vector<CURVE_KEY> colorKeys;
+    std::vector<CURVE_KEY> alphaKeys;
+    bool hasColorCurve = root->FirstChildElement("colorCurve") != NULL;
+    bool hasAlphaCurve = root->FirstChildElement("alphaCurve") != NULL;
+    if (hasColorCurve && FAILED(readCurveFromXML(root, "colorCurve", 3, colorKeys)))
     {
         return E_FAIL;
     }
-
-    XMFLOAT4 finalColor;
-    if (FAILED(readFloat4FromXML(root, "finalColor", finalColor)))
+    if (hasAlphaCurve && FAILED(readCurveFromXML(root, "alphaCurve", 1, alphaKeys)))
     {
         return E_FAIL;
     }
-
-    float fadeExponent;
-    if (FAILED(readFloatFromXML(root, "fadeExponent", fadeExponent)))
+    if (!hasColorCurve || !hasAlphaCurve)
     {
-        return E_FAIL;
+        XMFLOAT4 initialColor, finalColor;
+        float fadeExponent;
+        if (FAILED(readFloat4FromXML(root, "initialColor", initialColor)) ||
+            FAILED(readFloat4FromXML(root, "finalColor", finalColor)) ||
+            FAILED(readFloatFromXML(root, "fadeExponent", fadeExponent)))
+        {
+            return E_FAIL;
+        }
+
+        if (!hasColorCurve)
+        {
+            buildExponentCurve(initialColor, finalColor, fadeExponent, keyCount, colorKeys);
+        }
+
+        if (!hasAlphaCurve)
+        {
+            float alphaPower;
+            if (FAILED(readFloatFromXML(root, "alphaPower", alphaPower)))
+            {
+                return E_FAIL;
+            }
+
+            buildExponentCurve(XMFLOAT4(initialColor.w, 0.0f, 0.0f, 0.0f),
+                XMFLOAT4(finalColor.w, 0.0f, 0.0f, 0.0f), fadeExponent, keyCount, alphaKeys);
+
+            // The alpha also fades in and out over the life of the particle
+            for (UINT i = 0; i < keyCount; i++)
+            {
+                float fadeLerp = pow(alphaKeys[i].Time, fadeExponent);
+                alphaKeys[i].Value.x *= 1.0f - powf(2 * fadeLerp - 1.0f, alphaPower);
+            }
+        }
     }
 
-    float alphaPower;
-    if (FAILED(readFloatFromXML(root, "alphaPower", alphaPower)))
+    CURVE_SAMPLE curve[CURVE_SAMPLE_COUNT + 1];
+    for (UINT i = 0; i < keyCount; i++)
     {
-        return E_FAIL;
+        float t = i / (float)CURVE_SAMPLE_COUNT;
+
+        XMFLOAT4 color = evaluateCurve(colorKeys, t);
+        curve[i].Color = XMFLOAT4(color.x, color.y, color.z, evaluateCurve(alphaKeys, t).x);
+        curve[i].SizeSpeed = XMFLOAT4(evaluateCurve(sizeKeys, t).x, evaluateCurve(speedKeys, t).x, 0.0f, 0.0f);
     }
 
+    WriteDataTostream(COMPILED_MAGIC, output);
+    WriteDataTostream(COMPILED_VERSION, output);
     WriteWStringToStream(name, output);
     if (FAILED(WriteFileAndSizeToStream(diffPath, output)))
     {
@@ -332,21 +627,13 @@ HRESULT ParticleSystem::Compile(ID3D11Device* device, const std::wstring& path,
     WriteDataTostream(positionVariance, output);
     WriteDataTostream(spawnRate, output);
     WriteDataTostream(lifeSpan, output);
-    WriteDataTostream(startSize, output);
-    WriteDataTostream(endSize, output);
-    WriteDataTostream(sizeExponent, output);
-    WriteDataTostream(startSpeed, output);
-    WriteDataTostream(endSpeed, output);
-    WriteDataTostream(speedExponent, output);
     WriteDataTostream(speedVariance, output);
     WriteDataTostream(rollAmount, output);
     WriteDataTostream(windFalloff, output);
     WriteDataTostream(direction, output);
     WriteDataTostream(directionVariance, output);
-    WriteDataTostream(initialColor, output);
-    WriteDataTostream(finalColor, output);
-    WriteDataTostream(fadeExponent, output);
-    WriteDataTostream(alphaPower, output);
+    WriteDataTostream(keyCount, output);
+    WriteDataArrayTostream(curve, keyCount, output);
 
     return S_OK;
 }
@@ -354,6 +641,16 @@ HRESULT ParticleSystem::Compile(ID3D11Device* device, const std::wstring& path,
 HRESULT ParticleSystem::Create(ID3D11Device* device, std::istream& input,
                                ParticleSystem** output)
 {
+    // Files without the current version were compiled with an older layout
+    UINT magic = 0;
+    UINT version = 0;
+    ReadDataFromStream(magic, input);
+    ReadDataFromStream(version, input);
+    if (!input.good() || magic != COMPILED_MAGIC || version != COMPILED_VERSION)
+    {
+        return CONTENT_REVISION_MISMATCH;
+    }
+
     ParticleSystem* system = new ParticleSystem();
 
     system->_name = ReadWStringFromStream(input);
@@ -392,21 +689,23 @@ HRESULT ParticleSystem::Create(ID3D11Device* device, std::istream& input,
     ReadDataFromStream(system->_positionVariance, input);
     ReadDataFromStream(system->_spawnRate, input);
     ReadDataFromStream(system->_lifeSpan, input);
-    ReadDataFromStream(system->_startSize, input);
-    ReadDataFromStream(system->_endSize, input);
-    ReadDataFromStream(system->_sizeExponent, input);
-    ReadDataFromStream(system->_startSpeed, input);
-    ReadDataFromStream(system->_endSpeed, input);
-    ReadDataFromStream(system->_speedExponent, input);
     ReadDataFromStream(system->_speedVariance, input);
     ReadDataFromStream(system->_rollAmount, input);
     ReadDataFromStream(system->_windFalloff, input);
     ReadDataFromStream(system->_direction, input);
     ReadDataFromStream(system->_directionVariance, input);
-    ReadDataFromStream(system->_initialColor, input);
-    ReadDataFromStream(system->_finalColor, input);
-    ReadDataFromStream(system->_fadeExponent, input);
-    ReadDataFromStream(system->_alphaPower, input);
+
+    // Files compiled with a different table size have to be compiled again
+    UINT sampleCount;
+    ReadDataFromStream(sampleCount, input);
+    if (sampleCount != CURVE_SAMPLE_COUNT + 1)
+    {
+        system->Destroy();
+        delete system;
+        return CONTENT_REVISION_MISMATCH;
+    }
+    ReadDataArrayFromStream(system->_curve, sampleCount, input);
+    system->_curve[CURVE_SAMPLE_COUNT + 1] = system->_curve[CURVE_SAMPLE_COUNT];
 
     *output = system;
     return S_OK;
@@ -3,6 +3,7 @@
 #include "PCH.h"
 #include "ContentType.h"
 #include "Particle.h"
+#include "RandomStream.h"
 #include "xnaCollision.h"
 
 class ParticleSystem : public ContentType
@@ -19,13 +20,6 @@ private:
     float _spawnRate;
     float _lifeSpan;
 
-    float _startSize;
-    float _endSize;
-    float _sizeExponent;
-
-    float _startSpeed;
-    float _endSpeed;
-    float _speedExponent;
     float _speedVariance;
 
     float _rollAmount;
@@ -34,10 +28,23 @@ private:
     XMFLOAT3 _direction;
     XMFLOAT3 _directionVariance;
 
-    XMFLOAT4 _initialColor;
-    XMFLOAT4 _finalColor;
-    float _fadeExponent;
-    float _alphaPower;
+    // The color, alpha, size and speed curves sampled over the life of a particle. The table is
+    // baked from the keys in the particle file when it is compiled and read back as is, the last
+    // sample is repeated so the sample after any index is always valid.
+    struct CURVE_SAMPLE
+    {
+        XMFLOAT4 Color;
+        XMFLOAT4 SizeSpeed;
+    };
+    static const UINT CURVE_SAMPLE_COUNT = 256;
+    CURVE_SAMPLE _curve[CURVE_SAMPLE_COUNT + 2];
+
+    // Compiled files start with these, the version is raised whenever their layout changes so
+    // that files compiled before are compiled again
+    static const UINT COMPILED_MAGIC = 0x53595350;
+    static const UINT COMPILED_VERSION = 2;
+
+    void sampleCurve(UINT idx, FXMVECTOR t, XMVECTOR* color, XMVECTOR* sizeSpeed) const;
 
 public:
     ParticleSystem();
@@ -52,12 +59,15 @@ public:
 
     UINT GetMaxSimultaneousParticles() const { return (UINT)(_lifeSpan / _spawnRate);  }
     float GetSpawnRate() const { return _spawnRate; }
+    float GetLifeSpan() const { return _lifeSpan; }
 
     ID3D11ShaderResourceView* GetDiffuseSRV();
     ID3D11ShaderResourceView* GetNormalSRV();
 
-    void SpawnParticle(const XMFLOAT3& emitterPos, const XMFLOAT4& emitterRot, float emitterScale,
-        Particle* outParticle);
+    // Spawns count particles into the range starting at firstIdx, all random values come from
+    // the given stream so the results only depend on its seed
+    void SpawnParticles(const XMFLOAT3& emitterPos, const XMFLOAT4& emitterRot, float emitterScale,
+        RandomStream* random, ParticleArrays* particles, UINT firstIdx, UINT count);
     void AdvanceParticles(float dt, const XMFLOAT3& wind, const XMFLOAT3& gravity,
-        Particle* particles, UINT count, AxisAlignedBox* outBounds);
+        ParticleArrays* particles, UINT count, AxisAlignedBox* outBounds);
 };
\ No newline at end of file
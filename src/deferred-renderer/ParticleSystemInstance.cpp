@@ -1,13 +1,27 @@
 #include "PCH.h"
 #include "ParticleSystemInstance.h"
 #include "ParticleSystemLoader.h"
+#include "Logger.h"
 
 ParticleSystemInstance::ParticleSystemInstance(const WCHAR* path)
-    : _path(path), _system(NULL), _vb(NULL), _position(0.0f, 0.0f, 0.0f), _scale(1.0f),
-    _orientation(0.0f, 0.0f, 0.0f, 1.0f), _worldDirty(true), _particles(NULL), _particleSortSpace(NULL),
-    _particleCount(0), _particleIndex(0), _rolledOver(false), _spawnTimer(0), _vertexStride(0),
+    : _path(path), _system(NULL), _position(0.0f, 0.0f, 0.0f), _scale(1.0f),
+    _orientation(0.0f, 0.0f, 0.0f, 1.0f), _worldDirty(true), _particleData(NULL), _particleSortSpace(NULL),
+    _particleSortScratch(NULL), _sortedCount(0),
+    _stagingVertices(NULL), _stagedCount(0), _publishedVertices(NULL), _publishedCount(0),
+    _particleCount(0), _particleIndex(0), _rolledOver(false), _spawnScale(1.0f), _activeCount(0), _spawnTimer(0),
     _selectRadius(1.5f)
 {
+    ZeroMemory(&_particles, sizeof(ParticleArrays));
+
+    // Seeded in creation order so a scene spawns the same particles every run
+    static UINT nextSeed = 1;
+    SetRandomSeed(nextSeed++);
+}
+
+void ParticleSystemInstance::SetRandomSeed(UINT seed)
+{
+    _randomSeed = seed;
+    _random.Seed(seed);
 }
 
 void ParticleSystemInstance::clean()
@@ -26,6 +40,54 @@ void ParticleSystemInstance::clean()
     XMStoreFloat4x4(&_world, world);
 }
 
+HRESULT ParticleSystemInstance::allocateParticles(UINT count)
+{
+    // Pad each array to a whole number of vectors, the padding is advanced along with the
+    // particles so it is cleared to keep it finite
+    UINT capacity = (count + 3) & ~3;
+
+    _particleData = (float*)_aligned_malloc(PARTICLE_ARRAY_COUNT * capacity * sizeof(float), 16);
+    if (!_particleData)
+    {
+        return E_OUTOFMEMORY;
+    }
+    ZeroMemory(_particleData, PARTICLE_ARRAY_COUNT * capacity * sizeof(float));
+
+    float** arrays = (float**)&_particles;
+    for (UINT i = 0; i < PARTICLE_ARRAY_COUNT; i++)
+    {
+        arrays[i] = _particleData + (i * capacity);
+    }
+
+    return S_OK;
+}
+
+void ParticleSystemInstance::freeParticles()
+{
+    if (_particleData)
+    {
+        _aligned_free(_particleData);
+        _particleData = NULL;
+    }
+    ZeroMemory(&_particles, sizeof(ParticleArrays));
+}
+
+void ParticleSystemInstance::freeVertices()
+{
+    if (_stagingVertices)
+    {
+        _aligned_free(_stagingVertices);
+        _stagingVertices = NULL;
+    }
+    if (_publishedVertices)
+    {
+        _aligned_free(_publishedVertices);
+        _publishedVertices = NULL;
+    }
+    _stagedCount = 0;
+    _publishedCount = 0;
+}
+
 const XMFLOAT3& ParticleSystemInstance::GetPosition() const
 {
     return _position;
@@ -71,12 +133,39 @@ void ParticleSystemInstance::SetOrientation(const XMFLOAT4& orientation)
 
 UINT ParticleSystemInstance::GetParticleCount() const
 {
-    return (_rolledOver) ? _particleCount : _particleIndex;
+    return (_rolledOver) ? _activeCount : _particleIndex;
 }
 
-Particle* ParticleSystemInstance::GetParticles()
+void ParticleSystemInstance::SetSpawnScale(float scale)
 {
-    return _particles;
+    _spawnScale = max(scale, 0.001f);
+    if (_particleCount == 0)
+    {
+        return;
+    }
+
+    UINT activeCount = min(max((UINT)ceilf(_particleCount * _spawnScale), 1U), _particleCount);
+    if (activeCount < _activeCount)
+    {
+        // Drop the particles past the end of the smaller ring
+        if (_particleIndex >= activeCount)
+        {
+            _particleIndex = 0;
+            _rolledOver = true;
+        }
+    }
+    else if (activeCount > _activeCount && _rolledOver)
+    {
+        // Spawn into the new slots before overwriting live particles again
+        _particleIndex = _activeCount;
+        _rolledOver = false;
+    }
+    _activeCount = activeCount;
+}
+
+ParticleArrays* ParticleSystemInstance::GetParticles()
+{
+    return &_particles;
 }
 
 ParticleSystem* ParticleSystemInstance::GetParticleSystem()
@@ -87,13 +176,17 @@ ParticleSystem* ParticleSystemInstance::GetParticleSystem()
 void ParticleSystemInstance::Reset()
 {
     _particleIndex = 0;
+    _sortedCount = 0;
+    _stagedCount = 0;
+    _publishedCount = 0;
     _spawnTimer = 0.0f;
     _rolledOver = false;
+    _random.Seed(_randomSeed);
 }
 
 void ParticleSystemInstance::FillBoundingObjectSet( BoundingObjectSet* set )
 {
-    set->AddAxisAlignedBox(_aabb);
+    set->AddAxisAlignedBox(_publishedAABB);
 }
 
 bool ParticleSystemInstance::RayIntersect(const Ray& ray, float* dist)
@@ -101,120 +194,250 @@ bool ParticleSystemInstance::RayIntersect(const Ray& ray, float* dist)
     XMVECTOR rayOrigin = XMLoadFloat3(&ray.Origin);
     XMVECTOR rayDir = XMLoadFloat3(&ray.Direction);
 
-    return !Collision::IntersectPointAxisAlignedBox(rayOrigin, &_aabb) &&
-        Collision::IntersectRayAxisAlignedBox(rayOrigin, rayDir, &_aabb, dist);
+    return !Collision::IntersectPointAxisAlignedBox(rayOrigin, &_publishedAABB) &&
+        Collision::IntersectRayAxisAlignedBox(rayOrigin, rayDir, &_publishedAABB, dist);
 }
 
 void ParticleSystemInstance::AdvanceSystem(const XMFLOAT3& wind, const XMFLOAT3& gravity, float dt)
 {
+    if (_activeCount == 0)
+    {
+        return;
+    }
+
     _spawnTimer -= dt;
 
-    // Spawn new particles
-    while (_spawnTimer < 0.0f)
+    // Count the particles due this step and spawn them together
+    UINT spawnCount = 0;
+    if (_spawnTimer < 0.0f)
     {
-        _system->SpawnParticle(_position, _orientation, _scale, &_particles[_particleIndex]);
+        float spawnInterval = _system->GetSpawnRate() / _spawnScale;
 
-        _particleIndex = (_particleIndex + 1) % _particleCount;
-        if (!_rolledOver && _particleIndex == 0)
+        spawnCount = (UINT)ceilf(-_spawnTimer / spawnInterval);
+        _spawnTimer += spawnCount * spawnInterval;
+        while (_spawnTimer < 0.0f)
         {
+            spawnCount++;
+            _spawnTimer += spawnInterval;
+        }
+    }
+
+    // Only the last lap of the ring would survive
+    if (spawnCount > _activeCount)
+    {
+        _particleIndex = (_particleIndex + spawnCount - _activeCount) % _activeCount;
+        _rolledOver = true;
+        spawnCount = _activeCount;
+    }
+
+    // Spawn new particles, split where the ring wraps around
+    while (spawnCount > 0)
+    {
+        UINT batchCount = min(spawnCount, _activeCount - _particleIndex);
+        _system->SpawnParticles(_position, _orientation, _scale, &_random, &_particles, _particleIndex, batchCount);
+
+        _particleIndex += batchCount;
+        if (_particleIndex == _activeCount)
+        {
+            _particleIndex = 0;
             _rolledOver = true;
         }
 
-        _spawnTimer += _system->GetSpawnRate();
+        spawnCount -= batchCount;
+    }
+
+    _system->AdvanceParticles(dt, wind, gravity, &_particles, GetParticleCount(), &_aabb);
+}
+
+static inline UINT depthToSortKey(float depth)
+{
+    // Flip the float so that its bits compare as unsigned integers, then invert them so the
+    // farthest particles come first
+    UINT bits = *(UINT*)&depth;
+    UINT ascending = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    return ~ascending;
+}
+
+bool ParticleSystemInstance::coherentSort(UINT count)
+{
+    UINT maxShifts = count * COHERENT_SORT_SHIFTS_PER_PARTICLE;
+    UINT shifts = 0;
+
+    for (UINT i = 1; i < count; i++)
+    {
+        PARTICLE_SORT_INFO part = _particleSortSpace[i];
+
+        UINT j = i;
+        while (j > 0 && _particleSortSpace[j - 1].Key > part.Key)
+        {
+            _particleSortSpace[j] = _particleSortSpace[j - 1];
+            j--;
+        }
+        _particleSortSpace[j] = part;
+
+        // Too far out of order, the partly sorted array is still a valid input for the radix sort
+        shifts += i - j;
+        if (shifts > maxShifts)
+        {
+            return false;
+        }
     }
 
-    _system->AdvanceParticles(dt, wind, gravity, _particles, GetParticleCount(), &_aabb);
+    return true;
 }
 
-void ParticleSystemInstance::DepthSort(PARTICLE_SORT_INFO* parts, int low, int high)
+void ParticleSystemInstance::radixSort(UINT count)
 {
-    //  low is the lower index, high is the upper index
-    //  of the region of array a that is to be sorted
-    int i = low, j = high;
-    float h;
-    int index;
-    float x = parts[(low + high) / 2].Depth;
+    UINT histograms[RADIX_PASSES][RADIX_SIZE];
+    ZeroMemory(histograms, sizeof(histograms));
 
-    //  partition
-    do
+    // Count every digit in one read of the keys
+    for (UINT i = 0; i < count; i++)
     {
-        while (parts[i].Depth > x)
+        UINT key = _particleSortSpace[i].Key;
+        for (UINT pass = 0; pass < RADIX_PASSES; pass++)
         {
-            i++;
+            histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
         }
-        while (parts[j].Depth < x)
+    }
+
+    for (UINT pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        UINT shift = pass * RADIX_BITS;
+        UINT* histogram = histograms[pass];
+
+        // Every key has the same digit, usually the high bits of nearby particles
+        if (histogram[(_particleSortSpace[0].Key >> shift) & (RADIX_SIZE - 1)] == count)
         {
-            j--;
+            continue;
         }
 
-        if (i <= j)
+        UINT offset = 0;
+        for (UINT i = 0; i < RADIX_SIZE; i++)
         {
-            h = parts[i].Depth; parts[i].Depth = parts[j].Depth; parts[j].Depth = h;
-            index = parts[i].Particle; parts[i].Particle = parts[j].Particle; parts[j].Particle = index;
+            UINT digitCount = histogram[i];
+            histogram[i] = offset;
+            offset += digitCount;
+        }
 
-            i++;
-            j--;
+        for (UINT i = 0; i < count; i++)
+        {
+            const PARTICLE_SORT_INFO& part = _particleSortSpace[i];
+            _particleSortScratch[histogram[(part.Key >> shift) & (RADIX_SIZE - 1)]++] = part;
         }
-    } while (i <= j);
 
-    //  recursion
-    if (low < j)
-    {
-        DepthSort(parts, low, j);
+        PARTICLE_SORT_INFO* temp = _particleSortSpace;
+        _particleSortSpace = _particleSortScratch;
+        _particleSortScratch = temp;
     }
-    if (i < high)
+}
+
+void ParticleSystemInstance::writeSortedVertices(UINT count)
+{
+    for (UINT i = 0; i < count; i++)
     {
-        DepthSort(parts, i, high);
+        UINT idx = _particleSortSpace[i].Particle;
+
+        ParticleVertex* vertex = &_stagingVertices[i];
+        vertex->Position = XMFLOAT3(_particles.PositionX[idx], _particles.PositionY[idx], _particles.PositionZ[idx]);
+
+        XMStoreUByteN4(&vertex->Color, XMVectorSet(_particles.ColorR[idx], _particles.ColorG[idx],
+            _particles.ColorB[idx], _particles.ColorA[idx]));
+
+        XMStoreHalf4(&vertex->PreviousOffset, XMVectorSet(
+            _particles.PreviousPositionX[idx] - _particles.PositionX[idx],
+            _particles.PreviousPositionY[idx] - _particles.PositionY[idx],
+            _particles.PreviousPositionZ[idx] - _particles.PositionZ[idx], 0.0f));
+
+        XMStoreHalf2(&vertex->Radius, XMVectorSet(_particles.Radius[idx], _particles.PreviousRadius[idx], 0.0f, 0.0f));
+
+        // Remove whole turns so the rotation stays small enough for half precision, both rotations
+        // are moved by the same amount so the difference between them is kept
+        float turns = floorf(_particles.Rotation[idx] / XM_2PI) * XM_2PI;
+        XMStoreHalf2(&vertex->Rotation, XMVectorSet(_particles.Rotation[idx] - turns,
+            _particles.PreviousRotation[idx] - turns, 0.0f, 0.0f));
     }
 }
 
-ID3D11Buffer* ParticleSystemInstance::GetParticleVertexBuffer(ID3D11DeviceContext* pd3d11DeviceContext,
-                                                              Camera* camera)
+void ParticleSystemInstance::PrepareVertices(const XMFLOAT3& cameraForward)
 {
-    HRESULT hr;
-
     UINT partCount = GetParticleCount();
 
+    BEGIN_EVENT(L"Sort");
+
+    // Keep the order of the last sort and append anything spawned since then, if the particles
+    // have been reset the old order is meaningless
+    if (_sortedCount > partCount)
+    {
+        _sortedCount = 0;
+    }
+    for (UINT i = _sortedCount; i < partCount; i++)
+    {
+        _particleSortSpace[i].Particle = i;
+    }
+
     // Prepare the particles to be sorted
-    XMFLOAT3 camForward = camera->GetForward();
     for (UINT i = 0; i < partCount; i++)
     {
-        _particleSortSpace[i].Particle = i;
+        UINT idx = _particleSortSpace[i].Particle;
 
         // Dot product
-        _particleSortSpace[i].Depth =
-            (camForward.x * _particles[i].Position.x) +
-            (camForward.y * _particles[i].Position.y) +
-            (camForward.z * _particles[i].Position.z);
+        _particleSortSpace[i].Key = depthToSortKey(
+            (cameraForward.x * _particles.PositionX[idx]) +
+            (cameraForward.y * _particles.PositionY[idx]) +
+            (cameraForward.z * _particles.PositionZ[idx]));
     }
 
     // Sort the particles
-    DepthSort(_particleSortSpace, 0, partCount - 1);
+    bool coherent = coherentSort(partCount);
+    if (!coherent)
+    {
+        radixSort(partCount);
+    }
+    _sortedCount = partCount;
 
-    // Copy particles in sorted order to the buffer
-    D3D11_MAPPED_SUBRESOURCE mappedResource;
-    V(pd3d11DeviceContext->Map(_vb, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
-    ParticleVertex* bufferData = (ParticleVertex*)mappedResource.pData;
+    END_EVENT(coherent ? L"Coherent" : L"Radix");
 
-    for (UINT i = 0; i < partCount; i++)
+    BEGIN_EVENT(L"Stage");
+    writeSortedVertices(partCount);
+    _stagedCount = partCount;
+    END_EVENT(L"");
+}
+
+static void streamVertices(ParticleVertex* dest, const ParticleVertex* src, UINT count)
+{
+    UINT size = count * sizeof(ParticleVertex);
+
+    // The staged vertices will not be read again, stream them past the cache when both sides
+    // are aligned and copy whatever is left over
+    UINT streamed = 0;
+    if ((((size_t)dest | (size_t)src) & 15) == 0)
     {
-        bufferData[i].Position =            _particles[_particleSortSpace[i].Particle].Position;
-        bufferData[i].PreviousPosition =    _particles[_particleSortSpace[i].Particle].PreviousPosition;
-        bufferData[i].Color =                _particles[_particleSortSpace[i].Particle].Color;
-        bufferData[i].Radius =                _particles[_particleSortSpace[i].Particle].Radius;
-        bufferData[i].PreviousRadius =        _particles[_particleSortSpace[i].Particle].PreviousRadius;
-        bufferData[i].Rotation =            _particles[_particleSortSpace[i].Particle].Rotation;
-        bufferData[i].PreviousRotation =    _particles[_particleSortSpace[i].Particle].PreviousRotation;
+        const float* srcFloats = (const float*)src;
+        float* destFloats = (float*)dest;
+
+        streamed = size & ~15;
+        for (UINT i = 0; i < streamed / sizeof(float); i += 4)
+        {
+            _mm_stream_ps(destFloats + i, _mm_load_ps(srcFloats + i));
+        }
+        _mm_sfence();
     }
 
-    pd3d11DeviceContext->Unmap(_vb, 0);
+    memcpy((BYTE*)dest + streamed, (const BYTE*)src + streamed, size - streamed);
+}
 
-    return _vb;
+void ParticleSystemInstance::PublishVertices()
+{
+    // The old published vertices are overwritten by the next prepare, nothing is kept in them
+    std::swap(_stagingVertices, _publishedVertices);
+    _publishedCount = _stagedCount;
+    _publishedAABB = _aabb;
 }
 
-UINT ParticleSystemInstance::GetVertexStride() const
+void ParticleSystemInstance::CopyVertices(ParticleVertex* dest) const
 {
-    return _vertexStride;
+    streamVertices(dest, _publishedVertices, _publishedCount);
 }
 
 ID3D11ShaderResourceView* ParticleSystemInstance::GetDiffuseSRV()
@@ -235,30 +458,29 @@ HRESULT ParticleSystemInstance::OnD3D11CreateDevice(ID3D11Device* pd3dDevice,
     V_RETURN(pContentManager->LoadContent(pd3dDevice, _path, (ParticleSystemOptions*)NULL, &_system));
 
     _particleCount = _system->GetMaxSimultaneousParticles();
-    _particles = new Particle[_particleCount];
+    V_RETURN(allocateParticles(_particleCount));
     _particleSortSpace = new PARTICLE_SORT_INFO[_particleCount];
-    if (!_particles || !_particleSortSpace)
+    _particleSortScratch = new PARTICLE_SORT_INFO[_particleCount];
+    _stagingVertices = (ParticleVertex*)_aligned_malloc(_particleCount * sizeof(ParticleVertex), 16);
+    _publishedVertices = (ParticleVertex*)_aligned_malloc(_particleCount * sizeof(ParticleVertex), 16);
+    if (!_particleSortSpace || !_particleSortScratch || !_stagingVertices || !_publishedVertices)
     {
-        SAFE_DELETE_ARRAY(_particles);
+        freeParticles();
         SAFE_DELETE_ARRAY(_particleSortSpace);
+        SAFE_DELETE_ARRAY(_particleSortScratch);
+        freeVertices();
         return E_FAIL;
     }
-
-    D3D11_BUFFER_DESC vbDesc =
-    {
-        _particleCount * sizeof(ParticleVertex), // INT ByteWidth;
-        D3D11_USAGE_DYNAMIC, // D3D11_USAGE Usage;
-        D3D11_BIND_VERTEX_BUFFER, // UINT BindFlags;
-        D3D11_CPU_ACCESS_WRITE, // UINT CPUAccessFlags;
-        0, // UINT MiscFlags;
-        0, // UINT StructureByteStride;
-    };
-    V_RETURN(pd3dDevice->CreateBuffer(&vbDesc, NULL, &_vb));
-    _vertexStride = sizeof(ParticleVertex);
+    _sortedCount = 0;
+    _stagedCount = 0;
+    _publishedCount = 0;
 
     _particleIndex = 0;
     _spawnTimer = 0;
     _rolledOver = false;
+    _random.Seed(_randomSeed);
+    _activeCount = _particleCount;
+    SetSpawnScale(_spawnScale);
 
     return S_OK;
 }
@@ -266,10 +488,11 @@ HRESULT ParticleSystemInstance::OnD3D11CreateDevice(ID3D11Device* pd3dDevice,
 void ParticleSystemInstance::OnD3D11DestroyDevice(ContentManager* pContentManager)
 {
     SAFE_CM_RELEASE(pContentManager, _system);
-    SAFE_RELEASE(_vb);
 
-    SAFE_DELETE_ARRAY(_particles);
+    freeParticles();
     SAFE_DELETE_ARRAY(_particleSortSpace);
+    SAFE_DELETE_ARRAY(_particleSortScratch);
+    freeVertices();
     _particleCount = 0;
 }
 
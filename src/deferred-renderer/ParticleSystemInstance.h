@@ -5,6 +5,7 @@
 #include "IDragable.h"
 #include "ParticleSystem.h"
 #include "Particle.h"
+#include "RandomStream.h"
 #include "Camera.h"
 
 class ParticleSystemInstance : public IHasContent, public IDragable
@@ -14,9 +15,6 @@ private:
 
     ParticleSystem* _system;
 
-    ID3D11Buffer* _vb;
-    UINT _vertexStride;
-
     XMFLOAT4X4 _world;
     XMFLOAT3 _position;
     float _scale;
@@ -24,27 +22,63 @@ private:
 
     AxisAlignedBox _aabb;
 
-    Particle* _particles;
+    ParticleArrays _particles;
+    float* _particleData;
 
+    // Keys are the depths as unsigned integers that sort far to near
     struct PARTICLE_SORT_INFO
     {
         UINT Particle;
-        float Depth;
+        UINT Key;
     };
     PARTICLE_SORT_INFO* _particleSortSpace;
+    PARTICLE_SORT_INFO* _particleSortScratch;
+    UINT _sortedCount;
+
+    // Sorted and packed vertices waiting to be published
+    ParticleVertex* _stagingVertices;
+    UINT _stagedCount;
+
+    // What the renderer draws, the staging vertices and bounds of the last update are swapped in
+    // here so the next update can run while these are being copied to the vertex buffer
+    ParticleVertex* _publishedVertices;
+    UINT _publishedCount;
+    AxisAlignedBox _publishedAABB;
 
     UINT _particleCount;
     UINT _particleIndex;
     bool _rolledOver;
 
+    // Lower detail spawns less often, the ring of live particles shrinks to match so that
+    // particles are still replaced once they reach the end of their lives
+    float _spawnScale;
+    UINT _activeCount;
+
     float _spawnTimer;
 
+    // Reseeded on reset so that the instance always spawns the same particles
+    RandomStream _random;
+    UINT _randomSeed;
+
     float _selectRadius;
 
     bool _worldDirty;
     void clean();
 
-    void DepthSort(PARTICLE_SORT_INFO* parts, int low, int high);
+    HRESULT allocateParticles(UINT count);
+    void freeParticles();
+    void freeVertices();
+
+    // The order from the last frame is usually close to correct, it is insertion sorted until
+    // too many particles have moved and then radix sorted
+    static const UINT COHERENT_SORT_SHIFTS_PER_PARTICLE = 4;
+    static const UINT RADIX_BITS = 11;
+    static const UINT RADIX_SIZE = 1 << RADIX_BITS;
+    static const UINT RADIX_PASSES = (32 + RADIX_BITS - 1) / RADIX_BITS;
+
+    bool coherentSort(UINT count);
+    void radixSort(UINT count);
+    void writeSortedVertices(UINT count);
 
 public:
     ParticleSystemInstance(const WCHAR* path);
@@ -59,11 +93,22 @@ public:
     void SetOrientation(const XMFLOAT4& orientation);
 
     UINT GetParticleCount() const;
-    Particle* GetParticles();
+    UINT GetMaxParticleCount() const { return _particleCount; }
+
+    // The fraction of the system's spawn rate to spawn at, between 0 and 1
+    void SetSpawnScale(float scale);
+    float GetSpawnScale() const { return _spawnScale; }
+
+    // The bounds of the particles as simulated, which may be ahead of what is drawn
+    const AxisAlignedBox& GetAxisAlignedBox() const { return _aabb; }
+    ParticleArrays* GetParticles();
 
     ParticleSystem* GetParticleSystem();
 
     void Reset();
+
+    UINT GetRandomSeed() const { return _randomSeed; }
+    void SetRandomSeed(UINT seed);
     void AdvanceSystem(const XMFLOAT3& wind, const XMFLOAT3& gravity, float dt);
 
     void FillBoundingObjectSet(BoundingObjectSet* set);
@@ -71,8 +116,20 @@ public:
 
     ID3D11ShaderResourceView* GetDiffuseSRV();
     ID3D11ShaderResourceView* GetNormalSRV();
-    ID3D11Buffer* GetParticleVertexBuffer(ID3D11DeviceContext* pd3d11DeviceContext, Camera* camera);
-    UINT GetVertexStride() const;
+
+    // Sorts the particles and writes them into the staging vertices, this touches nothing but
+    // the instance so instances can be prepared in parallel
+    void PrepareVertices(const XMFLOAT3& cameraForward);
+
+    void ClearVertices() { _stagedCount = 0; }
+
+    // Hands the staged vertices and the current bounds over to the renderer, this must not be
+    // called while the instance is being prepared or its vertices are being copied
+    void PublishVertices();
+
+    // Copies the published vertices to mapped vertex buffer memory
+    void CopyVertices(ParticleVertex* dest) const;
+    UINT GetVertexCount() const { return _publishedCount; }
 
     HRESULT OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentManager* pContentManager,
         const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc);
@@ -0,0 +1,240 @@
+#include "PCH.h"
+#include "ParticleUpdater.h"
+#include "Logger.h"
+
+using std::tr1::mem_fn;
+using namespace std::tr1::placeholders;
+
+const float ParticleUpdater::MAX_CATCH_UP_STEP = 1.0f / 15.0f;
+
+ParticleUpdater::ParticleUpdater()
+    : _particleBudget(65536), _fullDetailScreenSize(0.25f), _lodEnabled(true), _visibleCount(0),
+      _simulatedParticleCount(0), _updatedSincePublish(false), _wind(0.0f, 0.0f, 0.0f), _gravity(0.0f, 0.0f, 0.0f),
+      _cameraForward(0.0f, 0.0f, 1.0f), _dt(0.0f)
+{
+}
+
+void ParticleUpdater::AddInstance(ParticleSystemInstance* instance)
+{
+    for (UINT i = 0; i < _instances.size(); i++)
+    {
+        if (_instances[i].Instance == instance)
+        {
+            return;
+        }
+    }
+
+    INSTANCE_INFO info;
+    info.Instance = instance;
+    info.Visible = true;
+    info.ScreenSize = 0.0f;
+    info.LODLevel = 0;
+    info.FramesUntilUpdate = 0;
+    info.PendingTime = 0.0f;
+
+    _instances.push_back(info);
+}
+
+void ParticleUpdater::RemoveInstance(ParticleSystemInstance* instance)
+{
+    for (UINT i = 0; i < _instances.size(); i++)
+    {
+        if (_instances[i].Instance == instance)
+        {
+            _instances.erase(_instances.begin() + i);
+            return;
+        }
+    }
+}
+
+void ParticleUpdater::updateVisibility(Camera* camera)
+{
+    Frustum frustum = camera->CreateFrustum();
+
+    XMFLOAT3 cameraPos = camera->GetPosition();
+    XMVECTOR position = XMLoadFloat3(&cameraPos);
+    XMVECTOR forward = XMLoadFloat3(&_cameraForward);
+
+    // Scales a radius over a view depth to the fraction of the view's height the diameter covers
+    float projScale = camera->GetProjection()._22;
+    float nearClip = camera->GetNearClip();
+
+    _jobs.clear();
+    for (UINT i = 0; i < _instances.size(); i++)
+    {
+        INSTANCE_INFO& info = _instances[i];
+        ParticleSystemInstance* instance = info.Instance;
+
+        // Nothing has been spawned so there are no bounds to cull or size with yet
+        if (instance->GetParticleCount() == 0)
+        {
+            info.Visible = true;
+            info.ScreenSize = FLT_MAX;
+        }
+        else
+        {
+            // The emitter may have been moved away from its particles while it was culled
+            const AxisAlignedBox& aabb = instance->GetAxisAlignedBox();
+            const XMFLOAT3& emitterPos = instance->GetPosition();
+            info.Visible = Collision::IntersectAxisAlignedBoxFrustum(&aabb, &frustum) != 0 ||
+                Collision::IntersectPointFrustum(XMLoadFloat3(&emitterPos), &frustum) != 0;
+
+            XMVECTOR center = XMLoadFloat3(&aabb.Center);
+            float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&aabb.Extents)));
+            float depth = max(XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, position), forward)), nearClip);
+            info.ScreenSize = (radius * projScale) / depth;
+        }
+
+        if (info.Visible)
+        {
+            _jobs.push_back(i);
+        }
+        else
+        {
+            // Keep count of the time missed so it can be caught up once visible again
+            info.PendingTime += _dt;
+            instance->ClearVertices();
+        }
+    }
+    _visibleCount = _jobs.size();
+}
+
+void ParticleUpdater::applyBudget()
+{
+    // Each level halves the size on screen an instance needs to stay at the level above it, an
+    // instance only gains detail once it is a quarter larger than it needs to be so that it does
+    // not switch back and forth on the boundary
+    UINT total = 0;
+    for (UINT i = 0; i < _jobs.size(); i++)
+    {
+        INSTANCE_INFO& info = _instances[_jobs[i]];
+
+        UINT level = 0;
+        if (_lodEnabled)
+        {
+            float levelSize = _fullDetailScreenSize;
+            while (level < MAX_LOD_LEVEL && info.ScreenSize < levelSize)
+            {
+                level++;
+                levelSize *= 0.5f;
+            }
+
+            if (level < info.LODLevel && info.ScreenSize < levelSize * 1.25f)
+            {
+                level = min(level + 1, info.LODLevel);
+            }
+        }
+        info.LODLevel = level;
+
+        total += info.Instance->GetMaxParticleCount() >> level;
+    }
+
+    // Raise the levels of the smallest instances first until everything fits
+    if (total > _particleBudget)
+    {
+        std::vector<std::pair<float, UINT> > bySize;
+        bySize.reserve(_jobs.size());
+        for (UINT i = 0; i < _jobs.size(); i++)
+        {
+            bySize.push_back(std::make_pair(_instances[_jobs[i]].ScreenSize, _jobs[i]));
+        }
+        std::sort(bySize.begin(), bySize.end());
+
+        bool raised = true;
+        while (total > _particleBudget && raised)
+        {
+            raised = false;
+            for (UINT i = 0; i < bySize.size() && total > _particleBudget; i++)
+            {
+                INSTANCE_INFO& info = _instances[bySize[i].second];
+                if (info.LODLevel < MAX_LOD_LEVEL)
+                {
+                    UINT maxCount = info.Instance->GetMaxParticleCount();
+                    total -= (maxCount >> info.LODLevel) - (maxCount >> (info.LODLevel + 1));
+                    info.LODLevel++;
+                    raised = true;
+                }
+            }
+        }
+    }
+    _simulatedParticleCount = total;
+
+    for (UINT i = 0; i < _jobs.size(); i++)
+    {
+        INSTANCE_INFO& info = _instances[_jobs[i]];
+        info.Instance->SetSpawnScale(1.0f / (1 << info.LODLevel));
+        info.FramesUntilUpdate = min(info.FramesUntilUpdate, (1U << info.LODLevel) - 1);
+    }
+}
+
+void ParticleUpdater::updateInstance(INSTANCE_INFO& info)
+{
+    ParticleSystemInstance* instance = info.Instance;
+
+    BEGIN_EVENT(instance->GetParticleSystem()->GetName().c_str());
+
+    info.PendingTime += _dt;
+    if (info.FramesUntilUpdate > 0)
+    {
+        info.FramesUntilUpdate--;
+    }
+    else
+    {
+        // Anything older than a particle's life would have been replaced already, and anything
+        // past the steps an update can take is not caught up at all
+        float time = min(info.PendingTime, instance->GetParticleSystem()->GetLifeSpan());
+        time = min(time, MAX_CATCH_UP_STEPS * MAX_CATCH_UP_STEP);
+        UINT steps = max((UINT)ceilf(time / MAX_CATCH_UP_STEP), 1U);
+        float step = time / steps;
+        for (UINT i = 0; i < steps; i++)
+        {
+            instance->AdvanceSystem(_wind, _gravity, step);
+        }
+
+        info.PendingTime = 0.0f;
+        info.FramesUntilUpdate = (1 << info.LODLevel) - 1;
+    }
+
+    instance->PrepareVertices(_cameraForward);
+
+    END_EVENT(L"");
+}
+
+void ParticleUpdater::updateInstances(UINT begin, UINT end)
+{
+    for (UINT i = begin; i < end; i++)
+    {
+        updateInstance(_instances[_jobs[i]]);
+    }
+}
+
+void ParticleUpdater::Update(ThreadPool* threadPool, Camera* camera, const XMFLOAT3& wind,
+                             const XMFLOAT3& gravity, float dt)
+{
+    _wind = wind;
+    _gravity = gravity;
+    _cameraForward = camera->GetForward();
+    _dt = dt;
+
+    updateVisibility(camera);
+    applyBudget();
+
+    // Emitters vary too much in size to batch them, one per chunk keeps the threads balanced
+    threadPool->ParallelFor(_jobs.size(), 1, bind(mem_fn(&ParticleUpdater::updateInstances), this, _1, _2));
+
+    _updatedSincePublish = true;
+}
+
+void ParticleUpdater::Publish()
+{
+    if (!_updatedSincePublish)
+    {
+        return;
+    }
+
+    for (UINT i = 0; i < _instances.size(); i++)
+    {
+        _instances[i].Instance->PublishVertices();
+    }
+    _updatedSincePublish = false;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "PCH.h"
+#include "ParticleSystemInstance.h"
+#include "ThreadPool.h"
+#include "Camera.h"
+
+// Advances particle system instances on the thread pool. Every instance is simulated, bounded,
+// sorted and written into its own staging vertices by one job, instances share nothing so the
+// jobs run in any order and the render thread is left to copy the staged vertices into the
+// vertex buffers.
+//
+// The staged vertices are only drawn once they are published, so the next update can run while
+// the renderer copies out the last published ones.
+//
+// Instances outside of the camera's frustum are neither simulated nor drawn, the time they
+// miss is simulated when they come back into view. Visible instances are given a level of
+// detail from their size on screen, each level halves the spawn rate and simulates half as
+// often. Levels are then raised from the smallest instances up until the particles of all of
+// them fit in the budget.
+class ParticleUpdater
+{
+private:
+    struct INSTANCE_INFO
+    {
+        ParticleSystemInstance* Instance;
+        bool Visible;
+        float ScreenSize;
+        UINT LODLevel;
+        UINT FramesUntilUpdate;
+        float PendingTime;
+    };
+    std::vector<INSTANCE_INFO> _instances;
+    std::vector<UINT> _jobs;
+
+    UINT _particleBudget;
+    float _fullDetailScreenSize;
+    bool _lodEnabled;
+
+    UINT _visibleCount;
+    UINT _simulatedParticleCount;
+
+    // Frames that take no simulation steps have nothing new to publish
+    bool _updatedSincePublish;
+
+    static const UINT MAX_LOD_LEVEL = 3;
+
+    // The longest single step taken when catching up, longer steps spawn particles in clumps.
+    // At most MAX_CATCH_UP_STEPS are taken in one update and any time past them is dropped, so
+    // an instance coming back into view after a stall costs a few steps instead of a life span.
+    static const UINT MAX_CATCH_UP_STEPS = 4;
+    static const float MAX_CATCH_UP_STEP;
+
+    // The parameters of the current update, only read by the jobs
+    XMFLOAT3 _wind;
+    XMFLOAT3 _gravity;
+    XMFLOAT3 _cameraForward;
+    float _dt;
+
+    void updateVisibility(Camera* camera);
+    void applyBudget();
+
+    void updateInstance(INSTANCE_INFO& info);
+    void updateInstances(UINT begin, UINT end);
+
+public:
+    ParticleUpdater();
+
+    void AddInstance(ParticleSystemInstance* instance);
+    void RemoveInstance(ParticleSystemInstance* instance);
+    UINT GetInstanceCount() const { return _instances.size(); }
+
+    // The most particles that can be live across all visible instances
+    UINT GetParticleBudget() const { return _particleBudget; }
+    void SetParticleBudget(UINT budget) { _particleBudget = budget; }
+
+    // The fraction of the view's height an instance's bounds cover at full detail
+    float GetFullDetailScreenSize() const { return _fullDetailScreenSize; }
+    void SetFullDetailScreenSize(float size) { _fullDetailScreenSize = size; }
+
+    bool GetLODEnabled() const { return _lodEnabled; }
+    void SetLODEnabled(bool enabled) { _lodEnabled = enabled; }
+
+    UINT GetVisibleInstanceCount() const { return _visibleCount; }
+    UINT GetSimulatedParticleCount() const { return _simulatedParticleCount; }
+
+    // Culls and sorts for the given camera, which must be final for the frame
+    void Update(ThreadPool* threadPool, Camera* camera, const XMFLOAT3& wind, const XMFLOAT3& gravity, float dt);
+
+    // Publishes the vertices staged by the updates since the last publish, must not be called
+    // during an update or while the instances are being drawn
+    void Publish();
+};
\ No newline at end of file
@@ -27,6 +27,10 @@ cbuffer cbShadowProperties : register(b3)
     float Bias;
     float3 Padding2;
     float4x4 ShadowMatrix;
+
+    // Scale in xy and offset in zw of each hemisphere's region in the shadow atlas
+    float4 FrontTransform;
+    float4 BackTransform;
 }
 
 Texture2D DiffuseTexture : register(t0);
@@ -176,13 +180,13 @@ float4 PS_PointLightShadowed(VS_Out_PointLight input) : SV_TARGET0
     float fSceneDepth = (fLength - CameraClips.x) / (CameraClips.y - CameraClips.x);
 
     float2 vShadowTexCoord;
+    float4 vRegionTransform;
     if(vPositionLS.z >= 0.0f)
     {
         vShadowTexCoord.x = (vPositionLS.x / (1.0f + vPositionLS.z)) * 0.5f + 0.5f; 
         vShadowTexCoord.y = 1.0f - ((vPositionLS.y / (1.0f + vPositionLS.z)) * 0.5f + 0.5f);
 
-        // Offset to the left side of the shadow map
-        vShadowTexCoord.x = vShadowTexCoord.x * 0.5f;
+        vRegionTransform = FrontTransform;
     }
     else
     {
@@ -190,10 +194,13 @@ float4 PS_PointLightShadowed(VS_Out_PointLight input) : SV_TARGET0
         vShadowTexCoord.x =  (vPositionLS.x /  (1.0f - vPositionLS.z)) * 0.5f + 0.5f;
         vShadowTexCoord.y =  1.0f - ((vPositionLS.y /  (1.0f - vPositionLS.z)) * 0.5f + 0.5f);
 
-        // Offset to the right side of the shadow map
-        vShadowTexCoord.x = vShadowTexCoord.x * 0.5f + 0.5f;
+        vRegionTransform = BackTransform;
     }
 
+    // Keep the filter taps inside the hemisphere's region so they never read a neighbour in the atlas
+    float fBorder = 3.0f / (vRegionTransform.x * ShadowMapSize.x);
+    vShadowTexCoord = clamp(vShadowTexCoord, fBorder, 1.0f - fBorder) * vRegionTransform.xy + vRegionTransform.zw;
+
     float fShadow = SampleShadow(vShadowTexCoord, fSceneDepth);
 
     return fShadow * PS_PointLightCommon(input, vPositionWS, vScreenCoord);
@@ -8,6 +8,7 @@
 #include "DeviceStates.h"
 #include "FullscreenQuad.h"
 #include "Camera.h"
+#include "FrameGraph.h"
 
 class PostProcess : public IHasContent
 {
@@ -34,6 +35,11 @@ public:
 
     bool GetIsAdditive() const { return _isAdditive; }
 
+    // Called while the frame graph is built, before the pass that renders this post process is
+    // executed. Targets that are only needed during that pass should be created here so that
+    // they can share memory with the rest of the frame.
+    virtual void DeclareTargets(FrameGraph* graph, UINT pass, const FrameGraphTargetDesc& sceneDesc) { }
+
     virtual HRESULT Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11ShaderResourceView* src,
         ID3D11RenderTargetView* dst, Camera* camera, GBuffer* gBuffer, ParticleBuffer* pBuffer,
         LightBuffer* lightBuffer) = 0;
@@ -1,10 +1,14 @@
 #include "PCH.h"
 #include "ProfilePane.h"
 
+const float ProfilePane::STATISTICS_UPDATE_INTERVAL = 0.25f;
+
 ProfilePane::ProfilePane(Gwen::Controls::Base* parent, Logger* logger)
-    : ConfigurationPane(parent, L"Profile", logger)
+    : ConfigurationPane(parent, L"Profile", logger), _statisticsUpdateTime(0.0f)
 {
-    const int treeHeight = 400;
+    const int treeHeight = 250;
+    const int statisticsHeight = 300;
+    const int labelHeight = 20;
 
     _tree = new Gwen::Controls::TreeControl(this);
     _tree->SetHeight(treeHeight);
@@ -19,12 +23,54 @@ ProfilePane::ProfilePane(Gwen::Controls::Base* parent, Logger* logger)
     _clearButton->SetText("Clear");
     _clearButton->onPress.Add(this, &ProfilePane::onClearButtonPressed);
     _clearButton->Dock(Gwen::Pos::Top);
+
+    _statisticsScroll = new Gwen::Controls::ScrollControl(this);
+    _statisticsScroll->SetScroll(false, true);
+    _statisticsScroll->SetHeight(statisticsHeight);
+    _statisticsScroll->Dock(Gwen::Pos::Top);
+
+    _statisticsControl = new EventStatisticsControl(_statisticsScroll);
+    _statisticsControl->Dock(Gwen::Pos::Top);
+
+    _resetStatisticsButton = new Gwen::Controls::Button(this);
+    _resetStatisticsButton->SetText("Reset statistics");
+    _resetStatisticsButton->onPress.Add(this, &ProfilePane::onResetStatisticsButtonPressed);
+    _resetStatisticsButton->Dock(Gwen::Pos::Top);
+
+    for (UINT i = 0; i < RenderCounter::Count; i++)
+    {
+        _counterLabels[i] = new Gwen::Controls::Label(this);
+        _counterLabels[i]->SetHeight(labelHeight);
+        _counterLabels[i]->SetAlignment(Gwen::Pos::Bottom | Gwen::Pos::Left);
+        _counterLabels[i]->Dock(Gwen::Pos::Top);
+    }
+    updateCounters();
 }
 
 void ProfilePane::onCaptureButtonPressed(Gwen::Controls::Base* button)
 {
     Logger* logger = GetConfiguredObject();
+
+    // The main thread's events are shown as they are, every other thread gets a node of its own
+    // with the time it spent in events during the frame
     buildTree(_tree, logger->GetRootEvent());
+    for (UINT i = 1; i < logger->GetLaneCount(); i++)
+    {
+        Logger::EventIterator root = logger->GetLaneRootEvent(i);
+        if (!root.IsValid())
+        {
+            continue;
+        }
+
+        float busyTime = 0.0f;
+        for (Logger::EventIterator it = root; it.IsValid(); it = it.GetNextSibling())
+        {
+            busyTime += it.GetDuration();
+        }
+
+        Gwen::UnicodeString text = Gwen::Utility::Format(L"%s (%f ms)", logger->GetLaneName(i).c_str(), busyTime * 1000.0f);
+        buildTree(_tree->AddNode(text), root);
+    }
 }
 
 void ProfilePane::onClearButtonPressed(Gwen::Controls::Base* button)
@@ -32,12 +78,29 @@ void ProfilePane::onClearButtonPressed(Gwen::Controls::Base* button)
     _tree->Clear();
 }
 
+void ProfilePane::onResetStatisticsButtonPressed(Gwen::Controls::Base* button)
+{
+    _statistics.Clear();
+    _statisticsControl->Update(&_statistics);
+}
+
+void ProfilePane::updateCounters()
+{
+    RenderStats* stats = RenderStats::GetInstance();
+    for (UINT i = 0; i < RenderCounter::Count; i++)
+    {
+        WCHAR text[64];
+        swprintf_s(text, L"%s: %u", RenderStats::GetCounterName(i), stats->GetCount(i));
+        _counterLabels[i]->SetText(text);
+    }
+}
+
 void ProfilePane::buildTree(Gwen::Controls::TreeNode* node, Logger::EventIterator it)
 {
     if (it.IsValid())
     {
         // Create this node
-        Gwen::UnicodeString text = Gwen::Utility::Format(L"%s (%f ms)", it.GetName(), it.GetDuration() * 1000.0f);
+        Gwen::UnicodeString text = Gwen::Utility::Format(L"%s (%f ms)", it.GetName().c_str(), it.GetDuration() * 1000.0f);
         Gwen::Controls::TreeNode* child = node->AddNode(text);
 
         // Create the children
@@ -56,4 +119,13 @@ void ProfilePane::buildTree(Gwen::Controls::TreeNode* node, Logger::EventIterato
 
 void ProfilePane::OnFrameMove(double totalTime, float dt)
 {
+    _statistics.RecordFrame(GetConfiguredObject());
+
+    _statisticsUpdateTime += dt;
+    if (_statisticsUpdateTime >= STATISTICS_UPDATE_INTERVAL && Visible())
+    {
+        _statisticsControl->Update(&_statistics);
+        updateCounters();
+        _statisticsUpdateTime = 0.0f;
+    }
 }
\ No newline at end of file
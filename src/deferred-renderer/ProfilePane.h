@@ -4,6 +4,10 @@
 #include "ConfigurationPane.h"
 #include "Logger.h"
 #include "Gwen/Controls/TreeControl.h"
+#include "Gwen/Controls/ScrollControl.h"
+#include "EventStatistics.h"
+#include "EventStatisticsControl.h"
+#include "RenderStats.h"
 
 class ProfilePane : public ConfigurationPane<Logger>
 {
@@ -13,9 +17,24 @@ private:
     Gwen::Controls::Button* _captureButton;
     Gwen::Controls::Button* _clearButton;
 
+    // Every frame is added to the statistics, the rows showing them are refreshed a few times a
+    // second while the pane is visible
+    EventStatistics _statistics;
+    Gwen::Controls::ScrollControl* _statisticsScroll;
+    EventStatisticsControl* _statisticsControl;
+    Gwen::Controls::Button* _resetStatisticsButton;
+    float _statisticsUpdateTime;
+
+    // The render counters of the last frame, refreshed along with the statistics
+    Gwen::Controls::Label* _counterLabels[RenderCounter::Count];
+
+    static const float STATISTICS_UPDATE_INTERVAL;
+
     virtual void onCaptureButtonPressed(Gwen::Controls::Base* button);
     virtual void onClearButtonPressed(Gwen::Controls::Base* button);
+    virtual void onResetStatisticsButtonPressed(Gwen::Controls::Base* button);
 
+    void updateCounters();
     void buildTree(Gwen::Controls::TreeNode* node, Logger::EventIterator it);
 
 public:
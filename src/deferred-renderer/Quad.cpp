@@ -1,5 +1,6 @@
 #include "PCH.h"
 #include "Quad.h"
+#include "RenderStats.h"
 
 Quad::Quad()
     : _vertexShader(NULL), _vertexBuffer(NULL)
@@ -23,6 +24,8 @@ HRESULT Quad::Render(ID3D11DeviceContext* pd3dImmediateContext, ID3D11PixelShade
     pd3dImmediateContext->VSSetShader(_vertexShader->VertexShader, NULL, 0);
     pd3dImmediateContext->PSSetShader(pixelShader, NULL, 0);
     pd3dImmediateContext->Draw(4, 0);
+    ADD_RENDER_STAT(DrawCalls, 1);
+    ADD_RENDER_STAT(Triangles, 2);
 
     return S_OK;
 }
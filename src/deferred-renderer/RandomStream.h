@@ -0,0 +1,49 @@
+#pragma once
+
+#include "PCH.h"
+
+// Four xorshift generators advanced together so that every call gives four random numbers. A
+// stream always produces the same numbers for the same seed and only touches its own state, so
+// each user owns a stream rather than sharing rand() between threads.
+class RandomStream
+{
+private:
+    // Kept as plain integers, the owner is not guaranteed to be 16 byte aligned
+    UINT _state[4];
+
+public:
+    RandomStream(UINT seed = 1)
+    {
+        Seed(seed);
+    }
+
+    void Seed(UINT seed)
+    {
+        // Scramble the seed for each lane so that nearby seeds give unrelated streams, xorshift
+        // never leaves a zero state so it is avoided
+        for (UINT i = 0; i < 4; i++)
+        {
+            UINT x = seed + (i + 1) * 0x9E3779B9;
+            x = (x ^ (x >> 16)) * 0x85EBCA6B;
+            x = (x ^ (x >> 13)) * 0xC2B2AE35;
+            x ^= x >> 16;
+
+            _state[i] = (x != 0) ? x : 0x6C078965;
+        }
+    }
+
+    // Four uniformly distributed values in [-1, 1)
+    XMVECTOR NextSigned()
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)_state);
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+        _mm_storeu_si128((__m128i*)_state, x);
+
+        // Use the high bits as the mantissa of a float in [1, 2) then move it to [-1, 1)
+        __m128i bits = _mm_or_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x3F800000));
+        XMVECTOR oneToTwo = _mm_castsi128_ps(bits);
+        return XMVectorSubtract(XMVectorAdd(oneToTwo, oneToTwo), XMVectorReplicate(3.0f));
+    }
+};
\ No newline at end of file
@@ -0,0 +1,1447 @@
+#include "PCH.h"
+#include "RecordingDeviceContext.h"
+
+// Mapped textures are given enough scratch memory for the widest format
+static const UINT MAX_TEXEL_SIZE = 16;
+
+RecordedCommandList::RecordedCommandList(ID3D11Device* device, const RecordingStats& stats,
+                                         const std::vector<std::wstring>& errors)
+    : _device(device), _refCount(1), _stats(stats), _errors(errors)
+{
+    if (_device)
+    {
+        _device->AddRef();
+    }
+}
+
+RecordedCommandList::~RecordedCommandList()
+{
+    SAFE_RELEASE(_device);
+}
+
+HRESULT STDMETHODCALLTYPE RecordedCommandList::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if (!ppvObject)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(ID3D11CommandList) ||
+        riid == __uuidof(RecordedCommandList))
+    {
+        *ppvObject = static_cast<ID3D11CommandList*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE RecordedCommandList::AddRef()
+{
+    return (ULONG)InterlockedIncrement(&_refCount);
+}
+
+ULONG STDMETHODCALLTYPE RecordedCommandList::Release()
+{
+    ULONG count = (ULONG)InterlockedDecrement(&_refCount);
+    if (count == 0)
+    {
+        delete this;
+    }
+    return count;
+}
+
+void STDMETHODCALLTYPE RecordedCommandList::GetDevice(ID3D11Device** ppDevice)
+{
+    *ppDevice = _device;
+    if (_device)
+    {
+        _device->AddRef();
+    }
+}
+
+HRESULT STDMETHODCALLTYPE RecordedCommandList::GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData)
+{
+    return DXGI_ERROR_NOT_FOUND;
+}
+
+HRESULT STDMETHODCALLTYPE RecordedCommandList::SetPrivateData(REFGUID guid, UINT DataSize, const void* pData)
+{
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE RecordedCommandList::SetPrivateDataInterface(REFGUID guid, const IUnknown* pData)
+{
+    return S_OK;
+}
+
+UINT STDMETHODCALLTYPE RecordedCommandList::GetContextFlags()
+{
+    return 0;
+}
+
+RecordingDeviceContext::RecordingDeviceContext(D3D11_DEVICE_CONTEXT_TYPE type)
+    : _device(NULL), _refCount(1), _type(type)
+{
+    ResetStats();
+    clearState();
+}
+
+RecordingDeviceContext::~RecordingDeviceContext()
+{
+    SAFE_RELEASE(_device);
+}
+
+void RecordingDeviceContext::clearState()
+{
+    ZeroMemory(_stages, sizeof(_stages));
+
+    _inputLayout = NULL;
+    _topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    ZeroMemory(_vertexBuffers, sizeof(_vertexBuffers));
+    ZeroMemory(_vertexStrides, sizeof(_vertexStrides));
+    ZeroMemory(_vertexOffsets, sizeof(_vertexOffsets));
+    _indexBuffer = NULL;
+    _indexFormat = DXGI_FORMAT_UNKNOWN;
+    _indexOffset = 0;
+
+    ZeroMemory(_streamOutTargets, sizeof(_streamOutTargets));
+
+    _rasterizerState = NULL;
+    _viewportCount = 0;
+    _scissorRectCount = 0;
+
+    ZeroMemory(_renderTargets, sizeof(_renderTargets));
+    _depthStencil = NULL;
+    ZeroMemory(_outputUAVs, sizeof(_outputUAVs));
+    ZeroMemory(_computeUAVs, sizeof(_computeUAVs));
+    _blendState = NULL;
+    for (UINT i = 0; i < 4; i++)
+    {
+        _blendFactor[i] = 1.0f;
+    }
+    _sampleMask = 0xFFFFFFFF;
+    _depthStencilState = NULL;
+    _stencilRef = 0;
+
+    _predicate = NULL;
+    _predicateValue = FALSE;
+}
+
+void RecordingDeviceContext::Reset(ID3D11Device* device, ID3D11DeviceContext* initialState)
+{
+    if (device)
+    {
+        device->AddRef();
+    }
+    SAFE_RELEASE(_device);
+    _device = device;
+
+    ResetStats();
+    _mapped.clear();
+
+    clearState();
+
+    if (initialState)
+    {
+        // The views stay alive while they are bound to the other context, the references that
+        // the Get methods added are not kept
+        initialState->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, _renderTargets, &_depthStencil);
+        for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+        {
+            if (_renderTargets[i])
+            {
+                _renderTargets[i]->Release();
+            }
+        }
+        if (_depthStencil)
+        {
+            _depthStencil->Release();
+        }
+
+        _viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+        initialState->RSGetViewports(&_viewportCount, _viewports);
+    }
+}
+
+void RecordingDeviceContext::ResetStats()
+{
+    ZeroMemory(&_stats, sizeof(RecordingStats));
+    _errors.clear();
+}
+
+void RecordingDeviceContext::error(const WCHAR* command, const WCHAR* msg)
+{
+    _stats.Errors++;
+
+    if (_errors.size() < MAX_STORED_ERRORS)
+    {
+        WCHAR error[256];
+        swprintf_s(error, L"%s: %s", command, msg);
+        _errors.push_back(error);
+    }
+}
+
+template <typename T>
+void RecordingDeviceContext::bindSlots(T** slots, UINT slotCount, UINT startSlot, UINT count, T* const* values,
+                                       const WCHAR* command)
+{
+    _stats.ResourceBinds++;
+
+    if (startSlot + count > slotCount)
+    {
+        error(command, L"the slot range is out of bounds");
+        return;
+    }
+
+    bool changed = false;
+    for (UINT i = 0; i < count; i++)
+    {
+        T* value = values ? values[i] : NULL;
+        if (slots[startSlot + i] != value)
+        {
+            slots[startSlot + i] = value;
+            changed = true;
+        }
+    }
+
+    if (!changed)
+    {
+        _stats.RedundantBinds++;
+    }
+}
+
+template <typename T>
+void RecordingDeviceContext::getSlots(T* const* slots, UINT slotCount, UINT startSlot, UINT count, T** out)
+{
+    // Like the real context every returned interface has a reference added that the caller releases
+    for (UINT i = 0; i < count; i++)
+    {
+        out[i] = (startSlot + i < slotCount) ? slots[startSlot + i] : NULL;
+        if (out[i])
+        {
+            out[i]->AddRef();
+        }
+    }
+}
+
+template <typename T>
+void RecordingDeviceContext::setState(T* current, T state)
+{
+    _stats.StateBinds++;
+
+    if (*current == state)
+    {
+        _stats.RedundantBinds++;
+    }
+    *current = state;
+}
+
+void RecordingDeviceContext::setShader(SHADER_STAGE stage, ID3D11DeviceChild* shader, UINT numClassInstances,
+                                       const WCHAR* command)
+{
+    _stats.ShaderBinds++;
+
+    if (numClassInstances > 0)
+    {
+        error(command, L"class instances are not recorded");
+    }
+
+    if (_stages[stage].Shader == shader)
+    {
+        _stats.RedundantBinds++;
+    }
+    _stages[stage].Shader = shader;
+}
+
+ID3D11DeviceChild* RecordingDeviceContext::getShader(SHADER_STAGE stage, UINT* numClassInstances)
+{
+    if (numClassInstances)
+    {
+        *numClassInstances = 0;
+    }
+
+    ID3D11DeviceChild* shader = _stages[stage].Shader;
+    if (shader)
+    {
+        shader->AddRef();
+    }
+    return shader;
+}
+
+void RecordingDeviceContext::setShaderResources(SHADER_STAGE stage, UINT startSlot, UINT count,
+                                                ID3D11ShaderResourceView* const* views, const WCHAR* command)
+{
+    STAGE_STATE& state = _stages[stage];
+    bindSlots(state.ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, startSlot, count, views, command);
+
+    if (views && startSlot + count <= D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT)
+    {
+        state.ShaderResourceCount = max(state.ShaderResourceCount, startSlot + count);
+    }
+}
+
+bool RecordingDeviceContext::isBoundAsOutput(ID3D11Resource* resource)
+{
+    // Only the pointers are compared, so the references added by GetResource are released
+    // straight away
+    for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+    {
+        if (_renderTargets[i])
+        {
+            ID3D11Resource* target;
+            _renderTargets[i]->GetResource(&target);
+            target->Release();
+
+            if (target == resource)
+            {
+                return true;
+            }
+        }
+    }
+
+    if (_depthStencil)
+    {
+        // Depth can be read while it is bound through a read only view
+        D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+        _depthStencil->GetDesc(&dsvDesc);
+
+        if (!(dsvDesc.Flags & D3D11_DSV_READ_ONLY_DEPTH))
+        {
+            ID3D11Resource* target;
+            _depthStencil->GetResource(&target);
+            target->Release();
+
+            if (target == resource)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void RecordingDeviceContext::validateDraw(const WCHAR* command)
+{
+    _stats.DrawCalls++;
+
+    if (_mapped.size() > 0)
+    {
+        error(command, L"a resource is still mapped");
+    }
+    if (!_stages[STAGE_VS].Shader)
+    {
+        error(command, L"no vertex shader is bound");
+    }
+    if (_topology == D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED)
+    {
+        error(command, L"no primitive topology is set");
+    }
+
+    // The runtime silently unbinds a resource that is both read and written, which usually
+    // means a missing unbind in the previous pass
+    for (UINT stage = STAGE_VS; stage <= STAGE_PS; stage++)
+    {
+        const STAGE_STATE& state = _stages[stage];
+        for (UINT i = 0; i < state.ShaderResourceCount; i++)
+        {
+            if (state.ShaderResources[i])
+            {
+                ID3D11Resource* resource;
+                state.ShaderResources[i]->GetResource(&resource);
+                resource->Release();
+
+                if (isBoundAsOutput(resource))
+                {
+                    error(command, L"a shader resource is also bound as an output");
+                }
+            }
+        }
+    }
+}
+
+HRESULT RecordingDeviceContext::getMappedSize(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType,
+                                              UINT* rowPitch, UINT* depthPitch, UINT* size,
+                                              const WCHAR** usageError)
+{
+    D3D11_USAGE usage;
+    UINT bindFlags;
+
+    D3D11_RESOURCE_DIMENSION dimension;
+    resource->GetType(&dimension);
+    switch (dimension)
+    {
+    case D3D11_RESOURCE_DIMENSION_BUFFER:
+        {
+            D3D11_BUFFER_DESC desc;
+            static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+            usage = desc.Usage;
+            bindFlags = desc.BindFlags;
+
+            *rowPitch = desc.ByteWidth;
+            *depthPitch = desc.ByteWidth;
+            *size = desc.ByteWidth;
+        }
+        break;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+        {
+            D3D11_TEXTURE1D_DESC desc;
+            static_cast<ID3D11Texture1D*>(resource)->GetDesc(&desc);
+            usage = desc.Usage;
+            bindFlags = desc.BindFlags;
+
+            UINT mip = subresource % desc.MipLevels;
+            *rowPitch = max(desc.Width >> mip, 1U) * MAX_TEXEL_SIZE;
+            *depthPitch = *rowPitch;
+            *size = *rowPitch;
+        }
+        break;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+        {
+            D3D11_TEXTURE2D_DESC desc;
+            static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+            usage = desc.Usage;
+            bindFlags = desc.BindFlags;
+
+            UINT mip = subresource % desc.MipLevels;
+            *rowPitch = max(desc.Width >> mip, 1U) * MAX_TEXEL_SIZE;
+            *depthPitch = *rowPitch * max(desc.Height >> mip, 1U);
+            *size = *depthPitch;
+        }
+        break;
+
+    case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+        {
+            D3D11_TEXTURE3D_DESC desc;
+            static_cast<ID3D11Texture3D*>(resource)->GetDesc(&desc);
+            usage = desc.Usage;
+            bindFlags = desc.BindFlags;
+
+            UINT mip = subresource % desc.MipLevels;
+            *rowPitch = max(desc.Width >> mip, 1U) * MAX_TEXEL_SIZE;
+            *depthPitch = *rowPitch * max(desc.Height >> mip, 1U);
+            *size = *depthPitch * max(desc.Depth >> mip, 1U);
+        }
+        break;
+
+    default:
+        return E_FAIL;
+    }
+
+    // The rules the Direct3D 11.0 runtime enforces
+    *usageError = NULL;
+    if (usage == D3D11_USAGE_DEFAULT || usage == D3D11_USAGE_IMMUTABLE)
+    {
+        *usageError = L"only dynamic and staging resources can be mapped";
+    }
+    else if (usage == D3D11_USAGE_DYNAMIC && mapType != D3D11_MAP_WRITE_DISCARD &&
+             mapType != D3D11_MAP_WRITE_NO_OVERWRITE)
+    {
+        *usageError = L"dynamic resources can only be mapped with WRITE_DISCARD or WRITE_NO_OVERWRITE";
+    }
+    else if (usage == D3D11_USAGE_STAGING && (mapType == D3D11_MAP_WRITE_DISCARD ||
+             mapType == D3D11_MAP_WRITE_NO_OVERWRITE))
+    {
+        *usageError = L"staging resources cannot be mapped with WRITE_DISCARD or WRITE_NO_OVERWRITE";
+    }
+    else if (mapType == D3D11_MAP_WRITE_NO_OVERWRITE &&
+             !(bindFlags & (D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_INDEX_BUFFER)))
+    {
+        *usageError = L"only vertex and index buffers can be mapped with WRITE_NO_OVERWRITE";
+    }
+
+    return S_OK;
+}
+
+// IUnknown
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if (!ppvObject)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(ID3D11DeviceContext))
+    {
+        *ppvObject = static_cast<ID3D11DeviceContext*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE RecordingDeviceContext::AddRef()
+{
+    return ++_refCount;
+}
+
+ULONG STDMETHODCALLTYPE RecordingDeviceContext::Release()
+{
+    // The recorder is owned by whoever created it, the count is only kept for the callers that
+    // expect it
+    return (_refCount > 1) ? --_refCount : 1;
+}
+
+// ID3D11DeviceChild
+void STDMETHODCALLTYPE RecordingDeviceContext::GetDevice(ID3D11Device** ppDevice)
+{
+    *ppDevice = _device;
+    if (_device)
+    {
+        _device->AddRef();
+    }
+}
+
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData)
+{
+    return DXGI_ERROR_NOT_FOUND;
+}
+
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::SetPrivateData(REFGUID guid, UINT DataSize, const void* pData)
+{
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::SetPrivateDataInterface(REFGUID guid, const IUnknown* pData)
+{
+    return S_OK;
+}
+
+// Shaders
+void STDMETHODCALLTYPE RecordingDeviceContext::VSSetShader(ID3D11VertexShader* pVertexShader, ID3D11ClassInstance* const* ppClassInstances,
+                                         UINT NumClassInstances)
+{
+    setShader(STAGE_VS, pVertexShader, NumClassInstances, L"VSSetShader");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSSetShader(ID3D11HullShader* pHullShader, ID3D11ClassInstance* const* ppClassInstances,
+                                         UINT NumClassInstances)
+{
+    setShader(STAGE_HS, pHullShader, NumClassInstances, L"HSSetShader");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSSetShader(ID3D11DomainShader* pDomainShader, ID3D11ClassInstance* const* ppClassInstances,
+                                         UINT NumClassInstances)
+{
+    setShader(STAGE_DS, pDomainShader, NumClassInstances, L"DSSetShader");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSSetShader(ID3D11GeometryShader* pShader, ID3D11ClassInstance* const* ppClassInstances,
+                                         UINT NumClassInstances)
+{
+    setShader(STAGE_GS, pShader, NumClassInstances, L"GSSetShader");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSSetShader(ID3D11PixelShader* pPixelShader, ID3D11ClassInstance* const* ppClassInstances,
+                                         UINT NumClassInstances)
+{
+    setShader(STAGE_PS, pPixelShader, NumClassInstances, L"PSSetShader");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSSetShader(ID3D11ComputeShader* pComputeShader, ID3D11ClassInstance* const* ppClassInstances,
+                                         UINT NumClassInstances)
+{
+    setShader(STAGE_CS, pComputeShader, NumClassInstances, L"CSSetShader");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::VSGetShader(ID3D11VertexShader** ppVertexShader, ID3D11ClassInstance** ppClassInstances,
+                                         UINT* pNumClassInstances)
+{
+    *ppVertexShader = static_cast<ID3D11VertexShader*>(getShader(STAGE_VS, pNumClassInstances));
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSGetShader(ID3D11HullShader** ppHullShader, ID3D11ClassInstance** ppClassInstances,
+                                         UINT* pNumClassInstances)
+{
+    *ppHullShader = static_cast<ID3D11HullShader*>(getShader(STAGE_HS, pNumClassInstances));
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSGetShader(ID3D11DomainShader** ppDomainShader, ID3D11ClassInstance** ppClassInstances,
+                                         UINT* pNumClassInstances)
+{
+    *ppDomainShader = static_cast<ID3D11DomainShader*>(getShader(STAGE_DS, pNumClassInstances));
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSGetShader(ID3D11GeometryShader** ppGeometryShader, ID3D11ClassInstance** ppClassInstances,
+                                         UINT* pNumClassInstances)
+{
+    *ppGeometryShader = static_cast<ID3D11GeometryShader*>(getShader(STAGE_GS, pNumClassInstances));
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSGetShader(ID3D11PixelShader** ppPixelShader, ID3D11ClassInstance** ppClassInstances,
+                                         UINT* pNumClassInstances)
+{
+    *ppPixelShader = static_cast<ID3D11PixelShader*>(getShader(STAGE_PS, pNumClassInstances));
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSGetShader(ID3D11ComputeShader** ppComputeShader, ID3D11ClassInstance** ppClassInstances,
+                                         UINT* pNumClassInstances)
+{
+    *ppComputeShader = static_cast<ID3D11ComputeShader*>(getShader(STAGE_CS, pNumClassInstances));
+}
+
+// Shader resources
+void STDMETHODCALLTYPE RecordingDeviceContext::VSSetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    setShaderResources(STAGE_VS, StartSlot, NumViews, ppShaderResourceViews, L"VSSetShaderResources");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSSetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    setShaderResources(STAGE_HS, StartSlot, NumViews, ppShaderResourceViews, L"HSSetShaderResources");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSSetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    setShaderResources(STAGE_DS, StartSlot, NumViews, ppShaderResourceViews, L"DSSetShaderResources");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSSetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    setShaderResources(STAGE_GS, StartSlot, NumViews, ppShaderResourceViews, L"GSSetShaderResources");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSSetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    setShaderResources(STAGE_PS, StartSlot, NumViews, ppShaderResourceViews, L"PSSetShaderResources");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSSetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    setShaderResources(STAGE_CS, StartSlot, NumViews, ppShaderResourceViews, L"CSSetShaderResources");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::VSGetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    getSlots(_stages[STAGE_VS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumViews,
+        ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSGetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    getSlots(_stages[STAGE_HS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumViews,
+        ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSGetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    getSlots(_stages[STAGE_DS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumViews,
+        ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSGetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    getSlots(_stages[STAGE_GS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumViews,
+        ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSGetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    getSlots(_stages[STAGE_PS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumViews,
+        ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSGetShaderResources(UINT StartSlot, UINT NumViews,
+                                                  ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    getSlots(_stages[STAGE_CS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumViews,
+        ppShaderResourceViews);
+}
+
+// Constant buffers
+void STDMETHODCALLTYPE RecordingDeviceContext::VSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
+{
+    bindSlots(_stages[STAGE_VS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers, L"VSSetConstantBuffers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
+{
+    bindSlots(_stages[STAGE_HS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers, L"HSSetConstantBuffers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
+{
+    bindSlots(_stages[STAGE_DS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers, L"DSSetConstantBuffers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
+{
+    bindSlots(_stages[STAGE_GS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers, L"GSSetConstantBuffers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
+{
+    bindSlots(_stages[STAGE_PS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers, L"PSSetConstantBuffers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers)
+{
+    bindSlots(_stages[STAGE_CS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers, L"CSSetConstantBuffers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::VSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers)
+{
+    getSlots(_stages[STAGE_VS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers)
+{
+    getSlots(_stages[STAGE_HS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers)
+{
+    getSlots(_stages[STAGE_DS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers)
+{
+    getSlots(_stages[STAGE_GS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers)
+{
+    getSlots(_stages[STAGE_PS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSGetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers)
+{
+    getSlots(_stages[STAGE_CS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, StartSlot,
+        NumBuffers, ppConstantBuffers);
+}
+
+// Samplers
+void STDMETHODCALLTYPE RecordingDeviceContext::VSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
+{
+    bindSlots(_stages[STAGE_VS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers,
+        L"VSSetSamplers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
+{
+    bindSlots(_stages[STAGE_HS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers,
+        L"HSSetSamplers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
+{
+    bindSlots(_stages[STAGE_DS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers,
+        L"DSSetSamplers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
+{
+    bindSlots(_stages[STAGE_GS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers,
+        L"GSSetSamplers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
+{
+    bindSlots(_stages[STAGE_PS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers,
+        L"PSSetSamplers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSSetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers)
+{
+    bindSlots(_stages[STAGE_CS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers,
+        L"CSSetSamplers");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::VSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers)
+{
+    getSlots(_stages[STAGE_VS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::HSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers)
+{
+    getSlots(_stages[STAGE_HS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers)
+{
+    getSlots(_stages[STAGE_DS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers)
+{
+    getSlots(_stages[STAGE_GS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::PSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers)
+{
+    getSlots(_stages[STAGE_PS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSGetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers)
+{
+    getSlots(_stages[STAGE_CS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, StartSlot, NumSamplers, ppSamplers);
+}
+
+// Input assembler
+void STDMETHODCALLTYPE RecordingDeviceContext::IASetInputLayout(ID3D11InputLayout* pInputLayout)
+{
+    setState(&_inputLayout, pInputLayout);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology)
+{
+    setState(&_topology, Topology);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IASetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppVertexBuffers,
+                                                const UINT* pStrides, const UINT* pOffsets)
+{
+    bindSlots(_vertexBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumBuffers, ppVertexBuffers,
+        L"IASetVertexBuffers");
+
+    if (StartSlot + NumBuffers <= D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT)
+    {
+        for (UINT i = 0; i < NumBuffers; i++)
+        {
+            _vertexStrides[StartSlot + i] = pStrides ? pStrides[i] : 0;
+            _vertexOffsets[StartSlot + i] = pOffsets ? pOffsets[i] : 0;
+        }
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IASetIndexBuffer(ID3D11Buffer* pIndexBuffer, DXGI_FORMAT Format, UINT Offset)
+{
+    _stats.ResourceBinds++;
+
+    if (_indexBuffer == pIndexBuffer && _indexFormat == Format && _indexOffset == Offset)
+    {
+        _stats.RedundantBinds++;
+    }
+    _indexBuffer = pIndexBuffer;
+    _indexFormat = Format;
+    _indexOffset = Offset;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IAGetInputLayout(ID3D11InputLayout** ppInputLayout)
+{
+    getSlots(&_inputLayout, 1, 0, 1, ppInputLayout);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY* pTopology)
+{
+    *pTopology = _topology;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IAGetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppVertexBuffers,
+                                                UINT* pStrides, UINT* pOffsets)
+{
+    if (ppVertexBuffers)
+    {
+        getSlots(_vertexBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, StartSlot, NumBuffers, ppVertexBuffers);
+    }
+
+    for (UINT i = 0; i < NumBuffers; i++)
+    {
+        bool valid = StartSlot + i < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+        if (pStrides)
+        {
+            pStrides[i] = valid ? _vertexStrides[StartSlot + i] : 0;
+        }
+        if (pOffsets)
+        {
+            pOffsets[i] = valid ? _vertexOffsets[StartSlot + i] : 0;
+        }
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::IAGetIndexBuffer(ID3D11Buffer** pIndexBuffer, DXGI_FORMAT* Format, UINT* Offset)
+{
+    if (pIndexBuffer)
+    {
+        getSlots(&_indexBuffer, 1, 0, 1, pIndexBuffer);
+    }
+    if (Format)
+    {
+        *Format = _indexFormat;
+    }
+    if (Offset)
+    {
+        *Offset = _indexOffset;
+    }
+}
+
+// Stream output
+void STDMETHODCALLTYPE RecordingDeviceContext::SOSetTargets(UINT NumBuffers, ID3D11Buffer* const* ppSOTargets, const UINT* pOffsets)
+{
+    bindSlots(_streamOutTargets, D3D11_SO_BUFFER_SLOT_COUNT, 0, NumBuffers, ppSOTargets, L"SOSetTargets");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::SOGetTargets(UINT NumBuffers, ID3D11Buffer** ppSOTargets)
+{
+    getSlots(_streamOutTargets, D3D11_SO_BUFFER_SLOT_COUNT, 0, NumBuffers, ppSOTargets);
+}
+
+// Rasterizer
+void STDMETHODCALLTYPE RecordingDeviceContext::RSSetState(ID3D11RasterizerState* pRasterizerState)
+{
+    setState(&_rasterizerState, pRasterizerState);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::RSSetViewports(UINT NumViewports, const D3D11_VIEWPORT* pViewports)
+{
+    _stats.StateBinds++;
+
+    if (NumViewports > D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE)
+    {
+        error(L"RSSetViewports", L"too many viewports");
+        return;
+    }
+
+    if (NumViewports == _viewportCount && memcmp(_viewports, pViewports, NumViewports * sizeof(D3D11_VIEWPORT)) == 0)
+    {
+        _stats.RedundantBinds++;
+    }
+    memcpy(_viewports, pViewports, NumViewports * sizeof(D3D11_VIEWPORT));
+    _viewportCount = NumViewports;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::RSSetScissorRects(UINT NumRects, const D3D11_RECT* pRects)
+{
+    _stats.StateBinds++;
+
+    if (NumRects > D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE)
+    {
+        error(L"RSSetScissorRects", L"too many scissor rectangles");
+        return;
+    }
+
+    if (NumRects == _scissorRectCount && memcmp(_scissorRects, pRects, NumRects * sizeof(D3D11_RECT)) == 0)
+    {
+        _stats.RedundantBinds++;
+    }
+    memcpy(_scissorRects, pRects, NumRects * sizeof(D3D11_RECT));
+    _scissorRectCount = NumRects;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::RSGetState(ID3D11RasterizerState** ppRasterizerState)
+{
+    getSlots(&_rasterizerState, 1, 0, 1, ppRasterizerState);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::RSGetViewports(UINT* pNumViewports, D3D11_VIEWPORT* pViewports)
+{
+    if (pViewports)
+    {
+        UINT count = min(*pNumViewports, _viewportCount);
+        memcpy(pViewports, _viewports, count * sizeof(D3D11_VIEWPORT));
+    }
+    *pNumViewports = _viewportCount;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::RSGetScissorRects(UINT* pNumRects, D3D11_RECT* pRects)
+{
+    if (pRects)
+    {
+        UINT count = min(*pNumRects, _scissorRectCount);
+        memcpy(pRects, _scissorRects, count * sizeof(D3D11_RECT));
+    }
+    *pNumRects = _scissorRectCount;
+}
+
+// Output merger
+void STDMETHODCALLTYPE RecordingDeviceContext::OMSetRenderTargets(UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews,
+                                                ID3D11DepthStencilView* pDepthStencilView)
+{
+    _stats.ResourceBinds++;
+
+    if (NumViews > D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT)
+    {
+        error(L"OMSetRenderTargets", L"too many render targets");
+        return;
+    }
+
+    // Every slot after the given views is unbound
+    bool changed = _depthStencil != pDepthStencilView;
+    for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+    {
+        ID3D11RenderTargetView* view = (ppRenderTargetViews && i < NumViews) ? ppRenderTargetViews[i] : NULL;
+        changed = changed || _renderTargets[i] != view;
+        _renderTargets[i] = view;
+    }
+    _depthStencil = pDepthStencilView;
+
+    if (!changed)
+    {
+        _stats.RedundantBinds++;
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMSetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs,
+    ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView, UINT UAVStartSlot,
+    UINT NumUAVs, ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts)
+{
+    if (NumRTVs != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL)
+    {
+        OMSetRenderTargets(NumRTVs, ppRenderTargetViews, pDepthStencilView);
+    }
+    if (NumUAVs != D3D11_KEEP_UNORDERED_ACCESS_VIEWS)
+    {
+        bindSlots(_outputUAVs, D3D11_PS_CS_UAV_REGISTER_COUNT, UAVStartSlot, NumUAVs, ppUnorderedAccessViews,
+            L"OMSetRenderTargetsAndUnorderedAccessViews");
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMSetBlendState(ID3D11BlendState* pBlendState, const FLOAT BlendFactor[4], UINT SampleMask)
+{
+    _stats.StateBinds++;
+
+    FLOAT blendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    if (BlendFactor)
+    {
+        memcpy(blendFactor, BlendFactor, sizeof(blendFactor));
+    }
+
+    if (_blendState == pBlendState && _sampleMask == SampleMask &&
+        memcmp(_blendFactor, blendFactor, sizeof(blendFactor)) == 0)
+    {
+        _stats.RedundantBinds++;
+    }
+    _blendState = pBlendState;
+    memcpy(_blendFactor, blendFactor, sizeof(blendFactor));
+    _sampleMask = SampleMask;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMSetDepthStencilState(ID3D11DepthStencilState* pDepthStencilState, UINT StencilRef)
+{
+    _stats.StateBinds++;
+
+    if (_depthStencilState == pDepthStencilState && _stencilRef == StencilRef)
+    {
+        _stats.RedundantBinds++;
+    }
+    _depthStencilState = pDepthStencilState;
+    _stencilRef = StencilRef;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMGetRenderTargets(UINT NumViews, ID3D11RenderTargetView** ppRenderTargetViews,
+                                                ID3D11DepthStencilView** ppDepthStencilView)
+{
+    if (ppRenderTargetViews)
+    {
+        getSlots(_renderTargets, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, 0, NumViews, ppRenderTargetViews);
+    }
+    if (ppDepthStencilView)
+    {
+        getSlots(&_depthStencil, 1, 0, 1, ppDepthStencilView);
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMGetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs,
+    ID3D11RenderTargetView** ppRenderTargetViews, ID3D11DepthStencilView** ppDepthStencilView, UINT UAVStartSlot,
+    UINT NumUAVs, ID3D11UnorderedAccessView** ppUnorderedAccessViews)
+{
+    OMGetRenderTargets(NumRTVs, ppRenderTargetViews, ppDepthStencilView);
+    if (ppUnorderedAccessViews)
+    {
+        getSlots(_outputUAVs, D3D11_PS_CS_UAV_REGISTER_COUNT, UAVStartSlot, NumUAVs, ppUnorderedAccessViews);
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMGetBlendState(ID3D11BlendState** ppBlendState, FLOAT BlendFactor[4], UINT* pSampleMask)
+{
+    if (ppBlendState)
+    {
+        getSlots(&_blendState, 1, 0, 1, ppBlendState);
+    }
+    if (BlendFactor)
+    {
+        memcpy(BlendFactor, _blendFactor, sizeof(_blendFactor));
+    }
+    if (pSampleMask)
+    {
+        *pSampleMask = _sampleMask;
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::OMGetDepthStencilState(ID3D11DepthStencilState** ppDepthStencilState, UINT* pStencilRef)
+{
+    if (ppDepthStencilState)
+    {
+        getSlots(&_depthStencilState, 1, 0, 1, ppDepthStencilState);
+    }
+    if (pStencilRef)
+    {
+        *pStencilRef = _stencilRef;
+    }
+}
+
+// Compute
+void STDMETHODCALLTYPE RecordingDeviceContext::CSSetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs,
+                                                       ID3D11UnorderedAccessView* const* ppUnorderedAccessViews,
+                                                       const UINT* pUAVInitialCounts)
+{
+    bindSlots(_computeUAVs, D3D11_PS_CS_UAV_REGISTER_COUNT, StartSlot, NumUAVs, ppUnorderedAccessViews,
+        L"CSSetUnorderedAccessViews");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CSGetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs,
+                                                       ID3D11UnorderedAccessView** ppUnorderedAccessViews)
+{
+    getSlots(_computeUAVs, D3D11_PS_CS_UAV_REGISTER_COUNT, StartSlot, NumUAVs, ppUnorderedAccessViews);
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
+{
+    _stats.Dispatches++;
+
+    if (_mapped.size() > 0)
+    {
+        error(L"Dispatch", L"a resource is still mapped");
+    }
+    if (!_stages[STAGE_CS].Shader)
+    {
+        error(L"Dispatch", L"no compute shader is bound");
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DispatchIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs)
+{
+    Dispatch(0, 0, 0);
+}
+
+// Draws
+void STDMETHODCALLTYPE RecordingDeviceContext::Draw(UINT VertexCount, UINT StartVertexLocation)
+{
+    validateDraw(L"Draw");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DrawIndexed(UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation)
+{
+    validateDraw(L"DrawIndexed");
+
+    if (!_indexBuffer)
+    {
+        error(L"DrawIndexed", L"no index buffer is bound");
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation,
+                                           UINT StartInstanceLocation)
+{
+    validateDraw(L"DrawInstanced");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount,
+                                                  UINT StartIndexLocation, INT BaseVertexLocation,
+                                                  UINT StartInstanceLocation)
+{
+    validateDraw(L"DrawIndexedInstanced");
+
+    if (!_indexBuffer)
+    {
+        error(L"DrawIndexedInstanced", L"no index buffer is bound");
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DrawAuto()
+{
+    validateDraw(L"DrawAuto");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DrawIndexedInstancedIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs)
+{
+    validateDraw(L"DrawIndexedInstancedIndirect");
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::DrawInstancedIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs)
+{
+    validateDraw(L"DrawInstancedIndirect");
+}
+
+// Resource access
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::Map(ID3D11Resource* pResource, UINT Subresource, D3D11_MAP MapType, UINT MapFlags,
+                                    D3D11_MAPPED_SUBRESOURCE* pMappedResource)
+{
+    _stats.Maps++;
+
+    if (!pResource || !pMappedResource)
+    {
+        error(L"Map", L"no resource was given");
+        return E_INVALIDARG;
+    }
+
+    SUBRESOURCE_KEY key(pResource, Subresource);
+    if (_mapped.find(key) != _mapped.end())
+    {
+        error(L"Map", L"the subresource is already mapped");
+        return E_INVALIDARG;
+    }
+
+    UINT rowPitch, depthPitch, size;
+    const WCHAR* usageError;
+    if (FAILED(getMappedSize(pResource, Subresource, MapType, &rowPitch, &depthPitch, &size, &usageError)))
+    {
+        error(L"Map", L"the resource cannot be mapped");
+        return E_INVALIDARG;
+    }
+    if (usageError)
+    {
+        error(L"Map", usageError);
+        return E_INVALIDARG;
+    }
+
+    std::vector<BYTE>& scratch = _scratch[key];
+    if (scratch.size() < size)
+    {
+        scratch.resize(size);
+    }
+    _mapped.insert(key);
+
+    pMappedResource->pData = &scratch[0];
+    pMappedResource->RowPitch = rowPitch;
+    pMappedResource->DepthPitch = depthPitch;
+
+    return S_OK;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::Unmap(ID3D11Resource* pResource, UINT Subresource)
+{
+    if (_mapped.erase(SUBRESOURCE_KEY(pResource, Subresource)) == 0)
+    {
+        error(L"Unmap", L"the subresource is not mapped");
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CopySubresourceRegion(ID3D11Resource* pDstResource, UINT DstSubresource, UINT DstX,
+                                                   UINT DstY, UINT DstZ, ID3D11Resource* pSrcResource,
+                                                   UINT SrcSubresource, const D3D11_BOX* pSrcBox)
+{
+    _stats.Copies++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CopyResource(ID3D11Resource* pDstResource, ID3D11Resource* pSrcResource)
+{
+    _stats.Copies++;
+
+    if (pDstResource == pSrcResource)
+    {
+        error(L"CopyResource", L"the source and destination are the same resource");
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::UpdateSubresource(ID3D11Resource* pDstResource, UINT DstSubresource,
+                                               const D3D11_BOX* pDstBox, const void* pSrcData, UINT SrcRowPitch,
+                                               UINT SrcDepthPitch)
+{
+    _stats.Copies++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::CopyStructureCount(ID3D11Buffer* pDstBuffer, UINT DstAlignedByteOffset,
+                                                ID3D11UnorderedAccessView* pSrcView)
+{
+    _stats.Copies++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::ResolveSubresource(ID3D11Resource* pDstResource, UINT DstSubresource,
+                                                ID3D11Resource* pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
+{
+    _stats.Copies++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GenerateMips(ID3D11ShaderResourceView* pShaderResourceView)
+{
+    _stats.Copies++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::SetResourceMinLOD(ID3D11Resource* pResource, FLOAT MinLOD)
+{
+}
+
+FLOAT STDMETHODCALLTYPE RecordingDeviceContext::GetResourceMinLOD(ID3D11Resource* pResource)
+{
+    return 0.0f;
+}
+
+// Clears
+void STDMETHODCALLTYPE RecordingDeviceContext::ClearRenderTargetView(ID3D11RenderTargetView* pRenderTargetView, const FLOAT ColorRGBA[4])
+{
+    _stats.Clears++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::ClearUnorderedAccessViewUint(ID3D11UnorderedAccessView* pUnorderedAccessView,
+                                                          const UINT Values[4])
+{
+    _stats.Clears++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::ClearUnorderedAccessViewFloat(ID3D11UnorderedAccessView* pUnorderedAccessView,
+                                                           const FLOAT Values[4])
+{
+    _stats.Clears++;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::ClearDepthStencilView(ID3D11DepthStencilView* pDepthStencilView, UINT ClearFlags,
+                                                   FLOAT Depth, UINT8 Stencil)
+{
+    _stats.Clears++;
+}
+
+// Queries and predication
+void STDMETHODCALLTYPE RecordingDeviceContext::Begin(ID3D11Asynchronous* pAsync)
+{
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::End(ID3D11Asynchronous* pAsync)
+{
+}
+
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::GetData(ID3D11Asynchronous* pAsync, void* pData, UINT DataSize, UINT GetDataFlags)
+{
+    // Nothing is executed so every query is finished straight away with zeroed results, returning
+    // S_FALSE would leave callers that wait on a query spinning forever
+    if (pData)
+    {
+        ZeroMemory(pData, DataSize);
+    }
+    return S_OK;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::SetPredication(ID3D11Predicate* pPredicate, BOOL PredicateValue)
+{
+    _stats.StateBinds++;
+
+    if (_predicate == pPredicate && _predicateValue == PredicateValue)
+    {
+        _stats.RedundantBinds++;
+    }
+    _predicate = pPredicate;
+    _predicateValue = PredicateValue;
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::GetPredication(ID3D11Predicate** ppPredicate, BOOL* pPredicateValue)
+{
+    if (ppPredicate)
+    {
+        getSlots(&_predicate, 1, 0, 1, ppPredicate);
+    }
+    if (pPredicateValue)
+    {
+        *pPredicateValue = _predicateValue;
+    }
+}
+
+// Context
+void STDMETHODCALLTYPE RecordingDeviceContext::ExecuteCommandList(ID3D11CommandList* pCommandList, BOOL RestoreContextState)
+{
+    if (_type != D3D11_DEVICE_CONTEXT_IMMEDIATE)
+    {
+        error(L"ExecuteCommandList", L"command lists can only be executed on an immediate context");
+        return;
+    }
+
+    RecordedCommandList* commandList = NULL;
+    if (!pCommandList || FAILED(pCommandList->QueryInterface(__uuidof(RecordedCommandList), (void**)&commandList)))
+    {
+        error(L"ExecuteCommandList", L"the command list was not finished by a recording context");
+        return;
+    }
+
+    // The commands were counted and checked as they were recorded
+    const RecordingStats& stats = commandList->GetStats();
+    _stats.DrawCalls += stats.DrawCalls;
+    _stats.Dispatches += stats.Dispatches;
+    _stats.ShaderBinds += stats.ShaderBinds;
+    _stats.ResourceBinds += stats.ResourceBinds;
+    _stats.StateBinds += stats.StateBinds;
+    _stats.RedundantBinds += stats.RedundantBinds;
+    _stats.Maps += stats.Maps;
+    _stats.Clears += stats.Clears;
+    _stats.Copies += stats.Copies;
+    _stats.Errors += stats.Errors;
+
+    const std::vector<std::wstring>& errors = commandList->GetErrors();
+    for (UINT i = 0; i < errors.size() && _errors.size() < MAX_STORED_ERRORS; i++)
+    {
+        _errors.push_back(errors[i]);
+    }
+
+    SAFE_RELEASE(commandList);
+
+    // Like the runtime, the context is left in its default state unless asked to restore it
+    if (!RestoreContextState)
+    {
+        clearState();
+    }
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::ClearState()
+{
+    clearState();
+}
+
+void STDMETHODCALLTYPE RecordingDeviceContext::Flush()
+{
+}
+
+D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE RecordingDeviceContext::GetType()
+{
+    return _type;
+}
+
+UINT STDMETHODCALLTYPE RecordingDeviceContext::GetContextFlags()
+{
+    return 0;
+}
+
+HRESULT STDMETHODCALLTYPE RecordingDeviceContext::FinishCommandList(BOOL RestoreDeferredContextState, ID3D11CommandList** ppCommandList)
+{
+    if (_type != D3D11_DEVICE_CONTEXT_DEFERRED)
+    {
+        error(L"FinishCommandList", L"only deferred contexts can finish command lists");
+        return DXGI_ERROR_INVALID_CALL;
+    }
+
+    if (!_mapped.empty())
+    {
+        error(L"FinishCommandList", L"a subresource is still mapped");
+        _mapped.clear();
+    }
+
+    if (ppCommandList)
+    {
+        *ppCommandList = new RecordedCommandList(_device, _stats, _errors);
+    }
+
+    // The next command list only holds what is recorded after this one
+    ResetStats();
+    if (!RestoreDeferredContextState)
+    {
+        clearState();
+    }
+
+    return S_OK;
+}
\ No newline at end of file
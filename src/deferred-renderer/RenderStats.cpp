@@ -0,0 +1,97 @@
+#include "PCH.h"
+#include "RenderStats.h"
+
+// Set the first time a thread adds to a counter
+static __declspec(thread) void* threadStatsInfo = NULL;
+
+RenderStats::RenderStats()
+{
+    InitializeCriticalSection(&_threadLock);
+
+    ZeroMemory(_totals, sizeof(_totals));
+    ZeroMemory(_frameCounts, sizeof(_frameCounts));
+}
+
+RenderStats::~RenderStats()
+{
+    for (UINT i = 0; i < _threads.size(); i++)
+    {
+        SAFE_DELETE(_threads[i]);
+    }
+
+    DeleteCriticalSection(&_threadLock);
+}
+
+RenderStats::THREAD_INFO* RenderStats::getThread()
+{
+    THREAD_INFO* thread = (THREAD_INFO*)threadStatsInfo;
+    if (thread)
+    {
+        return thread;
+    }
+
+    thread = new THREAD_INFO();
+    for (UINT i = 0; i < RenderCounter::Count; i++)
+    {
+        thread->Counts[i] = 0;
+    }
+
+    EnterCriticalSection(&_threadLock);
+    _threads.push_back(thread);
+    LeaveCriticalSection(&_threadLock);
+
+    threadStatsInfo = thread;
+    return thread;
+}
+
+void RenderStats::EndFrame()
+{
+    UINT totals[RenderCounter::Count];
+    ZeroMemory(totals, sizeof(totals));
+
+    EnterCriticalSection(&_threadLock);
+    for (UINT i = 0; i < _threads.size(); i++)
+    {
+        for (UINT j = 0; j < RenderCounter::Count; j++)
+        {
+            totals[j] += _threads[i]->Counts[j];
+        }
+    }
+    LeaveCriticalSection(&_threadLock);
+
+    // The counters are never reset so a thread can keep adding while this reads them, anything
+    // it adds after being read is counted in the next frame. Unsigned differences are still
+    // right once the totals wrap around
+    for (UINT i = 0; i < RenderCounter::Count; i++)
+    {
+        _frameCounts[i] = totals[i] - _totals[i];
+        _totals[i] = totals[i];
+    }
+}
+
+const WCHAR* RenderStats::GetCounterName(UINT counter)
+{
+    switch (counter)
+    {
+    case RenderCounter::InstancesTested: return L"Instances tested";
+    case RenderCounter::InstancesCulled: return L"Instances culled";
+    case RenderCounter::InstancesDrawn:  return L"Instances drawn";
+    case RenderCounter::DrawCalls:       return L"Draw calls";
+    case RenderCounter::Triangles:       return L"Triangles";
+    case RenderCounter::ShaderChanges:   return L"Shader changes";
+    case RenderCounter::ShadowMaps:      return L"Shadow maps";
+    case RenderCounter::ShadowCasters:   return L"Shadow casters";
+    case RenderCounter::Lights:          return L"Lights";
+    case RenderCounter::ShadowedLights:  return L"Shadowed lights";
+    case RenderCounter::ParticleSystems: return L"Particle systems";
+    case RenderCounter::Particles:       return L"Particles";
+    case RenderCounter::Sprites:         return L"Sprites";
+    default:                             return L"Unknown";
+    }
+}
+
+RenderStats RenderStats::_instance;
+RenderStats* RenderStats::GetInstance()
+{
+    return &_instance;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "PCH.h"
+
+#define ADD_RENDER_STAT(counter, value) (RenderStats::GetInstance()->Add(RenderCounter::counter, (value)))
+
+namespace RenderCounter
+{
+    enum
+    {
+        // Every instance set counts its tests, those of shadow casters included
+        InstancesTested = 0,
+        InstancesCulled,
+        InstancesDrawn,
+        DrawCalls,
+        Triangles,
+        ShaderChanges,
+        ShadowMaps,
+        ShadowCasters,
+        Lights,
+        ShadowedLights,
+        ParticleSystems,
+        Particles,
+        Sprites,
+        Count,
+    };
+}
+
+// Counts the work the renderers submit each frame. Every thread adds to counters of its own so
+// renderers recording on worker threads never contend, the counters only ever grow and the
+// totals of all the threads are compared with those of the previous frame in EndFrame
+class RenderStats
+{
+private:
+    struct THREAD_INFO
+    {
+        // Only written by the thread that owns them
+        volatile UINT Counts[RenderCounter::Count];
+    };
+    std::vector<THREAD_INFO*> _threads;
+    CRITICAL_SECTION _threadLock;
+
+    UINT _totals[RenderCounter::Count];
+    UINT _frameCounts[RenderCounter::Count];
+
+    THREAD_INFO* getThread();
+
+    static RenderStats _instance;
+
+    RenderStats();
+    ~RenderStats();
+
+public:
+    // Can be called from any thread
+    void Add(UINT counter, UINT value)
+    {
+        THREAD_INFO* thread = getThread();
+        thread->Counts[counter] += value;
+    }
+
+    // Called once all the work of the frame has been submitted, the counts of that frame are
+    // kept until the next call
+    void EndFrame();
+
+    UINT GetCount(UINT counter) const { return _frameCounts[counter]; }
+    static const WCHAR* GetCounterName(UINT counter);
+
+    static RenderStats* GetInstance();
+};
\ No newline at end of file
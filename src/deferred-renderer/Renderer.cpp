@@ -2,26 +2,17 @@
 #include "Renderer.h"
 #include "Logger.h"
 
-Renderer::Renderer()
-    : _begun(false), _ambientLight(XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f)
-{
-    for (UINT i = 0; i < 2; i++)
-    {
-        _ppShaderResourceViews[i] = NULL;
-        _ppRenderTargetViews[i] = NULL;
-    }
-}
+using std::tr1::bind;
+using std::tr1::mem_fn;
+using namespace std::tr1::placeholders;
 
-void Renderer::swapPPBuffers()
+Renderer::Renderer()
+    : _begun(false), _shadowAtlas(SHADOW_ATLAS_SIZE, MIN_SHADOW_REGION_SIZE, MAX_SHADOW_REGION_SIZE),
+      _ambientLight(XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f)
 {
-    ID3D11ShaderResourceView* tmpSRV = _ppShaderResourceViews[0];
-    ID3D11RenderTargetView* tmpRTV = _ppRenderTargetViews[0];
-
-    _ppShaderResourceViews[0] = _ppShaderResourceViews[1];
-    _ppRenderTargetViews[0] = _ppRenderTargetViews[1];
-
-    _ppShaderResourceViews[1] = tmpSRV;
-    _ppRenderTargetViews[1] = tmpRTV;
+    ZeroMemory(&_ppTargetDesc, sizeof(FrameGraphTargetDesc));
+    ZeroMemory(&_prevGraphStats, sizeof(FrameGraphStats));
+    ZeroMemory(&_prevAtlasStats, sizeof(ShadowAtlasStats));
 }
 
 void Renderer::AddModel(ModelInstance* model)
@@ -29,6 +20,10 @@ void Renderer::AddModel(ModelInstance* model)
     if (model && _begun)
     {
         _models.push_back(model);
+
+        // Instances stay registered with the scene bounds for as long as they are
+        // submitted, moving them only marks them to be merged in on the next query
+        _sceneBounds.Submit(model);
     }
 }
 
@@ -73,6 +68,151 @@ HRESULT Renderer::Begin()
     return S_OK;
 }
 
+HRESULT Renderer::clearShadowAtlas(ID3D11DeviceContext* context)
+{
+    if (_shadowAtlas.GetStats().RegionCount > 0)
+    {
+        context->ClearDepthStencilView(_shadowAtlas.GetDSV(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+    }
+
+    return S_OK;
+}
+
+HRESULT Renderer::renderShadowMaps(ID3D11DeviceContext* context, LightRendererBase* lightRenderer, Camera* camera,
+                                   AxisAlignedBox* sceneBounds)
+{
+    return lightRenderer->RenderGeometryShadowMaps(context, &_models, camera, sceneBounds);
+}
+
+HRESULT Renderer::renderGBuffer(ID3D11DeviceContext* context, Camera* camera)
+{
+    HRESULT hr;
+
+    V_RETURN(_gBuffer.Clear(context));
+
+    ID3D11RenderTargetView* gBufferRTVs[3] =
+    {
+        _gBuffer.GetDiffuseRTV(),
+        _gBuffer.GetNormalRTV(),
+        _gBuffer.GetVelocityRTV(),
+    };
+    context->OMSetRenderTargets(3, gBufferRTVs, _gBuffer.GetDepthDSV());
+
+    V_RETURN(_modelRenderer.RenderModels(context, &_models, camera));
+
+    return S_OK;
+}
+
+HRESULT Renderer::renderParticles(ID3D11DeviceContext* context, Camera* camera)
+{
+    HRESULT hr;
+
+    V_RETURN(_particleBuffer.Clear(context));
+
+    ID3D11RenderTargetView* particleBufferRTVs[3] =
+    {
+        _particleBuffer.GetDiffuseRTV(),
+        _particleBuffer.GetNormalRTV(),
+        _particleBuffer.GetVelocityRTV(),
+    };
+    context->OMSetRenderTargets(3, particleBufferRTVs, _gBuffer.GetReadOnlyDepthDSV());
+
+    V_RETURN(_particleRenderer.RenderParticles(context, &_particleSystems, camera, &_gBuffer));
+
+    return S_OK;
+}
+
+HRESULT Renderer::renderGeometryLights(ID3D11DeviceContext* context, Camera* camera)
+{
+    HRESULT hr;
+
+    V_RETURN(_lightBuffer.Clear(context));
+    _lightBuffer.SetAmbientColor(_ambientLight.GetColor());
+    _lightBuffer.SetAmbientBrightness(_ambientLight.GetBrightness());
+
+    ID3D11RenderTargetView* lightBufferGetometryRTVs[3] =
+    {
+        _lightBuffer.GetGeometryLightRTV(),
+        NULL,
+        NULL,
+    };
+    context->OMSetRenderTargets(3, lightBufferGetometryRTVs, _gBuffer.GetReadOnlyDepthDSV());
+
+    for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
+    {
+        V_RETURN(it->second->RenderGeometryLights(context, camera, &_gBuffer));
+    }
+
+    return S_OK;
+}
+
+HRESULT Renderer::renderParticleLights(ID3D11DeviceContext* context, Camera* camera)
+{
+    HRESULT hr;
+
+    ID3D11RenderTargetView* lightBufferGetometryRTVs[1] =
+    {
+        _lightBuffer.GetParticleLightRTV(),
+    };
+    context->OMSetRenderTargets(1, lightBufferGetometryRTVs, _gBuffer.GetReadOnlyDepthDSV());
+
+    for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
+    {
+        V_RETURN(it->second->RenderParticleLights(context, camera, &_particleBuffer));
+    }
+
+    ID3D11RenderTargetView* nullRTV[1] = { NULL };
+    context->OMSetRenderTargets(1, nullRTV, NULL);
+
+    return S_OK;
+}
+
+HRESULT Renderer::renderPostProcess(ID3D11DeviceContext* context, PostProcess* postProcess, UINT srcTarget,
+                                    UINT dstTarget, Camera* camera)
+{
+    ID3D11ShaderResourceView* srcSRV = (srcTarget != FrameGraph::INVALID_TARGET) ?
+        _frameGraph.GetSRV(srcTarget) : NULL;
+    ID3D11RenderTargetView* dstRTV = _frameGraph.GetRTV(dstTarget);
+
+    return postProcess->Render(context, srcSRV, dstRTV, camera, &_gBuffer, &_particleBuffer, &_lightBuffer);
+}
+
+void Renderer::logGraphStats()
+{
+    const FrameGraphStats& stats = _frameGraph.GetStats();
+    if (stats.PassCount == _prevGraphStats.PassCount && stats.CulledPassCount == _prevGraphStats.CulledPassCount &&
+        stats.DeferredPassCount == _prevGraphStats.DeferredPassCount && stats.TextureCount == _prevGraphStats.TextureCount &&
+        stats.TransientMemory == _prevGraphStats.TransientMemory)
+    {
+        return;
+    }
+    _prevGraphStats = stats;
+
+    WCHAR msg[256];
+    swprintf_s(msg, L"%u passes (%u culled, %u deferred), %u transient targets in %u textures using %.1f MB, "
+        L"%.1f MB without aliasing", stats.PassCount, stats.CulledPassCount, stats.DeferredPassCount,
+        stats.TransientTargetCount, stats.TextureCount,
+        stats.TransientMemory / (1024.0f * 1024.0f), stats.UnaliasedMemory / (1024.0f * 1024.0f));
+    LOG_INFO(L"Renderer", msg);
+}
+
+void Renderer::logShadowAtlasStats()
+{
+    const ShadowAtlasStats& stats = _shadowAtlas.GetStats();
+    if (stats.RequestCount == _prevAtlasStats.RequestCount && stats.AllocatedCount == _prevAtlasStats.AllocatedCount &&
+        stats.ReducedCount == _prevAtlasStats.ReducedCount && stats.UsedTexels == _prevAtlasStats.UsedTexels)
+    {
+        return;
+    }
+    _prevAtlasStats = stats;
+
+    WCHAR msg[256];
+    swprintf_s(msg, L"Shadow atlas: %u of %u lights shadowed (%u at a reduced size), %u regions using %.1f%% of "
+        L"the atlas", stats.AllocatedCount, stats.RequestCount, stats.ReducedCount, stats.RegionCount,
+        stats.TotalTexels > 0 ? (100.0f * stats.UsedTexels) / stats.TotalTexels : 0.0f);
+    LOG_INFO(L"Renderer", msg);
+}
+
 HRESULT Renderer::End(ID3D11DeviceContext* pd3dImmediateContext, Camera* viewCamera, Camera* clipCamera)
 {
     HRESULT hr;
@@ -95,159 +235,142 @@ HRESULT Renderer::End(ID3D11DeviceContext* pd3dImmediateContext, Camera* viewCam
     AxisAlignedBox sceneBounds;
     BEGIN_EVENT(L"Calculate scene bounds");
     {
-        if (_models.size() > 0)
-        {
-            sceneBounds = _models[0]->GetAxisAlignedBox();
-            for (UINT i = 1; i < _models.size(); i++)
-            {
-                AxisAlignedBox modelAABB = _models[i]->GetAxisAlignedBox();
-
-                Collision::MergeAxisAlignedBoxes(&sceneBounds, &sceneBounds, &modelAABB);
-            }
-        }
+        _sceneBounds.RemoveUnsubmitted();
+        sceneBounds = _sceneBounds.GetBounds();
     }
     END_EVENT(L"");
 
-    // render the shadow maps
-    BEGIN_EVENT_D3D(L"Shadow Maps");
+    // The lights of every type share the atlas, so all of them request their regions before any
+    // are placed
+    BEGIN_EVENT(L"Allocate shadow atlas");
+    _shadowAtlas.Begin();
+    for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
     {
-        for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
-        {
-            V_RETURN(it->second->RenderGeometryShadowMaps(pd3dImmediateContext, &_models, viewCamera, &sceneBounds));
-        }
+        it->second->RequestShadowMaps(&_shadowAtlas, viewCamera);
     }
-    END_EVENT_D3D(L"");
+    _shadowAtlas.Allocate();
+    END_EVENT(L"");
 
-    // Render the scene to the gbuffer
-    BEGIN_EVENT_D3D(L"G-Buffer");
-    {
-        V_RETURN(_gBuffer.Clear(pd3dImmediateContext));
+    logShadowAtlasStats();
 
-        ID3D11RenderTargetView* gBufferRTVs[3] =
-        {
-            _gBuffer.GetDiffuseRTV(),
-            _gBuffer.GetNormalRTV(),
-            _gBuffer.GetVelocityRTV(),
-        };
-        pd3dImmediateContext->OMSetRenderTargets(3, gBufferRTVs, _gBuffer.GetDepthDSV());
+    BEGIN_EVENT(L"Build frame graph");
+    _frameGraph.Reset();
 
-        V_RETURN(_modelRenderer.RenderModels(pd3dImmediateContext, &_models, viewCamera));
-    }
-    END_EVENT_D3D(L"");
+    // Everything but the post process results is owned elsewhere, the buffers are imported
+    // without views only so that the passes can depend on each other through them
+    UINT backBuffer = _frameGraph.ImportTarget(L"Back buffer", NULL, pOrigRTV);
+    UINT shadowMaps = _frameGraph.ImportTarget(L"Shadow maps", NULL, NULL);
+    UINT gBuffer = _frameGraph.ImportTarget(L"G-Buffer", NULL, NULL);
+    UINT particleBuffer = _frameGraph.ImportTarget(L"Particle buffer", NULL, NULL);
+    UINT lightBuffer = _frameGraph.ImportTarget(L"Light buffer", NULL, NULL);
+    _frameGraph.MarkOutput(backBuffer);
 
-    // Render the particles
-    BEGIN_EVENT_D3D(L"Particles");
-    {
-        V_RETURN(_particleBuffer.Clear(pd3dImmediateContext));
+    // The shadow maps of each light type, the g-buffer and the particles are each drawn by their
+    // own renderer so they can be recorded in parallel
+    UINT pass = _frameGraph.AddPass(L"Clear Shadow Atlas", bind(mem_fn(&Renderer::clearShadowAtlas), this, _1));
+    _frameGraph.Write(pass, shadowMaps);
 
-        ID3D11RenderTargetView* particleBufferRTVs[3] =
-        {
-            _particleBuffer.GetDiffuseRTV(),
-            _particleBuffer.GetNormalRTV(),
-            _particleBuffer.GetVelocityRTV(),
-        };
-        pd3dImmediateContext->OMSetRenderTargets(3, particleBufferRTVs, _gBuffer.GetReadOnlyDepthDSV());
+    UINT lightRendererIdx = 0;
+    for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
+    {
+        WCHAR passName[64];
+        swprintf_s(passName, L"Shadow Maps %u", lightRendererIdx++);
 
-        V_RETURN(_particleRenderer.RenderParticles(pd3dImmediateContext, &_particleSystems, viewCamera, &_gBuffer));
+        pass = _frameGraph.AddPass(passName,
+            bind(mem_fn(&Renderer::renderShadowMaps), this, _1, it->second, viewCamera, &sceneBounds), false, true);
+        _frameGraph.Write(pass, shadowMaps);
     }
-    END_EVENT_D3D(L"");
-
-    V_RETURN(_lightBuffer.Clear(pd3dImmediateContext));
-    _lightBuffer.SetAmbientColor(_ambientLight.GetColor());
-    _lightBuffer.SetAmbientBrightness(_ambientLight.GetBrightness());
 
-    // render the lights
-    BEGIN_EVENT_D3D(L"Geometry Lights");
+    pass = _frameGraph.AddPass(L"G-Buffer", bind(mem_fn(&Renderer::renderGBuffer), this, _1, viewCamera), false,
+        true);
+    _frameGraph.Write(pass, gBuffer);
+
+    pass = _frameGraph.AddPass(L"Particles", bind(mem_fn(&Renderer::renderParticles), this, _1, viewCamera), false,
+        true);
+    _frameGraph.Read(pass, gBuffer);
+    _frameGraph.Write(pass, particleBuffer);
+
+    pass = _frameGraph.AddPass(L"Geometry Lights",
+        bind(mem_fn(&Renderer::renderGeometryLights), this, _1, viewCamera));
+    _frameGraph.Read(pass, gBuffer);
+    _frameGraph.Read(pass, shadowMaps);
+    _frameGraph.Write(pass, lightBuffer);
+
+    pass = _frameGraph.AddPass(L"Particle Lights",
+        bind(mem_fn(&Renderer::renderParticleLights), this, _1, viewCamera));
+    _frameGraph.Read(pass, gBuffer);
+    _frameGraph.Read(pass, particleBuffer);
+    _frameGraph.Read(pass, shadowMaps);
+    _frameGraph.Write(pass, lightBuffer);
+
+    // Find the final non-additive pp
+    UINT lastNonAdditive = 0;
+    for (UINT i = _postProcesses.size() - 1; i > 0; i--)
     {
-        ID3D11RenderTargetView* lightBufferGetometryRTVs[3] =
-        {
-            _lightBuffer.GetGeometryLightRTV(),
-            NULL,
-            NULL,
-        };
-        pd3dImmediateContext->OMSetRenderTargets(3, lightBufferGetometryRTVs, _gBuffer.GetReadOnlyDepthDSV());
-
-        for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
+        if (!_postProcesses[i]->GetIsAdditive())
         {
-            V_RETURN(it->second->RenderGeometryLights(pd3dImmediateContext, viewCamera, &_gBuffer));
+            lastNonAdditive = i;
+            break;
         }
     }
-    END_EVENT_D3D(L"");
 
-    BEGIN_EVENT_D3D(L"Particle Lights");
+    // Every non-additive post process writes a new target, the graph only keeps as many of
+    // them in memory as are alive at once. Additive ones render on top of the current result.
+    UINT current = FrameGraph::INVALID_TARGET;
+    for (UINT i = 0; i < _postProcesses.size(); i++)
     {
-        ID3D11RenderTargetView* lightBufferGetometryRTVs[1] =
-        {
-            _lightBuffer.GetParticleLightRTV(),
-        };
-        pd3dImmediateContext->OMSetRenderTargets(1, lightBufferGetometryRTVs, _gBuffer.GetReadOnlyDepthDSV());
+        PostProcess* pp = _postProcesses[i];
+        bool isAdditive = pp->GetIsAdditive();
+
+        UINT src = (i > 0 && i <= lastNonAdditive) ? current : FrameGraph::INVALID_TARGET;
 
-        for (std::map<size_t, LightRendererBase*>::iterator it = _lightRenderers.begin(); it != _lightRenderers.end(); it++)
+        UINT dst;
+        if (i >= lastNonAdditive)
         {
-            V_RETURN(it->second->RenderParticleLights(pd3dImmediateContext, viewCamera, &_particleBuffer));
+            dst = backBuffer;
         }
-
-        ID3D11RenderTargetView* nullRTV[1] = { NULL };
-        pd3dImmediateContext->OMSetRenderTargets(1, nullRTV, NULL);
-    }
-    END_EVENT_D3D(L"");
-
-    BEGIN_EVENT_D3D(L"Post-Processes");
-    {
-        // Find the final non-additive pp
-        UINT lastNonAdditive = 0;
-        for (UINT i = _postProcesses.size() - 1; i > 0; i--)
+        else if (isAdditive)
+        {
+            dst = current;
+        }
+        else
         {
-            if (!_postProcesses[i]->GetIsAdditive())
-            {
-                lastNonAdditive = i;
-                break;
-            }
+            WCHAR targetName[64];
+            swprintf_s(targetName, L"Post-Process %u", i);
+            dst = _frameGraph.CreateTarget(targetName, _ppTargetDesc);
         }
 
-        // render the post processes
-        for (UINT i = 0; i < _postProcesses.size(); i++)
+        WCHAR passName[64];
+        swprintf_s(passName, L"Post-Process %u", i);
+        pass = _frameGraph.AddPass(passName,
+            bind(mem_fn(&Renderer::renderPostProcess), this, _1, pp, src, dst, viewCamera));
+        _frameGraph.Read(pass, gBuffer);
+        _frameGraph.Read(pass, particleBuffer);
+        _frameGraph.Read(pass, lightBuffer);
+        _frameGraph.Read(pass, src);
+        _frameGraph.Write(pass, dst);
+
+        pp->DeclareTargets(&_frameGraph, pass, _ppTargetDesc);
+
+        if (!isAdditive)
         {
-            PostProcess* pp = _postProcesses[i];
-            bool isAdditive = pp->GetIsAdditive();
-
-            // calculate source resource view
-            ID3D11ShaderResourceView* srcSRV = NULL;
-            if (i > 0 && i <= lastNonAdditive)
-            {
-                srcSRV = _ppShaderResourceViews[0];
-            }
-
-            // Calculate destination render target
-            ID3D11RenderTargetView* dstRTV = NULL;
-            if (i >= lastNonAdditive)
-            {
-                dstRTV = pOrigRTV;
-            }
-            else if (isAdditive)
-            {
-                dstRTV = _ppRenderTargetViews[0];
-            }
-            else
-            {
-                dstRTV = _ppRenderTargetViews[1];
-            }
-
-            // Render the post process
-            V_RETURN(pp->Render(pd3dImmediateContext, srcSRV, dstRTV, viewCamera, &_gBuffer, &_particleBuffer,
-                &_lightBuffer));
-
-            if (!isAdditive)
-            {
-                swapPPBuffers();
-            }
+            current = dst;
         }
     }
-    END_EVENT_D3D(L"");
+    END_EVENT(L"");
+
+    hr = _frameGraph.Execute(pd3dImmediateContext);
 
     SAFE_RELEASE(pOrigRTV);
     SAFE_RELEASE(pOrigDSV);
 
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    logGraphStats();
+
     return S_OK;
 }
 
@@ -263,6 +386,8 @@ HRESULT Renderer::OnD3D11CreateDevice(ID3D11Device* pd3dDevice, ContentManager*
     V_RETURN(_particleRenderer.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
     V_RETURN(_combinePP.OnD3D11CreateDevice(pd3dDevice, pContentManager, pBackBufferSurfaceDesc));
 
+    V_RETURN(_shadowAtlas.OnD3D11CreateDevice(pd3dDevice));
+
     return S_OK;
 }
 
@@ -274,6 +399,10 @@ void Renderer::OnD3D11DestroyDevice(ContentManager* pContentManager)
     _modelRenderer.OnD3D11DestroyDevice(pContentManager);
     _particleRenderer.OnD3D11DestroyDevice(pContentManager);
     _combinePP.OnD3D11DestroyDevice(pContentManager);
+
+    _shadowAtlas.OnD3D11DestroyDevice();
+
+    _frameGraph.ReleaseDeferredContexts();
 }
 
 HRESULT Renderer::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, ContentManager* pContentManager, IDXGISwapChain* pSwapChain,
@@ -281,60 +410,14 @@ HRESULT Renderer::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, ContentManag
 {
     HRESULT hr;
 
-    // Create the pp textures
-    D3D11_TEXTURE2D_DESC ppTextureDesc =
+    FrameGraphTargetDesc ppTargetDesc =
     {
         pBackBufferSurfaceDesc->Width,//UINT Width;
         pBackBufferSurfaceDesc->Height,//UINT Height;
-        1,//UINT MipLevels;
-        1,//UINT ArraySize;
         DXGI_FORMAT_R16G16B16A16_FLOAT,//DXGI_FORMAT Format;
-        1,//DXGI_SAMPLE_DESC SampleDesc;
-        0,
-        D3D11_USAGE_DEFAULT,//D3D11_USAGE Usage;
-        D3D11_BIND_RENDER_TARGET|D3D11_BIND_SHADER_RESOURCE,//UINT BindFlags;
-        0,//UINT CPUAccessFlags;
-        0//UINT MiscFlags;
-    };
-
-    ID3D11Texture2D* ppTextures[2];
-
-    V_RETURN(pd3dDevice->CreateTexture2D(&ppTextureDesc, NULL, &ppTextures[0]));
-    V_RETURN(pd3dDevice->CreateTexture2D(&ppTextureDesc, NULL, &ppTextures[1]));
-
-    // Create the shader resource views
-    D3D11_SHADER_RESOURCE_VIEW_DESC ppSRVDesc =
-    {
-        DXGI_FORMAT_R16G16B16A16_FLOAT,
-        D3D11_SRV_DIMENSION_TEXTURE2D,
-        0,
-        0
-    };
-    ppSRVDesc.Texture2D.MipLevels = 1;
-
-    V_RETURN(pd3dDevice->CreateShaderResourceView(ppTextures[0], &ppSRVDesc, &_ppShaderResourceViews[0]));
-    V_RETURN(SetDXDebugName(_ppShaderResourceViews[0], "Renderer post process SRV 0"));
-
-    V_RETURN(pd3dDevice->CreateShaderResourceView(ppTextures[1], &ppSRVDesc, &_ppShaderResourceViews[1]));
-    V_RETURN(SetDXDebugName(_ppShaderResourceViews[1], "Renderer post process SRV 1"));
-
-    // create the render target views
-    D3D11_RENDER_TARGET_VIEW_DESC ppRTVDesc =
-    {
-        DXGI_FORMAT_R16G16B16A16_FLOAT,
-        D3D11_RTV_DIMENSION_TEXTURE2D,
-        0,
-        0
+        1,//UINT MipLevels;
     };
-
-    V_RETURN(pd3dDevice->CreateRenderTargetView(ppTextures[0], &ppRTVDesc, &_ppRenderTargetViews[0]));
-    V_RETURN(SetDXDebugName(_ppRenderTargetViews[0], "Renderer post process RTV 0"));
-
-    V_RETURN(pd3dDevice->CreateRenderTargetView(ppTextures[1], &ppRTVDesc, &_ppRenderTargetViews[1]));
-    V_RETURN(SetDXDebugName(_ppRenderTargetViews[1], "Renderer post process RTV 1"));
-
-    SAFE_RELEASE(ppTextures[0]);
-    SAFE_RELEASE(ppTextures[1]);
+    _ppTargetDesc = ppTargetDesc;
 
     V_RETURN(_gBuffer.OnD3D11ResizedSwapChain(pd3dDevice, pContentManager, pSwapChain, pBackBufferSurfaceDesc));
     V_RETURN(_lightBuffer.OnD3D11ResizedSwapChain(pd3dDevice, pContentManager, pSwapChain, pBackBufferSurfaceDesc));
@@ -348,10 +431,7 @@ HRESULT Renderer::OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, ContentManag
 
 void Renderer::OnD3D11ReleasingSwapChain(ContentManager* pContentManager)
 {
-    SAFE_RELEASE(_ppShaderResourceViews[0]);
-    SAFE_RELEASE(_ppShaderResourceViews[1]);
-    SAFE_RELEASE(_ppRenderTargetViews[0]);
-    SAFE_RELEASE(_ppRenderTargetViews[1]);
+    _frameGraph.ReleaseTextures();
 
     _gBuffer.OnD3D11ReleasingSwapChain(pContentManager);
     _lightBuffer.OnD3D11ReleasingSwapChain(pContentManager);
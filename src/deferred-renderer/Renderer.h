@@ -13,6 +13,9 @@
 #include "IHasContent.h"
 #include "ModelRenderer.h"
 #include "ParticleRenderer.h"
+#include "SceneBounds.h"
+#include "FrameGraph.h"
+#include "ShadowAtlas.h"
 #include "xnaCollision.h"
 
 class Renderer : public IHasContent
@@ -24,6 +27,7 @@ private:
     ParticleBuffer _particleBuffer;
 
     std::vector<ModelInstance*> _models;
+    SceneBounds _sceneBounds;
     std::vector<PostProcess*> _postProcesses;
 
     std::vector<ParticleSystemInstance*> _particleSystems;
@@ -32,15 +36,37 @@ private:
     ParticleRenderer _particleRenderer;
     GeometryCombinePostProcess _combinePP;
 
-    ID3D11ShaderResourceView* _ppShaderResourceViews[2];
-    ID3D11RenderTargetView* _ppRenderTargetViews[2];
+    // The frame is rebuilt as a graph every frame, the intermediate post process results are
+    // transient targets of this description
+    FrameGraph _frameGraph;
+    FrameGraphTargetDesc _ppTargetDesc;
+    FrameGraphStats _prevGraphStats;
+
+    // The shadow maps of the point lights, and of any other light type that asks for regions,
+    // share one atlas whose regions are handed out again every frame
+    static const UINT SHADOW_ATLAS_SIZE = 4096;
+    static const UINT MIN_SHADOW_REGION_SIZE = 64;
+    static const UINT MAX_SHADOW_REGION_SIZE = 1024;
+    ShadowAtlas _shadowAtlas;
+    ShadowAtlasStats _prevAtlasStats;
 
     AmbientLight _ambientLight;
 
     typedef size_t LightTypeHash;
     std::map<LightTypeHash, LightRendererBase*> _lightRenderers;
 
-    void swapPPBuffers();
+    HRESULT clearShadowAtlas(ID3D11DeviceContext* context);
+    HRESULT renderShadowMaps(ID3D11DeviceContext* context, LightRendererBase* lightRenderer, Camera* camera,
+        AxisAlignedBox* sceneBounds);
+    HRESULT renderGBuffer(ID3D11DeviceContext* context, Camera* camera);
+    HRESULT renderParticles(ID3D11DeviceContext* context, Camera* camera);
+    HRESULT renderGeometryLights(ID3D11DeviceContext* context, Camera* camera);
+    HRESULT renderParticleLights(ID3D11DeviceContext* context, Camera* camera);
+    HRESULT renderPostProcess(ID3D11DeviceContext* context, PostProcess* postProcess, UINT srcTarget, UINT dstTarget,
+        Camera* camera);
+
+    void logGraphStats();
+    void logShadowAtlasStats();
 
 public:
     Renderer();
@@ -82,6 +108,13 @@ public:
     void AddParticleSystem(ParticleSystemInstance* particleSystem);
     void AddPostProcess(PostProcess* postProcess);
 
+    SceneBounds* GetSceneBounds() { return &_sceneBounds; }
+
+    // Independent passes are recorded on deferred contexts across the pool when one is set
+    void SetThreadPool(ThreadPool* threadPool) { _frameGraph.SetThreadPool(threadPool); }
+    const FrameGraphStats& GetFrameGraphStats() const { return _frameGraph.GetStats(); }
+    const ShadowAtlasStats& GetShadowAtlasStats() const { return _shadowAtlas.GetStats(); }
+
     HRESULT Begin();
     HRESULT End(ID3D11DeviceContext* pd3dImmediateContext, Camera* camera, Camera* clipCamera = NULL);
 
@@ -0,0 +1,265 @@
+#include "PCH.h"
+#include "SceneBounds.h"
+#include "ModelInstance.h"
+
+SceneBounds::SceneBounds()
+    : _min(FLT_MAX, FLT_MAX, FLT_MAX), _max(-FLT_MAX, -FLT_MAX, -FLT_MAX), _shrinkInterval(30),
+      _shrinkCountdown(0), _shrinkPending(false), _submitFrame(0),
+      _submitCount(0)
+{
+    _bounds.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    _bounds.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+SceneBounds::~SceneBounds()
+{
+    for (UINT i = 0; i < _entries.size(); i++)
+    {
+        _entries[i].Instance->setSceneBounds(NULL, 0);
+    }
+}
+
+void SceneBounds::grow(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+    _min.x = min(_min.x, boxMin.x);
+    _min.y = min(_min.y, boxMin.y);
+    _min.z = min(_min.z, boxMin.z);
+
+    _max.x = max(_max.x, boxMax.x);
+    _max.y = max(_max.y, boxMax.y);
+    _max.z = max(_max.z, boxMax.z);
+}
+
+bool SceneBounds::touchesEdge(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) const
+{
+    return boxMin.x <= _min.x || boxMin.y <= _min.y || boxMin.z <= _min.z ||
+           boxMax.x >= _max.x || boxMax.y >= _max.y || boxMax.z >= _max.z;
+}
+
+void SceneBounds::recompute()
+{
+    _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+    _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    // Moved instances that are still waiting on their transforms keep their previous
+    // boxes, those that were never read are empty and do not grow the bounds
+    for (UINT i = 0; i < _entries.size(); i++)
+    {
+        grow(_entries[i].Min, _entries[i].Max);
+    }
+
+    _shrinkPending = false;
+}
+
+void SceneBounds::updateBounds()
+{
+    if (_entries.size() == 0)
+    {
+        _bounds.Center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        _bounds.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        return;
+    }
+
+    _bounds.Center.x = (_max.x + _min.x) * 0.5f;
+    _bounds.Center.y = (_max.y + _min.y) * 0.5f;
+    _bounds.Center.z = (_max.z + _min.z) * 0.5f;
+
+    _bounds.Extents.x = (_max.x - _min.x) * 0.5f;
+    _bounds.Extents.y = (_max.y - _min.y) * 0.5f;
+    _bounds.Extents.z = (_max.z - _min.z) * 0.5f;
+}
+
+void SceneBounds::Insert(ModelInstance* instance)
+{
+    if (!instance || instance->GetSceneBounds())
+    {
+        return;
+    }
+
+    // The box is read the next time the bounds are queried, the instance may not
+    // have loaded its model yet. Its current transforms are used as they are.
+    ENTRY_INFO entry;
+    entry.Instance = instance;
+    entry.Min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+    entry.Max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    entry.Moved = true;
+    entry.MovedUpdate = instance->getTransformUpdateCount() - 1;
+    entry.LastMovedUpdate = entry.MovedUpdate;
+    entry.SubmitFrame = _submitFrame;
+    _submitCount++;
+
+    instance->setSceneBounds(this, _entries.size());
+    _entries.push_back(entry);
+    _movedInstances.push_back(instance);
+}
+
+void SceneBounds::Remove(ModelInstance* instance)
+{
+    if (!instance || instance->GetSceneBounds() != this)
+    {
+        return;
+    }
+
+    UINT idx = instance->getSceneBoundsIndex();
+    ENTRY_INFO& entry = _entries[idx];
+
+    if (entry.Moved)
+    {
+        _movedInstances.erase(std::find(_movedInstances.begin(), _movedInstances.end(), instance));
+    }
+    if (entry.Min.x <= entry.Max.x && touchesEdge(entry.Min, entry.Max))
+    {
+        _shrinkPending = true;
+    }
+    if (entry.SubmitFrame == _submitFrame)
+    {
+        _submitCount--;
+    }
+
+    // Swap the last entry into the removed slot
+    UINT lastIdx = _entries.size() - 1;
+    if (idx != lastIdx)
+    {
+        _entries[idx] = _entries[lastIdx];
+        _entries[idx].Instance->setSceneBounds(this, idx);
+    }
+    _entries.pop_back();
+
+    instance->setSceneBounds(NULL, 0);
+
+    if (_entries.size() == 0)
+    {
+        _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+        _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        _shrinkPending = false;
+    }
+}
+
+void SceneBounds::MarkMoved(ModelInstance* instance)
+{
+    if (!instance || instance->GetSceneBounds() != this)
+    {
+        return;
+    }
+
+    ENTRY_INFO& entry = _entries[instance->getSceneBoundsIndex()];
+    entry.LastMovedUpdate = instance->getTransformUpdateCount();
+    if (!entry.Moved)
+    {
+        entry.Moved = true;
+        entry.MovedUpdate = entry.LastMovedUpdate;
+        _movedInstances.push_back(instance);
+    }
+}
+
+void SceneBounds::Submit(ModelInstance* instance)
+{
+    if (!instance)
+    {
+        return;
+    }
+
+    if (!instance->GetSceneBounds())
+    {
+        Insert(instance);
+    }
+    else if (instance->GetSceneBounds() == this)
+    {
+        ENTRY_INFO& entry = _entries[instance->getSceneBoundsIndex()];
+        if (entry.SubmitFrame != _submitFrame)
+        {
+            entry.SubmitFrame = _submitFrame;
+            _submitCount++;
+        }
+    }
+}
+
+void SceneBounds::RemoveUnsubmitted()
+{
+    // Usually everything was submitted again and nothing has to be searched for
+    if (_submitCount < _entries.size())
+    {
+        // Walk backwards so that the entry swapped into a removed slot has already
+        // been checked
+        for (UINT i = _entries.size(); i > 0; i--)
+        {
+            if (_entries[i - 1].SubmitFrame != _submitFrame)
+            {
+                Remove(_entries[i - 1].Instance);
+            }
+        }
+    }
+
+    _submitFrame++;
+    _submitCount = 0;
+}
+
+const AxisAlignedBox& SceneBounds::GetBounds()
+{
+    bool changed = false;
+
+    // Merge in the new boxes of anything that was added or moved since the last query,
+    // only these instances need their boxes read
+    UINT remaining = 0;
+    for (UINT i = 0; i < _movedInstances.size(); i++)
+    {
+        ModelInstance* instance = _movedInstances[i];
+        ENTRY_INFO& entry = _entries[instance->getSceneBoundsIndex()];
+
+        // When simulation is pipelined the moves of the next frame are made before the
+        // current one is rendered, the box is stale until the transforms are updated
+        UINT updateCount = instance->getTransformUpdateCount();
+        if (entry.MovedUpdate == updateCount)
+        {
+            _movedInstances[remaining++] = instance;
+            continue;
+        }
+
+        if (!_shrinkPending && entry.Min.x <= entry.Max.x && touchesEdge(entry.Min, entry.Max))
+        {
+            // This instance may have been the one holding the bounds out
+            _shrinkPending = true;
+        }
+
+        const AxisAlignedBox& aabb = instance->GetAxisAlignedBox();
+        entry.Min = XMFLOAT3(aabb.Center.x - aabb.Extents.x, aabb.Center.y - aabb.Extents.y,
+            aabb.Center.z - aabb.Extents.z);
+        entry.Max = XMFLOAT3(aabb.Center.x + aabb.Extents.x, aabb.Center.y + aabb.Extents.y,
+            aabb.Center.z + aabb.Extents.z);
+
+        grow(entry.Min, entry.Max);
+        changed = true;
+
+        // Moved again after the update that was just read
+        if (entry.LastMovedUpdate == updateCount)
+        {
+            entry.MovedUpdate = updateCount;
+            _movedInstances[remaining++] = instance;
+        }
+        else
+        {
+            entry.Moved = false;
+        }
+    }
+    _movedInstances.resize(remaining);
+
+    // The bounds are always conservative, shrinking them is only needed for tighter
+    // shadow fitting so it is rate limited
+    if (_shrinkCountdown > 0)
+    {
+        _shrinkCountdown--;
+    }
+    if (_shrinkPending && _shrinkCountdown == 0)
+    {
+        recompute();
+        _shrinkCountdown = _shrinkInterval;
+        changed = true;
+    }
+
+    if (changed || _entries.size() == 0)
+    {
+        updateBounds();
+    }
+
+    return _bounds;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "PCH.h"
+#include "xnaCollision.h"
+
+class ModelInstance;
+
+// Tracks the union of the bounds of every registered model instance. Instances
+// are merged in as they are added or moved so the bounds only ever grow
+// incrementally; shrinking is deferred until an instance that touched the edge of
+// the bounds has moved away or been removed.
+//
+// Moves are made before the transforms are updated, so a moved instance's box is
+// only read once its transforms have been updated since it was marked. Until then
+// its previous box still covers what is being rendered.
+//
+// Submitted instances are registered for as long as they keep being submitted,
+// RemoveUnsubmitted drops those that were not submitted since its last call so the
+// bounds only cover what is being rendered.
+class SceneBounds
+{
+private:
+    struct ENTRY_INFO
+    {
+        ModelInstance* Instance;
+        XMFLOAT3 Min;
+        XMFLOAT3 Max;
+        bool Moved;
+        UINT MovedUpdate;
+        UINT LastMovedUpdate;
+        UINT SubmitFrame;
+    };
+    std::vector<ENTRY_INFO> _entries;
+    std::vector<ModelInstance*> _movedInstances;
+
+    XMFLOAT3 _min;
+    XMFLOAT3 _max;
+    AxisAlignedBox _bounds;
+
+    // Number of queries to wait before shrinking the bounds after it becomes
+    // too large, so that dragging an object on the edge of the scene does not
+    // cause a full recompute every frame
+    UINT _shrinkInterval;
+    UINT _shrinkCountdown;
+    bool _shrinkPending;
+
+    // The number of entries submitted since the last RemoveUnsubmitted, the entries only
+    // need to be searched when it is short of all of them
+    UINT _submitFrame;
+    UINT _submitCount;
+
+    void grow(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax);
+    bool touchesEdge(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax) const;
+    void recompute();
+    void updateBounds();
+
+public:
+    SceneBounds();
+    ~SceneBounds();
+
+    void Insert(ModelInstance* instance);
+    void Remove(ModelInstance* instance);
+    void MarkMoved(ModelInstance* instance);
+
+    // Registers the instance if it is not yet and keeps it registered through the
+    // next RemoveUnsubmitted
+    void Submit(ModelInstance* instance);
+    void RemoveUnsubmitted();
+
+    UINT GetInstanceCount() const { return _entries.size(); }
+
+    UINT GetShrinkInterval() const { return _shrinkInterval; }
+    void SetShrinkInterval(UINT interval) { _shrinkInterval = interval; }
+
+    const AxisAlignedBox& GetBounds();
+};
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "PCH.h"
+#include "ShadowAtlas.h"
+
+ShadowAtlas::ShadowAtlas(UINT size, UINT minRegionSize, UINT maxRegionSize)
+    : _size(size), _minRegionSize(minRegionSize), _maxRegionSize(min(maxRegionSize, size)), _dsv(NULL), _srv(NULL)
+{
+    ZeroMemory(&_stats, sizeof(ShadowAtlasStats));
+    Begin();
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+    OnD3D11DestroyDevice();
+}
+
+UINT ShadowAtlas::allocateNode(UINT node, UINT size)
+{
+    // The node list can grow while splitting, so nodes are always looked up by index
+    if (_nodes[node].Size < size || _nodes[node].State == NODE_USED)
+    {
+        return INVALID_NODE;
+    }
+
+    if (_nodes[node].Size == size)
+    {
+        if (_nodes[node].State != NODE_FREE)
+        {
+            return INVALID_NODE;
+        }
+
+        _nodes[node].State = NODE_USED;
+        return node;
+    }
+
+    if (_nodes[node].State == NODE_FREE)
+    {
+        if (_nodes[node].FirstChild == INVALID_NODE)
+        {
+            _nodes[node].FirstChild = _nodes.size();
+            for (UINT i = 0; i < 4; i++)
+            {
+                NODE_INFO child;
+                child.Size = _nodes[node].Size / 2;
+                child.X = _nodes[node].X + (i % 2) * child.Size;
+                child.Y = _nodes[node].Y + (i / 2) * child.Size;
+                child.State = NODE_FREE;
+                child.Parent = node;
+                child.FirstChild = INVALID_NODE;
+
+                _nodes.push_back(child);
+            }
+        }
+        else
+        {
+            for (UINT i = 0; i < 4; i++)
+            {
+                _nodes[_nodes[node].FirstChild + i].State = NODE_FREE;
+            }
+        }
+
+        _nodes[node].State = NODE_SPLIT;
+    }
+
+    for (UINT i = 0; i < 4; i++)
+    {
+        UINT allocated = allocateNode(_nodes[node].FirstChild + i, size);
+        if (allocated != INVALID_NODE)
+        {
+            return allocated;
+        }
+    }
+
+    return INVALID_NODE;
+}
+
+void ShadowAtlas::freeNode(UINT node)
+{
+    _nodes[node].State = NODE_FREE;
+
+    // Merge the parents back together once all of their children are free
+    UINT parent = _nodes[node].Parent;
+    while (parent != INVALID_NODE)
+    {
+        for (UINT i = 0; i < 4; i++)
+        {
+            if (_nodes[_nodes[parent].FirstChild + i].State != NODE_FREE)
+            {
+                return;
+            }
+        }
+
+        _nodes[parent].State = NODE_FREE;
+        parent = _nodes[parent].Parent;
+    }
+}
+
+bool ShadowAtlas::allocateRequest(REQUEST_INFO* request, UINT size)
+{
+    UINT firstRegion = _regionNodes.size();
+    for (UINT i = 0; i < request->RegionCount; i++)
+    {
+        UINT node = allocateNode(0, size);
+        if (node == INVALID_NODE)
+        {
+            // Give back the regions that did fit so the smaller size starts from the same atlas
+            for (UINT j = firstRegion; j < _regionNodes.size(); j++)
+            {
+                freeNode(_regionNodes[j]);
+            }
+            _regionNodes.resize(firstRegion);
+
+            return false;
+        }
+
+        _regionNodes.push_back(node);
+    }
+
+    request->FirstRegion = firstRegion;
+    request->AllocatedSize = size;
+
+    return true;
+}
+
+void ShadowAtlas::Begin()
+{
+    _requests.clear();
+    _regionNodes.clear();
+
+    NODE_INFO root;
+    root.X = 0;
+    root.Y = 0;
+    root.Size = _size;
+    root.State = NODE_FREE;
+    root.Parent = INVALID_NODE;
+    root.FirstChild = INVALID_NODE;
+
+    _nodes.clear();
+    _nodes.push_back(root);
+}
+
+UINT ShadowAtlas::Request(UINT size, UINT regionCount, float priority)
+{
+    size = clamp(size, _minRegionSize, _maxRegionSize);
+
+    UINT regionSize = _minRegionSize;
+    while (regionSize * 2 <= size)
+    {
+        regionSize *= 2;
+    }
+
+    REQUEST_INFO request;
+    request.Size = regionSize;
+    request.RegionCount = regionCount;
+    request.Priority = priority;
+    request.FirstRegion = 0;
+    request.AllocatedSize = 0;
+
+    _requests.push_back(request);
+    return _requests.size() - 1;
+}
+
+void ShadowAtlas::Allocate()
+{
+    ZeroMemory(&_stats, sizeof(ShadowAtlasStats));
+    _stats.RequestCount = _requests.size();
+    _stats.TotalTexels = (UINT64)_size * _size;
+
+    std::vector<REQUEST_ORDER_INFO> order(_requests.size());
+    for (UINT i = 0; i < _requests.size(); i++)
+    {
+        order[i].Request = i;
+        order[i].Priority = _requests[i].Priority;
+    }
+    std::stable_sort(order.begin(), order.end(), priorityCompare);
+
+    for (UINT i = 0; i < order.size(); i++)
+    {
+        REQUEST_INFO& request = _requests[order[i].Request];
+
+        for (UINT size = request.Size; size >= _minRegionSize; size /= 2)
+        {
+            if (allocateRequest(&request, size))
+            {
+                _stats.AllocatedCount++;
+                _stats.RegionCount += request.RegionCount;
+                _stats.UsedTexels += (UINT64)size * size * request.RegionCount;
+                if (size < request.Size)
+                {
+                    _stats.ReducedCount++;
+                }
+                break;
+            }
+        }
+    }
+}
+
+bool ShadowAtlas::GetRegion(UINT request, UINT idx, ShadowAtlasRegion* region) const
+{
+    if (request >= _requests.size() || _requests[request].AllocatedSize == 0 ||
+        idx >= _requests[request].RegionCount)
+    {
+        return false;
+    }
+
+    const NODE_INFO& node = _nodes[_regionNodes[_requests[request].FirstRegion + idx]];
+    region->X = node.X;
+    region->Y = node.Y;
+    region->Size = node.Size;
+
+    return true;
+}
+
+void ShadowAtlas::GetViewport(const ShadowAtlasRegion& region, D3D11_VIEWPORT* viewport)
+{
+    viewport->TopLeftX = (float)region.X;
+    viewport->TopLeftY = (float)region.Y;
+    viewport->Width = (float)region.Size;
+    viewport->Height = (float)region.Size;
+    viewport->MinDepth = 0.0f;
+    viewport->MaxDepth = 1.0f;
+}
+
+XMFLOAT4 ShadowAtlas::GetTexCoordTransform(const ShadowAtlasRegion& region) const
+{
+    float invSize = 1.0f / _size;
+    return XMFLOAT4(region.Size * invSize, region.Size * invSize, region.X * invSize, region.Y * invSize);
+}
+
+HRESULT ShadowAtlas::OnD3D11CreateDevice(ID3D11Device* pd3dDevice)
+{
+    HRESULT hr;
+
+    D3D11_TEXTURE2D_DESC atlasTextureDesc =
+    {
+        _size,//UINT Width;
+        _size,//UINT Height;
+        1,//UINT MipLevels;
+        1,//UINT ArraySize;
+        DXGI_FORMAT_R32_TYPELESS,//DXGI_FORMAT Format;
+        1,//DXGI_SAMPLE_DESC SampleDesc;
+        0,
+        D3D11_USAGE_DEFAULT,//D3D11_USAGE Usage;
+        D3D11_BIND_DEPTH_STENCIL|D3D11_BIND_SHADER_RESOURCE,//UINT BindFlags;
+        0,//UINT CPUAccessFlags;
+        0//UINT MiscFlags;
+    };
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC atlasSRVDesc =
+    {
+        DXGI_FORMAT_R32_FLOAT,
+        D3D11_SRV_DIMENSION_TEXTURE2D,
+        0,
+        0
+    };
+    atlasSRVDesc.Texture2D.MipLevels = 1;
+
+    D3D11_DEPTH_STENCIL_VIEW_DESC atlasDSVDesc =
+    {
+        DXGI_FORMAT_D32_FLOAT,
+        D3D11_DSV_DIMENSION_TEXTURE2D,
+        0,
+    };
+
+    ID3D11Texture2D* atlasTexture;
+    V_RETURN(pd3dDevice->CreateTexture2D(&atlasTextureDesc, NULL, &atlasTexture));
+
+    hr = pd3dDevice->CreateShaderResourceView(atlasTexture, &atlasSRVDesc, &_srv);
+    if (SUCCEEDED(hr))
+    {
+        hr = pd3dDevice->CreateDepthStencilView(atlasTexture, &atlasDSVDesc, &_dsv);
+    }
+    SAFE_RELEASE(atlasTexture);
+    V_RETURN(hr);
+
+    V_RETURN(SetDXDebugName(_srv, "Shadow atlas SRV"));
+    V_RETURN(SetDXDebugName(_dsv, "Shadow atlas DSV"));
+
+    return S_OK;
+}
+
+void ShadowAtlas::OnD3D11DestroyDevice()
+{
+    SAFE_RELEASE(_dsv);
+    SAFE_RELEASE(_srv);
+}
\ No newline at end of file
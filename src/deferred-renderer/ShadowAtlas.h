@@ -0,0 +1,129 @@
+#pragma once
+
+#include "PCH.h"
+
+struct ShadowAtlasRegion
+{
+    // In texels from the top left of the atlas, regions are square
+    UINT X;
+    UINT Y;
+    UINT Size;
+};
+
+struct ShadowAtlasStats
+{
+    // Requests are made per light, a light that did not fit at all is drawn without a shadow
+    UINT RequestCount;
+    UINT AllocatedCount;
+    UINT ReducedCount;
+
+    UINT RegionCount;
+    UINT64 UsedTexels;
+    UINT64 TotalTexels;
+};
+
+// A single depth texture shared by the shadow maps of every light that draws into it. Each frame
+// the lights request square regions with a size and a priority, the requests are then placed in
+// order of priority with a quadtree allocator. A request that does not fit at the size it asked
+// for is tried again at half the size until it reaches the smallest region size, so the memory
+// used for shadows stays fixed however many shadowed lights there are.
+//
+// Requests are made and allocated on the main thread before the frame is rendered, the regions
+// can be read from any thread while it is.
+class ShadowAtlas
+{
+public:
+    static const UINT INVALID_REQUEST = (UINT)-1;
+
+private:
+    static const UINT INVALID_NODE = (UINT)-1;
+
+    UINT _size;
+    UINT _minRegionSize;
+    UINT _maxRegionSize;
+
+    ID3D11DepthStencilView* _dsv;
+    ID3D11ShaderResourceView* _srv;
+
+    enum NODE_STATE
+    {
+        NODE_FREE,
+        NODE_USED,
+        NODE_SPLIT,
+    };
+
+    // The four children of a node are next to each other in the node list
+    struct NODE_INFO
+    {
+        UINT X;
+        UINT Y;
+        UINT Size;
+        NODE_STATE State;
+        UINT Parent;
+        UINT FirstChild;
+    };
+    std::vector<NODE_INFO> _nodes;
+
+    struct REQUEST_INFO
+    {
+        UINT Size;
+        UINT RegionCount;
+        float Priority;
+
+        // Index of the first region node in _regionNodes, the size is 0 if nothing was allocated
+        UINT FirstRegion;
+        UINT AllocatedSize;
+    };
+    std::vector<REQUEST_INFO> _requests;
+    std::vector<UINT> _regionNodes;
+
+    struct REQUEST_ORDER_INFO
+    {
+        UINT Request;
+        float Priority;
+    };
+
+    static bool priorityCompare(const REQUEST_ORDER_INFO& i, const REQUEST_ORDER_INFO& j)
+    {
+        return i.Priority > j.Priority;
+    }
+
+    ShadowAtlasStats _stats;
+
+    UINT allocateNode(UINT node, UINT size);
+    void freeNode(UINT node);
+    bool allocateRequest(REQUEST_INFO* request, UINT size);
+
+public:
+    ShadowAtlas(UINT size, UINT minRegionSize, UINT maxRegionSize);
+    ~ShadowAtlas();
+
+    UINT GetSize() const { return _size; }
+    UINT GetMinRegionSize() const { return _minRegionSize; }
+    UINT GetMaxRegionSize() const { return _maxRegionSize; }
+
+    ID3D11DepthStencilView* GetDSV() { return _dsv; }
+    ID3D11ShaderResourceView* GetSRV() { return _srv; }
+
+    // Forgets the requests and regions of the previous frame
+    void Begin();
+
+    // Asks for regionCount regions of the same size, the size is rounded down to a power of two
+    // and clamped between the minimum and maximum region size. Higher priorities are placed first.
+    UINT Request(UINT size, UINT regionCount, float priority);
+
+    void Allocate();
+
+    // Returns false if the request did not get any space in the atlas
+    bool GetRegion(UINT request, UINT idx, ShadowAtlasRegion* region) const;
+
+    static void GetViewport(const ShadowAtlasRegion& region, D3D11_VIEWPORT* viewport);
+
+    // The scale in xy and offset in zw that move a [0, 1] texture coordinate into the region
+    XMFLOAT4 GetTexCoordTransform(const ShadowAtlasRegion& region) const;
+
+    const ShadowAtlasStats& GetStats() const { return _stats; }
+
+    HRESULT OnD3D11CreateDevice(ID3D11Device* pd3dDevice);
+    void OnD3D11DestroyDevice();
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "PCH.h"
 #include "SpriteRenderer.h"
 #include "Logger.h"
+#include "RenderStats.h"
 
 const float SpriteRenderer::SPRITE_DEPTH = 0.5f;
 
@@ -122,6 +123,9 @@ HRESULT SpriteRenderer::End(ID3D11DeviceContext* pd3d11DeviceContext)
 
         // Draw
         pd3d11DeviceContext->DrawIndexed(_textures[i].SpriteCount * 6, _textures[i].StartSprite * 6, 0);
+        ADD_RENDER_STAT(Sprites, _textures[i].SpriteCount);
+        ADD_RENDER_STAT(DrawCalls, 1);
+        ADD_RENDER_STAT(Triangles, _textures[i].SpriteCount * 2);
     }
 
     // Null the srv
@@ -0,0 +1,1147 @@
+#include "PCH.h"
+#include "StateCachingDeviceContext.h"
+
+// Stands in for a binding the cache does not know, nothing can ever be bound at this address
+template <typename T>
+static T* unknownBinding()
+{
+    return reinterpret_cast<T*>(~(UINT_PTR)0);
+}
+
+// Replaces a remembered binding, the new one is referenced and the old one released
+template <typename T>
+static void setBinding(T** binding, T* value)
+{
+    if (value && value != unknownBinding<T>())
+    {
+        value->AddRef();
+    }
+    if (*binding && *binding != unknownBinding<T>())
+    {
+        (*binding)->Release();
+    }
+    *binding = value;
+}
+
+template <typename T>
+static void forgetSlots(T** slots, UINT slotCount)
+{
+    for (UINT i = 0; i < slotCount; i++)
+    {
+        setBinding(&slots[i], unknownBinding<T>());
+    }
+}
+
+StateCachingDeviceContext::StateCachingDeviceContext()
+    : _context(NULL), _refCount(1), _inputLayout(NULL), _indexBuffer(NULL), _rasterizerState(NULL),
+      _depthStencil(NULL), _blendState(NULL), _depthStencilState(NULL)
+{
+    ZeroMemory(&_stats, sizeof(StateCacheStats));
+    ZeroMemory(_stages, sizeof(_stages));
+    ZeroMemory(_vertexBuffers, sizeof(_vertexBuffers));
+    ZeroMemory(_renderTargets, sizeof(_renderTargets));
+    Invalidate();
+}
+
+StateCachingDeviceContext::~StateCachingDeviceContext()
+{
+    // Releases everything that is remembered
+    Invalidate();
+
+    SAFE_RELEASE(_context);
+}
+
+void StateCachingDeviceContext::Reset(ID3D11DeviceContext* context)
+{
+    if (context)
+    {
+        context->AddRef();
+    }
+    SAFE_RELEASE(_context);
+    _context = context;
+
+    Invalidate();
+}
+
+void StateCachingDeviceContext::Invalidate()
+{
+    for (UINT i = 0; i < STAGE_COUNT; i++)
+    {
+        setBinding(&_stages[i].Shader, unknownBinding<ID3D11DeviceChild>());
+        forgetSlots(_stages[i].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT);
+    }
+    invalidateInputs();
+
+    setBinding(&_inputLayout, unknownBinding<ID3D11InputLayout>());
+    _topology = (D3D11_PRIMITIVE_TOPOLOGY)-1;
+
+    setBinding(&_rasterizerState, unknownBinding<ID3D11RasterizerState>());
+    _viewportCount = (UINT)-1;
+    _scissorRectCount = (UINT)-1;
+
+    forgetSlots(_renderTargets, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
+    setBinding(&_depthStencil, unknownBinding<ID3D11DepthStencilView>());
+    setBinding(&_blendState, unknownBinding<ID3D11BlendState>());
+    setBinding(&_depthStencilState, unknownBinding<ID3D11DepthStencilState>());
+}
+
+void StateCachingDeviceContext::invalidateInputs()
+{
+    for (UINT i = 0; i < STAGE_COUNT; i++)
+    {
+        forgetSlots(_stages[i].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
+        forgetSlots(_stages[i].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
+    }
+
+    forgetSlots(_vertexBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+    setBinding(&_indexBuffer, unknownBinding<ID3D11Buffer>());
+}
+
+void StateCachingDeviceContext::ResetStats()
+{
+    ZeroMemory(&_stats, sizeof(StateCacheStats));
+}
+
+template <typename T>
+bool StateCachingDeviceContext::filterSlots(T** slots, UINT slotCount, UINT startSlot, UINT count, T* const* values,
+                                            UINT* first, UINT* changed)
+{
+    _stats.SubmittedCalls++;
+
+    // Calls the runtime will reject are passed on untouched so that it can still report them
+    if (!values || startSlot >= slotCount || count > slotCount - startSlot)
+    {
+        *first = startSlot;
+        *changed = count;
+        return true;
+    }
+
+    UINT begin = count;
+    UINT end = 0;
+    for (UINT i = 0; i < count; i++)
+    {
+        if (slots[startSlot + i] != values[i])
+        {
+            setBinding(&slots[startSlot + i], values[i]);
+            begin = min(begin, i);
+            end = i + 1;
+        }
+    }
+
+    if (begin >= end)
+    {
+        _stats.FilteredCalls++;
+        return false;
+    }
+
+    *first = startSlot + begin;
+    *changed = end - begin;
+    return true;
+}
+
+template <typename T>
+bool StateCachingDeviceContext::filterState(T* current, T state)
+{
+    _stats.SubmittedCalls++;
+
+    if (*current == state)
+    {
+        _stats.FilteredCalls++;
+        return false;
+    }
+
+    *current = state;
+    return true;
+}
+
+template <typename T>
+bool StateCachingDeviceContext::filterBinding(T** current, T* binding)
+{
+    _stats.SubmittedCalls++;
+
+    if (*current == binding)
+    {
+        _stats.FilteredCalls++;
+        return false;
+    }
+
+    setBinding(current, binding);
+    return true;
+}
+
+bool StateCachingDeviceContext::filterShader(SHADER_STAGE stage, ID3D11DeviceChild* shader, UINT numClassInstances)
+{
+    // Class instances are not tracked, binding any forgets the shader so that the next bind goes
+    // through
+    if (numClassInstances > 0)
+    {
+        _stats.SubmittedCalls++;
+        setBinding(&_stages[stage].Shader, unknownBinding<ID3D11DeviceChild>());
+        return true;
+    }
+
+    return filterBinding(&_stages[stage].Shader, shader);
+}
+
+// IUnknown
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if (!ppvObject)
+    {
+        return E_POINTER;
+    }
+
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(ID3D11DeviceContext))
+    {
+        *ppvObject = static_cast<ID3D11DeviceContext*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    // Other interfaces such as the annotation one do not touch the pipeline state
+    return _context->QueryInterface(riid, ppvObject);
+}
+
+ULONG STDMETHODCALLTYPE StateCachingDeviceContext::AddRef()
+{
+    return ++_refCount;
+}
+
+ULONG STDMETHODCALLTYPE StateCachingDeviceContext::Release()
+{
+    // The cache is owned by whoever created it, the count is only kept for the callers that expect
+    // it
+    return (_refCount > 1) ? --_refCount : 1;
+}
+
+// ID3D11DeviceChild
+void STDMETHODCALLTYPE StateCachingDeviceContext::GetDevice(ID3D11Device** ppDevice)
+{
+    _context->GetDevice(ppDevice);
+}
+
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData)
+{
+    return _context->GetPrivateData(guid, pDataSize, pData);
+}
+
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::SetPrivateData(REFGUID guid, UINT DataSize, const void* pData)
+{
+    return _context->SetPrivateData(guid, DataSize, pData);
+}
+
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::SetPrivateDataInterface(REFGUID guid, const IUnknown* pData)
+{
+    return _context->SetPrivateDataInterface(guid, pData);
+}
+
+// ID3D11DeviceContext
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSSetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppConstantBuffers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_VS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+        StartSlot, NumBuffers, ppConstantBuffers, &first, &changed))
+    {
+        _context->VSSetConstantBuffers(first, changed, ppConstantBuffers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSSetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_PS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT,
+        StartSlot, NumViews, ppShaderResourceViews, &first, &changed))
+    {
+        _context->PSSetShaderResources(first, changed, ppShaderResourceViews + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSSetShader(ID3D11PixelShader* pPixelShader,
+    ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
+{
+    if (filterShader(STAGE_PS, pPixelShader, NumClassInstances))
+    {
+        _context->PSSetShader(pPixelShader, ppClassInstances, NumClassInstances);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSSetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_PS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+        StartSlot, NumSamplers, ppSamplers, &first, &changed))
+    {
+        _context->PSSetSamplers(first, changed, ppSamplers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSSetShader(ID3D11VertexShader* pVertexShader,
+    ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
+{
+    if (filterShader(STAGE_VS, pVertexShader, NumClassInstances))
+    {
+        _context->VSSetShader(pVertexShader, ppClassInstances, NumClassInstances);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DrawIndexed(UINT IndexCount, UINT StartIndexLocation,
+    INT BaseVertexLocation)
+{
+    _stats.DrawCalls++;
+    _context->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::Draw(UINT VertexCount, UINT StartVertexLocation)
+{
+    _stats.DrawCalls++;
+    _context->Draw(VertexCount, StartVertexLocation);
+}
+
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::Map(ID3D11Resource* pResource, UINT Subresource, D3D11_MAP MapType,
+    UINT MapFlags, D3D11_MAPPED_SUBRESOURCE* pMappedResource)
+{
+    return _context->Map(pResource, Subresource, MapType, MapFlags, pMappedResource);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::Unmap(ID3D11Resource* pResource, UINT Subresource)
+{
+    _context->Unmap(pResource, Subresource);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSSetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppConstantBuffers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_PS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+        StartSlot, NumBuffers, ppConstantBuffers, &first, &changed))
+    {
+        _context->PSSetConstantBuffers(first, changed, ppConstantBuffers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IASetInputLayout(ID3D11InputLayout* pInputLayout)
+{
+    if (filterBinding(&_inputLayout, pInputLayout))
+    {
+        _context->IASetInputLayout(pInputLayout);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IASetVertexBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppVertexBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+    _stats.SubmittedCalls++;
+
+    if (!ppVertexBuffers || !pStrides || !pOffsets || StartSlot >= D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT ||
+        NumBuffers > D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT - StartSlot)
+    {
+        _context->IASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+        return;
+    }
+
+    UINT begin = NumBuffers;
+    UINT end = 0;
+    for (UINT i = 0; i < NumBuffers; i++)
+    {
+        UINT slot = StartSlot + i;
+        if (_vertexBuffers[slot] != ppVertexBuffers[i] || _vertexStrides[slot] != pStrides[i] ||
+            _vertexOffsets[slot] != pOffsets[i])
+        {
+            setBinding(&_vertexBuffers[slot], ppVertexBuffers[i]);
+            _vertexStrides[slot] = pStrides[i];
+            _vertexOffsets[slot] = pOffsets[i];
+            begin = min(begin, i);
+            end = i + 1;
+        }
+    }
+
+    if (begin >= end)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    _context->IASetVertexBuffers(StartSlot + begin, end - begin, ppVertexBuffers + begin, pStrides + begin,
+        pOffsets + begin);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IASetIndexBuffer(ID3D11Buffer* pIndexBuffer, DXGI_FORMAT Format,
+    UINT Offset)
+{
+    _stats.SubmittedCalls++;
+
+    if (_indexBuffer == pIndexBuffer && _indexFormat == Format && _indexOffset == Offset)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    setBinding(&_indexBuffer, pIndexBuffer);
+    _indexFormat = Format;
+    _indexOffset = Offset;
+    _context->IASetIndexBuffer(pIndexBuffer, Format, Offset);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount,
+    UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
+{
+    _stats.DrawCalls++;
+    _context->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation,
+        StartInstanceLocation);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount,
+    UINT StartVertexLocation, UINT StartInstanceLocation)
+{
+    _stats.DrawCalls++;
+    _context->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSSetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppConstantBuffers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_GS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+        StartSlot, NumBuffers, ppConstantBuffers, &first, &changed))
+    {
+        _context->GSSetConstantBuffers(first, changed, ppConstantBuffers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSSetShader(ID3D11GeometryShader* pShader,
+    ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
+{
+    if (filterShader(STAGE_GS, pShader, NumClassInstances))
+    {
+        _context->GSSetShader(pShader, ppClassInstances, NumClassInstances);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology)
+{
+    if (filterState(&_topology, Topology))
+    {
+        _context->IASetPrimitiveTopology(Topology);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSSetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_VS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT,
+        StartSlot, NumViews, ppShaderResourceViews, &first, &changed))
+    {
+        _context->VSSetShaderResources(first, changed, ppShaderResourceViews + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSSetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_VS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+        StartSlot, NumSamplers, ppSamplers, &first, &changed))
+    {
+        _context->VSSetSamplers(first, changed, ppSamplers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::Begin(ID3D11Asynchronous* pAsync)
+{
+    _context->Begin(pAsync);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::End(ID3D11Asynchronous* pAsync)
+{
+    _context->End(pAsync);
+}
+
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::GetData(ID3D11Asynchronous* pAsync, void* pData, UINT DataSize,
+    UINT GetDataFlags)
+{
+    return _context->GetData(pAsync, pData, DataSize, GetDataFlags);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::SetPredication(ID3D11Predicate* pPredicate, BOOL PredicateValue)
+{
+    _context->SetPredication(pPredicate, PredicateValue);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSSetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_GS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT,
+        StartSlot, NumViews, ppShaderResourceViews, &first, &changed))
+    {
+        _context->GSSetShaderResources(first, changed, ppShaderResourceViews + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSSetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_GS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+        StartSlot, NumSamplers, ppSamplers, &first, &changed))
+    {
+        _context->GSSetSamplers(first, changed, ppSamplers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMSetRenderTargets(UINT NumViews,
+    ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView)
+{
+    _stats.SubmittedCalls++;
+
+    bool valid = NumViews <= D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT && (ppRenderTargetViews || NumViews == 0);
+
+    bool changed = !valid || _depthStencil != pDepthStencilView;
+    for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT && !changed; i++)
+    {
+        changed = _renderTargets[i] != ((i < NumViews) ? ppRenderTargetViews[i] : NULL);
+    }
+
+    if (!changed)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    if (valid)
+    {
+        for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+        {
+            setBinding(&_renderTargets[i], (i < NumViews) ? ppRenderTargetViews[i] : NULL);
+        }
+        setBinding(&_depthStencil, pDepthStencilView);
+    }
+    else
+    {
+        forgetSlots(_renderTargets, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
+        setBinding(&_depthStencil, unknownBinding<ID3D11DepthStencilView>());
+    }
+
+    // The runtime unbinds any input that is now bound as an output
+    invalidateInputs();
+
+    _context->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMSetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs,
+    ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView, UINT UAVStartSlot,
+    UINT NumUAVs, ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts)
+{
+    _stats.SubmittedCalls++;
+
+    forgetSlots(_renderTargets, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
+    setBinding(&_depthStencil, unknownBinding<ID3D11DepthStencilView>());
+    invalidateInputs();
+
+    _context->OMSetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot,
+        NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMSetBlendState(ID3D11BlendState* pBlendState,
+    const FLOAT BlendFactor[4], UINT SampleMask)
+{
+    static const FLOAT defaultBlendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const FLOAT* blendFactor = BlendFactor ? BlendFactor : defaultBlendFactor;
+
+    _stats.SubmittedCalls++;
+
+    if (_blendState == pBlendState && _sampleMask == SampleMask &&
+        memcmp(_blendFactor, blendFactor, sizeof(_blendFactor)) == 0)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    setBinding(&_blendState, pBlendState);
+    memcpy(_blendFactor, blendFactor, sizeof(_blendFactor));
+    _sampleMask = SampleMask;
+    _context->OMSetBlendState(pBlendState, BlendFactor, SampleMask);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMSetDepthStencilState(ID3D11DepthStencilState* pDepthStencilState,
+    UINT StencilRef)
+{
+    _stats.SubmittedCalls++;
+
+    if (_depthStencilState == pDepthStencilState && _stencilRef == StencilRef)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    setBinding(&_depthStencilState, pDepthStencilState);
+    _stencilRef = StencilRef;
+    _context->OMSetDepthStencilState(pDepthStencilState, StencilRef);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::SOSetTargets(UINT NumBuffers, ID3D11Buffer* const* ppSOTargets,
+    const UINT* pOffsets)
+{
+    _stats.SubmittedCalls++;
+
+    invalidateInputs();
+    _context->SOSetTargets(NumBuffers, ppSOTargets, pOffsets);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DrawAuto()
+{
+    _stats.DrawCalls++;
+    _context->DrawAuto();
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DrawIndexedInstancedIndirect(ID3D11Buffer* pBufferForArgs,
+    UINT AlignedByteOffsetForArgs)
+{
+    _stats.DrawCalls++;
+    _context->DrawIndexedInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DrawInstancedIndirect(ID3D11Buffer* pBufferForArgs,
+    UINT AlignedByteOffsetForArgs)
+{
+    _stats.DrawCalls++;
+    _context->DrawInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY,
+    UINT ThreadGroupCountZ)
+{
+    _stats.Dispatches++;
+    _context->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DispatchIndirect(ID3D11Buffer* pBufferForArgs,
+    UINT AlignedByteOffsetForArgs)
+{
+    _stats.Dispatches++;
+    _context->DispatchIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::RSSetState(ID3D11RasterizerState* pRasterizerState)
+{
+    if (filterBinding(&_rasterizerState, pRasterizerState))
+    {
+        _context->RSSetState(pRasterizerState);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::RSSetViewports(UINT NumViewports, const D3D11_VIEWPORT* pViewports)
+{
+    _stats.SubmittedCalls++;
+
+    if (pViewports && NumViewports == _viewportCount &&
+        memcmp(_viewports, pViewports, NumViewports * sizeof(D3D11_VIEWPORT)) == 0)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    if (pViewports && NumViewports <= D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE)
+    {
+        memcpy(_viewports, pViewports, NumViewports * sizeof(D3D11_VIEWPORT));
+        _viewportCount = NumViewports;
+    }
+    else
+    {
+        _viewportCount = (UINT)-1;
+    }
+    _context->RSSetViewports(NumViewports, pViewports);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::RSSetScissorRects(UINT NumRects, const D3D11_RECT* pRects)
+{
+    _stats.SubmittedCalls++;
+
+    if (pRects && NumRects == _scissorRectCount &&
+        memcmp(_scissorRects, pRects, NumRects * sizeof(D3D11_RECT)) == 0)
+    {
+        _stats.FilteredCalls++;
+        return;
+    }
+
+    if (pRects && NumRects <= D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE)
+    {
+        memcpy(_scissorRects, pRects, NumRects * sizeof(D3D11_RECT));
+        _scissorRectCount = NumRects;
+    }
+    else
+    {
+        _scissorRectCount = (UINT)-1;
+    }
+    _context->RSSetScissorRects(NumRects, pRects);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CopySubresourceRegion(ID3D11Resource* pDstResource,
+    UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ID3D11Resource* pSrcResource, UINT SrcSubresource,
+    const D3D11_BOX* pSrcBox)
+{
+    _context->CopySubresourceRegion(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource,
+        pSrcBox);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CopyResource(ID3D11Resource* pDstResource,
+    ID3D11Resource* pSrcResource)
+{
+    _context->CopyResource(pDstResource, pSrcResource);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::UpdateSubresource(ID3D11Resource* pDstResource, UINT DstSubresource,
+    const D3D11_BOX* pDstBox, const void* pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch)
+{
+    _context->UpdateSubresource(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CopyStructureCount(ID3D11Buffer* pDstBuffer,
+    UINT DstAlignedByteOffset, ID3D11UnorderedAccessView* pSrcView)
+{
+    _context->CopyStructureCount(pDstBuffer, DstAlignedByteOffset, pSrcView);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ClearRenderTargetView(ID3D11RenderTargetView* pRenderTargetView,
+    const FLOAT ColorRGBA[4])
+{
+    _context->ClearRenderTargetView(pRenderTargetView, ColorRGBA);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ClearUnorderedAccessViewUint(
+    ID3D11UnorderedAccessView* pUnorderedAccessView, const UINT Values[4])
+{
+    _context->ClearUnorderedAccessViewUint(pUnorderedAccessView, Values);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ClearUnorderedAccessViewFloat(
+    ID3D11UnorderedAccessView* pUnorderedAccessView, const FLOAT Values[4])
+{
+    _context->ClearUnorderedAccessViewFloat(pUnorderedAccessView, Values);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ClearDepthStencilView(ID3D11DepthStencilView* pDepthStencilView,
+    UINT ClearFlags, FLOAT Depth, UINT8 Stencil)
+{
+    _context->ClearDepthStencilView(pDepthStencilView, ClearFlags, Depth, Stencil);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GenerateMips(ID3D11ShaderResourceView* pShaderResourceView)
+{
+    _context->GenerateMips(pShaderResourceView);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::SetResourceMinLOD(ID3D11Resource* pResource, FLOAT MinLOD)
+{
+    _context->SetResourceMinLOD(pResource, MinLOD);
+}
+
+FLOAT STDMETHODCALLTYPE StateCachingDeviceContext::GetResourceMinLOD(ID3D11Resource* pResource)
+{
+    return _context->GetResourceMinLOD(pResource);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ResolveSubresource(ID3D11Resource* pDstResource, UINT DstSubresource,
+    ID3D11Resource* pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format)
+{
+    _context->ResolveSubresource(pDstResource, DstSubresource, pSrcResource, SrcSubresource, Format);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ExecuteCommandList(ID3D11CommandList* pCommandList,
+    BOOL RestoreContextState)
+{
+    _context->ExecuteCommandList(pCommandList, RestoreContextState);
+    Invalidate();
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSSetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_HS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT,
+        StartSlot, NumViews, ppShaderResourceViews, &first, &changed))
+    {
+        _context->HSSetShaderResources(first, changed, ppShaderResourceViews + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSSetShader(ID3D11HullShader* pHullShader,
+    ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
+{
+    if (filterShader(STAGE_HS, pHullShader, NumClassInstances))
+    {
+        _context->HSSetShader(pHullShader, ppClassInstances, NumClassInstances);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSSetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_HS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+        StartSlot, NumSamplers, ppSamplers, &first, &changed))
+    {
+        _context->HSSetSamplers(first, changed, ppSamplers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSSetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppConstantBuffers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_HS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+        StartSlot, NumBuffers, ppConstantBuffers, &first, &changed))
+    {
+        _context->HSSetConstantBuffers(first, changed, ppConstantBuffers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSSetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_DS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT,
+        StartSlot, NumViews, ppShaderResourceViews, &first, &changed))
+    {
+        _context->DSSetShaderResources(first, changed, ppShaderResourceViews + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSSetShader(ID3D11DomainShader* pDomainShader,
+    ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
+{
+    if (filterShader(STAGE_DS, pDomainShader, NumClassInstances))
+    {
+        _context->DSSetShader(pDomainShader, ppClassInstances, NumClassInstances);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSSetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_DS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+        StartSlot, NumSamplers, ppSamplers, &first, &changed))
+    {
+        _context->DSSetSamplers(first, changed, ppSamplers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSSetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppConstantBuffers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_DS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+        StartSlot, NumBuffers, ppConstantBuffers, &first, &changed))
+    {
+        _context->DSSetConstantBuffers(first, changed, ppConstantBuffers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSSetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView* const* ppShaderResourceViews)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_CS].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT,
+        StartSlot, NumViews, ppShaderResourceViews, &first, &changed))
+    {
+        _context->CSSetShaderResources(first, changed, ppShaderResourceViews + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSSetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs,
+    ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts)
+{
+    _stats.SubmittedCalls++;
+
+    invalidateInputs();
+    _context->CSSetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSSetShader(ID3D11ComputeShader* pComputeShader,
+    ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances)
+{
+    if (filterShader(STAGE_CS, pComputeShader, NumClassInstances))
+    {
+        _context->CSSetShader(pComputeShader, ppClassInstances, NumClassInstances);
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSSetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState* const* ppSamplers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_CS].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT,
+        StartSlot, NumSamplers, ppSamplers, &first, &changed))
+    {
+        _context->CSSetSamplers(first, changed, ppSamplers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSSetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer* const* ppConstantBuffers)
+{
+    UINT first, changed;
+    if (filterSlots(_stages[STAGE_CS].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT,
+        StartSlot, NumBuffers, ppConstantBuffers, &first, &changed))
+    {
+        _context->CSSetConstantBuffers(first, changed, ppConstantBuffers + (first - StartSlot));
+    }
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSGetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppConstantBuffers)
+{
+    _context->VSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSGetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    _context->PSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSGetShader(ID3D11PixelShader** ppPixelShader,
+    ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances)
+{
+    _context->PSGetShader(ppPixelShader, ppClassInstances, pNumClassInstances);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSGetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState** ppSamplers)
+{
+    _context->PSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSGetShader(ID3D11VertexShader** ppVertexShader,
+    ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances)
+{
+    _context->VSGetShader(ppVertexShader, ppClassInstances, pNumClassInstances);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::PSGetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppConstantBuffers)
+{
+    _context->PSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IAGetInputLayout(ID3D11InputLayout** ppInputLayout)
+{
+    _context->IAGetInputLayout(ppInputLayout);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IAGetVertexBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppVertexBuffers, UINT* pStrides, UINT* pOffsets)
+{
+    _context->IAGetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IAGetIndexBuffer(ID3D11Buffer** pIndexBuffer, DXGI_FORMAT* Format,
+    UINT* Offset)
+{
+    _context->IAGetIndexBuffer(pIndexBuffer, Format, Offset);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSGetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppConstantBuffers)
+{
+    _context->GSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSGetShader(ID3D11GeometryShader** ppGeometryShader,
+    ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances)
+{
+    _context->GSGetShader(ppGeometryShader, ppClassInstances, pNumClassInstances);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY* pTopology)
+{
+    _context->IAGetPrimitiveTopology(pTopology);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSGetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    _context->VSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::VSGetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState** ppSamplers)
+{
+    _context->VSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GetPredication(ID3D11Predicate** ppPredicate, BOOL* pPredicateValue)
+{
+    _context->GetPredication(ppPredicate, pPredicateValue);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSGetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    _context->GSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::GSGetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState** ppSamplers)
+{
+    _context->GSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMGetRenderTargets(UINT NumViews,
+    ID3D11RenderTargetView** ppRenderTargetViews, ID3D11DepthStencilView** ppDepthStencilView)
+{
+    _context->OMGetRenderTargets(NumViews, ppRenderTargetViews, ppDepthStencilView);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMGetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs,
+    ID3D11RenderTargetView** ppRenderTargetViews, ID3D11DepthStencilView** ppDepthStencilView, UINT UAVStartSlot,
+    UINT NumUAVs, ID3D11UnorderedAccessView** ppUnorderedAccessViews)
+{
+    _context->OMGetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, ppDepthStencilView, UAVStartSlot,
+        NumUAVs, ppUnorderedAccessViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMGetBlendState(ID3D11BlendState** ppBlendState, FLOAT BlendFactor[4],
+    UINT* pSampleMask)
+{
+    _context->OMGetBlendState(ppBlendState, BlendFactor, pSampleMask);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::OMGetDepthStencilState(ID3D11DepthStencilState** ppDepthStencilState,
+    UINT* pStencilRef)
+{
+    _context->OMGetDepthStencilState(ppDepthStencilState, pStencilRef);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::SOGetTargets(UINT NumBuffers, ID3D11Buffer** ppSOTargets)
+{
+    _context->SOGetTargets(NumBuffers, ppSOTargets);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::RSGetState(ID3D11RasterizerState** ppRasterizerState)
+{
+    _context->RSGetState(ppRasterizerState);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::RSGetViewports(UINT* pNumViewports, D3D11_VIEWPORT* pViewports)
+{
+    _context->RSGetViewports(pNumViewports, pViewports);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::RSGetScissorRects(UINT* pNumRects, D3D11_RECT* pRects)
+{
+    _context->RSGetScissorRects(pNumRects, pRects);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSGetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    _context->HSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSGetShader(ID3D11HullShader** ppHullShader,
+    ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances)
+{
+    _context->HSGetShader(ppHullShader, ppClassInstances, pNumClassInstances);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSGetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState** ppSamplers)
+{
+    _context->HSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::HSGetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppConstantBuffers)
+{
+    _context->HSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSGetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    _context->DSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSGetShader(ID3D11DomainShader** ppDomainShader,
+    ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances)
+{
+    _context->DSGetShader(ppDomainShader, ppClassInstances, pNumClassInstances);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSGetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState** ppSamplers)
+{
+    _context->DSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::DSGetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppConstantBuffers)
+{
+    _context->DSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSGetShaderResources(UINT StartSlot, UINT NumViews,
+    ID3D11ShaderResourceView** ppShaderResourceViews)
+{
+    _context->CSGetShaderResources(StartSlot, NumViews, ppShaderResourceViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSGetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs,
+    ID3D11UnorderedAccessView** ppUnorderedAccessViews)
+{
+    _context->CSGetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSGetShader(ID3D11ComputeShader** ppComputeShader,
+    ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances)
+{
+    _context->CSGetShader(ppComputeShader, ppClassInstances, pNumClassInstances);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSGetSamplers(UINT StartSlot, UINT NumSamplers,
+    ID3D11SamplerState** ppSamplers)
+{
+    _context->CSGetSamplers(StartSlot, NumSamplers, ppSamplers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::CSGetConstantBuffers(UINT StartSlot, UINT NumBuffers,
+    ID3D11Buffer** ppConstantBuffers)
+{
+    _context->CSGetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers);
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::ClearState()
+{
+    _context->ClearState();
+    Invalidate();
+}
+
+void STDMETHODCALLTYPE StateCachingDeviceContext::Flush()
+{
+    _context->Flush();
+}
+
+D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE StateCachingDeviceContext::GetType()
+{
+    return _context->GetType();
+}
+
+UINT STDMETHODCALLTYPE StateCachingDeviceContext::GetContextFlags()
+{
+    return _context->GetContextFlags();
+}
+
+HRESULT STDMETHODCALLTYPE StateCachingDeviceContext::FinishCommandList(BOOL RestoreDeferredContextState,
+    ID3D11CommandList** ppCommandList)
+{
+    HRESULT hr = _context->FinishCommandList(RestoreDeferredContextState, ppCommandList);
+    Invalidate();
+
+    return hr;
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "PCH.h"
+#include "ThreadPool.h"
+#include "Logger.h"
+
+ThreadPool::ThreadPool(UINT threadCount, const std::wstring& name)
+    : _name(name), _nextWorkerIndex(0), _exiting(false), _count(0), _grainSize(1), _chunkCount(0), _nextChunk(0), _runningWorkers(0)
+{
+    if (threadCount == 0)
+    {
+        SYSTEM_INFO sysInfo;
+        GetSystemInfo(&sysInfo);
+        threadCount = sysInfo.dwNumberOfProcessors;
+    }
+
+    _workSemaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    _doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    // The thread calling ParallelFor is the last worker
+    for (UINT i = 1; i < threadCount; i++)
+    {
+        HANDLE thread = CreateThread(NULL, 0, workerMain, this, 0, NULL);
+        if (thread)
+        {
+            _threads.push_back(thread);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    _exiting = true;
+    ReleaseSemaphore(_workSemaphore, _threads.size(), NULL);
+
+    if (_threads.size() > 0)
+    {
+        WaitForMultipleObjects(_threads.size(), &_threads[0], TRUE, INFINITE);
+    }
+    for (UINT i = 0; i < _threads.size(); i++)
+    {
+        CloseHandle(_threads[i]);
+    }
+
+    CloseHandle(_workSemaphore);
+    CloseHandle(_doneEvent);
+}
+
+void ThreadPool::runChunks()
+{
+    LONG chunk;
+    while ((chunk = InterlockedIncrement(&_nextChunk) - 1) < (LONG)_chunkCount)
+    {
+        UINT begin = chunk * _grainSize;
+        UINT end = min(begin + _grainSize, _count);
+
+        _func(begin, end);
+    }
+}
+
+DWORD WINAPI ThreadPool::workerMain(LPVOID param)
+{
+    ThreadPool* pool = (ThreadPool*)param;
+
+    WCHAR threadName[64];
+    swprintf_s(threadName, L"%s %u", pool->_name.c_str(), InterlockedIncrement(&pool->_nextWorkerIndex));
+    Logger::GetInstance()->SetThreadName(threadName);
+
+    while (true)
+    {
+        WaitForSingleObject(pool->_workSemaphore, INFINITE);
+        if (pool->_exiting)
+        {
+            break;
+        }
+
+        pool->runChunks();
+
+        // The last worker out lets the calling thread return, the job can't change until then
+        if (InterlockedDecrement(&pool->_runningWorkers) == 0)
+        {
+            SetEvent(pool->_doneEvent);
+        }
+    }
+
+    return 0;
+}
+
+void ThreadPool::ParallelFor(UINT count, UINT grainSize, const RangeFunction& func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = max(grainSize, 1U);
+    UINT chunkCount = (count + grainSize - 1) / grainSize;
+
+    // Small jobs are not worth waking anyone up for
+    UINT workerCount = min(chunkCount - 1, (UINT)_threads.size());
+    if (workerCount == 0)
+    {
+        func(0, count);
+        return;
+    }
+
+    _func = func;
+    _count = count;
+    _grainSize = grainSize;
+    _chunkCount = chunkCount;
+    _nextChunk = 0;
+    _runningWorkers = workerCount;
+
+    ReleaseSemaphore(_workSemaphore, workerCount, NULL);
+
+    runChunks();
+
+    WaitForSingleObject(_doneEvent, INFINITE);
+
+    _func = RangeFunction();
+}
\ No newline at end of file
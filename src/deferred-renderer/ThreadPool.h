@@ -0,0 +1,43 @@
+#pragma once
+
+#include "PCH.h"
+
+// A fixed set of worker threads for splitting data parallel work across the cores. ParallelFor
+// must only be called from one thread at a time and the work it is given must not call it
+// again. Each worker logs its events in a lane of its own, named after the pool.
+class ThreadPool
+{
+public:
+    typedef std::tr1::function<void (UINT begin, UINT end)> RangeFunction;
+
+private:
+    std::vector<HANDLE> _threads;
+    std::wstring _name;
+    volatile LONG _nextWorkerIndex;
+    HANDLE _workSemaphore;
+    HANDLE _doneEvent;
+    volatile bool _exiting;
+
+    // The current job, only written while no workers are running
+    RangeFunction _func;
+    UINT _count;
+    UINT _grainSize;
+    UINT _chunkCount;
+    volatile LONG _nextChunk;
+    volatile LONG _runningWorkers;
+
+    void runChunks();
+
+    static DWORD WINAPI workerMain(LPVOID param);
+
+public:
+    // A thread count of 0 creates one worker for every core other than the calling thread's
+    ThreadPool(UINT threadCount = 0, const std::wstring& name = L"Worker");
+    ~ThreadPool();
+
+    UINT GetThreadCount() const { return _threads.size() + 1; }
+
+    // Calls func on chunks of at most grainSize items covering [0, count), the calling thread
+    // works on chunks too and only returns once all of them are done
+    void ParallelFor(UINT count, UINT grainSize, const RangeFunction& func);
+};
\ No newline at end of file
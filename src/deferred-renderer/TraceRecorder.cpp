@@ -0,0 +1,144 @@
+#include "PCH.h"
+#include "TraceRecorder.h"
+
+static std::string toJSONString(const std::wstring& str)
+{
+    std::string result = WStringToUTF8(str);
+    for (UINT i = 0; i < result.size(); i++)
+    {
+        if (result[i] == '"' || result[i] == '\\')
+        {
+            result.insert(i++, 1, '\\');
+        }
+    }
+
+    return result;
+}
+
+TraceRecorder::TraceRecorder()
+    : _firstEvent(true), _frameCount(0), _frameTime(0.0)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    End();
+}
+
+HRESULT TraceRecorder::Begin(const WCHAR* path)
+{
+    End();
+
+    _file.open(path, std::ios::out | std::ios::trunc);
+    if (!_file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    _firstEvent = true;
+    _frameCount = 0;
+    _frameTime = 0.0;
+    _threads.clear();
+
+    // Times are written in microseconds with a fixed precision so long traces keep their detail
+    _file.setf(std::ios::fixed);
+    _file.precision(3);
+
+    _file << "{\"traceEvents\":[" << std::endl;
+
+    return _file.good() ? S_OK : E_FAIL;
+}
+
+HRESULT TraceRecorder::End()
+{
+    if (!_file.is_open())
+    {
+        return S_OK;
+    }
+
+    // The viewers show threads in order of their sort index, which keeps the lanes in the same
+    // order as the profile pane
+    for (std::map<DWORD, THREAD_INFO>::iterator it = _threads.begin(); it != _threads.end(); it++)
+    {
+        beginEvent();
+        _file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it->first <<
+            ",\"args\":{\"name\":\"" << toJSONString(it->second.Name) << "\"}}";
+
+        beginEvent();
+        _file << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it->first <<
+            ",\"args\":{\"sort_index\":" << it->second.Lane << "}}";
+    }
+
+    _file << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+    HRESULT hr = _file.good() ? S_OK : E_FAIL;
+    _file.close();
+
+    return hr;
+}
+
+void TraceRecorder::beginEvent()
+{
+    if (!_firstEvent)
+    {
+        _file << "," << std::endl;
+    }
+    _firstEvent = false;
+}
+
+void TraceRecorder::writeEvents(Logger::EventIterator it, DWORD threadID)
+{
+    for (; it.IsValid(); it = it.GetNextSibling())
+    {
+        beginEvent();
+        _file << "{\"name\":\"" << toJSONString(it.GetName()) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadID <<
+            ",\"ts\":" << _frameTime + it.GetStartTime() * 1000000.0 << ",\"dur\":" << it.GetDuration() * 1000000.0 <<
+            "}";
+
+        if (it.HasChildren())
+        {
+            writeEvents(it.GetFirstChild(), threadID);
+        }
+    }
+}
+
+void TraceRecorder::RecordFrame(Logger* logger)
+{
+    if (!_file.is_open())
+    {
+        return;
+    }
+
+    _frameTime = logger->GetFrameStartTime() * 1000000.0;
+
+    for (UINT i = 0; i < logger->GetLaneCount(); i++)
+    {
+        Logger::EventIterator root = logger->GetLaneRootEvent(i);
+        if (!root.IsValid())
+        {
+            continue;
+        }
+
+        DWORD threadID = logger->GetLaneThreadID(i);
+
+        THREAD_INFO& thread = _threads[threadID];
+        thread.Name = logger->GetLaneName(i);
+        thread.Lane = i;
+
+        writeEvents(root, threadID);
+    }
+
+    _frameCount++;
+}
+
+void TraceRecorder::RecordCounter(const std::wstring& name, float value)
+{
+    if (!_file.is_open())
+    {
+        return;
+    }
+
+    beginEvent();
+    _file << "{\"name\":\"" << toJSONString(name) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << _frameTime <<
+        ",\"args\":{\"value\":" << value << "}}";
+}
\ No newline at end of file
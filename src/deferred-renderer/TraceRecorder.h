@@ -0,0 +1,44 @@
+#pragma once
+
+#include "PCH.h"
+#include "Logger.h"
+
+// Streams the logger's events to a file in the Chrome trace event format, which chrome://tracing
+// and Perfetto can open. Every frame that is recorded adds the events of all its lanes, each lane
+// being the thread it was logged on, so spikes can be found across thousands of frames. Counters
+// are written as counter tracks at the time of the last recorded frame.
+class TraceRecorder
+{
+private:
+    std::ofstream _file;
+    bool _firstEvent;
+    UINT _frameCount;
+
+    // Microseconds since the logger was created
+    double _frameTime;
+
+    // Thread names are written once the trace ends, with the lane each thread was last seen in
+    struct THREAD_INFO
+    {
+        std::wstring Name;
+        UINT Lane;
+    };
+    std::map<DWORD, THREAD_INFO> _threads;
+
+    void beginEvent();
+    void writeEvents(Logger::EventIterator it, DWORD threadID);
+
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    HRESULT Begin(const WCHAR* path);
+    HRESULT End();
+
+    bool IsRecording() const { return _file.is_open(); }
+    UINT GetFrameCount() const { return _frameCount; }
+
+    // Records every lane of the logger's last frame
+    void RecordFrame(Logger* logger);
+    void RecordCounter(const std::wstring& name, float value);
+};
\ No newline at end of file
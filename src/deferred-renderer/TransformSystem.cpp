@@ -0,0 +1,523 @@
+#include "PCH.h"
+#include "TransformSystem.h"
+#include "Logger.h"
+
+using std::tr1::mem_fn;
+using namespace std::tr1::placeholders;
+
+const UINT TransformSystem::INVALID_HANDLE;
+const UINT TransformSystem::INVALID_SLOT;
+
+TransformSystem::TransformSystem()
+    : _layoutDirty(false), _updateCount(0)
+{
+}
+
+UINT TransformSystem::addSlot()
+{
+    UINT slot = _positions.size();
+
+    _positions.push_back(XMFLOAT3(0.0f, 0.0f, 0.0f));
+    _orientations.push_back(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+    _scales.push_back(1.0f);
+    _parents.push_back(INVALID_SLOT);
+
+    _worldOrientations.push_back(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+    _worldScales.push_back(1.0f);
+    _worlds.push_back(XMFLOAT4X4());
+    _prevWorlds.push_back(XMFLOAT4X4());
+    _axisBoxes.push_back(AxisAlignedBox());
+    _orientedBoxes.push_back(OrientedBox());
+    _subtreeMins.push_back(XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
+    _subtreeMaxs.push_back(XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+
+    BOUNDS_INFO bounds = { NULL, NULL, NULL };
+    _bounds.push_back(bounds);
+
+    _dirtyFlags.push_back(0);
+    _changedFlags.push_back(0);
+    _newFlags.push_back(0);
+    _aliveFlags.push_back(1);
+
+    _handles.push_back(INVALID_HANDLE);
+    _blockIndices.push_back(INVALID_SLOT);
+
+    return slot;
+}
+
+UINT TransformSystem::Add()
+{
+    UINT slot = addSlot();
+
+    UINT handle;
+    if (_freeHandles.size() > 0)
+    {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+        _slots[handle] = slot;
+    }
+    else
+    {
+        handle = _slots.size();
+        _slots.push_back(slot);
+    }
+    _handles[slot] = handle;
+
+    // Build it now so nothing reads garbage before the next update
+    updateSlot(slot);
+    _prevWorlds[slot] = _worlds[slot];
+
+    _newFlags[slot] = 1;
+    markDirty(slot);
+
+    // It has no block until the layout is rebuilt
+    _layoutDirty = true;
+
+    return handle;
+}
+
+void TransformSystem::Remove(UINT handle)
+{
+    UINT slot = _slots[handle];
+
+    for (UINT i = 0; i < _parents.size(); i++)
+    {
+        if (_parents[i] == slot)
+        {
+            _parents[i] = INVALID_SLOT;
+            markDirty(i);
+        }
+    }
+
+    BOUNDS_INFO& bounds = _bounds[slot];
+    bounds.SourceModel = NULL;
+    bounds.MeshAxisBoxes = NULL;
+    bounds.MeshOrientedBoxes = NULL;
+
+    _parents[slot] = INVALID_SLOT;
+    _aliveFlags[slot] = 0;
+
+    _slots[handle] = INVALID_SLOT;
+    _freeHandles.push_back(handle);
+
+    // The slot is dropped when the layout is rebuilt
+    _layoutDirty = true;
+}
+
+bool TransformSystem::SetParent(UINT handle, UINT parentHandle)
+{
+    UINT slot = _slots[handle];
+    UINT parentSlot = (parentHandle != INVALID_HANDLE) ? _slots[parentHandle] : INVALID_SLOT;
+
+    for (UINT i = parentSlot; i != INVALID_SLOT; i = _parents[i])
+    {
+        if (i == slot)
+        {
+            LOG_ERROR(L"TransformSystem", L"Attempted to parent a transform to one of its own descendants.");
+            return false;
+        }
+    }
+
+    if (_parents[slot] != parentSlot)
+    {
+        _parents[slot] = parentSlot;
+        markDirty(slot);
+
+        _layoutDirty = true;
+    }
+
+    return true;
+}
+
+UINT TransformSystem::GetParent(UINT handle) const
+{
+    UINT parentSlot = _parents[_slots[handle]];
+    return (parentSlot != INVALID_SLOT) ? _handles[parentSlot] : INVALID_HANDLE;
+}
+
+void TransformSystem::SetModel(UINT handle, const Model* model, AxisAlignedBox* meshAxisBoxes,
+                               OrientedBox* meshOrientedBoxes)
+{
+    UINT slot = _slots[handle];
+
+    BOUNDS_INFO& bounds = _bounds[slot];
+    bounds.SourceModel = model;
+    bounds.MeshAxisBoxes = meshAxisBoxes;
+    bounds.MeshOrientedBoxes = meshOrientedBoxes;
+
+    // The boxes are readable straight away, the subtree bounds are refit in the next update
+    updateSlot(slot);
+    markDirty(slot);
+}
+
+void TransformSystem::markDirty(UINT slot)
+{
+    _dirtyFlags[slot] = 1;
+
+    // Blocks are recomputed from the flags when the layout is rebuilt
+    if (!_layoutDirty && _blockIndices[slot] != INVALID_SLOT)
+    {
+        _blocks[_blockIndices[slot]].Dirty = true;
+    }
+}
+
+void TransformSystem::SetPosition(UINT handle, const XMFLOAT3& pos)
+{
+    UINT slot = _slots[handle];
+    _positions[slot] = pos;
+    markDirty(slot);
+}
+
+void TransformSystem::SetScale(UINT handle, float scale)
+{
+    UINT slot = _slots[handle];
+    _scales[slot] = scale;
+    markDirty(slot);
+}
+
+void TransformSystem::SetOrientation(UINT handle, const XMFLOAT4& orientation)
+{
+    UINT slot = _slots[handle];
+    _orientations[slot] = orientation;
+    markDirty(slot);
+}
+
+AxisAlignedBox TransformSystem::GetSubtreeAxisAlignedBox(UINT handle) const
+{
+    UINT slot = _slots[handle];
+
+    const XMFLOAT3& boxMin = _subtreeMins[slot];
+    const XMFLOAT3& boxMax = _subtreeMaxs[slot];
+
+    AxisAlignedBox result;
+    if (boxMin.x > boxMax.x)
+    {
+        // Nothing in the subtree has a model
+        result.Center = XMFLOAT3(_worlds[slot]._41, _worlds[slot]._42, _worlds[slot]._43);
+        result.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    }
+    else
+    {
+        result.Center = XMFLOAT3((boxMax.x + boxMin.x) * 0.5f, (boxMax.y + boxMin.y) * 0.5f,
+            (boxMax.z + boxMin.z) * 0.5f);
+        result.Extents = XMFLOAT3((boxMax.x - boxMin.x) * 0.5f, (boxMax.y - boxMin.y) * 0.5f,
+            (boxMax.z - boxMin.z) * 0.5f);
+    }
+
+    return result;
+}
+
+template <class T>
+static void reorder(std::vector<T>& items, const std::vector<UINT>& order)
+{
+    std::vector<T> reordered;
+    reordered.reserve(order.size());
+    for (UINT i = 0; i < order.size(); i++)
+    {
+        reordered.push_back(items[order[i]]);
+    }
+    items.swap(reordered);
+}
+
+void TransformSystem::rebuildLayout()
+{
+    UINT slotCount = _positions.size();
+
+    // Link the children of every slot together, in reverse so they keep their order
+    std::vector<UINT> firstChild(slotCount, INVALID_SLOT);
+    std::vector<UINT> nextSibling(slotCount, INVALID_SLOT);
+    for (UINT i = slotCount; i-- > 0; )
+    {
+        if (_aliveFlags[i] && _parents[i] != INVALID_SLOT)
+        {
+            nextSibling[i] = firstChild[_parents[i]];
+            firstChild[_parents[i]] = i;
+        }
+    }
+
+    // Walk each root's tree breadth first so every slot comes after its parent
+    std::vector<UINT> order;
+    order.reserve(slotCount);
+
+    std::vector<BLOCK_INFO> blocks;
+    for (UINT i = 0; i < slotCount; i++)
+    {
+        if (!_aliveFlags[i] || _parents[i] != INVALID_SLOT)
+        {
+            continue;
+        }
+
+        BLOCK_INFO block;
+        block.Start = order.size();
+        block.Dirty = false;
+        block.Moved = false;
+
+        order.push_back(i);
+        for (UINT j = block.Start; j < order.size(); j++)
+        {
+            for (UINT child = firstChild[order[j]]; child != INVALID_SLOT; child = nextSibling[child])
+            {
+                order.push_back(child);
+            }
+        }
+        block.Count = order.size() - block.Start;
+
+        // Carry over whether anything in it moved in the last update so its previous worlds
+        // are still caught up
+        for (UINT j = block.Start; j < order.size(); j++)
+        {
+            UINT oldBlock = _blockIndices[order[j]];
+            if (oldBlock != INVALID_SLOT && _blocks[oldBlock].Moved)
+            {
+                block.Moved = true;
+                break;
+            }
+        }
+
+        blocks.push_back(block);
+    }
+
+    std::vector<UINT> newSlots(slotCount, INVALID_SLOT);
+    for (UINT i = 0; i < order.size(); i++)
+    {
+        newSlots[order[i]] = i;
+    }
+
+    reorder(_positions, order);
+    reorder(_orientations, order);
+    reorder(_scales, order);
+    reorder(_parents, order);
+    reorder(_worldOrientations, order);
+    reorder(_worldScales, order);
+    reorder(_worlds, order);
+    reorder(_prevWorlds, order);
+    reorder(_axisBoxes, order);
+    reorder(_orientedBoxes, order);
+    reorder(_subtreeMins, order);
+    reorder(_subtreeMaxs, order);
+    reorder(_bounds, order);
+    reorder(_dirtyFlags, order);
+    reorder(_changedFlags, order);
+    reorder(_newFlags, order);
+    reorder(_aliveFlags, order);
+    reorder(_handles, order);
+    reorder(_blockIndices, order);
+
+    for (UINT i = 0; i < order.size(); i++)
+    {
+        if (_parents[i] != INVALID_SLOT)
+        {
+            _parents[i] = newSlots[_parents[i]];
+        }
+        _slots[_handles[i]] = i;
+    }
+
+    for (UINT i = 0; i < blocks.size(); i++)
+    {
+        BLOCK_INFO& block = blocks[i];
+        for (UINT j = block.Start; j < block.Start + block.Count; j++)
+        {
+            _blockIndices[j] = i;
+            if (_dirtyFlags[j])
+            {
+                block.Dirty = true;
+            }
+        }
+    }
+    _blocks.swap(blocks);
+}
+
+//--------------------------------------------------------------------------------------
+// Transforms a box by a scale, rotation and translation. The axis aligned box uses Arvo's
+// method, its extents are the local extents multiplied by the absolute of the world
+// matrix's rotation and scale, which gives the same box as transforming all eight corners.
+//--------------------------------------------------------------------------------------
+static inline void transformBox(const AxisAlignedBox& box, FXMVECTOR orientation, FXMVECTOR scale,
+                                CXMMATRIX world, CXMMATRIX absWorld, AxisAlignedBox* axisBox,
+                                OrientedBox* orientedBox)
+{
+    XMVECTOR center = XMVector3Transform(XMLoadFloat3(&box.Center), world);
+    XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+    XMVECTOR axisExtents = XMVectorMultiply(XMVectorSplatX(extents), absWorld.r[0]);
+    axisExtents = XMVectorMultiplyAdd(XMVectorSplatY(extents), absWorld.r[1], axisExtents);
+    axisExtents = XMVectorMultiplyAdd(XMVectorSplatZ(extents), absWorld.r[2], axisExtents);
+
+    XMStoreFloat3(&axisBox->Center, center);
+    XMStoreFloat3(&axisBox->Extents, axisExtents);
+
+    XMStoreFloat3(&orientedBox->Center, center);
+    XMStoreFloat3(&orientedBox->Extents, XMVectorMultiply(extents, scale));
+    XMStoreFloat4(&orientedBox->Orientation, orientation);
+}
+
+void TransformSystem::updateSlot(UINT slot)
+{
+    XMVECTOR position = XMLoadFloat3(&_positions[slot]);
+    XMVECTOR orientation = XMLoadFloat4(&_orientations[slot]);
+    XMVECTOR scale = XMVectorReplicate(_scales[slot]);
+
+    // Concatenate with the parent, its world is always up to date by the time its children
+    // are reached
+    UINT parent = _parents[slot];
+    if (parent != INVALID_SLOT)
+    {
+        XMMATRIX parentWorld = XMLoadFloat4x4(&_worlds[parent]);
+
+        position = XMVector3Transform(position, parentWorld);
+        orientation = XMQuaternionMultiply(orientation, XMLoadFloat4(&_worldOrientations[parent]));
+        scale = XMVectorMultiply(scale, XMVectorReplicate(_worldScales[parent]));
+    }
+
+    XMStoreFloat4(&_worldOrientations[slot], orientation);
+    _worldScales[slot] = XMVectorGetX(scale);
+
+    // Scale the rows of the rotation and put the translation in the last row, this is the same
+    // as scale * rotate * translate without the matrix multiplies
+    XMMATRIX world = XMMatrixRotationQuaternion(orientation);
+    world.r[0] = XMVectorMultiply(world.r[0], scale);
+    world.r[1] = XMVectorMultiply(world.r[1], scale);
+    world.r[2] = XMVectorMultiply(world.r[2], scale);
+    world.r[3] = XMVectorSetW(position, 1.0f);
+
+    XMStoreFloat4x4(&_worlds[slot], world);
+
+    const BOUNDS_INFO& bounds = _bounds[slot];
+    if (!bounds.SourceModel)
+    {
+        return;
+    }
+
+    XMMATRIX absWorld;
+    absWorld.r[0] = XMVectorAbs(world.r[0]);
+    absWorld.r[1] = XMVectorAbs(world.r[1]);
+    absWorld.r[2] = XMVectorAbs(world.r[2]);
+    absWorld.r[3] = XMVectorZero();
+
+    transformBox(bounds.SourceModel->GetAxisAlignedBox(), orientation, scale, world, absWorld,
+        &_axisBoxes[slot], &_orientedBoxes[slot]);
+
+    UINT meshCount = bounds.SourceModel->GetMeshCount();
+    for (UINT i = 0; i < meshCount; i++)
+    {
+        transformBox(bounds.SourceModel->GetMeshAxisAlignedBox(i), orientation, scale, world, absWorld,
+            &bounds.MeshAxisBoxes[i], &bounds.MeshOrientedBoxes[i]);
+    }
+}
+
+void TransformSystem::updateBlock(UINT blockIdx)
+{
+    const BLOCK_INFO& block = _blocks[blockIdx];
+    UINT end = block.Start + block.Count;
+
+    // Anything in the block that moved in the last update has stopped unless it changes again,
+    // either way its previous world is the world it has now
+    for (UINT i = block.Start; i < end; i++)
+    {
+        _prevWorlds[i] = _worlds[i];
+    }
+
+    if (!block.Dirty)
+    {
+        return;
+    }
+
+    // Parents come first so a change is pushed down to all descendants in one sweep
+    for (UINT i = block.Start; i < end; i++)
+    {
+        UINT parent = _parents[i];
+        _changedFlags[i] = _dirtyFlags[i] || (parent != INVALID_SLOT && _changedFlags[parent]);
+
+        if (_changedFlags[i])
+        {
+            updateSlot(i);
+        }
+    }
+
+    // Children come last so sweeping backwards merges every subtree into its parent before the
+    // parent is merged into its own
+    for (UINT i = block.Start; i < end; i++)
+    {
+        if (_bounds[i].SourceModel)
+        {
+            XMVECTOR center = XMLoadFloat3(&_axisBoxes[i].Center);
+            XMVECTOR extents = XMLoadFloat3(&_axisBoxes[i].Extents);
+
+            XMStoreFloat3(&_subtreeMins[i], XMVectorSubtract(center, extents));
+            XMStoreFloat3(&_subtreeMaxs[i], XMVectorAdd(center, extents));
+        }
+        else
+        {
+            _subtreeMins[i] = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+            _subtreeMaxs[i] = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        }
+    }
+    for (UINT i = end - 1; i > block.Start; i--)
+    {
+        UINT parent = _parents[i];
+
+        XMStoreFloat3(&_subtreeMins[parent], XMVectorMin(XMLoadFloat3(&_subtreeMins[parent]),
+            XMLoadFloat3(&_subtreeMins[i])));
+        XMStoreFloat3(&_subtreeMaxs[parent], XMVectorMax(XMLoadFloat3(&_subtreeMaxs[parent]),
+            XMLoadFloat3(&_subtreeMaxs[i])));
+    }
+}
+
+void TransformSystem::updateBlocks(UINT begin, UINT end)
+{
+    for (UINT i = begin; i < end; i++)
+    {
+        updateBlock(_blockJobs[i]);
+    }
+}
+
+void TransformSystem::Update(ThreadPool* threadPool)
+{
+    BEGIN_EVENT(L"Update transforms");
+
+    if (_layoutDirty)
+    {
+        rebuildLayout();
+        _layoutDirty = false;
+    }
+
+    // Blocks that moved in the last update still need their previous worlds caught up
+    _blockJobs.clear();
+    for (UINT i = 0; i < _blocks.size(); i++)
+    {
+        if (_blocks[i].Dirty || _blocks[i].Moved)
+        {
+            _blockJobs.push_back(i);
+        }
+    }
+
+    // Blocks only write to their own slots so they can be split freely
+    threadPool->ParallelFor(_blockJobs.size(), UPDATE_GRAIN_SIZE,
+        bind(mem_fn(&TransformSystem::updateBlocks), this, _1, _2));
+
+    for (UINT i = 0; i < _blockJobs.size(); i++)
+    {
+        BLOCK_INFO& block = _blocks[_blockJobs[i]];
+        if (block.Dirty)
+        {
+            for (UINT j = block.Start; j < block.Start + block.Count; j++)
+            {
+                // Something placed this update has not moved yet
+                if (_newFlags[j])
+                {
+                    _prevWorlds[j] = _worlds[j];
+                    _newFlags[j] = 0;
+                }
+                _dirtyFlags[j] = 0;
+                _changedFlags[j] = 0;
+            }
+        }
+
+        block.Moved = block.Dirty;
+        block.Dirty = false;
+    }
+
+    _updateCount++;
+
+    END_EVENT(L"");
+}
\ No newline at end of file
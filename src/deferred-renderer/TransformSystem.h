@@ -0,0 +1,125 @@
+#pragma once
+
+#include "PCH.h"
+#include "Model.h"
+#include "ThreadPool.h"
+#include "xnaCollision.h"
+
+// Owns the transforms of model instances, stored as one array per component. Changing a
+// transform only marks it dirty, the world matrices and bounds of everything that changed are
+// then rebuilt together in Update so that reading them is always free.
+//
+// Transforms can be parented to each other, positions, orientations and scales are then
+// relative to the parent. The arrays are kept sorted so that every root and its descendants
+// form one contiguous block with parents before children, which lets each block be updated in
+// a single forward sweep and its bounds refit in a single backward sweep. Blocks do not depend
+// on each other so they are split across the thread pool.
+class TransformSystem
+{
+public:
+    static const UINT INVALID_HANDLE = (UINT)-1;
+
+private:
+    static const UINT INVALID_SLOT = (UINT)-1;
+
+    struct BOUNDS_INFO
+    {
+        const Model* SourceModel;
+        AxisAlignedBox* MeshAxisBoxes;
+        OrientedBox* MeshOrientedBoxes;
+    };
+
+    struct BLOCK_INFO
+    {
+        UINT Start;
+        UINT Count;
+        bool Dirty;
+        bool Moved;
+    };
+
+    // Indexed by slot, slots are reordered whenever the hierarchy changes
+    std::vector<XMFLOAT3> _positions;
+    std::vector<XMFLOAT4> _orientations;
+    std::vector<float> _scales;
+    std::vector<UINT> _parents;
+
+    std::vector<XMFLOAT4> _worldOrientations;
+    std::vector<float> _worldScales;
+    std::vector<XMFLOAT4X4> _worlds;
+    std::vector<XMFLOAT4X4> _prevWorlds;
+    std::vector<AxisAlignedBox> _axisBoxes;
+    std::vector<OrientedBox> _orientedBoxes;
+    std::vector<XMFLOAT3> _subtreeMins;
+    std::vector<XMFLOAT3> _subtreeMaxs;
+    std::vector<BOUNDS_INFO> _bounds;
+
+    // Written from the update threads so these are bytes rather than packed bools
+    std::vector<BYTE> _dirtyFlags;
+    std::vector<BYTE> _changedFlags;
+    std::vector<BYTE> _newFlags;
+    std::vector<BYTE> _aliveFlags;
+
+    std::vector<UINT> _handles;
+    std::vector<UINT> _blockIndices;
+
+    // Indexed by handle, handles stay the same for the lifetime of a transform
+    std::vector<UINT> _slots;
+    std::vector<UINT> _freeHandles;
+
+    std::vector<BLOCK_INFO> _blocks;
+    std::vector<UINT> _blockJobs;
+    bool _layoutDirty;
+    UINT _updateCount;
+
+    static const UINT UPDATE_GRAIN_SIZE = 4;
+
+    UINT addSlot();
+    void markDirty(UINT slot);
+    void rebuildLayout();
+
+    void updateSlot(UINT slot);
+    void updateBlock(UINT blockIdx);
+    void updateBlocks(UINT begin, UINT end);
+
+public:
+    TransformSystem();
+
+    UINT Add();
+    void Remove(UINT handle);
+
+    // Children of a transform that is removed become roots, keeping their relative transforms.
+    // Returns false and leaves the parent as it was if the parent is one of its descendants.
+    bool SetParent(UINT handle, UINT parentHandle);
+    UINT GetParent(UINT handle) const;
+
+    // The model's boxes and the arrays to write each mesh's transformed boxes into, which must
+    // stay valid until the model is set again
+    void SetModel(UINT handle, const Model* model, AxisAlignedBox* meshAxisBoxes, OrientedBox* meshOrientedBoxes);
+
+    const XMFLOAT3& GetPosition(UINT handle) const { return _positions[_slots[handle]]; }
+    float GetScale(UINT handle) const { return _scales[_slots[handle]]; }
+    const XMFLOAT4& GetOrientation(UINT handle) const { return _orientations[_slots[handle]]; }
+
+    void SetPosition(UINT handle, const XMFLOAT3& pos);
+    void SetScale(UINT handle, float scale);
+    void SetOrientation(UINT handle, const XMFLOAT4& orientation);
+
+    const XMFLOAT4X4& GetWorld(UINT handle) const { return _worlds[_slots[handle]]; }
+    const XMFLOAT4X4& GetPreviousWorld(UINT handle) const { return _prevWorlds[_slots[handle]]; }
+    const AxisAlignedBox& GetAxisAlignedBox(UINT handle) const { return _axisBoxes[_slots[handle]]; }
+    const OrientedBox& GetOrientedBox(UINT handle) const { return _orientedBoxes[_slots[handle]]; }
+
+    // The bounds of a transform's model merged with those of all of its descendants
+    AxisAlignedBox GetSubtreeAxisAlignedBox(UINT handle) const;
+
+    UINT GetCount() const { return _slots.size() - _freeHandles.size(); }
+    UINT GetBlockCount() const { return _blocks.size(); }
+
+    // Rebuilds everything that changed since the last update, the previous world matrices are
+    // what the world matrices were before this call
+    void Update(ThreadPool* threadPool);
+
+    // Number of calls to Update, a change made since the last one is not yet reflected in
+    // the world matrices or bounds
+    UINT GetUpdateCount() const { return _updateCount; }
+};
\ No newline at end of file
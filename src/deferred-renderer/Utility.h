@@ -207,6 +207,20 @@ inline std::string WStringToAnsi(const std::wstring& input)
     return output;
 }
 
+inline std::string WStringToUTF8(const std::wstring& input)
+{
+    int size = WideCharToMultiByte(CP_UTF8, 0, input.c_str(), input.size(), NULL, 0, NULL, NULL);
+    if (size <= 0)
+    {
+        return std::string();
+    }
+
+    std::string output(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, input.c_str(), input.size(), &output[0], size, NULL, NULL);
+
+    return output;
+}
+
 inline int GetExtensionFromFileNameW(const WCHAR* fileName, WCHAR* output, UINT outputLength)
 {
     _ASSERT(fileName);